@@ -18,6 +18,9 @@ void Copter::run_rate_controller_main()
         motors->set_dt_s(last_loop_time_s);
         // only run the rate controller if we are not using the rate thread
         attitude_control->rate_controller_run();
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+        AP::scheduler().loop_trace.mark(AP::LoopTrace::Point::RATE_CONTROL);
+#endif
     }
     // reset sysid and other temporary inputs
     attitude_control->rate_controller_target_reset();
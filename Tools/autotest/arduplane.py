@@ -6589,6 +6589,7 @@ class AutoTestPlane(vehicle_test_suite.TestSuite):
         self.install_test_scripts_context([
             "math.lua",
             "strings.lua",
+            "userdata_alloc_bench.lua",
         ])
         self.install_example_script_context('simple_loop.lua')
         self.context_collect('STATUSTEXT')
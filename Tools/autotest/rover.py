@@ -5099,6 +5099,7 @@ Brakes have negligible effect (with=%0.2fm without=%0.2fm delta=%0.2fm)
             "scripting_require_test_2.lua",
             "math.lua",
             "strings.lua",
+            "userdata_alloc_bench.lua",
             "mavlink_test.lua",
         ])
 
@@ -5112,6 +5113,7 @@ Brakes have negligible effect (with=%0.2fm without=%0.2fm delta=%0.2fm)
                 "Require test 2 passed",
                 "Math tests passed",
                 "String tests passed",
+                "Userdata alloc tests passed",
                 "Received heartbeat from"
         ]:
             self.wait_statustext(success_text, check_context=True)
@@ -0,0 +1,141 @@
+# Copyright 2023 ArduPilot.org.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+# flake8: noqa
+
+"""
+Bring up ArduPilot SITL and check the event driven topics are published at their full rate.
+
+colcon test --packages-select ardupilot_dds_tests \
+--event-handlers=console_cohesion+ --pytest-args -k test_topic_rates
+
+"""
+
+import pytest
+import rclpy
+import rclpy.node
+import threading
+import time
+
+from launch_pytest.tools import process as process_tools
+
+from rclpy.qos import QoSProfile
+from rclpy.qos import QoSReliabilityPolicy
+from rclpy.qos import QoSHistoryPolicy
+
+from geometry_msgs.msg import PoseStamped
+from sensor_msgs.msg import Imu
+
+from launch_fixtures import (
+    launch_sitl_copter_dds_udp,
+)
+
+WAIT_FOR_START_TIMEOUT = 5.0
+MEASURE_TIME = 5.0
+
+# topic, type, minimum rate (Hz), largest gap between stamps (s)
+TOPICS = (
+    ("ap/imu/experimental/data", Imu, 100.0, 0.05),
+    ("ap/pose/filtered", PoseStamped, 20.0, 0.1),
+)
+
+
+def stamp_to_sec(stamp):
+    return stamp.sec + stamp.nanosec * 1.0e-9
+
+
+class RateListener(rclpy.node.Node):
+    """Count messages and the gaps between their stamps."""
+
+    def __init__(self):
+        """Initialise the node."""
+        super().__init__("rate_listener")
+        self.first_msg_event_object = threading.Event()
+        self.counts = {}
+        self.max_gap = {}
+        self.last_stamp = {}
+        self.lock = threading.Lock()
+
+    def start_subscriber(self):
+        """Start the subscribers."""
+        qos_profile = QoSProfile(
+            reliability=QoSReliabilityPolicy.BEST_EFFORT,
+            history=QoSHistoryPolicy.KEEP_LAST,
+            depth=10,
+        )
+        self.subscriptions_list = []
+        for topic, msg_type, _, _ in TOPICS:
+            self.counts[topic] = 0
+            self.max_gap[topic] = 0.0
+            self.subscriptions_list.append(
+                self.create_subscription(msg_type, topic, lambda msg, t=topic: self.subscriber_callback(t, msg), qos_profile)
+            )
+
+        # Add a spin thread.
+        self.ros_spin_thread = threading.Thread(target=lambda node: rclpy.spin(node), args=(self,))
+        self.ros_spin_thread.start()
+
+    def reset(self):
+        with self.lock:
+            for topic in self.counts:
+                self.counts[topic] = 0
+                self.max_gap[topic] = 0.0
+            self.last_stamp = {}
+
+    def subscriber_callback(self, topic, msg):
+        """Process a message."""
+        stamp = stamp_to_sec(msg.header.stamp)
+        with self.lock:
+            self.counts[topic] += 1
+            if topic in self.last_stamp:
+                self.max_gap[topic] = max(self.max_gap[topic], stamp - self.last_stamp[topic])
+            self.last_stamp[topic] = stamp
+        self.first_msg_event_object.set()
+
+
+@pytest.mark.launch(fixture=launch_sitl_copter_dds_udp)
+def test_dds_udp_topic_rates(launch_context, launch_sitl_copter_dds_udp):
+    """Test IMU and pose are published on new data at their full rate."""
+    _, actions = launch_sitl_copter_dds_udp
+    micro_ros_agent = actions["micro_ros_agent"].action
+    mavproxy = actions["mavproxy"].action
+    sitl = actions["sitl"].action
+
+    # Wait for process to start.
+    process_tools.wait_for_start_sync(launch_context, micro_ros_agent, timeout=WAIT_FOR_START_TIMEOUT)
+    process_tools.wait_for_start_sync(launch_context, mavproxy, timeout=WAIT_FOR_START_TIMEOUT)
+    process_tools.wait_for_start_sync(launch_context, sitl, timeout=WAIT_FOR_START_TIMEOUT)
+
+    rclpy.init()
+    try:
+        node = RateListener()
+        node.start_subscriber()
+        msgs_received_flag = node.first_msg_event_object.wait(timeout=10.0)
+        assert msgs_received_flag, "Did not receive any msgs."
+
+        # let discovery of all topics settle before measuring
+        time.sleep(2.0)
+        node.reset()
+        time.sleep(MEASURE_TIME)
+
+        with node.lock:
+            for topic, _, min_rate, max_gap in TOPICS:
+                rate = node.counts[topic] / MEASURE_TIME
+                node.get_logger().info(f"{topic}: {rate:.1f}Hz max gap {node.max_gap[topic]:.3f}s")
+                assert rate >= min_rate, f"'{topic}' rate {rate:.1f}Hz below {min_rate}Hz"
+                assert node.max_gap[topic] <= max_gap, f"'{topic}' gap {node.max_gap[topic]:.3f}s"
+    finally:
+        rclpy.shutdown()
+    yield
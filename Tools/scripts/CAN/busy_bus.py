@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+
+# flake8: noqa
+
+'''
+ flood a CAN bus with DroneCAN traffic nobody subscribes to, to
+ measure what unwanted frames cost the receiving DroneCAN driver
+
+ For SITL with CAN over multicast:
+   busy_bus.py mcast:0 --rate 4000
+ then compare the per frame costs in @SYS/dronecan_rx.txt and
+ @SYS/can0_stats.txt with CAN_D1_UC_OPTION bit 10 (acceptance
+ filters) clear and set
+'''
+
+import dronecan
+import random
+import time
+
+from argparse import ArgumentParser
+parser = ArgumentParser(description='DroneCAN busy bus generator')
+parser.add_argument("canport", default=None, type=str, help="CAN port, eg. mcast:0")
+parser.add_argument("--rate", default=2000, type=float, help="frames per second")
+parser.add_argument("--duration", default=0, type=float, help="seconds to run for, 0 for forever")
+parser.add_argument("--node", default=100, type=int, help="source node ID")
+parser.add_argument("--types", default=32, type=int, help="number of message types to use")
+parser.add_argument("--first-type", default=30000, type=int, help="first message type ID to use")
+parser.add_argument("--multi-frame", action='store_true', help="send three frame transfers")
+
+args = parser.parse_args()
+
+print("Connecting to %s" % args.canport)
+driver = dronecan.driver.make_driver(args.canport)
+
+def frame_id(priority, type_id, node):
+    '''29 bit id of a message frame'''
+    return (priority << 24) | (type_id << 8) | node
+
+def tail_byte(start, end, toggle, tid):
+    return (start << 7) | (end << 6) | (toggle << 5) | (tid & 0x1F)
+
+transfer_ids = {}
+
+def send_transfer(type_id):
+    tid = transfer_ids.get(type_id, 0)
+    transfer_ids[type_id] = (tid + 1) % 32
+    fid = frame_id(24, type_id, args.node)
+    if not args.multi_frame:
+        data = bytes(random.getrandbits(8) for _ in range(7)) + bytes([tail_byte(1, 1, 0, tid)])
+        driver.send(fid, data, extended=True)
+        return 1
+    # the CRC isn't checked until the last frame, by which point the
+    # frames have already cost the receiver, so it needn't be correct
+    for i in range(3):
+        data = bytes(random.getrandbits(8) for _ in range(7)) + bytes([tail_byte(int(i == 0), int(i == 2), i % 2, tid)])
+        driver.send(fid, data, extended=True)
+    return 3
+
+tstart = time.time()
+sent = 0
+last_print = tstart
+while args.duration <= 0 or time.time() - tstart < args.duration:
+    type_id = args.first_type + random.randrange(args.types)
+    sent += send_transfer(type_id)
+
+    # hold the requested average rate
+    ahead = sent / args.rate - (time.time() - tstart)
+    if ahead > 0:
+        time.sleep(ahead)
+
+    now = time.time()
+    if now - last_print >= 5:
+        print("sent %u frames, %.0f frames/s" % (sent, sent / (now - tstart)))
+        last_print = now
@@ -18,14 +18,21 @@ data = open(args.file,'rb').read()
 last_name = ""
 
 magic = 0x671b
+magic_with_default = 0x671c
+magic_versioned = 0x671d
+magic_versioned_with_default = 0x671e
 
-# header of 6 bytes
+# header of 6 bytes, or 10 bytes for a versioned file from param.pck?since=N
 magic2,num_params,total_params = struct.unpack("<HHH", data[0:6])
-if magic != magic2:
+if magic2 in [magic_versioned, magic_versioned_with_default]:
+    version, = struct.unpack("<I", data[6:10])
+    print("Snapshot version %u" % version)
+    data = data[10:]
+elif magic2 not in [magic, magic_with_default]:
     print("Bad magic 0x%x expected 0x%x" % (magic2, magic))
     sys.exit(1)
-
-data = data[6:]
+else:
+    data = data[6:]
 
 # mapping of data type to type length and format
 data_types = {
@@ -67,6 +74,9 @@ while True:
     name = last_name[0:common_len] + data[2:2+name_len].decode('utf-8')
     vdata = data[2+name_len:2+name_len+type_len]
     last_name = name
+    if flags & 1:
+        # default value follows
+        data = data[type_len:]
     data = data[2+name_len+type_len:]
     v, = struct.unpack("<" + type_format, vdata)
     count += 1
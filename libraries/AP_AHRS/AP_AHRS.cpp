@@ -36,6 +36,7 @@
 #include <AP_Logger/AP_Logger.h>
 #include <AP_Notify/AP_Notify.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
+#include <AP_Scheduler/AP_Scheduler.h>
 #include <GCS_MAVLink/GCS.h>
 #include <AP_InertialSensor/AP_InertialSensor.h>
 #include <AP_CustomRotations/AP_CustomRotations.h>
@@ -452,6 +453,10 @@ void AP_AHRS::update(bool skip_ins_update)
 #endif
     }
 
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    AP::scheduler().loop_trace.mark(AP::LoopTrace::Point::AHRS_UPDATE);
+#endif
+
 #if AP_MODULE_SUPPORTED
     // call AHRS_update hook if any
     AP_Module::call_hook_AHRS_update(*this);
@@ -945,12 +945,7 @@ void AP_RunCam::send_packet(Command command, uint8_t param)
         buffer[2] = param;
     }
 
-    uint8_t crc = 0;
-    for (uint8_t i = 0; i < buffer_len - 1; i++) {
-        crc = crc8_dvb_s2(crc, buffer[i]);
-    }
-
-    buffer[buffer_len - 1] = crc;
+    buffer[buffer_len - 1] = crc8_dvb_s2_update(0, buffer, buffer_len - 1);
 
     // send data if possible
     uart->write(buffer, buffer_len);
@@ -1050,11 +1045,7 @@ AP_RunCam::Request::Request(AP_RunCam* device, Command commandID, uint8_t param,
 
 uint8_t AP_RunCam::Request::get_crc() const
 {
-    uint8_t crc = 0;
-    for (int i = 0; i < _recv_response_length; i++) {
-        crc = crc8_dvb_s2(crc, _recv_buf[i]);
-    }
-    return crc;
+    return crc8_dvb_s2_update(0, _recv_buf, _recv_response_length);
 }
 
 // get the length of a response
@@ -20,6 +20,7 @@
 # endif // AP_DDS_ARM_SERVER_ENABLED
 #include <AP_Vehicle/AP_Vehicle.h>
 #include <AP_Common/AP_FWVersion.h>
+#include <AP_Common/ExpandingString.h>
 #include <AP_ExternalControl/AP_ExternalControl_config.h>
 
 #if AP_DDS_ARM_SERVER_ENABLED
@@ -172,6 +173,8 @@ const AP_Param::GroupInfo AP_DDS_Client::var_info[] {
     AP_GROUPEND
 };
 
+AP_DDS_Client *AP_DDS_Client::_singleton;
+
 #if AP_DDS_STATIC_TF_PUB_ENABLED | AP_DDS_LOCAL_POSE_PUB_ENABLED | AP_DDS_GEOPOSE_PUB_ENABLED | AP_DDS_IMU_PUB_ENABLED
 static void initialize(geometry_msgs_msg_Quaternion& q)
 {
@@ -770,6 +773,11 @@ bool AP_DDS_Client::start(void)
         return true;
     }
 
+#if AP_DDS_TOPIC_STATS_ENABLED
+    topic_stats = NEW_NOTHROW TopicStats[ARRAY_SIZE(topics)];
+#endif
+    _singleton = this;
+
     if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&AP_DDS_Client::main_loop, void),
                                       "DDS",
                                       8192, AP_HAL::Scheduler::PRIORITY_IO, 1)) {
@@ -1250,6 +1258,17 @@ void AP_DDS_Client::main_loop(void)
             return;
         }
         connected = true;
+#if AP_DDS_TOPIC_STATS_ENABLED
+        {
+            WITH_SEMAPHORE(csem);
+            if (topic_stats != nullptr) {
+                memset(topic_stats, 0, sizeof(TopicStats) * ARRAY_SIZE(topics));
+            }
+            stats_start_ms = AP_HAL::millis();
+            flushes = 0;
+            flushed_topics = 0;
+        }
+#endif
         GCS_SEND_TEXT(MAV_SEVERITY_INFO, "%s Initialization passed", msg_prefix);
 
 #if AP_DDS_STATIC_TF_PUB_ENABLED
@@ -1261,7 +1280,12 @@ void AP_DDS_Client::main_loop(void)
         uint8_t num_pings_missed{0};
         bool had_ping_reply{false};
         while (connected) {
+#if AP_DDS_EVENT_DRIVEN_ENABLED
+            // wake for new data, or after 1ms for the timed topics
+            IGNORE_RETURN(data_ready_sem.wait(1000));
+#else
             hal.scheduler->delay(1);
+#endif
 
             // publish topics
             update();
@@ -1501,6 +1525,9 @@ void AP_DDS_Client::write_time_topic()
         const uint32_t topic_size = builtin_interfaces_msg_Time_size_of_topic(&time_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::TIME_PUB)].dw_id, &ub, topic_size);
         const bool success = builtin_interfaces_msg_Time_serialize_topic(&ub, &time_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::TIME_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: XRCE_Client failed to serialize");
@@ -1517,6 +1544,9 @@ void AP_DDS_Client::write_nav_sat_fix_topic()
         const uint32_t topic_size = sensor_msgs_msg_NavSatFix_size_of_topic(&nav_sat_fix_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::NAV_SAT_FIX_PUB)].dw_id, &ub, topic_size);
         const bool success = sensor_msgs_msg_NavSatFix_serialize_topic(&ub, &nav_sat_fix_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::NAV_SAT_FIX_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
@@ -1534,6 +1564,9 @@ void AP_DDS_Client::write_static_transforms()
         const uint32_t topic_size = tf2_msgs_msg_TFMessage_size_of_topic(&tx_static_transforms_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::STATIC_TRANSFORMS_PUB)].dw_id, &ub, topic_size);
         const bool success = tf2_msgs_msg_TFMessage_serialize_topic(&ub, &tx_static_transforms_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::STATIC_TRANSFORMS_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
@@ -1551,6 +1584,9 @@ void AP_DDS_Client::write_battery_state_topic()
         const uint32_t topic_size = sensor_msgs_msg_BatteryState_size_of_topic(&battery_state_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::BATTERY_STATE_PUB)].dw_id, &ub, topic_size);
         const bool success = sensor_msgs_msg_BatteryState_serialize_topic(&ub, &battery_state_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::BATTERY_STATE_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
@@ -1568,6 +1604,9 @@ void AP_DDS_Client::write_local_pose_topic()
         const uint32_t topic_size = geometry_msgs_msg_PoseStamped_size_of_topic(&local_pose_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::LOCAL_POSE_PUB)].dw_id, &ub, topic_size);
         const bool success = geometry_msgs_msg_PoseStamped_serialize_topic(&ub, &local_pose_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::LOCAL_POSE_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
@@ -1585,6 +1624,9 @@ void AP_DDS_Client::write_tx_local_velocity_topic()
         const uint32_t topic_size = geometry_msgs_msg_TwistStamped_size_of_topic(&tx_local_velocity_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::LOCAL_VELOCITY_PUB)].dw_id, &ub, topic_size);
         const bool success = geometry_msgs_msg_TwistStamped_serialize_topic(&ub, &tx_local_velocity_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::LOCAL_VELOCITY_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
@@ -1601,6 +1643,9 @@ void AP_DDS_Client::write_tx_local_airspeed_topic()
         const uint32_t topic_size = ardupilot_msgs_msg_Airspeed_size_of_topic(&tx_local_airspeed_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::LOCAL_AIRSPEED_PUB)].dw_id, &ub, topic_size);
         const bool success = ardupilot_msgs_msg_Airspeed_serialize_topic(&ub, &tx_local_airspeed_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::LOCAL_AIRSPEED_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
@@ -1617,6 +1662,9 @@ void AP_DDS_Client::write_tx_local_rc_topic()
         const uint32_t topic_size = ardupilot_msgs_msg_Rc_size_of_topic(&tx_local_rc_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::LOCAL_RC_PUB)].dw_id, &ub, topic_size);
         const bool success = ardupilot_msgs_msg_Rc_serialize_topic(&ub, &tx_local_rc_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::LOCAL_RC_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize\n");
@@ -1633,6 +1681,9 @@ void AP_DDS_Client::write_imu_topic()
         const uint32_t topic_size = sensor_msgs_msg_Imu_size_of_topic(&imu_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::IMU_PUB)].dw_id, &ub, topic_size);
         const bool success = sensor_msgs_msg_Imu_serialize_topic(&ub, &imu_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::IMU_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
@@ -1650,6 +1701,9 @@ void AP_DDS_Client::write_geo_pose_topic()
         const uint32_t topic_size = geographic_msgs_msg_GeoPoseStamped_size_of_topic(&geo_pose_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::GEOPOSE_PUB)].dw_id, &ub, topic_size);
         const bool success = geographic_msgs_msg_GeoPoseStamped_serialize_topic(&ub, &geo_pose_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::GEOPOSE_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
@@ -1667,6 +1721,9 @@ void AP_DDS_Client::write_clock_topic()
         const uint32_t topic_size = rosgraph_msgs_msg_Clock_size_of_topic(&clock_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::CLOCK_PUB)].dw_id, &ub, topic_size);
         const bool success = rosgraph_msgs_msg_Clock_serialize_topic(&ub, &clock_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::CLOCK_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
@@ -1684,6 +1741,9 @@ void AP_DDS_Client::write_gps_global_origin_topic()
         const uint32_t topic_size = geographic_msgs_msg_GeoPointStamped_size_of_topic(&gps_global_origin_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::GPS_GLOBAL_ORIGIN_PUB)].dw_id, &ub, topic_size);
         const bool success = geographic_msgs_msg_GeoPointStamped_serialize_topic(&ub, &gps_global_origin_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::GPS_GLOBAL_ORIGIN_PUB), topic_size, success);
+#endif
         if (!success) {
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
         }
@@ -1700,6 +1760,9 @@ void AP_DDS_Client::write_goal_topic()
         const uint32_t topic_size = geographic_msgs_msg_GeoPointStamped_size_of_topic(&goal_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::GOAL_PUB)].dw_id, &ub, topic_size);
         const bool success = geographic_msgs_msg_GeoPointStamped_serialize_topic(&ub, &goal_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::GOAL_PUB), topic_size, success);
+#endif
         if (!success) {
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
         }
@@ -1716,6 +1779,9 @@ void AP_DDS_Client::write_status_topic()
         const uint32_t topic_size = ardupilot_msgs_msg_Status_size_of_topic(&status_topic, 0);
         uxr_prepare_output_stream(&session, reliable_out, topics[to_underlying(TopicIndex::STATUS_PUB)].dw_id, &ub, topic_size);
         const bool success = ardupilot_msgs_msg_Status_serialize_topic(&ub, &status_topic);
+#if AP_DDS_TOPIC_STATS_ENABLED
+        topic_written(to_underlying(TopicIndex::STATUS_PUB), topic_size, success);
+#endif
         if (!success) {
             // TODO sometimes serialization fails on bootup. Determine why.
             // AP_HAL::panic("FATAL: DDS_Client failed to serialize");
@@ -1724,10 +1790,100 @@ void AP_DDS_Client::write_status_topic()
 }
 #endif // AP_DDS_STATUS_PUB_ENABLED
 
+#if AP_DDS_EVENT_DRIVEN_ENABLED
+void AP_DDS_Client::data_ready(uint8_t events)
+{
+    last_event_us = AP_HAL::micros();
+    pending_events |= events;
+    data_ready_sem.signal();
+}
+#endif // AP_DDS_EVENT_DRIVEN_ENABLED
+
+/*
+  once the vehicle signals data, a topic fed by an event goes out on
+  the first event after its minimum interval, so it carries the
+  newest data with the least delay. Until then, and for topics with
+  no event, it is published on the interval
+ */
+bool AP_DDS_Client::publish_due(uint8_t event, uint64_t last_ms, uint16_t delay_ms, uint64_t now_ms)
+{
+#if AP_DDS_EVENT_DRIVEN_ENABLED
+    if (events_seen && event != EVENT_NONE) {
+        if ((current_events & event) == 0 || now_ms - last_ms < delay_ms) {
+            return false;
+        }
+        event_data_us = current_event_us;
+        return true;
+    }
+#endif
+    event_data_us = 0;
+    return now_ms - last_ms > delay_ms;
+}
+
+#if AP_DDS_TOPIC_STATS_ENABLED
+void AP_DDS_Client::topic_written(uint8_t index, uint32_t size, bool success)
+{
+    if (topic_stats == nullptr) {
+        return;
+    }
+    TopicStats &ts = topic_stats[index];
+    if (!success) {
+        ts.failures++;
+        return;
+    }
+    ts.count++;
+    ts.bytes += size;
+    unflushed_topics++;
+    if (event_data_us != 0) {
+        const uint32_t latency_us = AP_HAL::micros() - event_data_us;
+        ts.latency_sum_us += latency_us;
+        ts.latency_max_us = MAX(ts.latency_max_us, latency_us);
+        ts.latency_count++;
+        event_data_us = 0;
+    }
+}
+
+void AP_DDS_Client::topic_info(ExpandingString &str)
+{
+    WITH_SEMAPHORE(csem);
+    if (topic_stats == nullptr) {
+        return;
+    }
+    const float dt = (AP_HAL::millis() - stats_start_ms) * 0.001f;
+    str.printf("flushes=%u topics/flush=%.2f\n",
+               unsigned(flushes),
+               flushes > 0 ? double(flushed_topics) / flushes : 0.0);
+    for (uint8_t i=0; i<ARRAY_SIZE(topics); i++) {
+        if (topics[i].topic_rw != Topic_rw::DataWriter) {
+            continue;
+        }
+        const TopicStats &ts = topic_stats[i];
+        str.printf("%s count=%u rate=%.1fHz bytes=%u fail=%u",
+                   topics[i].topic_name,
+                   unsigned(ts.count),
+                   dt > 0 ? double(ts.count / dt) : 0.0,
+                   unsigned(ts.bytes),
+                   unsigned(ts.failures));
+        if (ts.latency_count > 0) {
+            str.printf(" latency avg=%uus max=%uus",
+                       unsigned(ts.latency_sum_us / ts.latency_count),
+                       unsigned(ts.latency_max_us));
+        }
+        str.printf("\n");
+    }
+}
+#endif // AP_DDS_TOPIC_STATS_ENABLED
+
 void AP_DDS_Client::update()
 {
     WITH_SEMAPHORE(csem);
     const auto cur_time_ms = AP_HAL::millis64();
+#if AP_DDS_EVENT_DRIVEN_ENABLED
+    current_events = pending_events.exchange(0);
+    current_event_us = last_event_us;
+    events_seen |= (current_events != 0);
+#endif
+    event_data_us = 0;
 
 #if AP_DDS_TIME_PUB_ENABLED
     if (cur_time_ms - last_time_time_ms > DELAY_TIME_TOPIC_MS) {
@@ -1755,14 +1911,14 @@ void AP_DDS_Client::update()
     }
 #endif // AP_DDS_BATTERY_STATE_PUB_ENABLED
 #if AP_DDS_LOCAL_POSE_PUB_ENABLED
-    if (cur_time_ms - last_local_pose_time_ms > DELAY_LOCAL_POSE_TOPIC_MS) {
+    if (publish_due(EVENT_EKF, last_local_pose_time_ms, DELAY_LOCAL_POSE_TOPIC_MS, cur_time_ms)) {
         update_topic(local_pose_topic);
         last_local_pose_time_ms = cur_time_ms;
         write_local_pose_topic();
     }
 #endif // AP_DDS_LOCAL_POSE_PUB_ENABLED
 #if AP_DDS_LOCAL_VEL_PUB_ENABLED
-    if (cur_time_ms - last_local_velocity_time_ms > DELAY_LOCAL_VELOCITY_TOPIC_MS) {
+    if (publish_due(EVENT_EKF, last_local_velocity_time_ms, DELAY_LOCAL_VELOCITY_TOPIC_MS, cur_time_ms)) {
         update_topic(tx_local_velocity_topic);
         last_local_velocity_time_ms = cur_time_ms;
         write_tx_local_velocity_topic();
@@ -1785,14 +1941,14 @@ void AP_DDS_Client::update()
     }
 #endif // AP_DDS_RC_PUB_ENABLED
 #if AP_DDS_IMU_PUB_ENABLED
-    if (cur_time_ms - last_imu_time_ms > DELAY_IMU_TOPIC_MS) {
+    if (publish_due(EVENT_IMU, last_imu_time_ms, DELAY_IMU_TOPIC_MS, cur_time_ms)) {
         update_topic(imu_topic);
         last_imu_time_ms = cur_time_ms;
         write_imu_topic();
     }
 #endif // AP_DDS_IMU_PUB_ENABLED
 #if AP_DDS_GEOPOSE_PUB_ENABLED
-    if (cur_time_ms - last_geo_pose_time_ms > DELAY_GEO_POSE_TOPIC_MS) {
+    if (publish_due(EVENT_EKF, last_geo_pose_time_ms, DELAY_GEO_POSE_TOPIC_MS, cur_time_ms)) {
         update_topic(geo_pose_topic);
         last_geo_pose_time_ms = cur_time_ms;
         write_geo_pose_topic();
@@ -1829,7 +1985,21 @@ void AP_DDS_Client::update()
     }
 #endif // AP_DDS_STATUS_PUB_ENABLED
 
+#if AP_DDS_TOPIC_STATS_ENABLED
+    if (unflushed_topics > 0) {
+        // everything written above goes out in this one flush
+        flushes++;
+        flushed_topics += unflushed_topics;
+        unflushed_topics = 0;
+    }
+#endif
+
+#if AP_DDS_EVENT_DRIVEN_ENABLED
+    // the thread has already waited for data, so don't wait here
+    status_ok = uxr_run_session_time(&session, 0);
+#else
     status_ok = uxr_run_session_time(&session, 1);
+#endif
 }
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_CHIBIOS
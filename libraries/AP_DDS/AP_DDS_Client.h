@@ -68,6 +68,8 @@
 
 #include "fcntl.h"
 
+#include <atomic>
+
 #include <AP_Param/AP_Param.h>
 
 #define DDS_MTU             512
@@ -81,6 +83,8 @@
 
 extern const AP_HAL::HAL& hal;
 
+class ExpandingString;
+
 class AP_DDS_Client
 {
 
@@ -246,6 +250,43 @@ private:
 #endif // AP_DDS_DYNAMIC_TF_SUB_ENABLED
     HAL_Semaphore csem;
 
+#if AP_DDS_EVENT_DRIVEN_ENABLED
+    // signalled by data_ready() to wake the DDS thread
+    HAL_BinarySemaphore data_ready_sem;
+    std::atomic<uint8_t> pending_events;
+    std::atomic<uint32_t> last_event_us;
+    // events taken by the current update()
+    uint8_t current_events;
+    uint32_t current_event_us;
+    // true once the vehicle has signalled data, until then all topics are polled
+    bool events_seen;
+#endif
+    // when the data for the topic about to be written became
+    // available, zero if not known
+    uint32_t event_data_us;
+    //! @brief Return true if a topic fed by event should be published
+    bool publish_due(uint8_t event, uint64_t last_ms, uint16_t delay_ms, uint64_t now_ms);
+
+#if AP_DDS_TOPIC_STATS_ENABLED
+    struct TopicStats {
+        uint32_t count;
+        uint32_t failures;
+        uint32_t bytes;
+        uint32_t latency_sum_us;
+        uint32_t latency_max_us;
+        uint32_t latency_count;
+    } *topic_stats;
+    uint32_t stats_start_ms;
+    // stream flushes which carried topics, and the topics they carried
+    uint32_t flushes;
+    uint32_t flushed_topics;
+    uint8_t unflushed_topics;
+    //! @brief Account for a topic written to the output stream
+    void topic_written(uint8_t index, uint32_t size, bool success);
+#endif
+
+    static AP_DDS_Client *_singleton;
+
 #if AP_DDS_PARAMETER_SERVER_ENABLED
     static rcl_interfaces_srv_SetParameters_Request set_parameter_request;
     static rcl_interfaces_srv_SetParameters_Response set_parameter_response;
@@ -331,6 +372,26 @@ public:
     //! @brief Update the internally stored DDS messages with latest data
     void update();
 
+    //! @brief Data ready events, signalled by the vehicle
+    enum DataEvent : uint8_t {
+        EVENT_NONE = 0,
+        EVENT_IMU = (1U<<0), // new IMU sample
+        EVENT_EKF = (1U<<1), // new AHRS output
+    };
+
+#if AP_DDS_EVENT_DRIVEN_ENABLED
+    //! @brief Called from the main loop when new data is available,
+    //         wakes the DDS thread to publish the topics fed by it
+    void data_ready(uint8_t events);
+#endif
+
+#if AP_DDS_TOPIC_STATS_ENABLED
+    //! @brief Per topic publish statistics
+    void topic_info(ExpandingString &str);
+#endif
+
+    static AP_DDS_Client *get_singleton() { return _singleton; }
+
     //! @brief GCS message prefix
     static constexpr const char* msg_prefix = "DDS:";
 
@@ -165,6 +165,17 @@
 #define AP_DDS_ARM_CHECK_SERVER_ENABLED 1
 #endif
 
+// publish IMU and state estimate topics when the vehicle signals new
+// data, rather than on a timer
+#ifndef AP_DDS_EVENT_DRIVEN_ENABLED
+#define AP_DDS_EVENT_DRIVEN_ENABLED 1
+#endif
+
+// per topic publish counts, rates and latency in @SYS/dds_topics.txt
+#ifndef AP_DDS_TOPIC_STATS_ENABLED
+#define AP_DDS_TOPIC_STATS_ENABLED 1
+#endif
+
 // Whether to include Twist support
 #define AP_DDS_NEEDS_TWIST AP_DDS_VEL_CTRL_ENABLED || AP_DDS_LOCAL_VEL_PUB_ENABLED
 
@@ -10,10 +10,21 @@ extern const AP_HAL::HAL& hal;
 #define LOG_TAG "DroneCANIface"
 #include <canard.h>
 #include <AP_CANManager/AP_CANSensor.h>
+#include <AP_Common/ExpandingString.h>
 
 #define DEBUG_PKTS 0
 
 #define CANARD_MSG_TYPE_FROM_ID(x)                         ((uint16_t)(((x) >> 8U)  & 0xFFFFU))
+#define CANARD_DEST_ID_FROM_ID(x)                          ((uint8_t)(((x) >> 8U)  & 0x7FU))
+
+// frame id fields used by the acceptance filters
+#define CANARD_FILTER_SOURCE_MASK                          0x7FU
+#define CANARD_FILTER_SERVICE_BIT                          0x80U
+#define CANARD_FILTER_MSG_TYPE_MASK                        (0xFFFFU << 8U)
+#define CANARD_FILTER_DEST_MASK                            (0x7FU << 8U)
+
+// message ids searched per call while building acceptance filters
+#define CANARD_FILTER_PROBE_STEP                           2048U
 
 DEFINE_HANDLER_LIST_HEADS();
 DEFINE_HANDLER_LIST_SEMAPHORES();
@@ -186,7 +197,77 @@ bool CanardInterface::shouldAcceptTransfer(const CanardInstance* ins,
                                            CanardTransferType transfer_type,
                                            uint8_t source_node_id) {
     CanardInterface* iface = (CanardInterface*) ins->user_reference;
-    return iface->accept_message(data_type_id, transfer_type, *out_data_type_signature);
+    return iface->accept_transfer(data_type_id, transfer_type, *out_data_type_signature);
+}
+
+/*
+  look up whether we have a handler for a transfer, searching the
+  handler lists only the first time a transfer type is seen. Must be
+  called with _sem_rx held
+ */
+bool CanardInterface::accept_transfer(uint16_t data_type_id, CanardTransferType transfer_type, uint64_t &signature)
+{
+    if (dispatch_stale) {
+        dispatch_stale = false;
+        memset(dispatch, 0, sizeof(dispatch));
+    }
+
+    const uint32_t key = ((uint32_t(transfer_type) << 16) | data_type_id) + 1;
+    const uint32_t mask = AP_DRONECAN_DISPATCH_CACHE_SIZE - 1;
+    const uint32_t home = ((key * 2654435761U) >> 16) & mask;
+    const uint32_t now_ms = AP_HAL::millis();
+
+    DispatchEntry *entry = nullptr;
+    for (uint32_t i=0; i<AP_DRONECAN_DISPATCH_CACHE_SIZE; i++) {
+        DispatchEntry &e = dispatch[(home + i) & mask];
+        if (e.key == key) {
+            if (e.accept || now_ms - e.checked_ms < AP_DRONECAN_DISPATCH_RECHECK_MS) {
+                rx_cost.cache_hits++;
+                signature = e.signature;
+                return e.accept;
+            }
+            entry = &e;
+            break;
+        }
+        if (e.key == 0) {
+            entry = &e;
+            break;
+        }
+    }
+    if (entry == nullptr) {
+        // cache is full, replace the entry in our home slot
+        entry = &dispatch[home];
+    }
+
+    rx_cost.cache_misses++;
+    uint64_t sig = 0;
+    const bool accept = accept_message(data_type_id, transfer_type, sig);
+    entry->key = key;
+    entry->signature = sig;
+    entry->checked_ms = now_ms;
+    entry->accept = accept;
+    signature = sig;
+    return accept;
+}
+
+/*
+  return false for extended frames which can't be for us, without
+  handing them to libcanard. Must be called with _sem_rx held
+ */
+bool CanardInterface::frame_wanted(uint32_t id)
+{
+    const CanardTransferType transfer_type = extractTransferType(id);
+    if (transfer_type != CanardTransferTypeBroadcast &&
+        CANARD_DEST_ID_FROM_ID(id) != canard.node_id) {
+        protocol_stats.rx_ignored_wrong_address++;
+        return false;
+    }
+    uint64_t signature;
+    if (!accept_transfer(extractDataType(id), transfer_type, signature)) {
+        protocol_stats.rx_ignored_not_wanted++;
+        return false;
+    }
+    return true;
 }
 
 #if AP_TEST_DRONECAN_DRIVERS
@@ -232,9 +313,10 @@ void CanardInterface::processTx(bool raw_commands_only = false) {
         // scan through list of pending transfers
         while (true) {
             auto txf = &txq->frame;
-            if (raw_commands_only &&
-                CANARD_MSG_TYPE_FROM_ID(txf->id) != UAVCAN_EQUIPMENT_ESC_RAWCOMMAND_ID &&
-                CANARD_MSG_TYPE_FROM_ID(txf->id) != COM_HOBBYWING_ESC_RAWCOMMAND_ID) {
+            const bool is_raw_command =
+                CANARD_MSG_TYPE_FROM_ID(txf->id) == UAVCAN_EQUIPMENT_ESC_RAWCOMMAND_ID ||
+                CANARD_MSG_TYPE_FROM_ID(txf->id) == COM_HOBBYWING_ESC_RAWCOMMAND_ID;
+            if (raw_commands_only && !is_raw_command) {
                 // look at next transfer
                 txq = txq->next;
                 if (txq == nullptr) {
@@ -262,7 +344,8 @@ void CanardInterface::processTx(bool raw_commands_only = false) {
                 }
             } else if ((txf->iface_mask & (1U<<iface)) && (AP_HAL::micros64() < txf->deadline_usec)) {
                 // try sending to interfaces, clearing the mask if we succeed
-                if (ifaces[iface]->send(txmsg, txf->deadline_usec, 0) > 0) {
+                const AP_HAL::CANIface::CanIOFlags flags = is_raw_command ? AP_HAL::CANIface::IsActuatorCommand : 0;
+                if (ifaces[iface]->send(txmsg, txf->deadline_usec, flags) > 0) {
                     txf->iface_mask &= ~(1U<<iface);
                 } else {
                     // if we fail to send then we try sending on next interface
@@ -368,6 +451,13 @@ void CanardInterface::processRx() {
             {
                 WITH_SEMAPHORE(_sem_rx);
 
+                const uint32_t start_us = AP_HAL::micros();
+                if (!frame_wanted(rx_frame.id)) {
+                    rx_cost.dropped++;
+                    rx_cost.dropped_us += AP_HAL::micros() - start_us;
+                    continue;
+                }
+
                 const int16_t res = canardHandleRxFrame(&canard, &rx_frame, timestamp);
                 if (res == -CANARD_ERROR_RX_MISSED_START) {
                     // this might remaining frames from a message that we don't accept, so check
@@ -384,11 +474,137 @@ void CanardInterface::processRx() {
                 } else {
                     update_rx_protocol_stats(res);
                 }
+                rx_cost.wanted++;
+                rx_cost.wanted_us += AP_HAL::micros() - start_us;
             }
         }
     }
 }
 
+/*
+  add an acceptance filter, merging the two closest filters first if
+  the list is full
+ */
+void CanardInterface::add_filter(uint32_t id, uint32_t mask)
+{
+    if (filter_count >= AP_DRONECAN_MAX_FILTERS) {
+        merge_closest_filters(filter_list, filter_count);
+    }
+    filter_list[filter_count].id = id;
+    filter_list[filter_count].mask = mask;
+    filter_count++;
+}
+
+/*
+  replace the pair of filters whose merged mask keeps the most id
+  bits with the merged filter. Merging only ever accepts more frames
+ */
+void CanardInterface::merge_closest_filters(AP_HAL::CANIface::CanFilterConfig *filters, uint8_t &count)
+{
+    if (count < 2) {
+        return;
+    }
+    uint8_t best_a = 0;
+    uint8_t best_b = 1;
+    int16_t best_bits = -1;
+    uint32_t best_mask = 0;
+    for (uint8_t a=0; a<count; a++) {
+        for (uint8_t b=a+1; b<count; b++) {
+            const uint32_t mask = filters[a].mask & filters[b].mask & ~(filters[a].id ^ filters[b].id);
+            const int16_t bits = __builtin_popcount(mask);
+            if (bits > best_bits) {
+                best_bits = bits;
+                best_mask = mask;
+                best_a = a;
+                best_b = b;
+            }
+        }
+    }
+    filters[best_a].mask = best_mask;
+    filters[best_a].id &= best_mask;
+    filters[best_b] = filters[count-1];
+    count--;
+}
+
+/*
+  generate acceptance filters for everything we handle: each
+  subscribed message type, services addressed to us, anonymous
+  messages for node allocation and 11 bit frames when an auxillary
+  driver wants them. The handler lists are searched a slice of
+  message ids per call, and the filters are given to the interfaces
+  once the search is complete
+ */
+void CanardInterface::update_filters(void)
+{
+    const uint32_t eff = AP_HAL::CANFrame::FlagEFF;
+    if (filters_stale) {
+        filters_stale = false;
+        if (filter_list == nullptr) {
+            filter_list = NEW_NOTHROW AP_HAL::CANIface::CanFilterConfig[AP_DRONECAN_MAX_FILTERS];
+            if (filter_list == nullptr) {
+                return;
+            }
+        }
+        filter_count = 0;
+        filter_probe_id = 0;
+        filters_building = true;
+        add_filter(eff | CANARD_FILTER_SERVICE_BIT | (uint32_t(canard.node_id) << 8U),
+                   eff | CANARD_FILTER_SERVICE_BIT | CANARD_FILTER_DEST_MASK);
+        add_filter(eff,
+                   eff | CANARD_FILTER_SERVICE_BIT | CANARD_FILTER_SOURCE_MASK);
+        if (aux_11bit_driver != nullptr) {
+            add_filter(0, eff);
+        }
+    }
+    if (!filters_building) {
+        return;
+    }
+
+    const uint32_t end = MIN(filter_probe_id + CANARD_FILTER_PROBE_STEP, 0x10000U);
+    for (; filter_probe_id < end; filter_probe_id++) {
+        uint64_t signature;
+        if (accept_message(uint16_t(filter_probe_id), CanardTransferTypeBroadcast, signature)) {
+            add_filter(eff | (filter_probe_id << 8U),
+                       eff | CANARD_FILTER_SERVICE_BIT | CANARD_FILTER_MSG_TYPE_MASK);
+        }
+    }
+    if (filter_probe_id < 0x10000U) {
+        return;
+    }
+    filters_building = false;
+
+    for (uint8_t i=0; i<num_ifaces; i++) {
+        if (ifaces[i] == nullptr) {
+            continue;
+        }
+        const uint16_t num_hw = ifaces[i]->getNumFilters();
+        if (num_hw == 0) {
+            continue;
+        }
+        while (filter_count > num_hw) {
+            merge_closest_filters(filter_list, filter_count);
+        }
+        if (ifaces[i]->configureFilters(filter_list, filter_count)) {
+            rx_cost.num_filters = filter_count;
+        }
+    }
+}
+
+void CanardInterface::rx_info(ExpandingString &str)
+{
+    WITH_SEMAPHORE(_sem_rx);
+    str.printf("wanted:  %u frames %.2fus/frame\n",
+               unsigned(rx_cost.wanted),
+               rx_cost.wanted > 0 ? double(rx_cost.wanted_us) / rx_cost.wanted : 0.0);
+    str.printf("dropped: %u frames %.2fus/frame\n",
+               unsigned(rx_cost.dropped),
+               rx_cost.dropped > 0 ? double(rx_cost.dropped_us) / rx_cost.dropped : 0.0);
+    str.printf("dispatch cache: hits=%u misses=%u\n",
+               unsigned(rx_cost.cache_hits),
+               unsigned(rx_cost.cache_misses));
+    str.printf("acceptance filters: %u\n", unsigned(rx_cost.num_filters));
+}
+
 void CanardInterface::process(uint32_t duration_ms) {
 #if AP_TEST_DRONECAN_DRIVERS
     const uint64_t deadline = AP_HAL::micros64() + duration_ms*1000;
@@ -6,6 +6,24 @@
 
 class AP_DroneCAN;
 class CANSensor;
+class ExpandingString;
+
+// number of transfer types remembered by the receive dispatch cache,
+// must be a power of 2
+#ifndef AP_DRONECAN_DISPATCH_CACHE_SIZE
+#define AP_DRONECAN_DISPATCH_CACHE_SIZE 64
+#endif
+
+// how long a transfer type found to have no handler is dropped
+// before the handler lists are searched again
+#ifndef AP_DRONECAN_DISPATCH_RECHECK_MS
+#define AP_DRONECAN_DISPATCH_RECHECK_MS 2000
+#endif
+
+// most acceptance filters generated before the closest are merged
+#ifndef AP_DRONECAN_MAX_FILTERS
+#define AP_DRONECAN_MAX_FILTERS 64
+#endif
 
 class CanardInterface : public Canard::Interface {
     friend class AP_DroneCAN;
@@ -68,6 +86,20 @@ public:
     // get reference to the semaphore that is held during message receive
     HAL_Semaphore &get_sem_rx(void) { return _sem_rx; }
 
+    // a handler has been added, forget cached rejections and
+    // regenerate the acceptance filters
+    void subscriptions_changed(void) {
+        dispatch_stale = true;
+        filters_stale = true;
+    }
+
+    // configure interface acceptance filters for the subscribed
+    // transfers, called from the DroneCAN thread
+    void update_filters(void);
+
+    // receive dispatch and cost statistics
+    void rx_info(ExpandingString &str);
+
 private:
     CanardInstance canard;
     AP_HAL::CANIface* ifaces[HAL_NUM_CAN_IFACES];
@@ -85,5 +117,45 @@ private:
 
     // auxillary 11 bit CANSensor
     CANSensor *aux_11bit_driver;
+
+    /*
+      cache of the handler list search done for each transfer type,
+      so frames nobody wants are dropped before libcanard parses them
+     */
+    struct DispatchEntry {
+        // transfer type and data type id plus one, zero when empty
+        uint32_t key;
+        uint64_t signature;
+        uint32_t checked_ms;
+        bool accept;
+    };
+    DispatchEntry dispatch[AP_DRONECAN_DISPATCH_CACHE_SIZE];
+    volatile bool dispatch_stale;
+
+    /*
+      acceptance filters are built a slice of message ids at a time
+      so searching the handler lists doesn't stall the thread
+     */
+    volatile bool filters_stale = true;
+    bool filters_building;
+    uint32_t filter_probe_id;
+    uint8_t filter_count;
+    AP_HAL::CANIface::CanFilterConfig *filter_list;
+    void add_filter(uint32_t id, uint32_t mask);
+    static void merge_closest_filters(AP_HAL::CANIface::CanFilterConfig *filters, uint8_t &count);
+
+    struct {
+        uint32_t cache_hits;
+        uint32_t cache_misses;
+        uint32_t dropped;
+        uint32_t wanted;
+        uint64_t dropped_us;
+        uint64_t wanted_us;
+        uint8_t num_filters;
+    } rx_cost;
+
+    bool accept_transfer(uint16_t data_type_id, CanardTransferType transfer_type, uint64_t &signature);
+    bool frame_wanted(uint32_t id);
+    void forget_rejections(void);
 };
 #endif // HAL_ENABLE_DRONECAN_DRIVERS
@@ -51,6 +51,7 @@
 #include <AP_Mount/AP_Mount_Xacti.h>
 #include <string.h>
 #include <AP_Servo_Telem/AP_Servo_Telem.h>
+#include <AP_Common/ExpandingString.h>
 
 #if AP_DRONECAN_SERIAL_ENABLED
 #include "AP_DroneCAN_serial.h"
@@ -129,7 +130,7 @@ const AP_Param::GroupInfo AP_DroneCAN::var_info[] = {
     // @Param: OPTION
     // @DisplayName: DroneCAN options
     // @Description: Option flags
-    // @Bitmask: 0:ClearDNADatabase,1:IgnoreDNANodeConflicts,2:EnableCanfd,3:IgnoreDNANodeUnhealthy,4:SendServoAsPWM,5:SendGNSS,6:UseHimarkServo,7:HobbyWingESC,8:EnableStats,9:EnableFlexDebug
+    // @Bitmask: 0:ClearDNADatabase,1:IgnoreDNANodeConflicts,2:EnableCanfd,3:IgnoreDNANodeUnhealthy,4:SendServoAsPWM,5:SendGNSS,6:UseHimarkServo,7:HobbyWingESC,8:EnableStats,9:EnableFlexDebug,10:UseAcceptanceFilters
     // @User: Advanced
     AP_GROUPINFO("OPTION", 5, AP_DroneCAN, _options, 0),
     
@@ -308,6 +309,18 @@ AP_DroneCAN *AP_DroneCAN::get_dronecan(uint8_t driver_index)
     return static_cast<AP_DroneCAN*>(AP::can().get_driver(driver_index));
 }
 
+void AP_DroneCAN::rx_info(ExpandingString &str)
+{
+    for (uint8_t i = 0; i < HAL_MAX_CAN_PROTOCOL_DRIVERS; i++) {
+        AP_DroneCAN *dronecan = get_dronecan(i);
+        if (dronecan == nullptr) {
+            continue;
+        }
+        str.printf("DroneCAN%u\n", unsigned(i+1));
+        dronecan->canard_iface.rx_info(str);
+    }
+}
+
 bool AP_DroneCAN::add_interface(AP_HAL::CANIface* can_iface)
 {
     if (!canard_iface.add_interface(can_iface)) {
@@ -533,6 +546,12 @@ void AP_DroneCAN::loop(void)
 
         canard_iface.process(1);
 
+        if (option_is_set(Options::ACCEPTANCE_FILTERS)) {
+            // drop unsubscribed traffic in the interface, note that
+            // this also hides it from CAN forwarding and SLCAN
+            canard_iface.update_filters();
+        }
+
         safety_state_send();
         notify_state_send();
         check_parameter_callback_timeout();
@@ -88,6 +88,9 @@ public:
 
     // Return uavcan from @driver_index or nullptr if it's not ready or doesn't exist
     static AP_DroneCAN *get_dronecan(uint8_t driver_index);
+
+    // receive dispatch statistics for all DroneCAN drivers, for @SYS/dronecan_rx.txt
+    static void rx_info(ExpandingString &str);
     bool prearm_check(char* fail_msg, uint8_t fail_msg_len) const;
 
     __INITFUNC__ void init(uint8_t driver_index, bool enable_filters) override;
@@ -151,6 +154,7 @@ public:
         USE_HOBBYWING_ESC         = (1U<<7),
         ENABLE_STATS              = (1U<<8),
         ENABLE_FLEX_DEBUG         = (1U<<9),
+        ACCEPTANCE_FILTERS        = (1U<<10),
     };
 
     // check if a option is set
@@ -68,6 +68,12 @@ int AP_Filesystem_Param::open(const char *fname, int flags, bool allow_absolute_
     r.read_size = 0;
     r.file_size = 0;
     r.writebuf = nullptr;
+#if AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED
+    r.have_since = false;
+    r.since = 0;
+    r.image = nullptr;
+    r.own_image = false;
+#endif
     if (!read_only) {
         // setup for upload
         r.writebuf = NEW_NOTHROW ExpandingString();
@@ -116,12 +122,39 @@ int AP_Filesystem_Param::open(const char *fname, int flags, bool allow_absolute_
             continue;
         }
 #endif
+#if AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED
+        if (strncmp(c, "since=", 6) == 0) {
+            r.since = strtoul(c+6, nullptr, 10);
+            r.have_since = true;
+            c += 6;
+            c = strchr(c, '&');
+            continue;
+        }
+#endif
+    }
+
+#if AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED
+    if (r.have_since && (!read_only || r.start != 0 || r.count != 0)) {
+        // versioned files always hold the whole parameter tree
+        goto failed;
+    }
+    if (read_only && r.start == 0 && r.count == 0 &&
+        !snapshot_open(r) && r.have_since) {
+        delete [] r.cursors;
+        r.cursors = nullptr;
+        r.open = false;
+        errno = ENOMEM;
+        return -1;
     }
+#endif
 
     return idx;
 
 failed:
     delete [] r.cursors;
+    r.cursors = nullptr;
+    delete r.writebuf;
+    r.writebuf = nullptr;
     r.open = false;
     errno = EINVAL;
     return -1;
@@ -139,6 +172,9 @@ int AP_Filesystem_Param::close(int fd)
         errno = EINVAL;
         ret = -1;
     }
+#if AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED
+    snapshot_close(r);
+#endif
     r.open = false;
     delete [] r.cursors;
     r.cursors = nullptr;
@@ -166,6 +202,17 @@ int AP_Filesystem_Param::close(int fd)
     Any leading zero bytes after the header should be discarded as pad
     bytes. Pad bytes are used to ensure that a parameter data[] field
     does not cross a read packet boundary
+
+  versioned format, from param.pck?since=N:
+    file header:
+      uint16_t magic = 0x671d or 0x671e for included default values
+      uint16_t num_params    // number of parameters in this file
+      uint16_t total_params  // number of parameters on the vehicle
+      uint32_t version       // pass as since=version to get later changes
+
+    followed by the parameters with values that changed after version
+    N, in the same per-parameter format. A since=0 request, or one
+    with a version not from this boot, returns all parameters
  */
 
 /*
@@ -200,6 +247,7 @@ uint8_t AP_Filesystem_Param::pack_param(const struct rfile &r, struct cursor &c,
         return 0;
     }
     ap->copy_name_token(c.token, name, AP_MAX_NAME_SIZE, true);
+    c.ap = ap;
 
     uint8_t common_len = 0;
     const char *last_name = c.last_name;
@@ -229,7 +277,7 @@ uint8_t AP_Filesystem_Param::pack_param(const struct rfile &r, struct cursor &c,
       crosses a block boundary. This ensures that re-reading a block
       won't get a corrupt value for a parameter
      */
-    if (type_len > 1) {
+    if (type_len > 1 && r.read_size != 0) {
         const uint32_t ofs = c.token_ofs + sizeof(struct header) + packed_len;
         const uint32_t ofs_mod = ofs % r.read_size;
         if (ofs_mod > 0 && ofs_mod < type_len) {
@@ -335,6 +383,21 @@ int32_t AP_Filesystem_Param::read(int fd, void *buf, uint32_t count)
     }
     size_t header_total = 0;
 
+#if AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED
+    if (r.image != nullptr) {
+        // the image doesn't change while we have it open, so any
+        // read size is fine
+        const uint32_t len = r.image->get_length();
+        if (r.file_ofs >= len) {
+            return 0;
+        }
+        count = MIN(count, len - r.file_ofs);
+        memcpy(buf, &r.image->get_string()[r.file_ofs], count);
+        r.file_ofs += count;
+        return count;
+    }
+#endif
+
     /*
       we only allow for a single read size. This ensures that pad
       bytes placed to avoid a data value crossing a block boundary in
@@ -483,6 +546,205 @@ int AP_Filesystem_Param::stat(const char *name, struct stat *stbuf)
     return 0;
 }
 
+#if AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED
+/*
+  attach a file opened for a full download to the shared image, or
+  create an image for it. Returns false if the file should fall back
+  to walking the parameters
+ */
+bool AP_Filesystem_Param::snapshot_open(rfile &r)
+{
+    WITH_SEMAPHORE(snapshot.sem);
+    if (!snapshot_update()) {
+        return false;
+    }
+    if (r.have_since) {
+        r.image = snapshot_pack(r.with_defaults, r.since, true);
+        r.own_image = true;
+        return r.image != nullptr;
+    }
+    if (snapshot.image != nullptr &&
+        (snapshot.image_version != snapshot.version ||
+         snapshot.image_with_defaults != r.with_defaults)) {
+        // other files are still reading an image which is now out of
+        // date or in the other form, so this file gets its own
+        r.image = snapshot_pack(r.with_defaults, 0, false);
+        r.own_image = true;
+        return r.image != nullptr;
+    }
+    if (snapshot.image == nullptr) {
+        snapshot.image = snapshot_pack(r.with_defaults, 0, false);
+        if (snapshot.image == nullptr) {
+            return false;
+        }
+        snapshot.image_version = snapshot.version;
+        snapshot.image_with_defaults = r.with_defaults;
+    }
+    r.image = snapshot.image;
+    snapshot.readers++;
+    return true;
+}
+
+/*
+  release the image used by a file. The shared image is freed when
+  its last reader closes, and the next open builds a current one
+ */
+void AP_Filesystem_Param::snapshot_close(rfile &r)
+{
+    if (r.image == nullptr) {
+        return;
+    }
+    if (r.own_image) {
+        delete r.image;
+    } else {
+        WITH_SEMAPHORE(snapshot.sem);
+        if (--snapshot.readers == 0) {
+            delete snapshot.image;
+            snapshot.image = nullptr;
+        }
+    }
+    r.image = nullptr;
+    r.own_image = false;
+}
+
+/*
+  bring the version of each parameter up to date, bumping the
+  snapshot version if any value changed
+ */
+bool AP_Filesystem_Param::snapshot_update(void)
+{
+    if (snapshot.first_version == 0) {
+        // start from a random version so versions from an earlier
+        // boot are not mistaken for ours. Keep clear of zero and of
+        // wrapping around
+        uint32_t seed = 0;
+        if (!hal.util->get_random_vals((uint8_t *)&seed, sizeof(seed))) {
+            seed = AP_HAL::micros() ^ (uint32_t(get_random16()) << 16);
+        }
+        snapshot.first_version = (seed & 0x7FFFFFFF) | 1;
+        snapshot.version = snapshot.first_version - 1;
+    }
+
+    const uint16_t count = AP_Param::count_parameters();
+    snapshot_entry *entries = snapshot.entries;
+    if (entries == nullptr || snapshot.num_params != count) {
+        // the parameter tree changed, entries which still match keep
+        // their version
+        entries = NEW_NOTHROW snapshot_entry[count];
+        if (entries == nullptr) {
+            return false;
+        }
+    }
+    const bool in_place = entries == snapshot.entries;
+    const uint32_t new_version = snapshot.version + 1;
+    bool changed = !in_place;
+
+    AP_Param::ParamToken token {};
+    enum ap_var_type ptype;
+    uint16_t i = 0;
+    AP_Param *ap;
+    for (ap = AP_Param::first(&token, &ptype);
+         ap != nullptr && i < count;
+         ap = AP_Param::next_scalar(&token, &ptype), i++) {
+        uint32_t value = 0;
+        memcpy(&value, ap, AP_Param::type_size(ptype));
+        auto &e = entries[i];
+        if (!in_place) {
+            if (snapshot.entries != nullptr && i < snapshot.num_params) {
+                e = snapshot.entries[i];
+            } else {
+                e.ap = nullptr;
+            }
+        }
+        if (e.ap == ap && e.value == value) {
+            continue;
+        }
+        e.ap = ap;
+        e.value = value;
+        e.version = new_version;
+        changed = true;
+    }
+    if (changed) {
+        snapshot.version = new_version;
+    }
+    if (i != count || ap != nullptr) {
+        // the parameter count is out of date
+        AP_Param::invalidate_count();
+        if (!in_place) {
+            delete [] entries;
+        }
+        return false;
+    }
+    if (!in_place) {
+        delete [] snapshot.entries;
+        snapshot.entries = entries;
+        snapshot.num_params = count;
+    }
+    return true;
+}
+
+/*
+  pack the parameters whose value changed after the given version. A
+  versioned image has the snapshot version in its header
+ */
+ExpandingString *AP_Filesystem_Param::snapshot_pack(bool with_defaults, uint32_t since, bool versioned)
+{
+    ExpandingString *image = NEW_NOTHROW ExpandingString();
+    if (image == nullptr) {
+        return nullptr;
+    }
+    struct header_versioned hdr;
+    if (with_defaults) {
+        hdr.magic = versioned ? pmagic_versioned_with_default : pmagic_with_default;
+    } else if (!versioned) {
+        hdr.magic = pmagic;
+    }
+    hdr.num_params = 0;
+    hdr.total_params = snapshot.num_params;
+    hdr.version = snapshot.version;
+    const uint8_t hdr_len = versioned ? sizeof(header_versioned) : sizeof(header);
+    bool ok = image->append((const char *)&hdr, hdr_len);
+
+    if (since < snapshot.first_version || since > snapshot.version) {
+        // not a version from this boot, send everything
+        since = 0;
+    }
+
+    struct rfile r {};
+    r.with_defaults = with_defaults;
+    struct cursor c {};
+    char last_name[AP_MAX_NAME_SIZE+1] {};
+    uint16_t i;
+    for (i=0; ok && i<snapshot.num_params; i++) {
+        // name compression is relative to the last parameter we emit
+        strcpy(c.last_name, last_name);
+        uint8_t tbuf[max_pack_len];
+        const uint8_t len = pack_param(r, c, tbuf);
+        if (len == 0) {
+            break;
+        }
+        c.token_ofs += len;
+        if (c.ap != snapshot.entries[i].ap) {
+            // the parameter tree changed under us
+            ok = false;
+            break;
+        }
+        if (snapshot.entries[i].version <= since) {
+            continue;
+        }
+        ok = image->append((const char *)tbuf, len);
+        strcpy(last_name, c.last_name);
+        hdr.num_params++;
+    }
+    if (!ok || i != snapshot.num_params) {
+        delete image;
+        return nullptr;
+    }
+    memcpy(image->get_writeable_string(), &hdr, hdr_len);
+    return image;
+}
+#endif // AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED
+
 /*
   check for the right file name
  */
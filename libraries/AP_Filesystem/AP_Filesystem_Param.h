@@ -49,6 +49,8 @@ private:
     // Support both protocol versions
     static constexpr uint16_t pmagic = 0x671b;
     static constexpr uint16_t pmagic_with_default = 0x671c;
+    static constexpr uint16_t pmagic_versioned = 0x671d;
+    static constexpr uint16_t pmagic_versioned_with_default = 0x671e;
 
     // header at front of the file
     struct header {
@@ -57,6 +59,14 @@ private:
         uint16_t total_params; // for upload this is total file length
     };
 
+    // header at front of a versioned file, param.pck?since=N
+    struct PACKED header_versioned {
+        uint16_t magic = pmagic_versioned;
+        uint16_t num_params;
+        uint16_t total_params;
+        uint32_t version;   // pass as since=N to get later changes
+    };
+
     struct cursor {
         AP_Param::ParamToken token;
         uint32_t token_ofs;
@@ -64,6 +74,7 @@ private:
         uint8_t trailer_len;
         uint8_t trailer[max_pack_len];
         uint16_t idx;
+        const AP_Param *ap; // last packed parameter
     };
 
     struct rfile {
@@ -76,6 +87,14 @@ private:
         uint32_t file_size;
         struct cursor *cursors;
         ExpandingString *writebuf; // for upload
+#if AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED
+        bool have_since;
+        uint32_t since;
+        // packed image to read from, either the shared snapshot or
+        // a delta owned by this file
+        const ExpandingString *image;
+        bool own_image;
+#endif
     } file[max_open_file];
 
     bool token_seek(const struct rfile &r, const uint32_t data_ofs, struct cursor &c);
@@ -85,6 +104,44 @@ private:
     // finish uploading parameters
     bool finish_upload(const rfile &r);
     bool param_upload_parse(const rfile &r, bool &need_retry);
+
+#if AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED
+    /*
+      the version at which each parameter value last changed, allowing
+      for delta downloads. The version is bumped each time a file is
+      opened and some value has changed since the last open. The first
+      version is random each boot, so a since from an earlier boot is
+      very unlikely to fall in this boot's range and gets all
+      parameters.
+
+      Full downloads share a packed image, so reads are a plain memcpy.
+      The image doesn't change while files are reading it and is freed
+      when the last one closes. A file opened after a value changed
+      gets its own image instead
+     */
+    struct snapshot_entry {
+        const AP_Param *ap;
+        uint32_t value;     // raw value, for change detection
+        uint32_t version;   // version at which the value last changed
+    };
+    struct {
+        HAL_Semaphore sem;
+        snapshot_entry *entries;
+        uint16_t num_params;
+        uint32_t first_version;
+        uint32_t version;
+        // shared image, only allocated while it has readers
+        ExpandingString *image;
+        uint32_t image_version;
+        bool image_with_defaults;
+        uint8_t readers;
+    } snapshot;
+
+    bool snapshot_open(rfile &r);
+    void snapshot_close(rfile &r);
+    bool snapshot_update(void);
+    ExpandingString *snapshot_pack(bool with_defaults, uint32_t since, bool versioned);
+#endif
 };
 
 #endif  // AP_FILESYSTEM_PARAM_ENABLED
@@ -26,6 +26,16 @@
 #include <AP_CANManager/AP_CANManager.h>
 #include <AP_Scheduler/AP_Scheduler.h>
 #include <AP_Common/ExpandingString.h>
+#include <AP_Param/AP_Param.h>
+#include <GCS_MAVLink/GCS.h>
+#include <AP_Scripting/AP_Scripting.h>
+#include <AP_DDS/AP_DDS_config.h>
+#if AP_DDS_ENABLED && AP_DDS_TOPIC_STATS_ENABLED
+#include <AP_DDS/AP_DDS_Client.h>
+#endif
+#if HAL_ENABLE_DRONECAN_DRIVERS
+#include <AP_DroneCAN/AP_DroneCAN.h>
+#endif
 
 extern const AP_HAL::HAL& hal;
 
@@ -37,12 +47,31 @@ static const SysFileList sysfs_file_list[] = {
     {"threads.txt"},
     {"tasks.txt"},
     {"dma.txt"},
+    {"semaphores.txt"},
     {"memory.txt"},
     {"uarts.txt"},
     {"timers.txt"},
+#if AP_PARAM_INDEX_ENABLED
+    {"params.txt"},
+#endif
+#if AP_MAVLINK_TX_SCHEDULER_ENABLED
+    {"mavlink_tx.txt"},
+#endif
+#if AP_SCRIPTING_PROFILER_ENABLED
+    {"lua_profile.txt"},
+#endif
+#if AP_DDS_ENABLED && AP_DDS_TOPIC_STATS_ENABLED
+    {"dds_topics.txt"},
+#endif
 #if HAL_MAX_CAN_PROTOCOL_DRIVERS
     {"can_log.txt"},
 #endif
+#if HAL_ENABLE_DRONECAN_DRIVERS
+    {"dronecan_rx.txt"},
+#endif
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    {"loop_trace.json"},
+#endif
 #if HAL_NUM_CAN_IFACES > 0
     {"can0_stats.txt"},
     {"can1_stats.txt"},
@@ -109,6 +138,9 @@ int AP_Filesystem_Sys::open(const char *fname, int flags, bool allow_absolute_pa
     if (strcmp(fname, "dma.txt") == 0) {
         hal.util->dma_info(*r.str);
     }
+    if (strcmp(fname, "semaphores.txt") == 0) {
+        hal.util->semaphore_info(*r.str);
+    }
     if (strcmp(fname, "memory.txt") == 0) {
         hal.util->mem_info(*r.str);
     }
@@ -120,11 +152,47 @@ int AP_Filesystem_Sys::open(const char *fname, int flags, bool allow_absolute_pa
     if (strcmp(fname, "timers.txt") == 0) {
         hal.util->timer_info(*r.str);
     }
+#if AP_PARAM_INDEX_ENABLED
+    if (strcmp(fname, "params.txt") == 0) {
+        AP_Param::index_info(*r.str);
+    }
+#endif
+#if AP_MAVLINK_TX_SCHEDULER_ENABLED
+    if (strcmp(fname, "mavlink_tx.txt") == 0) {
+        gcs().tx_scheduler_info(*r.str);
+    }
+#endif
+#if AP_SCRIPTING_PROFILER_ENABLED
+    if (strcmp(fname, "lua_profile.txt") == 0) {
+        AP_Scripting *scripting = AP::scripting();
+        if (scripting != nullptr) {
+            scripting->profile_info(*r.str);
+        }
+    }
+#endif
+#if AP_DDS_ENABLED && AP_DDS_TOPIC_STATS_ENABLED
+    if (strcmp(fname, "dds_topics.txt") == 0) {
+        AP_DDS_Client *dds = AP_DDS_Client::get_singleton();
+        if (dds != nullptr) {
+            dds->topic_info(*r.str);
+        }
+    }
+#endif
 #if HAL_CANMANAGER_ENABLED
     if (strcmp(fname, "can_log.txt") == 0) {
         AP::can().log_retrieve(*r.str);
     }
 #endif
+#if HAL_ENABLE_DRONECAN_DRIVERS
+    if (strcmp(fname, "dronecan_rx.txt") == 0) {
+        AP_DroneCAN::rx_info(*r.str);
+    }
+#endif
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    if (strcmp(fname, "loop_trace.json") == 0) {
+        AP::scheduler().loop_trace_info(*r.str);
+    }
+#endif
 #if HAL_NUM_CAN_IFACES > 0
     int8_t can_stats_num = -1;
     if (strcmp(fname, "can0_stats.txt") == 0) {
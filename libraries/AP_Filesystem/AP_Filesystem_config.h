@@ -28,6 +28,11 @@
 #define AP_FILESYSTEM_PARAM_ENABLED 1
 #endif
 
+// cached packed parameter image with versioned delta downloads
+#ifndef AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED
+#define AP_FILESYSTEM_PARAM_SNAPSHOT_ENABLED (AP_FILESYSTEM_PARAM_ENABLED && HAL_MEM_CLASS >= HAL_MEM_CLASS_1000)
+#endif
+
 #ifndef AP_FILESYSTEM_POSIX_ENABLED
 #define AP_FILESYSTEM_POSIX_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX || CONFIG_HAL_BOARD == HAL_BOARD_QURT)
 #endif
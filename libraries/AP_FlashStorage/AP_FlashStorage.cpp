@@ -110,7 +110,9 @@ bool AP_FlashStorage::init(void)
     write_error = false;
     reserved_space = 0;
     
-    // if the first sector is full then write out all data so we can erase it
+    // if the first sector is full then write out all data so we can
+    // erase it. This also completes a sector switch which update()
+    // was part way through copying when we lost power
     if (states[first_sector] == SECTOR_STATE_FULL) {
         current_sector = first_sector ^ 1;
         if (!write_all()) {
@@ -128,6 +130,7 @@ bool AP_FlashStorage::init(void)
     }
 
     reserved_space = 0;
+    switch_state = SwitchState::IDLE;
     
     // ready to use
     return true;
@@ -161,8 +164,10 @@ bool AP_FlashStorage::protected_switch_full_sector(void)
     // clear any write error
     write_error = false;
     reserved_space = 0;
-    
-    if (!write_all()) {
+
+    // if update() finished copying then the current sector already
+    // holds all of the data
+    if (switch_state != SwitchState::ERASE && !write_all()) {
         return false;
     }
 
@@ -258,6 +263,62 @@ bool AP_FlashStorage::write(uint16_t offset, uint16_t length)
     return true;
 }
 
+/*
+  copy the data forward from the full sector in small steps, then
+  erase it once that is allowed. This keeps the erase and the bulk
+  of the copying out of write(), so a sector switch in flight only
+  costs a header write
+ */
+void AP_FlashStorage::update(void)
+{
+    if (write_error) {
+        return;
+    }
+    switch (switch_state) {
+    case SwitchState::IDLE:
+        break;
+
+    case SwitchState::COPY: {
+        const uint32_t start_us = AP_HAL::micros();
+        while (copy_offset < storage_size) {
+            // local variable needed to overcome problem with MIN() macro and -O0
+            const uint8_t max_write_local = max_write;
+            const uint8_t n = MIN(max_write_local, storage_size-copy_offset);
+            if (!all_zero(copy_offset, n)) {
+                const uint8_t sector = current_sector;
+                if (!write(copy_offset, n)) {
+                    return;
+                }
+                if (sector != current_sector) {
+                    // the write had to switch sectors, which restarted the copy
+                    return;
+                }
+            }
+            copy_offset += n;
+            if (AP_HAL::micros() - start_us > copy_budget_us) {
+                return;
+            }
+        }
+        debug("copy to sector %u done at %u\n", current_sector, write_offset);
+        switch_state = SwitchState::ERASE;
+        break;
+    }
+
+    case SwitchState::ERASE:
+        if (!flash_erase_ok()) {
+            break;
+        }
+        if (!erase_sector(current_sector ^ 1, true)) {
+            break;
+        }
+        debug("erased sector %u\n", current_sector ^ 1);
+        // the next switch_sectors() can go straight to the other sector
+        reserved_space = 0;
+        switch_state = SwitchState::IDLE;
+        break;
+    }
+}
+
 /*
   load all data from a flash sector into mem_buffer
  */
@@ -344,6 +405,8 @@ bool AP_FlashStorage::erase_sector(uint8_t sector, bool mark_available)
 bool AP_FlashStorage::erase_all(void)
 {
     write_error = false;
+    reserved_space = 0;
+    switch_state = SwitchState::IDLE;
 
     current_sector = 0;
     write_offset = sizeof(struct sector_header);
@@ -443,6 +506,14 @@ bool AP_FlashStorage::switch_sectors(void)
     reserved_space = reserve_size;
     
     write_offset = sizeof(header);
+
+    // update() now copies the data forward so the full sector can be
+    // erased. If the sector is too small to hold the copy as well as
+    // the reserved space then leave it to switch_full_sector()
+    if (flash_sector_size >= sizeof(header) + 2*reserve_size) {
+        switch_state = SwitchState::COPY;
+        copy_offset = 0;
+    }
     return true;    
 }
 
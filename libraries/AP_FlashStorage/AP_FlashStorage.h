@@ -19,8 +19,13 @@
   backend for any HAL. The basic methodology is to use a log based
   storage system over two flash sectors. Key design elements:
 
-  - erase of sectors only called on init, as erase will lock the flash
-    and prevent code execution
+  - erase of sectors only called on init, from update() when the
+    caller allows it, or when both sectors fill up, as erase will lock
+    the flash and prevent code execution
+
+  - after switching sectors the data still held only in the full
+    sector is copied forward by update() in small steps, so the full
+    sector can be erased well before the new sector fills up
 
   - write using log based system
 
@@ -127,6 +132,17 @@ public:
     // offline for considerable periods as an erase will be needed
     bool switch_full_sector(void) WARN_IF_UNUSED;
 
+    // make progress on a pending sector switch. Should be called
+    // regularly from the storage timer when there is nothing to write.
+    // Each call does at most copy_budget_us of copying, or one erase
+    // if flash_erase_ok() allows it
+    void update(void);
+
+    // true if the previous sector still has to be copied or erased
+    bool switch_pending(void) const {
+        return switch_state != SwitchState::IDLE;
+    }
+
     // write some data to storage from mem_buffer
     bool write(uint16_t offset, uint16_t length) WARN_IF_UNUSED;
 
@@ -146,6 +162,18 @@ private:
     uint32_t reserved_space;
     bool write_error;
 
+    // progress of copying data forward after a switch_sectors()
+    enum class SwitchState : uint8_t {
+        IDLE,   // other sector is available
+        COPY,   // copying mem_buffer into the current sector
+        ERASE,  // current sector holds all data, other sector needs erase
+    };
+    SwitchState switch_state;
+    uint16_t copy_offset;
+
+    // time limit on copying in one update() call
+    static const uint16_t copy_budget_us = 500;
+
     // 24 bit signature
 #if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F4
     static const uint32_t signature = 0x51685B;
@@ -17,7 +17,10 @@ public:
     void loop() override;
 
 private:
-    static const uint32_t flash_sector_size = 32U * 1024U;
+    // sector size under test. 32k sectors are too small for update()
+    // to copy data forward, 128k sectors (as on F4, F7 and H7 boards)
+    // are large enough
+    uint32_t flash_sector_size;
 
     uint8_t mem_buffer[AP_FlashStorage::storage_size];
     uint8_t mem_mirror[AP_FlashStorage::storage_size];
@@ -29,18 +32,31 @@ private:
     bool flash_read(uint8_t sector, uint32_t offset, uint8_t *data, uint16_t length);
     bool flash_erase(uint8_t sector);
     bool flash_erase_ok(void);
-    
-    AP_FlashStorage storage{mem_buffer,
-            flash_sector_size,
-            FUNCTOR_BIND_MEMBER(&FlashTest::flash_write, bool, uint8_t, uint32_t, const uint8_t *, uint16_t),
-            FUNCTOR_BIND_MEMBER(&FlashTest::flash_read, bool, uint8_t, uint32_t, uint8_t *, uint16_t),
-            FUNCTOR_BIND_MEMBER(&FlashTest::flash_erase, bool, uint8_t),
-            FUNCTOR_BIND_MEMBER(&FlashTest::flash_erase_ok, bool)};
+
+    AP_FlashStorage *storage;
 
     // write to storage and mem_mirror
     void write(uint16_t offset, const uint8_t *data, uint16_t length);
 
+    // run all tests with one sector size
+    void run_tests(uint32_t sector_size);
+
+    // random writes and re-init
+    void random_test(void);
+
+    // measure worst case write() time
+    void latency_test(void);
+
+    // reboot part way through copying data to the new sector
+    void reboot_test(void);
+
     bool erase_ok;
+
+    // simulated time taken by a sector erase
+    uint32_t erase_delay_ms;
+    uint32_t erase_count;
+    uint32_t erases_in_write;
+    bool in_write;
 };
 
 bool FlashTest::flash_write(uint8_t sector, uint32_t offset, const uint8_t *data, uint16_t length)
@@ -108,6 +124,13 @@ bool FlashTest::flash_erase(uint8_t sector)
         AP_HAL::panic("FATAL: erase sector %u", (unsigned)sector);
     }
     memset(&flash[sector][0], 0xFF, flash_sector_size);
+    erase_count++;
+    if (in_write) {
+        erases_in_write++;
+    }
+    if (erase_delay_ms != 0) {
+        hal.scheduler->delay(erase_delay_ms);
+    }
     return true;
 }
 
@@ -120,7 +143,7 @@ void FlashTest::write(uint16_t offset, const uint8_t *data, uint16_t length)
 {
     memcpy(&mem_mirror[offset], data, length);
     memcpy(&mem_buffer[offset], data, length);
-    if (!storage.write(offset, length)) {
+    if (!storage->write(offset, length)) {
         if (erase_ok) {
             printf("Failed to write at %u for %u\n", offset, length);
         }
@@ -128,24 +151,111 @@ void FlashTest::write(uint16_t offset, const uint8_t *data, uint16_t length)
 }
 
 /*
- * test flash storage
+  measure the worst case time of write() with the sector switch driven
+  from update() between writes, as the storage timer does, and with a
+  simulated erase time. No erase should be needed inside write()
  */
-void FlashTest::setup(void)
+void FlashTest::latency_test(void)
 {
-    hal.console->printf("AP_FlashStorage test\n");
+    printf("latency test\n");
+    erase_ok = true;
+    erase_delay_ms = 20;
+    erases_in_write = 0;
+    const uint32_t erase_count0 = erase_count;
+    uint32_t max_us = 0;
+    uint32_t total_us = 0;
+    const uint32_t num_writes = 200000;
+
+    for (uint32_t i=0; i<num_writes; i++) {
+        uint16_t ofs = get_random16() % sizeof(mem_buffer);
+        uint16_t length = get_random16() & 0x1F;
+        length = MIN(length, sizeof(mem_buffer) - ofs);
+        uint8_t data[length];
+        for (uint8_t j=0; j<length; j++) {
+            data[j] = get_random16() & 0xFF;
+        }
+
+        const uint32_t t0 = AP_HAL::micros();
+        in_write = true;
+        write(ofs, data, length);
+        in_write = false;
+        const uint32_t dt = AP_HAL::micros() - t0;
+        max_us = MAX(max_us, dt);
+        total_us += dt;
+
+        if (i % 10 == 0) {
+            storage->update();
+        }
+    }
+
+    printf("writes=%u max=%uus avg=%.2fus erases=%u erases_in_write=%u\n",
+           (unsigned)num_writes,
+           (unsigned)max_us,
+           total_us / float(num_writes),
+           (unsigned)(erase_count - erase_count0),
+           (unsigned)erases_in_write);
+    erase_delay_ms = 0;
+
+    if (erases_in_write != 0) {
+        AP_HAL::panic("FATAL: erase in write()");
+    }
+    if (memcmp(mem_buffer, mem_mirror, sizeof(mem_buffer)) != 0) {
+        AP_HAL::panic("FATAL: data mis-match in latency test");
+    }
+    memset(mem_buffer, 0, sizeof(mem_buffer));
+    if (!storage->init()) {
+        AP_HAL::panic("Failed latency test init()");
+    }
+    if (memcmp(mem_buffer, mem_mirror, sizeof(mem_buffer)) != 0) {
+        AP_HAL::panic("FATAL: data mis-match after latency test");
+    }
 }
 
-void FlashTest::loop(void)
+/*
+  power off while update() is part way through copying data forward
+  after a sector switch. init() must finish the copy and erase the
+  full sector
+ */
+void FlashTest::reboot_test(void)
 {
-    flash[0] = (uint8_t *)malloc(flash_sector_size);
-    flash[1] = (uint8_t *)malloc(flash_sector_size);
-    flash_erase(0);
-    flash_erase(1);
+    printf("reboot test\n");
+    erase_ok = true;
 
-    if (!storage.init()) {
-        AP_HAL::panic("Failed first init()");
+    for (uint8_t reboots=0; reboots<10; reboots++) {
+        // fill the current sector without calling update()
+        while (!storage->switch_pending()) {
+            uint16_t ofs = get_random16() % sizeof(mem_buffer);
+            uint8_t data[8];
+            const uint16_t length = MIN(sizeof(data), sizeof(mem_buffer) - ofs);
+            for (uint8_t j=0; j<length; j++) {
+                data[j] = get_random16() & 0xFF;
+            }
+            write(ofs, data, length);
+        }
+        // copy some of the data, fewer steps each time round
+        for (uint8_t i=0; i<reboots % 3; i++) {
+            storage->update();
+        }
+
+        memset(mem_buffer, 0, sizeof(mem_buffer));
+        if (!storage->init()) {
+            AP_HAL::panic("Failed reboot test init()");
+        }
+        if (memcmp(mem_buffer, mem_mirror, sizeof(mem_buffer)) != 0) {
+            AP_HAL::panic("FATAL: data mis-match after reboot %u", (unsigned)reboots);
+        }
+        if (storage->switch_pending()) {
+            AP_HAL::panic("FATAL: switch pending after reboot %u", (unsigned)reboots);
+        }
     }
+}
 
+/*
+  random writes with erases only allowed occasionally, then check
+  the data survives a re-init
+ */
+void FlashTest::random_test(void)
+{
     // fill with 10k random writes
     for (uint32_t i=0; i<5000000; i++) {
         uint16_t ofs = get_random16() % sizeof(mem_buffer);
@@ -178,13 +288,74 @@ void FlashTest::loop(void)
     // re-init
     printf("re-init\n");
     memset(mem_buffer, 0, sizeof(mem_buffer));
-    if (!storage.init()) {
+    if (!storage->init()) {
         AP_HAL::panic("Failed second init()");
     }
 
     if (memcmp(mem_buffer, mem_mirror, sizeof(mem_buffer)) != 0) {
         AP_HAL::panic("FATAL: data mis-match");
     }
+}
+
+void FlashTest::run_tests(uint32_t sector_size)
+{
+    hal.console->printf("testing %uk sectors\n", unsigned(sector_size/1024));
+
+    flash_sector_size = sector_size;
+    flash[0] = (uint8_t *)malloc(flash_sector_size);
+    flash[1] = (uint8_t *)malloc(flash_sector_size);
+    if (flash[0] == nullptr || flash[1] == nullptr) {
+        AP_HAL::panic("FATAL: no memory for flash");
+    }
+    flash_erase(0);
+    flash_erase(1);
+    memset(mem_mirror, 0, sizeof(mem_mirror));
+
+    storage = NEW_NOTHROW AP_FlashStorage(mem_buffer,
+            flash_sector_size,
+            FUNCTOR_BIND_MEMBER(&FlashTest::flash_write, bool, uint8_t, uint32_t, const uint8_t *, uint16_t),
+            FUNCTOR_BIND_MEMBER(&FlashTest::flash_read, bool, uint8_t, uint32_t, uint8_t *, uint16_t),
+            FUNCTOR_BIND_MEMBER(&FlashTest::flash_erase, bool, uint8_t),
+            FUNCTOR_BIND_MEMBER(&FlashTest::flash_erase_ok, bool));
+    if (storage == nullptr) {
+        AP_HAL::panic("FATAL: no memory for storage");
+    }
+
+    if (!storage->init()) {
+        AP_HAL::panic("Failed first init()");
+    }
+
+    random_test();
+
+    // sectors too small to copy forward keep the old behaviour of
+    // erasing from write()
+    if (flash_sector_size >= 128U * 1024U) {
+        latency_test();
+        reboot_test();
+    }
+
+    delete storage;
+    storage = nullptr;
+    free(flash[0]);
+    free(flash[1]);
+}
+
+/*
+ * test flash storage
+ */
+void FlashTest::setup(void)
+{
+    hal.console->printf("AP_FlashStorage test\n");
+}
+
+void FlashTest::loop(void)
+{
+#if AP_FLASHSTORAGE_TYPE != AP_FLASHSTORAGE_TYPE_H7
+    // H7 parts only have 128k sectors
+    run_tests(32U * 1024U);
+#endif
+    run_tests(128U * 1024U);
+
     while (true) {
         hal.console->printf("TEST PASSED");
         hal.scheduler->delay(20000);
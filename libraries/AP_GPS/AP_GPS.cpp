@@ -1631,12 +1631,17 @@ bool AP_GPS::parse_rtcm_injection(mavlink_channel_t chan, const mavlink_gps_rtcm
         }
         GCS_SEND_TEXT(MAV_SEVERITY_INFO, "GPS: RTCM parsing for chan %u", unsigned(chan));
     }
-    for (uint16_t i=0; i<pkt.len; i++) {
-        if (rtcm.parsers[chan]->read(pkt.data[i])) {
-            // we have a full message, inject it
-            const uint8_t *buf = nullptr;
-            uint16_t len = rtcm.parsers[chan]->get_len(buf);
-
+    const uint8_t *data = pkt.data;
+    uint16_t remaining = pkt.len;
+    while (remaining > 0) {
+        const uint16_t used = rtcm.parsers[chan]->read(data, remaining);
+        data += used;
+        remaining -= used;
+        // a full message is checked in place in pkt.data where it
+        // can be, and injected from there without another copy
+        const uint8_t *buf = nullptr;
+        uint16_t len = rtcm.parsers[chan]->get_len(buf);
+        if (len > 0) {
             // see if we have already sent it. This prevents
             // duplicates from multiple sources
             const uint32_t crc = crc_crc32(0, buf, len);
@@ -27,6 +27,7 @@ void RTCM3_Parser::reset(void)
     pkt_len = 0;
     pkt_bytes = 0;
     found_len = 0;
+    found_pkt = nullptr;
 }
 
 // clear previous packet
@@ -35,6 +36,12 @@ void RTCM3_Parser::clear_packet(void)
     if (found_len == 0) {
         return;
     }
+    if (found_pkt != &pkt[0]) {
+        // packet was in the caller's buffer, nothing to remove
+        found_len = 0;
+        found_pkt = nullptr;
+        return;
+    }
     // clear previous packet
     if (pkt_bytes > found_len) {
         memmove(&pkt[0], &pkt[found_len], pkt_bytes-found_len);
@@ -43,6 +50,7 @@ void RTCM3_Parser::clear_packet(void)
         pkt_bytes = 0;
     }
     found_len = 0;
+    found_pkt = nullptr;
     pkt_len = 0;
 }
 
@@ -50,7 +58,7 @@ void RTCM3_Parser::clear_packet(void)
 uint16_t RTCM3_Parser::get_len(const uint8_t *&bytes) const
 {
     if (found_len > 0) {
-        bytes = &pkt[0];
+        bytes = found_pkt;
     }
     return found_len;
 }
@@ -61,7 +69,7 @@ uint16_t RTCM3_Parser::get_id(void) const
     if (found_len == 0) {
         return 0;
     }
-    return (pkt[3]<<8 | pkt[4]) >> 4;
+    return (found_pkt[3]<<8 | found_pkt[4]) >> 4;
 }
 
 // look for preamble to try to resync
@@ -82,19 +90,26 @@ void RTCM3_Parser::resync(void)
     }
 }
 
+// check the parity of a packet with len bytes of body
+bool RTCM3_Parser::check_crc(const uint8_t *bytes, uint16_t len)
+{
+    const uint8_t *parity = &bytes[len+3];
+    uint32_t crc1 = (parity[0] << 16) | (parity[1] << 8) | parity[2];
+    uint32_t crc2 = crc_crc24(bytes, len+3);
+    return crc1 == crc2;
+}
+
 // parse packet
 bool RTCM3_Parser::parse(void)
 {
-    const uint8_t *parity = &pkt[pkt_len+3];
-    uint32_t crc1 = (parity[0] << 16) | (parity[1] << 8) | parity[2];
-    uint32_t crc2 = crc_crc24(pkt, pkt_len+3);
-    if (crc1 != crc2) {
+    if (!check_crc(pkt, pkt_len)) {
         resync();
         return false;
     }
 
     // we got a good packet
     found_len = pkt_len+6;
+    found_pkt = &pkt[0];
     return true;
 }
 
@@ -121,9 +136,11 @@ bool RTCM3_Parser::read(uint8_t byte)
 
     if (pkt_len == 0 && pkt_bytes >= 3) {
         pkt_len = (pkt[1]<<8 | pkt[2]) & 0x3ff;
-        if (pkt_len == 0) {
-            resync();
-        }
+    }
+    while (pkt_bytes >= 3 && (pkt_len == 0 || pkt_len+6U > sizeof(pkt))) {
+        // not a header we can use. Resync now rather than filling
+        // pkt[] first, which could swallow the packets that follow
+        resync();
     }
 
     if (pkt_len != 0 && pkt_bytes >= pkt_len + 6) {
@@ -135,6 +152,74 @@ bool RTCM3_Parser::read(uint8_t byte)
     return false;
 }
 
+// read in a block of bytes, stopping at the end of a full packet
+uint16_t RTCM3_Parser::read(const uint8_t *bytes, uint16_t len)
+{
+    clear_packet();
+
+    uint16_t used = 0;
+    while (true) {
+        if (pkt_bytes == 0) {
+            // skip to the next preamble
+            if (used >= len) {
+                break;
+            }
+            const uint8_t *p = (const uint8_t *)memchr(&bytes[used], RTCMv3_PREAMBLE, len-used);
+            if (p == nullptr) {
+                used = len;
+                break;
+            }
+            used = p - bytes;
+            const uint16_t avail = len - used;
+            if (avail >= 3) {
+                const uint16_t plen = (p[1]<<8 | p[2]) & 0x3ff;
+                if (plen == 0 || plen+6U > sizeof(pkt)) {
+                    // not a header we can use
+                    used++;
+                    continue;
+                }
+                if (avail >= plen+6U) {
+                    // the whole packet is here, check it in place
+                    if (!check_crc(p, plen)) {
+                        used++;
+                        continue;
+                    }
+                    found_len = plen+6;
+                    found_pkt = p;
+                    return used + found_len;
+                }
+            }
+        }
+
+        if (pkt_bytes >= 3) {
+            if (pkt_len == 0) {
+                pkt_len = (pkt[1]<<8 | pkt[2]) & 0x3ff;
+            }
+            if (pkt_len == 0 || pkt_len+6U > sizeof(pkt)) {
+                resync();
+                continue;
+            }
+            if (pkt_bytes >= pkt_len+6U) {
+                if (parse()) {
+                    return used;
+                }
+                continue;
+            }
+        }
+
+        if (used >= len) {
+            break;
+        }
+        // copy as much of the partial packet as we need
+        const uint16_t want = (pkt_bytes < 3 ? 3 : pkt_len+6) - pkt_bytes;
+        const uint16_t n = MIN(want, uint16_t(len - used));
+        memcpy(&pkt[pkt_bytes], &bytes[used], n);
+        pkt_bytes += n;
+        used += n;
+    }
+    return used;
+}
+
 #ifdef RTCM_MAIN_TEST
 /*
   parsing test, taking a raw file captured from UART to u-blox F9
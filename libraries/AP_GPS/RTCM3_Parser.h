@@ -28,6 +28,13 @@ public:
     // process one byte, return true if packet found
     bool read(uint8_t b);
 
+    // process a block of bytes, stopping after the first complete
+    // packet. Returns the number of bytes consumed, call get_len() to
+    // see if a packet was found. A packet that lies wholly within
+    // bytes is checked in place and not copied, so bytes must stay
+    // valid until the packet has been used
+    uint16_t read(const uint8_t *bytes, uint16_t len);
+
     // reset internal state
     void reset(void);
 
@@ -54,7 +61,11 @@ private:
 
     // length of found packet
     uint16_t found_len;
-    
+
+    // start of found packet, either pkt[] or the caller's buffer
+    const uint8_t *found_pkt;
+
+    static bool check_crc(const uint8_t *bytes, uint16_t len);
     bool parse(void);
     void resync(void);
 };
@@ -0,0 +1,84 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_GPS/RTCM3_Parser.h>
+#include <AP_Math/AP_Math.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+// a stream of MSM7 sized packets, as sent for an RTK base
+static uint8_t stream[4096];
+static uint16_t stream_len;
+
+static void setup_stream()
+{
+    if (stream_len != 0) {
+        return;
+    }
+    while (stream_len + 506U <= sizeof(stream)) {
+        uint8_t *buf = &stream[stream_len];
+        const uint16_t len = 500;
+        buf[0] = 0xD3;
+        buf[1] = len >> 8;
+        buf[2] = len & 0xFF;
+        for (uint16_t i=0; i<len; i++) {
+            buf[3+i] = uint8_t(i*13 + stream_len);
+        }
+        const uint32_t crc = crc_crc24(buf, len+3);
+        buf[len+3] = crc >> 16;
+        buf[len+4] = crc >> 8;
+        buf[len+5] = crc;
+        stream_len += len+6;
+    }
+}
+
+static void BM_RTCM3ByteRead(benchmark::State& state)
+{
+    setup_stream();
+    RTCM3_Parser parser {};
+    while (state.KeepRunning()) {
+        bool found = false;
+        for (uint16_t i=0; i<stream_len; i++) {
+            found |= parser.read(stream[i]);
+        }
+        gbenchmark_escape(&found);
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * stream_len);
+}
+
+// fed as 180 byte MAVLink GPS_RTCM_DATA fragments
+static void BM_RTCM3BlockRead(benchmark::State& state)
+{
+    setup_stream();
+    RTCM3_Parser parser {};
+    while (state.KeepRunning()) {
+        for (uint16_t ofs=0; ofs<stream_len; ofs += 180) {
+            const uint8_t *data = &stream[ofs];
+            uint16_t remaining = MIN(180, stream_len - ofs);
+            while (remaining > 0) {
+                const uint16_t used = parser.read(data, remaining);
+                data += used;
+                remaining -= used;
+                const uint8_t *bytes;
+                uint16_t len = parser.get_len(bytes);
+                gbenchmark_escape(&len);
+            }
+        }
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * stream_len);
+}
+
+static void BM_CRC24(benchmark::State& state)
+{
+    setup_stream();
+    while (state.KeepRunning()) {
+        uint32_t crc = crc_crc24(stream, stream_len);
+        gbenchmark_escape(&crc);
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * stream_len);
+}
+
+BENCHMARK(BM_RTCM3ByteRead);
+BENCHMARK(BM_RTCM3BlockRead);
+BENCHMARK(BM_CRC24);
+
+BENCHMARK_MAIN();
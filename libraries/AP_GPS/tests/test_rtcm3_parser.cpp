@@ -0,0 +1,127 @@
+#include <AP_gtest.h>
+
+#include <AP_GPS/RTCM3_Parser.h>
+#include <AP_Math/AP_Math.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+// build an RTCMv3 packet with a body of len bytes, returning its total length
+static uint16_t make_packet(uint8_t *buf, uint16_t id, uint16_t len, uint8_t seed)
+{
+    buf[0] = 0xD3;
+    buf[1] = len >> 8;
+    buf[2] = len & 0xFF;
+    buf[3] = id >> 4;
+    buf[4] = (id & 0xF) << 4;
+    for (uint16_t i=2; i<len; i++) {
+        buf[3+i] = uint8_t(seed + i*7);
+    }
+    const uint32_t crc = crc_crc24(buf, len+3);
+    buf[len+3] = crc >> 16;
+    buf[len+4] = crc >> 8;
+    buf[len+5] = crc;
+    return len + 6;
+}
+
+TEST(RTCM3_Parser, crc24)
+{
+    // CRC-24Q check value
+    const uint8_t check[] = "123456789";
+    EXPECT_EQ(0xCDE703U, crc_crc24(check, 9));
+}
+
+TEST(RTCM3_Parser, byte_read)
+{
+    uint8_t buf[200];
+    const uint16_t n = make_packet(buf, 1077, 100, 1);
+    RTCM3_Parser parser {};
+    for (uint16_t i=0; i<n-1; i++) {
+        EXPECT_FALSE(parser.read(buf[i]));
+    }
+    EXPECT_TRUE(parser.read(buf[n-1]));
+    const uint8_t *bytes;
+    EXPECT_EQ(n, parser.get_len(bytes));
+    EXPECT_EQ(1077, parser.get_id());
+}
+
+TEST(RTCM3_Parser, block_in_place)
+{
+    uint8_t buf[300];
+    buf[0] = 0x55;
+    buf[1] = 0xD3;  // junk that looks like a preamble
+    const uint16_t n = make_packet(&buf[2], 1005, 19, 2);
+    RTCM3_Parser parser {};
+    EXPECT_EQ(n+2, parser.read(buf, n+2));
+    const uint8_t *bytes;
+    EXPECT_EQ(n, parser.get_len(bytes));
+    // a whole packet in the caller's buffer isn't copied
+    EXPECT_EQ(&buf[2], bytes);
+    EXPECT_EQ(1005, parser.get_id());
+}
+
+TEST(RTCM3_Parser, block_split)
+{
+    uint8_t buf[1500];
+    uint16_t n = 0;
+    n += make_packet(&buf[n], 1074, 300, 3);
+    n += make_packet(&buf[n], 1084, 200, 4);
+    buf[n++] = 0xD3;
+    n += make_packet(&buf[n], 1094, 150, 5);
+    // corrupted packet
+    const uint16_t bad = n;
+    n += make_packet(&buf[n], 1124, 50, 6);
+    buf[bad+10] ^= 1;
+    n += make_packet(&buf[n], 1230, 10, 7);
+
+    const uint16_t expected_ids[] { 1074, 1084, 1094, 1230 };
+
+    // the byte at a time parser gives the reference packets
+    static uint8_t ref_pkt[ARRAY_SIZE(expected_ids)][RTCM3_MAX_PACKET_LEN];
+    uint16_t ref_len[ARRAY_SIZE(expected_ids)];
+    uint8_t ref_count = 0;
+    {
+        RTCM3_Parser parser {};
+        for (uint16_t i=0; i<n; i++) {
+            if (!parser.read(buf[i])) {
+                continue;
+            }
+            ASSERT_LT(ref_count, ARRAY_SIZE(expected_ids));
+            EXPECT_EQ(expected_ids[ref_count], parser.get_id());
+            const uint8_t *bytes;
+            ref_len[ref_count] = parser.get_len(bytes);
+            memcpy(ref_pkt[ref_count], bytes, ref_len[ref_count]);
+            ref_count++;
+        }
+    }
+    ASSERT_EQ(ARRAY_SIZE(expected_ids), ref_count);
+
+    // feed in every slice size and check we see the same packets
+    for (uint16_t slice=1; slice<=n; slice++) {
+        RTCM3_Parser parser {};
+        uint8_t found = 0;
+        for (uint16_t ofs=0; ofs<n; ofs += slice) {
+            const uint8_t *data = &buf[ofs];
+            uint16_t remaining = MIN(slice, uint16_t(n - ofs));
+            while (remaining > 0) {
+                const uint16_t used = parser.read(data, remaining);
+                data += used;
+                remaining -= used;
+                const uint8_t *bytes;
+                const uint16_t len = parser.get_len(bytes);
+                if (len > 0) {
+                    ASSERT_LT(found, ref_count) << "slice " << slice;
+                    EXPECT_EQ(expected_ids[found], parser.get_id()) << "slice " << slice;
+                    ASSERT_EQ(ref_len[found], len) << "slice " << slice;
+                    EXPECT_EQ(0, memcmp(ref_pkt[found], bytes, len)) << "slice " << slice;
+                    found++;
+                } else {
+                    // only stops early after a packet
+                    EXPECT_EQ(0, remaining);
+                }
+            }
+        }
+        EXPECT_EQ(ref_count, found) << "slice " << slice;
+    }
+}
+
+AP_GTEST_MAIN()
@@ -288,6 +288,13 @@
 #define HAL_ENABLE_THREAD_STATISTICS 0
 #endif
 
+// per thread event tracing to a Chrome trace file, see
+// AP_HAL/utility/ThreadTrace.h. Only supported by the SITL and Linux
+// HALs, which enable it in their board headers
+#ifndef AP_HAL_THREAD_TRACE_ENABLED
+#define AP_HAL_THREAD_TRACE_ENABLED 0
+#endif
+
 #ifndef AP_STATS_ENABLED
 #define AP_STATS_ENABLED 1
 #endif
@@ -126,6 +126,8 @@ public:
     static const CanIOFlags Loopback = 1;
     static const CanIOFlags AbortOnError = 2;
     static const CanIOFlags IsForwardedFrame = 4;
+    // frame carries an actuator command, HALs may track its latency
+    static const CanIOFlags IsActuatorCommand = 8;
 
     // Single Rx Frame with related info
     struct CanRxItem {
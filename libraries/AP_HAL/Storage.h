@@ -12,4 +12,8 @@ public:
     virtual void _timer_tick(void) {};
     virtual bool healthy(void) { return true; }
     virtual bool get_storage_ptr(void *&ptr, size_t &size) { return false; }
+
+    // true if writes reach the backing store in the order they were
+    // made, so a later write is never persisted ahead of an earlier one
+    virtual bool keeps_write_order(void) { return false; }
 };
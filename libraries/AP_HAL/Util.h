@@ -158,6 +158,9 @@ public:
     // request information on dma contention
     virtual void dma_info(ExpandingString &str) {}
 
+    // request information on semaphore contention
+    virtual void semaphore_info(ExpandingString &str) {}
+
     // request information on memory allocation
     virtual void mem_info(ExpandingString &str) {}
 
@@ -69,6 +69,11 @@
     #define HAL_LINUX_I2C_EXTERNAL_BUS_MASK 0xFFFF
 #endif
 
+// needed by the semaphores
+#ifndef AP_HAL_THREAD_TRACE_ENABLED
+#define AP_HAL_THREAD_TRACE_ENABLED 1
+#endif
+
 // only include if compiling C++ code
 #ifdef __cplusplus
 #include <AP_HAL_Linux/Semaphores.h>
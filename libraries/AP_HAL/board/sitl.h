@@ -58,6 +58,11 @@
 #define HAL_HAVE_SERVO_VOLTAGE 1
 #define HAL_HAVE_SAFETY_SWITCH 1
 
+// needed by the semaphores
+#ifndef AP_HAL_THREAD_TRACE_ENABLED
+#define AP_HAL_THREAD_TRACE_ENABLED 1
+#endif
+
 // only include if compiling C++ code
 #ifdef __cplusplus
 // allow for static semaphores
@@ -45,6 +45,10 @@
 
 #include <errno.h>
 
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+#include <sys/uio.h>
+#endif
+
 #if AP_NETWORKING_BACKEND_CHIBIOS || AP_NETWORKING_BACKEND_PPP
 #define CALL_PREFIX(x) ::lwip_##x
 #else
@@ -362,25 +366,82 @@ ssize_t SOCKET_CLASS_NAME::recv(void *buf, size_t size, uint32_t timeout_ms)
         }
         return ret;
     }
-    if (fd_in != -1) {
-        /*
-          for multicast check we are not receiving from ourselves
-         */
-        struct sockaddr_in send_addr;
-        socklen_t send_len = sizeof(send_addr);
-        if (CALL_PREFIX(getsockname)(fd, (struct sockaddr *)&send_addr, &send_len) != 0) {
+    if (received_from_self()) {
+        // discard packets from ourselves
+        return -1;
+    }
+    return ret;
+}
+
+/*
+  for multicast check we are not receiving from ourselves
+ */
+bool SOCKET_CLASS_NAME::received_from_self(void) const
+{
+    if (fd_in == -1) {
+        return false;
+    }
+    struct sockaddr_in send_addr;
+    socklen_t send_len = sizeof(send_addr);
+    if (CALL_PREFIX(getsockname)(fd, (struct sockaddr *)&send_addr, &send_len) != 0) {
+        return true;
+    }
+    const struct sockaddr_in &sin = *(struct sockaddr_in *)&last_in_addr[0];
+    return sin.sin_port == send_addr.sin_port &&
+        sin.sin_family == send_addr.sin_family &&
+        sin.sin_addr.s_addr == send_addr.sin_addr.s_addr;
+}
+
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+/*
+  fill in a msghdr for the buffers in vec
+ */
+static void make_msghdr(struct msghdr &msg, struct iovec *iov, const ByteBuffer::IoVec *vec, uint8_t count)
+{
+    for (uint8_t i=0; i<count; i++) {
+        iov[i].iov_base = vec[i].data;
+        iov[i].iov_len = vec[i].len;
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+}
+
+/*
+  send a batch of datagrams
+ */
+int SOCKET_CLASS_NAME::send_batch(const ByteBuffer::IoVec *vec, const uint8_t *vec_counts, uint8_t num_datagrams,
+                                  uint32_t address, uint16_t port) const
+{
+    if (fd == -1 || num_datagrams > max_batch) {
+        return -1;
+    }
+    struct sockaddr_in sockaddr {};
+#ifdef HAVE_SOCK_SIN_LEN
+    sockaddr.sin_len = sizeof(sockaddr);
+#endif
+    sockaddr.sin_port = htons(port);
+    sockaddr.sin_family = AF_INET;
+    sockaddr.sin_addr.s_addr = htonl(address);
+
+    struct iovec iov[max_batch*2];
+    struct mmsghdr msgs[max_batch];
+    uint8_t v = 0;
+    for (uint8_t i=0; i<num_datagrams; i++) {
+        if (v + vec_counts[i] > ARRAY_SIZE(iov)) {
             return -1;
         }
-        const struct sockaddr_in &sin = *(struct sockaddr_in *)&last_in_addr[0];
-        if (sin.sin_port == send_addr.sin_port &&
-            sin.sin_family == send_addr.sin_family &&
-            sin.sin_addr.s_addr == send_addr.sin_addr.s_addr) {
-            // discard packets from ourselves
-            return -1;
+        make_msghdr(msgs[i].msg_hdr, &iov[v], &vec[v], vec_counts[i]);
+        msgs[i].msg_len = 0;
+        if (address != 0) {
+            msgs[i].msg_hdr.msg_name = &sockaddr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr);
         }
+        v += vec_counts[i];
     }
-    return ret;
+    return CALL_PREFIX(sendmmsg)(fd, msgs, num_datagrams, MSG_NOSIGNAL);
 }
+#endif  // AP_NETWORKING_BATCHED_IO_ENABLED
 
 /*
   return the IP address and port of the last received packet
@@ -18,6 +18,7 @@
 
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Networking/AP_Networking_Config.h>
+#include "RingBuffer.h"
 
 #if AP_NETWORKING_SOCKETS_ENABLED || defined(AP_SOCKET_NATIVE_ENABLED)
 
@@ -46,6 +47,18 @@ public:
     ssize_t sendto(const void *buf, size_t size, uint32_t address, uint16_t port);
     ssize_t recv(void *pkt, size_t size, uint32_t timeout_ms);
 
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+    /*
+      send up to max_batch datagrams in one system call. Datagram i
+      is made of the next vec_counts[i] buffers in vec. The datagrams
+      go to address and port, or to the connected address if address
+      is zero. Returns the number of datagrams sent, or -1
+     */
+    static const uint8_t max_batch = 16;
+    int send_batch(const ByteBuffer::IoVec *vec, const uint8_t *vec_counts, uint8_t num_datagrams,
+                   uint32_t address, uint16_t port) const;
+#endif
+
     // return the IP address and port of the last received packet
     void last_recv_address(const char *&ip_addr, uint16_t &port) const;
 
@@ -76,6 +89,11 @@ public:
         return fd_in != -1? fd_in : fd;
     }
 
+    // get a FD suitable for write selection
+    int get_write_fd(void) const {
+        return fd;
+    }
+
     // create a new socket with same fd, but new memory
     // the old socket gets fd of -1
     SOCKET_CLASS_NAME *duplicate(void);
@@ -96,6 +114,8 @@ private:
     // mixing native sockets and lwip sockets in SITL
     uint32_t last_in_addr[4];
     bool is_multicast_address(struct sockaddr_in &addr) const;
+    // true if the last packet received on a multicast socket was our own
+    bool received_from_self(void) const;
 
     int fd = -1;
 
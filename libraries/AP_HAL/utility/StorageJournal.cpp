@@ -0,0 +1,370 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  log structured storage for boards that keep storage in a file
+ */
+#include "StorageJournal.h"
+
+#if AP_HAL_STORAGE_JOURNAL_ENABLED
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/*
+  load the base image and replay the journal
+ */
+bool StorageJournal::init(const char *base_path)
+{
+    if (strlen(base_path) >= sizeof(_base_path)) {
+        return false;
+    }
+    strncpy(_base_path, base_path, sizeof(_base_path));
+    snprintf(_journal_path, sizeof(_journal_path), "%s.jnl", base_path);
+    snprintf(_tmp_path, sizeof(_tmp_path), "%s.tmp", base_path);
+    strncpy(_dir_path, base_path, sizeof(_dir_path));
+    char *slash = strrchr(_dir_path, '/');
+    if (slash != nullptr) {
+        *slash = 0;
+    } else {
+        strncpy(_dir_path, ".", sizeof(_dir_path));
+    }
+
+    if (_commit_buf == nullptr) {
+        _commit_buf = (uint8_t *)malloc(max_commit_size);
+        if (_commit_buf == nullptr) {
+            return false;
+        }
+    }
+
+    int fd = open(_base_path, O_RDWR|O_CREAT|O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    const ssize_t ret = read(fd, _buffer, HAL_STORAGE_SIZE);
+    close(fd);
+    if (ret < 0) {
+        return false;
+    }
+    if (ret < HAL_STORAGE_SIZE) {
+        // a new or short base file, the rest of the image is blank
+        memset(&_buffer[ret], 0, HAL_STORAGE_SIZE - ret);
+    }
+
+    if (_journal_fd != -1) {
+        close(_journal_fd);
+    }
+    _journal_fd = open(_journal_path, O_RDWR|O_CREAT|O_APPEND|O_CLOEXEC, 0644);
+    if (_journal_fd == -1) {
+        return false;
+    }
+
+    journal_header jh;
+    if (pread(_journal_fd, &jh, sizeof(jh), 0) == sizeof(jh) &&
+        jh.magic == journal_magic &&
+        jh.base_crc == crc_crc32(0, _buffer, HAL_STORAGE_SIZE)) {
+        _journal_len = replay();
+        // drop any torn commit from the end so new commits follow
+        // the last good one
+        if (ftruncate(_journal_fd, _journal_len) != 0) {
+            close(_journal_fd);
+            _journal_fd = -1;
+            return false;
+        }
+    } else if (!start_journal(_buffer)) {
+        // the journal was written against some other base image, or
+        // is new
+        close(_journal_fd);
+        _journal_fd = -1;
+        return false;
+    }
+
+    _dirty.clearall();
+    _write_failed = false;
+    return true;
+}
+
+/*
+  empty the journal and start it for the given base image
+ */
+bool StorageJournal::start_journal(const uint8_t *base)
+{
+    journal_header jh;
+    jh.magic = journal_magic;
+    jh.base_crc = crc_crc32(0, base, HAL_STORAGE_SIZE);
+    if (ftruncate(_journal_fd, 0) != 0 ||
+        ::write(_journal_fd, &jh, sizeof(jh)) != sizeof(jh) ||
+        fsync(_journal_fd) != 0) {
+        return false;
+    }
+    _journal_len = sizeof(jh);
+    return true;
+}
+
+/*
+  CRC over the header fields and range data of a commit
+ */
+uint32_t StorageJournal::commit_crc(const commit_header &hdr, const uint8_t *data)
+{
+    const uint32_t crc = crc_crc32(0, (const uint8_t *)&hdr, offsetof(commit_header, crc));
+    return crc_crc32(crc, data, hdr.length);
+}
+
+/*
+  apply all complete commits from the journal to the image, returning
+  the length of the valid part of the journal
+ */
+uint32_t StorageJournal::replay(void)
+{
+    uint32_t ofs = sizeof(journal_header);
+    while (true) {
+        commit_header hdr;
+        if (pread(_journal_fd, &hdr, sizeof(hdr), ofs) != sizeof(hdr) ||
+            hdr.magic != commit_magic ||
+            hdr.length > max_commit_size - sizeof(hdr)) {
+            break;
+        }
+        uint8_t *data = &_commit_buf[sizeof(hdr)];
+        if (pread(_journal_fd, data, hdr.length, ofs + sizeof(hdr)) != ssize_t(hdr.length) ||
+            commit_crc(hdr, data) != hdr.crc) {
+            break;
+        }
+
+        // check all ranges before applying any of them
+        bool ok = true;
+        uint32_t pos = 0;
+        for (uint16_t i=0; i<hdr.num_ranges && ok; i++) {
+            range_header rh;
+            if (pos + sizeof(rh) > hdr.length) {
+                ok = false;
+                break;
+            }
+            memcpy(&rh, &data[pos], sizeof(rh));
+            pos += sizeof(rh);
+            ok = rh.length <= hdr.length - pos &&
+                rh.offset <= HAL_STORAGE_SIZE &&
+                rh.length <= HAL_STORAGE_SIZE - rh.offset;
+            pos += rh.length;
+        }
+        if (!ok || pos != hdr.length) {
+            break;
+        }
+        pos = 0;
+        for (uint16_t i=0; i<hdr.num_ranges; i++) {
+            range_header rh;
+            memcpy(&rh, &data[pos], sizeof(rh));
+            pos += sizeof(rh);
+            memcpy(&_buffer[rh.offset], &data[pos], rh.length);
+            pos += rh.length;
+        }
+
+        _seq = hdr.seq;
+        ofs += sizeof(hdr) + hdr.length;
+    }
+    return ofs;
+}
+
+/*
+  change part of the image. Taking the semaphore keeps a commit from
+  copying the image part way through a run of writes
+ */
+void StorageJournal::write(uint16_t loc, const void *src, uint16_t length)
+{
+    WITH_SEMAPHORE(_sem);
+    memcpy(&_buffer[loc], src, length);
+    mark_dirty(loc, length);
+}
+
+/*
+  mark some lines as dirty, called with the semaphore held
+ */
+void StorageJournal::mark_dirty(uint16_t loc, uint16_t length)
+{
+    if (length == 0) {
+        return;
+    }
+    const uint32_t now = AP_HAL::millis();
+    if (_dirty.empty()) {
+        _first_change_ms = now;
+    }
+    _last_change_ms = now;
+    const uint16_t end = loc + length - 1;
+    for (uint16_t line=loc>>line_shift; line <= end>>line_shift; line++) {
+        _dirty.set(line);
+    }
+}
+
+/*
+  write all dirty lines to the journal as a single commit
+ */
+bool StorageJournal::flush(void)
+{
+    if (_journal_fd == -1 || _commit_buf == nullptr) {
+        return false;
+    }
+
+    uint8_t *data = &_commit_buf[sizeof(commit_header)];
+    uint32_t pos = 0;
+    uint16_t num_ranges = 0;
+    uint16_t line = 0;
+    // the commit is a copy of the image at one point in time
+    _sem.take_blocking();
+    if (_dirty.empty()) {
+        _sem.give();
+        return true;
+    }
+    while (line < num_lines) {
+        if (!_dirty.get(line)) {
+            line++;
+            continue;
+        }
+        const uint16_t start = line;
+        while (line < num_lines && _dirty.get(line)) {
+            _dirty.clear(line);
+            line++;
+        }
+        range_header rh;
+        rh.offset = uint32_t(start) << line_shift;
+        rh.length = MIN(uint32_t(line - start) << line_shift, HAL_STORAGE_SIZE - rh.offset);
+        memcpy(&data[pos], &rh, sizeof(rh));
+        pos += sizeof(rh);
+        memcpy(&data[pos], &_buffer[rh.offset], rh.length);
+        pos += rh.length;
+        num_ranges++;
+    }
+    _sem.give();
+
+    commit_header hdr;
+    hdr.magic = commit_magic;
+    hdr.seq = _seq + 1;
+    hdr.num_ranges = num_ranges;
+    hdr.length = pos;
+    hdr.crc = commit_crc(hdr, data);
+    memcpy(_commit_buf, &hdr, sizeof(hdr));
+
+    const ssize_t total = sizeof(hdr) + pos;
+    if (::write(_journal_fd, _commit_buf, total) != total ||
+        fsync(_journal_fd) != 0) {
+        // drop anything partially written and try again with the
+        // whole image on the next update
+        if (ftruncate(_journal_fd, _journal_len) != 0) {
+            close(_journal_fd);
+            _journal_fd = -1;
+        }
+        WITH_SEMAPHORE(_sem);
+        _dirty.setall();
+        _write_failed = true;
+        return false;
+    }
+    _seq = hdr.seq;
+    _journal_len += total;
+    _num_commits++;
+    _write_failed = false;
+    return true;
+}
+
+/*
+  write the image to a new base file. The rename makes the switch
+  atomic; if we crash before the journal is restarted then its base
+  CRC no longer matches and it is discarded, which is fine as the new
+  base already holds all of its commits
+ */
+bool StorageJournal::compact(void)
+{
+    if (_journal_fd == -1 || _commit_buf == nullptr || !_dirty.empty()) {
+        return false;
+    }
+
+    {
+        // take a copy so the image written is the one the journal
+        // describes
+        WITH_SEMAPHORE(_sem);
+        if (!_dirty.empty()) {
+            return false;
+        }
+        memcpy(_commit_buf, _buffer, HAL_STORAGE_SIZE);
+    }
+
+    int fd = open(_tmp_path, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    const bool ok = ::write(fd, _commit_buf, HAL_STORAGE_SIZE) == HAL_STORAGE_SIZE &&
+        fsync(fd) == 0;
+    close(fd);
+    if (!ok || rename(_tmp_path, _base_path) != 0) {
+        unlink(_tmp_path);
+        return false;
+    }
+    int dfd = open(_dir_path, O_RDONLY|O_CLOEXEC);
+    if (dfd != -1) {
+        fsync(dfd);
+        close(dfd);
+    }
+
+    if (!start_journal(_commit_buf)) {
+        // a journal we can't write to is no use
+        close(_journal_fd);
+        _journal_fd = -1;
+        _write_failed = true;
+        return false;
+    }
+    _num_compactions++;
+    return true;
+}
+
+/*
+  commit changes once writes have stopped for a while, and compact in
+  between commits
+ */
+void StorageJournal::update(void)
+{
+    const uint32_t now = AP_HAL::millis();
+    if (!_dirty.empty()) {
+        if (now - _last_change_ms < quiet_ms &&
+            now - _first_change_ms < max_delay_ms) {
+            // more changes are probably on the way
+            return;
+        }
+        flush();
+        return;
+    }
+    if (_journal_len > compact_threshold) {
+        compact();
+    }
+}
+
+/*
+  consider storage healthy if the last commit succeeded and no change
+  has been waiting for more than 2 seconds. Steady writes always leave
+  something dirty, but update() still commits them within
+  max_delay_ms
+ */
+bool StorageJournal::healthy(void) const
+{
+    if (_journal_fd == -1 || _write_failed) {
+        return false;
+    }
+    return _dirty.empty() || AP_HAL::millis() - _first_change_ms < 2000;
+}
+
+#endif // AP_HAL_STORAGE_JOURNAL_ENABLED
@@ -0,0 +1,151 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  log structured storage for boards that keep storage in a file
+
+  The storage image lives in RAM. Changes to it are coalesced and
+  appended to a journal file as CRC protected commits, so a mission
+  upload or a bulk parameter set becomes a few sequential writes and
+  fsyncs instead of one per storage line. When the journal grows too
+  large the image is written to a new base file which is renamed over
+  the old one, and the journal is emptied.
+
+  Each commit holds a copy of every changed line taken at a single
+  point in time, so writes are saved in the order they are made: after
+  a power loss a later write is never present without an earlier one.
+
+  On startup the base file is loaded and the journal replayed. A torn
+  commit at the end of the journal (from a crash or power loss) fails
+  its CRC check and is discarded as a whole. The journal starts with
+  the CRC of the base image it applies to, so a journal left beside a
+  base file which was replaced or deleted is discarded rather than
+  replayed over it.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL_Boards.h>
+
+#ifndef AP_HAL_STORAGE_JOURNAL_ENABLED
+#define AP_HAL_STORAGE_JOURNAL_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif
+
+#if AP_HAL_STORAGE_JOURNAL_ENABLED
+
+#include <stdint.h>
+#include <AP_Common/AP_Common.h>
+#include <AP_Common/Bitmask.h>
+#include <AP_HAL/Semaphores.h>
+
+class StorageJournal {
+public:
+    // buffer is the RAM image, HAL_STORAGE_SIZE bytes long
+    StorageJournal(uint8_t *buffer) : _buffer(buffer) {}
+
+    CLASS_NO_COPY(StorageJournal);
+
+    /*
+      load the image from base_path and replay the journal kept
+      beside it. Returns false if the files can't be used
+     */
+    bool init(const char *base_path);
+
+    // change part of the image
+    void write(uint16_t loc, const void *src, uint16_t length);
+
+    // called regularly from the storage timer
+    void update(void);
+
+    // commit all pending changes now
+    bool flush(void);
+
+    // write the image to a new base file and empty the journal
+    bool compact(void);
+
+    // true if commits are succeeding and changes are not waiting
+    // much longer than max_delay_ms
+    bool healthy(void) const;
+
+    uint32_t journal_length(void) const { return _journal_len; }
+    uint32_t num_commits(void) const { return _num_commits; }
+    uint32_t num_compactions(void) const { return _num_compactions; }
+
+private:
+    static const uint8_t line_shift = 4;
+    static const uint16_t line_size = 1U<<line_shift;
+    static const uint16_t num_lines = (HAL_STORAGE_SIZE + line_size - 1) / line_size;
+
+    // wait for writes to stop for this long before committing
+    static const uint16_t quiet_ms = 100;
+    // but don't hold changes for longer than this
+    static const uint16_t max_delay_ms = 1000;
+    // compact when the journal gets this large
+    static const uint32_t compact_threshold = 4 * HAL_STORAGE_SIZE;
+
+    static const uint32_t commit_magic = 0x4A524E32;
+    static const uint32_t journal_magic = 0x4A524E48;
+
+    // at the start of the journal file
+    struct PACKED journal_header {
+        uint32_t magic;
+        uint32_t base_crc;  // CRC of the base image the commits apply to
+    };
+
+    // each commit is a header followed by num_ranges ranges, each a
+    // range_header followed by the data. The CRC covers the header
+    // fields before it and all of the range data
+    struct PACKED commit_header {
+        uint32_t magic;
+        uint32_t seq;
+        uint16_t num_ranges;
+        uint32_t length;
+        uint32_t crc;
+    };
+    struct PACKED range_header {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    // largest possible commit, every other line dirty
+    static const uint32_t max_commit_size = sizeof(commit_header) + HAL_STORAGE_SIZE + (num_lines/2+1) * sizeof(range_header);
+
+    uint8_t *_buffer;
+    // held while changing the image or copying it for a commit
+    HAL_Semaphore _sem;
+    uint8_t *_commit_buf = nullptr;
+    Bitmask<num_lines> _dirty;
+
+    char _base_path[128];
+    char _journal_path[132];
+    char _tmp_path[132];
+    char _dir_path[128];
+
+    int _journal_fd = -1;
+    uint32_t _journal_len;
+    uint32_t _seq;
+
+    uint32_t _first_change_ms;
+    uint32_t _last_change_ms;
+    bool _write_failed;
+
+    uint32_t _num_commits = 0;
+    uint32_t _num_compactions = 0;
+
+    void mark_dirty(uint16_t loc, uint16_t length);
+    uint32_t replay(void);
+    bool start_journal(const uint8_t *base);
+    static uint32_t commit_crc(const commit_header &hdr, const uint8_t *data);
+};
+
+#endif // AP_HAL_STORAGE_JOURNAL_ENABLED
@@ -0,0 +1,420 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThreadTrace.h"
+
+#if AP_HAL_THREAD_TRACE_ENABLED
+
+#include <AP_Common/AP_Common.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+std::atomic<bool> ThreadTrace::_active;
+
+namespace {
+
+// events buffered per thread. A thread which records events faster
+// than the rings are drained loses events, and the losses are marked
+// in the trace
+static constexpr uint32_t ring_size = 16384;
+static constexpr uint32_t flush_period_us = 100000;
+// how often, in events, a thread checks whether it has been renamed
+// after its first few events
+static constexpr uint32_t name_check_interval = 1024;
+static constexpr uint8_t name_len = 16;
+
+struct Event {
+    uint64_t start_us;
+    uint32_t dur_us;
+    ThreadTrace::Kind kind;
+    const char *name;
+    uintptr_t arg;
+};
+
+/*
+  single producer, single consumer ring. The owning thread writes
+  events and advances head, the flush thread reads them and advances
+  tail. Rings are never freed; the ring of a thread which has exited
+  is reused by a new thread once it has been drained.
+
+  The owning thread also writes the name, guarded by the name_seq
+  seqlock so neither side needs a lock
+ */
+struct Ring {
+    Ring *next;
+    std::atomic<uint32_t> tid;
+    std::atomic<bool> in_use;
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> dropped;
+    uint32_t name_check;
+    std::atomic<uint32_t> name_seq;
+    char name[name_len];
+    // only used by the flush side
+    uint32_t tid_written;
+    char name_written[name_len];
+    Event events[ring_size];
+};
+
+static const struct {
+    const char *name;
+    const char *cat;
+    const char *arg;
+    bool hex;
+} kinds[] {
+    { "sem wait",    "sem",      "sem",     true },
+    { "sem hold",    "sem",      "sem",     true },
+    { "delay",       "sleep",    "us",      false },
+    { "task",        "task",     nullptr,   false },
+    { "timer procs", "callback", "count",   false },
+    { "io procs",    "callback", "count",   false },
+    { "tick",        "thread",   "late_us", false },
+};
+static_assert(ARRAY_SIZE(kinds) == uint8_t(ThreadTrace::Kind::THREAD_TICK) + 1, "kinds must match ThreadTrace::Kind");
+
+// rings_mtx is taken when a thread claims a ring, once per thread,
+// and is never held over file IO. Rings are only added to the front
+// of the list, so it can be walked without the lock. These can't be
+// HAL_Semaphores as those are traced
+static pthread_mutex_t rings_mtx = PTHREAD_MUTEX_INITIALIZER;
+static std::atomic<Ring *> rings;
+static uint32_t next_tid = 1;
+
+// flush_mtx makes the flush side a single consumer and protects the
+// file. It is never taken when recording events
+static pthread_mutex_t flush_mtx = PTHREAD_MUTEX_INITIALIZER;
+static FILE *trace_file;
+static bool first_event;
+// events are copied out of a ring here before they are written, so
+// the ring has its space back without waiting for file IO
+static Event *drain_buf;
+
+static pthread_t flush_thread;
+static std::atomic<bool> flush_running;
+
+static pthread_once_t key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+static thread_local Ring *thread_ring;
+
+static void get_thread_name(char name[name_len])
+{
+    name[0] = 0;
+#if !defined(__OpenBSD__)
+    pthread_getname_np(pthread_self(), name, name_len);
+#endif
+    name[name_len-1] = 0;
+}
+
+// set the name of a ring, only called by the thread owning it
+static void set_ring_name(Ring *r, const char name[name_len])
+{
+    const uint32_t seq = r->name_seq.load(std::memory_order_relaxed);
+    r->name_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(r->name, name, name_len);
+    r->name_seq.store(seq + 2, std::memory_order_release);
+}
+
+// read the name of a ring, retrying if the owner changes it meanwhile
+static void get_ring_name(const Ring *r, char name[name_len])
+{
+    while (true) {
+        const uint32_t seq = r->name_seq.load(std::memory_order_acquire);
+        if ((seq & 1) == 0) {
+            memcpy(name, r->name, name_len);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (r->name_seq.load(std::memory_order_relaxed) == seq) {
+                break;
+            }
+        }
+        sched_yield();
+    }
+    name[name_len-1] = 0;
+}
+
+// called on thread exit to free the thread's ring for reuse
+static void release_ring(void *ptr)
+{
+    static_cast<Ring *>(ptr)->in_use.store(false);
+}
+
+static void make_ring_key()
+{
+    pthread_key_create(&ring_key, release_ring);
+}
+
+static Ring *get_ring()
+{
+    if (thread_ring != nullptr) {
+        return thread_ring;
+    }
+    pthread_once(&key_once, make_ring_key);
+
+    pthread_mutex_lock(&rings_mtx);
+    Ring *r = nullptr;
+    for (Ring *p = rings.load(); p != nullptr; p = p->next) {
+        if (!p->in_use.load() && p->head.load() == p->tail.load()) {
+            r = p;
+            break;
+        }
+    }
+    if (r == nullptr) {
+        r = NEW_NOTHROW Ring {};
+        if (r == nullptr) {
+            pthread_mutex_unlock(&rings_mtx);
+            return nullptr;
+        }
+        r->next = rings.load();
+        rings.store(r);
+    }
+    r->in_use.store(true);
+    r->tid.store(next_tid++);
+    r->name_check = 1;
+    char name[name_len];
+    get_thread_name(name);
+    set_ring_name(r, name);
+    pthread_mutex_unlock(&rings_mtx);
+
+    pthread_setspecific(ring_key, r);
+    thread_ring = r;
+    return r;
+}
+
+/*
+  thread names are usually set by the creating thread after the thread
+  has started, so a thread may record events before it has its name
+ */
+static void update_name(Ring *r)
+{
+    char name[name_len];
+    get_thread_name(name);
+    if (strncmp(name, r->name, name_len) != 0) {
+        set_ring_name(r, name);
+    }
+}
+
+static void write_separator()
+{
+    if (!first_event) {
+        fputs(",\n", trace_file);
+    }
+    first_event = false;
+}
+
+static void write_event(uint32_t tid, const Event &e)
+{
+    const uint8_t k = uint8_t(e.kind);
+    if (k >= ARRAY_SIZE(kinds)) {
+        return;
+    }
+    write_separator();
+    fprintf(trace_file,
+            "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%" PRIu64 ",\"dur\":%" PRIu32 ",\"pid\":1,\"tid\":%" PRIu32,
+            e.name != nullptr ? e.name : kinds[k].name,
+            kinds[k].cat,
+            e.start_us,
+            e.dur_us,
+            tid);
+    if (kinds[k].arg != nullptr) {
+        if (kinds[k].hex) {
+            fprintf(trace_file, ",\"args\":{\"%s\":\"0x%" PRIxPTR "\"}", kinds[k].arg, e.arg);
+        } else {
+            fprintf(trace_file, ",\"args\":{\"%s\":%" PRIuPTR "}", kinds[k].arg, e.arg);
+        }
+    }
+    fputs("}", trace_file);
+}
+
+// write out all events in the rings, called with flush_mtx held
+static void flush_rings()
+{
+    for (Ring *r = rings.load(); r != nullptr; r = r->next) {
+        const uint32_t tail = r->tail.load(std::memory_order_relaxed);
+        const uint32_t head = r->head.load(std::memory_order_acquire);
+        // a reused ring only has events once its new tid is set
+        const uint32_t tid = r->tid.load();
+        const uint32_t count = head - tail;
+        for (uint32_t i = 0; i < count; i++) {
+            drain_buf[i] = r->events[(tail + i) % ring_size];
+        }
+        r->tail.store(head, std::memory_order_release);
+        const uint32_t dropped = r->dropped.exchange(0);
+
+        if (count != 0) {
+            char name[name_len];
+            get_ring_name(r, name);
+            if (tid != r->tid_written || strncmp(name, r->name_written, name_len) != 0) {
+                r->tid_written = tid;
+                memcpy(r->name_written, name, name_len);
+                write_separator();
+                if (name[0] != 0) {
+                    fprintf(trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"name\":\"%s\"}}",
+                            tid, name);
+                } else {
+                    fprintf(trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"name\":\"thread %" PRIu32 "\"}}",
+                            tid, tid);
+                }
+            }
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            write_event(tid, drain_buf[i]);
+        }
+
+        if (dropped != 0) {
+            write_separator();
+            fprintf(trace_file, "{\"name\":\"dropped events\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%" PRIu64 ",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"count\":%" PRIu32 "}}",
+                    AP_HAL::micros64(), tid, dropped);
+        }
+    }
+    fflush(trace_file);
+}
+
+static void *flush_main(void *)
+{
+    while (flush_running.load()) {
+        usleep(flush_period_us);
+        pthread_mutex_lock(&flush_mtx);
+        flush_rings();
+        pthread_mutex_unlock(&flush_mtx);
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+void ThreadTrace::init()
+{
+    const char *path = getenv("AP_THREAD_TRACE");
+    if (path == nullptr || path[0] == 0) {
+        return;
+    }
+    if (!start(path)) {
+        ::fprintf(stderr, "ThreadTrace: failed to start tracing to %s\n", path);
+        return;
+    }
+    ::fprintf(stderr, "ThreadTrace: tracing to %s\n", path);
+    atexit(stop);
+}
+
+bool ThreadTrace::start(const char *path)
+{
+    pthread_mutex_lock(&flush_mtx);
+    if (trace_file != nullptr) {
+        pthread_mutex_unlock(&flush_mtx);
+        return false;
+    }
+    if (drain_buf == nullptr) {
+        drain_buf = NEW_NOTHROW Event[ring_size];
+        if (drain_buf == nullptr) {
+            pthread_mutex_unlock(&flush_mtx);
+            return false;
+        }
+    }
+    trace_file = fopen(path, "w");
+    if (trace_file == nullptr) {
+        pthread_mutex_unlock(&flush_mtx);
+        return false;
+    }
+    // the closing bracket is optional in the array format, so a trace
+    // cut short by a crash can still be loaded
+    fputs("[\n", trace_file);
+    first_event = true;
+
+    // discard anything left over from an earlier trace
+    for (Ring *r = rings.load(); r != nullptr; r = r->next) {
+        r->tail.store(r->head.load());
+        r->dropped.store(0);
+        r->tid_written = 0;
+    }
+    pthread_mutex_unlock(&flush_mtx);
+
+    // the flush thread does file IO, so it mustn't inherit a
+    // realtime priority from the thread starting it
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    struct sched_param param {};
+    pthread_attr_setschedparam(&attr, &param);
+
+    flush_running.store(true);
+    const int ret = pthread_create(&flush_thread, &attr, flush_main, nullptr);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
+        flush_running.store(false);
+        pthread_mutex_lock(&flush_mtx);
+        fclose(trace_file);
+        trace_file = nullptr;
+        pthread_mutex_unlock(&flush_mtx);
+        return false;
+    }
+#if !defined(__APPLE__) && !defined(__OpenBSD__)
+    pthread_setname_np(flush_thread, "ap-trace");
+#endif
+
+    _active.store(true);
+    return true;
+}
+
+void ThreadTrace::stop()
+{
+    if (!flush_running.load()) {
+        return;
+    }
+    _active.store(false);
+    flush_running.store(false);
+    pthread_join(flush_thread, nullptr);
+
+    pthread_mutex_lock(&flush_mtx);
+    flush_rings();
+    fputs("\n]\n", trace_file);
+    fclose(trace_file);
+    trace_file = nullptr;
+    pthread_mutex_unlock(&flush_mtx);
+}
+
+void ThreadTrace::record(Kind kind, uint64_t start_us, uintptr_t arg, const char *name)
+{
+    const uint64_t now_us = AP_HAL::micros64();
+    Ring *r = get_ring();
+    if (r == nullptr) {
+        return;
+    }
+    r->name_check++;
+    if (r->name_check < 16 || r->name_check % name_check_interval == 0) {
+        update_name(r);
+    }
+
+    const uint32_t head = r->head.load(std::memory_order_relaxed);
+    if (head - r->tail.load(std::memory_order_acquire) >= ring_size) {
+        r->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Event &e = r->events[head % ring_size];
+    e.start_us = start_us;
+    const uint64_t dur_us = now_us > start_us ? now_us - start_us : 0;
+    e.dur_us = dur_us < UINT32_MAX ? uint32_t(dur_us) : UINT32_MAX;
+    e.kind = kind;
+    e.name = name;
+    e.arg = arg;
+    r->head.store(head + 1, std::memory_order_release);
+}
+
+#endif  // AP_HAL_THREAD_TRACE_ENABLED
@@ -0,0 +1,87 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL_Boards.h>
+
+#if AP_HAL_THREAD_TRACE_ENABLED
+
+#include <stdint.h>
+#include <atomic>
+#include <AP_HAL/system.h>
+
+/*
+  per thread event tracing for the SITL and Linux HALs
+
+  Each thread records events into a ring of its own, without locks,
+  and a background thread drains the rings into a file in Chrome trace
+  event format which can be opened in Perfetto (ui.perfetto.dev) or
+  chrome://tracing. Tracing is started by setting the AP_THREAD_TRACE
+  environment variable to the file name before starting the
+  vehicle. When tracing isn't running each hook costs a load and a
+  branch.
+
+  Hooks look like:
+
+    const uint64_t trace_start_us = ThreadTrace::begin();
+    ... the work being traced ...
+    ThreadTrace::end(ThreadTrace::Kind::DELAY, trace_start_us, usec);
+ */
+class ThreadTrace {
+public:
+    enum class Kind : uint8_t {
+        SEM_WAIT,       // waiting to take a semaphore, arg is the semaphore
+        SEM_HOLD,       // semaphore held, arg is the semaphore
+        DELAY,          // delay, arg is the requested delay in microseconds
+        TASK,           // scheduler task, name is the task name
+        TIMER_PROCS,    // timer callbacks, arg is the number of callbacks
+        IO_PROCS,       // IO callbacks, arg is the number of callbacks
+        THREAD_TICK,    // one run of a periodic thread, arg is how late it woke in microseconds
+    };
+
+    // start tracing if AP_THREAD_TRACE is set, called by the HAL
+    // scheduler on startup
+    static void init();
+
+    // start tracing to a file, returning false if it can't be opened
+    static bool start(const char *path);
+
+    // stop tracing, writing out all events recorded so far
+    static void stop();
+
+    static bool active() {
+        return _active.load(std::memory_order_relaxed);
+    }
+
+    // start time of an event, or zero if not tracing
+    static uint64_t begin() {
+        return active() ? AP_HAL::micros64() : 0;
+    }
+
+    // record an event that started at start_us and finishes now.
+    // name must point at a string which is never freed
+    static void end(Kind kind, uint64_t start_us, uintptr_t arg=0, const char *name=nullptr) {
+        if (start_us != 0) {
+            record(kind, start_us, arg, name);
+        }
+    }
+
+private:
+    static std::atomic<bool> _active;
+
+    static void record(Kind kind, uint64_t start_us, uintptr_t arg, const char *name);
+};
+
+#endif  // AP_HAL_THREAD_TRACE_ENABLED
@@ -10,9 +10,9 @@
 /*
   return the number of bytes to send for a packetised connection
  */
-uint16_t mavlink_packetise(ByteBuffer &writebuf, uint16_t n)
+uint16_t mavlink_packetise(ByteBuffer &writebuf, uint16_t n, uint32_t ofs)
 {
-    int16_t b = writebuf.peek(0);
+    int16_t b = writebuf.peek(ofs);
     if (b != MAVLINK_STX_MAVLINK1 && b != MAVLINK_STX) {
         /*
           we have a non-mavlink packet at the start of the
@@ -22,7 +22,7 @@ uint16_t mavlink_packetise(ByteBuffer &writebuf, uint16_t n)
         uint16_t limit = n>256?256:n;
         uint16_t i;
         for (i=0; i<limit; i++) {
-            b = writebuf.peek(i);
+            b = writebuf.peek(ofs+i);
             if (b == MAVLINK_STX_MAVLINK1 || b == MAVLINK_STX) {
                 n = i;
                 break;
@@ -46,10 +46,10 @@ uint16_t mavlink_packetise(ByteBuffer &writebuf, uint16_t n)
     }
 
     // the length of the packet is the 2nd byte
-    int16_t len = writebuf.peek(1);
+    int16_t len = writebuf.peek(ofs+1);
     if (b == MAVLINK_STX) {
         // This is Mavlink2. Check for signed packet with extra 13 bytes
-        int16_t incompat_flags = writebuf.peek(2);
+        int16_t incompat_flags = writebuf.peek(ofs+2);
         if (incompat_flags & MAVLINK_IFLAG_SIGNED) {
             min_length += MAVLINK_SIGNATURE_BLOCK_LEN;
         }
@@ -7,7 +7,8 @@
 #endif
 
 /*
-  return the number of bytes to send for a packetised connection
+  return the number of bytes to send for a packetised connection,
+  looking at the n bytes starting ofs bytes into the buffer
 */
-uint16_t mavlink_packetise(ByteBuffer &writebuf, uint16_t n);
+uint16_t mavlink_packetise(ByteBuffer &writebuf, uint16_t n, uint32_t ofs=0);
 
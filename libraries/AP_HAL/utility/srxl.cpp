@@ -273,7 +273,6 @@ int srxl_decode(uint64_t timestamp_us, uint8_t byte, uint8_t *num_values, uint16
     switch (decode_state) {
     case STATE_NEW:   /* buffer header byte and prepare for frame reception and decoding */
         buffer[0U]=byte;
-        crc_fmu = crc_xmodem_update(0U,byte);
         buflen = 1U;
         decode_state_next = STATE_COLLECT;
         break;
@@ -289,12 +288,9 @@ int srxl_decode(uint64_t timestamp_us, uint8_t byte, uint8_t *num_values, uint16
         }
         buffer[buflen] = byte;
         buflen++;
-        /* CRC not over last 2 frame bytes as these bytes inhabitate the crc */
-        if (buflen <= (frame_len_full-2)) {
-           crc_fmu = crc_xmodem_update(crc_fmu,byte);
-        }
         if(  buflen == frame_len_full ) {
-            /* CRC check here */
+            /* CRC check here, not over last 2 frame bytes as these bytes inhabitate the crc */
+            crc_fmu = crc_xmodem(buffer, buflen-2);
             crc_receiver =  ((uint16_t)buffer[buflen-2] << 8U) | ((uint16_t)buffer[buflen-1]);
             if (crc_receiver == crc_fmu) {
                 /* at this point buffer contains all frame data and crc is valid --> extract channel info according to SRXL variant */
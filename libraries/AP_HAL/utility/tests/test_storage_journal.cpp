@@ -0,0 +1,280 @@
+#include <AP_gtest.h>
+
+#include <AP_HAL/utility/StorageJournal.h>
+
+#if AP_HAL_STORAGE_JOURNAL_ENABLED
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+static uint8_t image[HAL_STORAGE_SIZE];
+static uint8_t image2[HAL_STORAGE_SIZE];
+
+static void make_path(char *path, size_t len)
+{
+    snprintf(path, len, "/tmp/test_storage_journal.%d", int(getpid()));
+    unlink(path);
+    char jnl[200];
+    snprintf(jnl, sizeof(jnl), "%s.jnl", path);
+    unlink(jnl);
+}
+
+static void put(StorageJournal &j, uint16_t loc, uint8_t value)
+{
+    j.write(loc, &value, 1);
+}
+
+static off_t file_size(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+    return st.st_size;
+}
+
+TEST(StorageJournalTest, CommitAndReplay)
+{
+    char path[100];
+    make_path(path, sizeof(path));
+
+    StorageJournal j{image};
+    ASSERT_TRUE(j.init(path));
+    for (uint16_t i=0; i<HAL_STORAGE_SIZE; i++) {
+        EXPECT_EQ(image[i], 0U);
+    }
+
+    uint8_t block[50];
+    memset(block, 0x55, sizeof(block));
+    j.write(100, block, sizeof(block));
+    put(j, HAL_STORAGE_SIZE-1, 0xAA);
+    EXPECT_TRUE(j.flush());
+    EXPECT_EQ(j.num_commits(), 1U);
+
+    // the base file is untouched until compaction
+    EXPECT_EQ(file_size(path), 0);
+
+    StorageJournal j2{image2};
+    ASSERT_TRUE(j2.init(path));
+    EXPECT_EQ(memcmp(image, image2, HAL_STORAGE_SIZE), 0);
+    EXPECT_EQ(j2.journal_length(), j.journal_length());
+}
+
+TEST(StorageJournalTest, TornCommit)
+{
+    char path[100];
+    make_path(path, sizeof(path));
+    char jnl[200];
+    snprintf(jnl, sizeof(jnl), "%s.jnl", path);
+
+    memset(image, 0, sizeof(image));
+    StorageJournal j{image};
+    ASSERT_TRUE(j.init(path));
+    put(j, 10, 1);
+    ASSERT_TRUE(j.flush());
+    const uint32_t good_len = j.journal_length();
+    put(j, 500, 2);
+    ASSERT_TRUE(j.flush());
+
+    // cut the second commit short, as a power loss would
+    ASSERT_EQ(truncate(jnl, good_len + 7), 0);
+
+    StorageJournal j2{image2};
+    ASSERT_TRUE(j2.init(path));
+    EXPECT_EQ(image2[10], 1U);
+    EXPECT_EQ(image2[500], 0U);
+    EXPECT_EQ(j2.journal_length(), good_len);
+    EXPECT_EQ(file_size(jnl), off_t(good_len));
+
+    // corrupt data in the last commit is also discarded
+    put(j2, 20, 3);
+    ASSERT_TRUE(j2.flush());
+    int fd = open(jnl, O_RDWR);
+    ASSERT_NE(fd, -1);
+    const uint8_t bad = 0xFF;
+    ASSERT_EQ(pwrite(fd, &bad, 1, file_size(jnl)-1), 1);
+    close(fd);
+
+    memset(image, 0, sizeof(image));
+    StorageJournal j3{image};
+    ASSERT_TRUE(j3.init(path));
+    EXPECT_EQ(image[10], 1U);
+    EXPECT_EQ(image[20], 0U);
+}
+
+TEST(StorageJournalTest, Compact)
+{
+    char path[100];
+    make_path(path, sizeof(path));
+    char jnl[200];
+    snprintf(jnl, sizeof(jnl), "%s.jnl", path);
+
+    memset(image, 0, sizeof(image));
+    StorageJournal j{image};
+    ASSERT_TRUE(j.init(path));
+    for (uint16_t i=0; i<HAL_STORAGE_SIZE; i+=64) {
+        put(j, i, uint8_t(i>>6));
+    }
+    ASSERT_TRUE(j.flush());
+    ASSERT_TRUE(j.compact());
+    // only the journal header is left
+    EXPECT_LT(j.journal_length(), 16U);
+    EXPECT_EQ(file_size(jnl), off_t(j.journal_length()));
+    EXPECT_EQ(file_size(path), off_t(HAL_STORAGE_SIZE));
+
+    // the base file is a plain storage image
+    int fd = open(path, O_RDONLY);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(read(fd, image2, HAL_STORAGE_SIZE), HAL_STORAGE_SIZE);
+    close(fd);
+    EXPECT_EQ(memcmp(image, image2, HAL_STORAGE_SIZE), 0);
+
+    // changes after compaction replay over the new base
+    put(j, 7, 0x77);
+    ASSERT_TRUE(j.flush());
+    memset(image2, 0, sizeof(image2));
+    StorageJournal j2{image2};
+    ASSERT_TRUE(j2.init(path));
+    EXPECT_EQ(memcmp(image, image2, HAL_STORAGE_SIZE), 0);
+
+    unlink(path);
+    unlink(jnl);
+}
+
+TEST(StorageJournalTest, ReplacedBase)
+{
+    char path[100];
+    make_path(path, sizeof(path));
+    char jnl[200];
+    snprintf(jnl, sizeof(jnl), "%s.jnl", path);
+
+    memset(image, 0, sizeof(image));
+    StorageJournal j{image};
+    ASSERT_TRUE(j.init(path));
+    EXPECT_TRUE(j.healthy());
+    put(j, 30, 0x30);
+    EXPECT_TRUE(j.healthy());
+    ASSERT_TRUE(j.flush());
+
+    // a different base file, with the old journal left beside it
+    uint8_t base[64];
+    memset(base, 0x42, sizeof(base));
+    int fd = open(path, O_WRONLY|O_TRUNC);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(write(fd, base, sizeof(base)), ssize_t(sizeof(base)));
+    close(fd);
+
+    memset(image2, 0, sizeof(image2));
+    StorageJournal j2{image2};
+    ASSERT_TRUE(j2.init(path));
+    EXPECT_EQ(image2[30], 0x42U);
+    EXPECT_EQ(image2[100], 0U);
+    EXPECT_EQ(file_size(jnl), off_t(j2.journal_length()));
+
+    // and the restarted journal replays over the new base
+    put(j2, 100, 0x10);
+    ASSERT_TRUE(j2.flush());
+    memset(image, 0, sizeof(image));
+    StorageJournal j3{image};
+    ASSERT_TRUE(j3.init(path));
+    EXPECT_EQ(memcmp(image, image2, HAL_STORAGE_SIZE), 0);
+
+    unlink(path);
+    unlink(jnl);
+}
+
+struct OrderArgs {
+    StorageJournal *j;
+    volatile bool stop;
+};
+
+// write a count to a low offset and then a high one
+static void *order_writer(void *arg)
+{
+    OrderArgs *a = (OrderArgs *)arg;
+    for (uint32_t i=1; !a->stop; i++) {
+        a->j->write(16, &i, sizeof(i));
+        a->j->write(HAL_STORAGE_SIZE-8, &i, sizeof(i));
+    }
+    return nullptr;
+}
+
+/*
+  commits made while another thread writes must keep the order of the
+  writes: replaying any number of commits never shows the high copy
+  of the count ahead of the low one, even though lines are copied
+  from low to high
+ */
+TEST(StorageJournalTest, WriteOrder)
+{
+    char path[100];
+    make_path(path, sizeof(path));
+    char jnl[200];
+    snprintf(jnl, sizeof(jnl), "%s.jnl", path);
+
+    memset(image, 0, sizeof(image));
+    StorageJournal j{image};
+    ASSERT_TRUE(j.init(path));
+    OrderArgs args { &j, false };
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, nullptr, order_writer, &args), 0);
+    while (j.num_commits() < 50) {
+        j.flush();
+    }
+    args.stop = true;
+    pthread_join(thread, nullptr);
+    ASSERT_TRUE(j.flush());
+
+    const off_t len = file_size(jnl);
+    uint8_t *data = (uint8_t *)malloc(len);
+    ASSERT_NE(data, nullptr);
+    int fd = open(jnl, O_RDONLY);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(read(fd, data, len), len);
+    close(fd);
+
+    char path2[120];
+    snprintf(path2, sizeof(path2), "%s.copy", path);
+    char jnl2[200];
+    snprintf(jnl2, sizeof(jnl2), "%s.jnl", path2);
+    unlink(path2);
+
+    // the journal header is 8 bytes, and the length of each commit is
+    // 10 bytes into its 18 byte header
+    uint32_t commits = 0;
+    for (off_t ofs = 8; ofs + 18 <= len; commits++) {
+        uint32_t length;
+        memcpy(&length, &data[ofs+10], sizeof(length));
+        ofs += 18 + length;
+
+        fd = open(jnl2, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+        ASSERT_NE(fd, -1);
+        ASSERT_EQ(::write(fd, data, ofs), ofs);
+        close(fd);
+        memset(image2, 0, sizeof(image2));
+        StorageJournal j2{image2};
+        ASSERT_TRUE(j2.init(path2));
+        uint32_t high, low;
+        memcpy(&high, &image2[HAL_STORAGE_SIZE-8], sizeof(high));
+        memcpy(&low, &image2[16], sizeof(low));
+        EXPECT_LE(high, low) << "commit " << commits;
+    }
+    EXPECT_GE(commits, 50U);
+    free(data);
+
+    unlink(path);
+    unlink(jnl);
+    unlink(path2);
+    unlink(jnl2);
+}
+
+#endif // AP_HAL_STORAGE_JOURNAL_ENABLED
+
+AP_GTEST_MAIN()
@@ -0,0 +1,122 @@
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/ThreadTrace.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#if AP_HAL_THREAD_TRACE_ENABLED
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static const uint16_t events_per_thread = 500;
+
+static void *record_events(void *arg)
+{
+    pthread_setname_np(pthread_self(), (const char *)arg);
+    for (uint16_t i=0; i<events_per_thread; i++) {
+        const uint64_t start_us = ThreadTrace::begin();
+        ThreadTrace::end(ThreadTrace::Kind::TASK, start_us, 0, "test_task");
+    }
+    return nullptr;
+}
+
+// count the occurrences of str in a file
+static uint32_t count_in_file(const char *path, const char *str)
+{
+    FILE *f = fopen(path, "r");
+    if (f == nullptr) {
+        return 0;
+    }
+    uint32_t count = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f) != nullptr) {
+        for (const char *p = strstr(line, str); p != nullptr; p = strstr(p+1, str)) {
+            count++;
+        }
+    }
+    fclose(f);
+    return count;
+}
+
+TEST(ThreadTrace, Inactive)
+{
+    EXPECT_FALSE(ThreadTrace::active());
+    EXPECT_EQ(0U, ThreadTrace::begin());
+}
+
+TEST(ThreadTrace, Threads)
+{
+    char path[] = "/tmp/thread_trace_XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+    close(fd);
+
+    ASSERT_TRUE(ThreadTrace::start(path));
+    EXPECT_TRUE(ThreadTrace::active());
+    // only one trace at a time
+    EXPECT_FALSE(ThreadTrace::start(path));
+
+    static const char *names[] { "trace-a", "trace-b", "trace-c" };
+    pthread_t threads[ARRAY_SIZE(names)];
+    for (uint8_t i=0; i<ARRAY_SIZE(names); i++) {
+        ASSERT_EQ(0, pthread_create(&threads[i], nullptr, record_events, (void *)names[i]));
+    }
+    for (uint8_t i=0; i<ARRAY_SIZE(names); i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    ThreadTrace::stop();
+    EXPECT_FALSE(ThreadTrace::active());
+
+    EXPECT_EQ(ARRAY_SIZE(names) * events_per_thread, count_in_file(path, "\"name\":\"test_task\""));
+    EXPECT_EQ(0U, count_in_file(path, "dropped events"));
+    EXPECT_EQ(1U, count_in_file(path, "\"name\":\"trace-b\""));
+    EXPECT_EQ(1U, count_in_file(path, "]"));
+
+    unlink(path);
+}
+
+// a thread renamed after its first events, while the rings are flushed
+static void *rename_and_record(void *)
+{
+    pthread_setname_np(pthread_self(), "trace-old");
+    for (uint16_t i=0; i<events_per_thread; i++) {
+        const uint64_t start_us = ThreadTrace::begin();
+        ThreadTrace::end(ThreadTrace::Kind::TASK, start_us, 0, "test_task");
+    }
+    // let the flush thread write the old name
+    usleep(250000);
+    pthread_setname_np(pthread_self(), "trace-new");
+    for (uint16_t i=0; i<2048; i++) {
+        const uint64_t start_us = ThreadTrace::begin();
+        ThreadTrace::end(ThreadTrace::Kind::TASK, start_us, 0, "test_task");
+    }
+    return nullptr;
+}
+
+TEST(ThreadTrace, Rename)
+{
+    char path[] = "/tmp/thread_trace_XXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_NE(-1, fd);
+    close(fd);
+
+    ASSERT_TRUE(ThreadTrace::start(path));
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, nullptr, rename_and_record, nullptr));
+    pthread_join(thread, nullptr);
+    ThreadTrace::stop();
+
+    EXPECT_EQ(events_per_thread + 2048U, count_in_file(path, "\"name\":\"test_task\""));
+    EXPECT_EQ(1U, count_in_file(path, "\"name\":\"trace-old\""));
+    EXPECT_EQ(1U, count_in_file(path, "\"name\":\"trace-new\""));
+
+    unlink(path);
+}
+
+#endif  // AP_HAL_THREAD_TRACE_ENABLED
+
+AP_GTEST_MAIN()
@@ -92,6 +92,8 @@ void Storage::_timer_tick(void)
     }
     if (_dirty_mask.empty()) {
         _last_empty_ms = AP_HAL::millis();
+        // use idle time to progress any pending sector switch
+        _flash.update();
         return;
     }
 
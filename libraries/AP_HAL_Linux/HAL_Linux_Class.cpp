@@ -40,6 +40,7 @@
 #include "SPIDevice.h"
 #include "SPIUARTDriver.h"
 #include "Scheduler.h"
+#include "Semaphores.h"
 #include "Storage.h"
 #include "UARTDriver.h"
 #include "Util.h"
@@ -384,6 +385,10 @@ void HAL_Linux::run(int argc, char* const argv[], Callbacks* callbacks) const
     GetOptLong gopt(argc, argv, "A:B:C:D:E:F:G:H:I:J:l:t:s:he:SM:c:",
                     options);
 
+    // registered after all static constructors have run, so this
+    // runs before any static destructor on exit
+    atexit(Semaphore::set_exiting);
+
     /*
       parse command line options
      */
@@ -10,6 +10,7 @@
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/ThreadTrace.h>
 #include <AP_Math/AP_Math.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
 
@@ -140,6 +141,10 @@ void Scheduler::init()
 #if defined(DEBUG_STACK) && DEBUG_STACK
     register_timer_process(FUNCTOR_BIND_MEMBER(&Scheduler::_debug_stack, void));
 #endif
+
+#if AP_HAL_THREAD_TRACE_ENABLED
+    ThreadTrace::init();
+#endif
 }
 
 void Scheduler::_debug_stack()
@@ -178,6 +183,9 @@ void Scheduler::delay(uint16_t ms)
         return;
     }
 
+#if AP_HAL_THREAD_TRACE_ENABLED
+    const uint64_t trace_start_us = ThreadTrace::begin();
+#endif
     uint64_t now = AP_HAL::micros64();
     uint64_t end = now + 1000UL * ms + 1U;
     do {
@@ -188,6 +196,9 @@ void Scheduler::delay(uint16_t ms)
         }
         now = AP_HAL::micros64();
     } while (now < end);
+#if AP_HAL_THREAD_TRACE_ENABLED
+    ThreadTrace::end(ThreadTrace::Kind::DELAY, trace_start_us, ms * 1000U);
+#endif
 }
 
 void Scheduler::delay_microseconds(uint16_t us)
@@ -195,7 +206,13 @@ void Scheduler::delay_microseconds(uint16_t us)
     if (_stopped_clock_usec) {
         return;
     }
+#if AP_HAL_THREAD_TRACE_ENABLED
+    const uint64_t trace_start_us = ThreadTrace::begin();
+#endif
     microsleep(us);
+#if AP_HAL_THREAD_TRACE_ENABLED
+    ThreadTrace::end(ThreadTrace::Kind::DELAY, trace_start_us, us);
+#endif
 }
 
 void Scheduler::register_timer_process(AP_HAL::MemberProc proc)
@@ -244,6 +261,9 @@ void Scheduler::_timer_task()
         return;
     }
     _in_timer_proc = true;
+#if AP_HAL_THREAD_TRACE_ENABLED
+    const uint64_t trace_start_us = ThreadTrace::begin();
+#endif
 
     // now call the timer based drivers
     for (i = 0; i < _num_timer_procs; i++) {
@@ -257,12 +277,18 @@ void Scheduler::_timer_task()
         _failsafe();
     }
 
+#if AP_HAL_THREAD_TRACE_ENABLED
+    ThreadTrace::end(ThreadTrace::Kind::TIMER_PROCS, trace_start_us, _num_timer_procs);
+#endif
     _in_timer_proc = false;
 }
 
 void Scheduler::_run_io(void)
 {
     _io_semaphore.take_blocking();
+#if AP_HAL_THREAD_TRACE_ENABLED
+    const uint64_t trace_start_us = ThreadTrace::begin();
+#endif
 
     // now call the IO based drivers
     for (int i = 0; i < _num_io_procs; i++) {
@@ -271,6 +297,9 @@ void Scheduler::_run_io(void)
         }
     }
 
+#if AP_HAL_THREAD_TRACE_ENABLED
+    ThreadTrace::end(ThreadTrace::Kind::IO_PROCS, trace_start_us, _num_io_procs);
+#endif
     _io_semaphore.give();
 }
 
@@ -2,46 +2,298 @@
 
 #include "Semaphores.h"
 
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <AP_Common/ExpandingString.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_HAL/utility/ThreadTrace.h>
+
 extern const AP_HAL::HAL& hal;
 
 using namespace Linux;
 
+// all semaphores, so contention statistics can be listed. Semaphores
+// are constructed statically, so these must be constant initialised
+static pthread_mutex_t semaphores_mtx = PTHREAD_MUTEX_INITIALIZER;
+static Semaphore *semaphores;
+
+std::atomic<bool> Semaphore::stats_enabled;
+std::atomic<bool> Semaphore::exiting;
+
+static pid_t current_tid()
+{
+    static thread_local pid_t tid;
+    if (tid == 0) {
+        tid = syscall(SYS_gettid);
+    }
+    return tid;
+}
+
+static void timespec_add_us(struct timespec &ts, uint64_t us)
+{
+    ts.tv_sec += us / 1000000ULL;
+    ts.tv_nsec += (us % 1000000ULL) * 1000UL;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+}
+
+static void current_thread_name(char name[16])
+{
+    if (pthread_getname_np(pthread_self(), name, 16) != 0) {
+        name[0] = 0;
+    }
+}
+
 // construct a semaphore
 Semaphore::Semaphore()
 {
+    /*
+      priority inheritance stops a low priority thread holding a
+      semaphore wanted by the main thread from being held off by
+      threads of medium priority
+     */
     pthread_mutexattr_t attr;
     pthread_mutexattr_init(&attr);
     pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
     pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
     pthread_mutex_init(&_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    pthread_mutex_lock(&semaphores_mtx);
+    next = semaphores;
+    semaphores = this;
+    pthread_mutex_unlock(&semaphores_mtx);
+}
+
+Semaphore::~Semaphore()
+{
+    /*
+      static destructors run while HAL threads may still be taking
+      semaphores, so once exit has started they stay registered and
+      their mutex is not destroyed
+     */
+    if (exiting.load()) {
+        return;
+    }
+    pthread_mutex_lock(&semaphores_mtx);
+    for (Semaphore **p = &semaphores; *p != nullptr; p = &(*p)->next) {
+        if (*p == this) {
+            *p = next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&semaphores_mtx);
+    pthread_mutex_destroy(&_lock);
+}
+
+void Semaphore::set_exiting(void)
+{
+    exiting.store(true);
 }
 
 bool Semaphore::give()
 {
+    if (--take_count == 0 && instrumented) {
+        if (hold_start_us != 0) {
+            const uint64_t hold_us = AP_HAL::micros64() - hold_start_us;
+            if (hold_us > stats.max_hold_us) {
+                stats.max_hold_us = hold_us;
+                current_thread_name(stats.max_hold_thread);
+            }
+            hold_start_us = 0;
+        }
+        holder_tid = 0;
+#if AP_HAL_THREAD_TRACE_ENABLED
+        ThreadTrace::end(ThreadTrace::Kind::SEM_HOLD, trace_hold_start_us, uintptr_t(this));
+#endif
+    }
     return pthread_mutex_unlock(&_lock) == 0;
 }
 
 bool Semaphore::take(uint32_t timeout_ms)
+{
+    const bool stats_on = stats_enabled.load(std::memory_order_relaxed);
+#if AP_HAL_THREAD_TRACE_ENABLED
+    const bool trace_on = ThreadTrace::active();
+#else
+    const bool trace_on = false;
+#endif
+    if (!instrumented || !(stats_on || trace_on)) {
+        return _take(timeout_ms);
+    }
+    // only a take which has to wait is timed
+    if (take_nonblocking()) {
+        return true;
+    }
+    const uint64_t start_us = AP_HAL::micros64();
+    const bool ret = _take(timeout_ms);
+    if (ret && stats_on) {
+        record_wait(AP_HAL::micros64() - start_us);
+    }
+#if AP_HAL_THREAD_TRACE_ENABLED
+    ThreadTrace::end(ThreadTrace::Kind::SEM_WAIT, trace_on ? start_us : 0, uintptr_t(this));
+#endif
+    return ret;
+}
+
+bool Semaphore::_take(uint32_t timeout_ms)
 {
     if (timeout_ms == HAL_SEMAPHORE_BLOCK_FOREVER) {
-        return pthread_mutex_lock(&_lock) == 0;
+        if (pthread_mutex_lock(&_lock) != 0) {
+            return false;
+        }
+        taken();
+        return true;
     }
     if (take_nonblocking()) {
         return true;
     }
-    uint64_t start = AP_HAL::micros64();
-    do {
-        hal.scheduler->delay_microseconds(200);
-        if (take_nonblocking()) {
-            return true;
+    /*
+      block in the kernel rather than polling with trylock, as the
+      holder only inherits our priority while we are blocked on the
+      mutex. The deadline is on the monotonic clock as
+      Util::set_hw_rtc() may step the realtime clock
+     */
+    const uint64_t deadline_us = AP_HAL::micros64() + timeout_ms * 1000ULL;
+    struct timespec ts;
+    int ret;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return false;
+    }
+    timespec_add_us(ts, timeout_ms * 1000ULL);
+    ret = pthread_mutex_clocklock(&_lock, CLOCK_MONOTONIC, &ts);
+    if (ret == 0) {
+        taken();
+        return true;
+    }
+    if (ret != EINVAL) {
+        return false;
+    }
+#endif
+    /*
+      kernels before 5.14 can only time a wait on a priority
+      inheritance mutex against the realtime clock. Wait in short
+      slices and check the deadline against micros64(), so a forward
+      step of the realtime clock can't end the wait early and a
+      backward step only delays the end of the current slice
+     */
+    while (true) {
+        const uint64_t now_us = AP_HAL::micros64();
+        if (now_us >= deadline_us) {
+            return false;
         }
-    } while ((AP_HAL::micros64() - start) < timeout_ms*1000);
-    return false;
+        if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+            return false;
+        }
+        timespec_add_us(ts, MIN(deadline_us - now_us, 10000ULL));
+        ret = pthread_mutex_timedlock(&_lock, &ts);
+        if (ret == 0) {
+            break;
+        }
+        if (ret != ETIMEDOUT) {
+            return false;
+        }
+    }
+    taken();
+    return true;
 }
 
 bool Semaphore::take_nonblocking()
 {
-    return pthread_mutex_trylock(&_lock) == 0;
+    if (pthread_mutex_trylock(&_lock) != 0) {
+        return false;
+    }
+    taken();
+    return true;
+}
+
+// called with the mutex newly taken
+void Semaphore::taken()
+{
+    if (++take_count != 1 || !instrumented) {
+        return;
+    }
+    if (stats_enabled.load(std::memory_order_relaxed)) {
+        stats.takes++;
+        holder_tid = current_tid();
+        hold_start_us = AP_HAL::micros64();
+    }
+#if AP_HAL_THREAD_TRACE_ENABLED
+    trace_hold_start_us = ThreadTrace::begin();
+#endif
+}
+
+// record a take which had to wait, called with the mutex taken
+void Semaphore::record_wait(uint32_t wait_us)
+{
+    stats.contended++;
+    uint8_t b = 0;
+    for (uint32_t limit = 16; b < ARRAY_SIZE(stats.wait_hist)-1 && wait_us >= limit; limit *= 4) {
+        b++;
+    }
+    stats.wait_hist[b]++;
+    if (wait_us > stats.max_wait_us) {
+        stats.max_wait_us = wait_us;
+        current_thread_name(stats.max_wait_thread);
+    }
+}
+
+/*
+  contention statistics since the last call, for semaphores which have
+  been taken. The statistics are updated without locking, so
+  occasionally a line may mix old and new values
+ */
+void Semaphore::semaphore_info(ExpandingString &str)
+{
+    // collection starts on the first read, so that read is empty
+    stats_enabled.store(true);
+
+    // a header to allow for machine parsers to determine format
+    str.printf("SEMV1\n");
+
+    pthread_mutex_lock(&semaphores_mtx);
+    for (Semaphore *sem = semaphores; sem != nullptr; sem = sem->next) {
+        Stats &st = sem->stats;
+        if (st.takes == 0 && sem->holder_tid == 0) {
+            continue;
+        }
+        // the current holder, which may exit before we look it up
+        char holder[16] = "-";
+        const pid_t holder_tid = sem->holder_tid;
+        if (holder_tid != 0) {
+            char path[48];
+            snprintf(path, sizeof(path), "/proc/self/task/%d/comm", int(holder_tid));
+            FILE *f = fopen(path, "r");
+            if (f != nullptr) {
+                if (fgets(holder, sizeof(holder), f) != nullptr) {
+                    holder[strcspn(holder, "\n")] = 0;
+                }
+                fclose(f);
+            }
+        }
+        str.printf("SEM=%p TAKES=%7u CONT=%5u (%4.1f%%) HOLDER=%s\n",
+                   sem, unsigned(st.takes), unsigned(st.contended),
+                   st.takes > 0 ? 100.0 * st.contended / st.takes : 0.0, holder);
+        str.printf("  MAXWAIT=%7uus (%s) MAXHOLD=%7uus (%s)\n",
+                   unsigned(st.max_wait_us), st.max_wait_thread[0] ? st.max_wait_thread : "-",
+                   unsigned(st.max_hold_us), st.max_hold_thread[0] ? st.max_hold_thread : "-");
+        if (st.contended != 0) {
+            str.printf("  WAIT <16us:%u <64us:%u <256us:%u <1ms:%u <4ms:%u <16ms:%u <64ms:%u >64ms:%u\n",
+                       unsigned(st.wait_hist[0]), unsigned(st.wait_hist[1]),
+                       unsigned(st.wait_hist[2]), unsigned(st.wait_hist[3]),
+                       unsigned(st.wait_hist[4]), unsigned(st.wait_hist[5]),
+                       unsigned(st.wait_hist[6]), unsigned(st.wait_hist[7]));
+        }
+        memset(&st, 0, sizeof(st));
+    }
+    pthread_mutex_unlock(&semaphores_mtx);
 }
 
 /*
@@ -51,8 +303,13 @@ bool Semaphore::take_nonblocking()
 BinarySemaphore::BinarySemaphore(bool initial_state) :
     AP_HAL::BinarySemaphore(initial_state)
 {
-    pthread_cond_init(&cond, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&cond, &attr);
+    pthread_condattr_destroy(&attr);
     pending = initial_state;
+    mtx.instrumented = false;
 }
 
 bool BinarySemaphore::wait(uint32_t timeout_us)
@@ -60,15 +317,10 @@ bool BinarySemaphore::wait(uint32_t timeout_us)
     WITH_SEMAPHORE(mtx);
     if (!pending) {
         struct timespec ts;
-        if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+        if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
             return false;
         }
-        ts.tv_sec += timeout_us/1000000UL;
-        ts.tv_nsec += (timeout_us % 1000000U) * 1000UL;
-        if (ts.tv_nsec >= 1000000000L) {
-            ts.tv_sec++;
-            ts.tv_nsec -= 1000000000L;
-        }
+        timespec_add_us(ts, timeout_us);
         if (pthread_cond_timedwait(&cond, &mtx._lock, &ts) != 0) {
             return false;
         }
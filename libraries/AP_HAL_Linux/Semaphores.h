@@ -4,7 +4,11 @@
 #include <stdint.h>
 #include <AP_HAL/AP_HAL_Macros.h>
 #include <AP_HAL/Semaphores.h>
+#include <atomic>
 #include <pthread.h>
+#include <sys/types.h>
+
+class ExpandingString;
 
 namespace Linux {
 
@@ -12,11 +16,55 @@ class Semaphore : public AP_HAL::Semaphore {
 public:
     friend class BinarySemaphore;
     Semaphore();
+    ~Semaphore();
     bool give() override;
     bool take(uint32_t timeout_ms) override;
     bool take_nonblocking() override;
+
+    // contention statistics for @SYS/semaphores.txt. Statistics are
+    // only collected once this has first been called
+    static void semaphore_info(ExpandingString &str);
+
+    // called on exit, after which static semaphores are left alone
+    // as other threads may still be using them
+    static void set_exiting(void);
+
 protected:
+    bool _take(uint32_t timeout_ms);
+    void taken();
+
     pthread_mutex_t _lock;
+
+    // the mutex of a BinarySemaphore is released while waiting on
+    // its condition, so its hold times would be wrong
+    bool instrumented = true;
+    // recursion level, so holds are timed from the outermost take
+    uint8_t take_count = 0;
+
+#if AP_HAL_THREAD_TRACE_ENABLED
+    uint64_t trace_hold_start_us;
+#endif
+
+    // all semaphores, for semaphore_info()
+    Semaphore *next;
+
+    struct Stats {
+        uint32_t takes;
+        uint32_t contended;
+        // wait times in buckets of 0-16us, 16-64us, 64-256us and so on
+        uint32_t wait_hist[8];
+        uint32_t max_wait_us;
+        uint32_t max_hold_us;
+        char max_wait_thread[16];
+        char max_hold_thread[16];
+    } stats {};
+    // kernel thread ID of the holder, zero if not held
+    pid_t holder_tid = 0;
+    uint64_t hold_start_us = 0;
+
+    static std::atomic<bool> stats_enabled;
+    static std::atomic<bool> exiting;
+    void record_wait(uint32_t wait_us);
 };
 
 
@@ -15,6 +15,10 @@ using namespace Linux;
 /*
   This stores 'eeprom' data on the SD card, with a 4k size, and a
   in-memory buffer. This keeps the latency down.
+
+  With AP_HAL_STORAGE_JOURNAL_ENABLED changes are appended to a
+  journal beside the storage file instead of rewriting it in place,
+  see StorageJournal.h
  */
 
 // name the storage file after the sketch so you can use the same board
@@ -145,6 +149,14 @@ void Storage::init()
         dpath = HAL_BOARD_STORAGE_DIRECTORY;
     }
 
+#if AP_HAL_STORAGE_JOURNAL_ENABLED
+    mkdir_p(dpath, strlen(dpath), 0777);
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", dpath, STORAGE_FILE);
+    if (!_journal.init(path)) {
+        AP_HAL::panic("Cannot open storage %s (%m)", path);
+    }
+#else
     int fd = _storage_create(dpath);
     if (fd == -1) {
         AP_HAL::panic("Cannot create storage %s (%m)", dpath);
@@ -158,9 +170,11 @@ void Storage::init()
     }
 
     _fd = fd;
+#endif
     _initialised = true;
 }
 
+#if !AP_HAL_STORAGE_JOURNAL_ENABLED
 /*
   mark some lines as dirty. Note that there is no attempt to avoid
   the race condition between this code and the _timer_tick() code
@@ -180,6 +194,7 @@ void Storage::_mark_dirty(uint16_t loc, uint16_t length)
         _dirty_mask |= 1U << line;
     }
 }
+#endif
 
 void Storage::read_block(void *dst, uint16_t loc, size_t n)
 {
@@ -197,13 +212,23 @@ void Storage::write_block(uint16_t loc, const void *src, size_t n)
     }
     if (memcmp(src, &_buffer[loc], n) != 0) {
         init();
+#if AP_HAL_STORAGE_JOURNAL_ENABLED
+        // copy under the journal lock so a commit never holds half a write
+        _journal.write(loc, src, n);
+#else
         memcpy(&_buffer[loc], src, n);
         _mark_dirty(loc, n);
+#endif
     }
 }
 
 void Storage::_timer_tick(void)
 {
+#if AP_HAL_STORAGE_JOURNAL_ENABLED
+    if (_initialised) {
+        _journal.update();
+    }
+#else
     if (!_initialised || _dirty_mask == 0 || _fd == -1) {
         return;
     }
@@ -252,6 +277,7 @@ void Storage::_timer_tick(void)
             }
         }
     }
+#endif // AP_HAL_STORAGE_JOURNAL_ENABLED
 }
 
 /*
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/StorageJournal.h>
 
 #define LINUX_STORAGE_SIZE HAL_STORAGE_SIZE
 #define LINUX_STORAGE_MAX_WRITE 512
@@ -36,14 +37,25 @@ public:
 
     virtual void _timer_tick(void) override;
 
+#if AP_HAL_STORAGE_JOURNAL_ENABLED
+    bool healthy(void) override { return _journal.healthy(); }
+    bool keeps_write_order(void) override { return true; }
+#endif
+
 protected:
+#if !AP_HAL_STORAGE_JOURNAL_ENABLED
     void _mark_dirty(uint16_t loc, uint16_t length);
+#endif
     int _storage_create(const char *dpath);
 
     int _fd;
     volatile bool _initialised;
     volatile uint32_t _dirty_mask;
     uint8_t _buffer[LINUX_STORAGE_SIZE];
+
+#if AP_HAL_STORAGE_JOURNAL_ENABLED
+    StorageJournal _journal{_buffer};
+#endif
 };
 
 }
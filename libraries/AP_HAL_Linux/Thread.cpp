@@ -24,6 +24,7 @@
 #include <utility>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/ThreadTrace.h>
 #include <AP_Math/AP_Math.h>
 #include "Scheduler.h"
 
@@ -266,9 +267,16 @@ bool PeriodicThread::_run()
         } else {
             Scheduler::from(hal.scheduler)->microsleep(dt);
         }
+#if AP_HAL_THREAD_TRACE_ENABLED
+        const uint64_t trace_start_us = ThreadTrace::begin();
+        const uint64_t late_us = trace_start_us > next_run_usec ? trace_start_us - next_run_usec : 0;
+#endif
         next_run_usec += _period_usec;
 
         _task();
+#if AP_HAL_THREAD_TRACE_ENABLED
+        ThreadTrace::end(ThreadTrace::Kind::THREAD_TICK, trace_start_us, late_us);
+#endif
     }
 
     _started = false;
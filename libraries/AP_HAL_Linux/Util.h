@@ -68,6 +68,10 @@ public:
 
     uint32_t available_memory(void) override;
 
+    void semaphore_info(ExpandingString &str) override {
+        Semaphore::semaphore_info(str);
+    }
+
     bool get_system_id(char buf[50]) override;
     bool get_system_id_unformatted(uint8_t buf[], uint8_t &len) override;
 
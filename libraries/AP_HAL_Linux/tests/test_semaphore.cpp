@@ -0,0 +1,222 @@
+#include <AP_gtest.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Common/ExpandingString.h>
+#include <AP_HAL_Linux/Semaphores.h>
+
+using namespace Linux;
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+static uint64_t now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void spin_us(uint32_t us)
+{
+    const uint64_t start = now_us();
+    while (now_us() - start < us) {
+    }
+}
+
+struct HoldArgs {
+    Semaphore *sem;
+    uint32_t hold_us;
+    volatile bool holding;
+};
+
+static void *hold_semaphore(void *arg)
+{
+    HoldArgs *a = (HoldArgs *)arg;
+    pthread_setname_np(pthread_self(), "sem-holder");
+    a->sem->take_blocking();
+    a->holding = true;
+    usleep(a->hold_us);
+    a->sem->give();
+    return nullptr;
+}
+
+TEST(LinuxSemaphore, recursive)
+{
+    Semaphore sem;
+    EXPECT_TRUE(sem.take(10));
+    EXPECT_TRUE(sem.take_nonblocking());
+    EXPECT_TRUE(sem.give());
+    EXPECT_TRUE(sem.give());
+    EXPECT_TRUE(sem.take_nonblocking());
+    EXPECT_TRUE(sem.give());
+}
+
+TEST(LinuxSemaphore, timeout)
+{
+    Semaphore sem;
+    HoldArgs args { &sem, 200000, false };
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, nullptr, hold_semaphore, &args));
+    while (!args.holding) {
+        usleep(100);
+    }
+    EXPECT_FALSE(sem.take_nonblocking());
+    const uint64_t start_us = now_us();
+    EXPECT_FALSE(sem.take(20));
+    const uint64_t waited_us = now_us() - start_us;
+    EXPECT_GE(waited_us, 20000U);
+    EXPECT_LT(waited_us, 150000U);
+    // and succeeds once the holder lets go
+    EXPECT_TRUE(sem.take(1000));
+    EXPECT_TRUE(sem.give());
+    pthread_join(thread, nullptr);
+}
+
+TEST(LinuxSemaphore, stats)
+{
+    ExpandingString str;
+    // the first call starts collection
+    Semaphore::semaphore_info(str);
+
+    Semaphore sem;
+    HoldArgs args { &sem, 20000, false };
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, nullptr, hold_semaphore, &args));
+    while (!args.holding) {
+        usleep(100);
+    }
+    EXPECT_TRUE(sem.take(1000));
+    EXPECT_TRUE(sem.give());
+    pthread_join(thread, nullptr);
+
+    ExpandingString info;
+    Semaphore::semaphore_info(info);
+    ASSERT_FALSE(info.has_failed_allocation());
+    char self[20];
+    snprintf(self, sizeof(self), "SEM=%p", &sem);
+    const char *line = strstr(info.get_string(), self);
+    ASSERT_NE(nullptr, line);
+    EXPECT_NE(nullptr, strstr(line, "TAKES=      2 CONT=    1"));
+    EXPECT_NE(nullptr, strstr(line, "(sem-holder)"));
+}
+
+/*
+  priority inversion stress test. A low priority thread takes the lock
+  briefly and often, a medium priority thread hogs the CPU and a high
+  priority "main loop" takes the lock. Without priority inheritance
+  the main loop waits for the hog whenever it preempts the low
+  priority holder. Needs realtime scheduling, so only runs as root
+ */
+struct Contention {
+    volatile bool stop;
+    uint32_t max_wait_us;
+    bool (*take)(void *lock);
+    void (*give)(void *lock);
+    void *lock;
+};
+
+static bool set_fifo(int prio)
+{
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(0, &cpus);
+    struct sched_param param {};
+    param.sched_priority = prio;
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0 &&
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
+
+static void *low_prio(void *arg)
+{
+    Contention *c = (Contention *)arg;
+    set_fifo(10);
+    while (!c->stop) {
+        if (c->take(c->lock)) {
+            spin_us(200);
+            c->give(c->lock);
+        }
+        usleep(300);
+    }
+    return nullptr;
+}
+
+static void *medium_prio(void *arg)
+{
+    Contention *c = (Contention *)arg;
+    set_fifo(20);
+    while (!c->stop) {
+        usleep(5000);
+        spin_us(20000);
+    }
+    return nullptr;
+}
+
+static void *high_prio(void *arg)
+{
+    Contention *c = (Contention *)arg;
+    set_fifo(30);
+    const uint64_t end_us = now_us() + 1000000;
+    while (now_us() < end_us) {
+        const uint64_t start_us = now_us();
+        if (c->take(c->lock)) {
+            c->give(c->lock);
+        }
+        const uint32_t wait_us = now_us() - start_us;
+        if (wait_us > c->max_wait_us) {
+            c->max_wait_us = wait_us;
+        }
+        usleep(2500);
+    }
+    c->stop = true;
+    return nullptr;
+}
+
+static uint32_t worst_main_wait(bool (*take)(void *), void (*give)(void *), void *lock)
+{
+    Contention c {};
+    c.take = take;
+    c.give = give;
+    c.lock = lock;
+    pthread_t threads[3];
+    pthread_create(&threads[0], nullptr, low_prio, &c);
+    pthread_create(&threads[1], nullptr, medium_prio, &c);
+    pthread_create(&threads[2], nullptr, high_prio, &c);
+    for (uint8_t i=0; i<ARRAY_SIZE(threads); i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    return c.max_wait_us;
+}
+
+TEST(LinuxSemaphore, priority_inversion)
+{
+    if (geteuid() != 0) {
+        printf("not running as root, skipping priority inversion test\n");
+        return;
+    }
+
+    // a plain mutex, as the semaphores used to be
+    pthread_mutex_t plain = PTHREAD_MUTEX_INITIALIZER;
+    const uint32_t plain_wait_us = worst_main_wait(
+        [](void *l) { return pthread_mutex_lock((pthread_mutex_t *)l) == 0; },
+        [](void *l) { pthread_mutex_unlock((pthread_mutex_t *)l); },
+        &plain);
+
+    Semaphore sem;
+    const uint32_t sem_wait_us = worst_main_wait(
+        [](void *l) { return ((Semaphore *)l)->take(100); },
+        [](void *l) { ((Semaphore *)l)->give(); },
+        &sem);
+
+    printf("worst main loop wait: plain mutex %uus, Linux::Semaphore %uus\n",
+           unsigned(plain_wait_us), unsigned(sem_wait_us));
+    // the hog runs for 20ms, a boosted holder gets out of the way
+    // well before that
+    EXPECT_LT(sem_wait_us, 5000U);
+}
+
+AP_GTEST_MAIN()
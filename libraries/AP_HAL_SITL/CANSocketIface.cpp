@@ -31,6 +31,7 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 
 #include <sys/ioctl.h>
 #include <net/if.h>
@@ -39,6 +40,7 @@
 #include "Scheduler.h"
 #include <AP_CANManager/AP_CANManager.h>
 #include <AP_Common/ExpandingString.h>
+#include <AP_Math/AP_Math.h>
 #include "CAN_Multicast.h"
 #include "CAN_SocketCAN.h"
 
@@ -54,6 +56,42 @@ using namespace HALSITL;
 
 uint8_t CANIface::_num_interfaces;
 
+// how long the RX thread sleeps in poll() with nothing to read
+#define CAN_RX_THREAD_POLL_MS 10
+
+const uint16_t CANIface::latency_bucket_us[num_latency_buckets-1] { 50, 100, 200, 500, 1000, 2000, 5000 };
+
+void CANIface::LatencyHistogram::add(uint32_t latency_us)
+{
+    uint8_t i = 0;
+    while (i < num_latency_buckets-1 && latency_us >= latency_bucket_us[i]) {
+        i++;
+    }
+    count[i]++;
+    total_us += latency_us;
+    max_us = MAX(max_us, latency_us);
+}
+
+void CANIface::LatencyHistogram::print(ExpandingString &str, const char *name) const
+{
+    uint32_t total = 0;
+    for (const auto c : count) {
+        total += c;
+    }
+    str.printf("%s latency: n=%u avg=%uus max=%uus\n",
+               name,
+               unsigned(total),
+               unsigned(total > 0 ? total_us / total : 0),
+               unsigned(max_us));
+    for (uint8_t i=0; i<num_latency_buckets; i++) {
+        if (i < num_latency_buckets-1) {
+            str.printf("  <%5uus: %u\n", unsigned(latency_bucket_us[i]), unsigned(count[i]));
+        } else {
+            str.printf("  >=%4uus: %u\n", unsigned(latency_bucket_us[i-1]), unsigned(count[i]));
+        }
+    }
+}
+
 bool CANIface::is_initialized() const
 {
     return transport != nullptr;
@@ -62,25 +100,29 @@ bool CANIface::is_initialized() const
 int16_t CANIface::send(const AP_HAL::CANFrame& frame, const uint64_t tx_deadline,
                        const CANIface::CanIOFlags flags)
 {
-    WITH_SEMAPHORE(sem);
-    CanTxItem tx_item {};
-    tx_item.frame = frame;
-    if (flags & Loopback) {
-        tx_item.loopback = true;
-    }
-    if (flags & AbortOnError) {
-        tx_item.abort_on_error = true;
-    }
-    tx_item.setup = true;
-    tx_item.index = _tx_frame_counter;
-    tx_item.deadline = tx_deadline;
-    if (_tx_queue.push(tx_item)) {
-        _tx_frame_counter++;
-        stats.tx_requests++;
-    } else {
-        stats.tx_overflow++;
+    {
+        WITH_SEMAPHORE(sem);
+        TxItem tx {};
+        CanTxItem &tx_item = tx.item;
+        tx_item.frame = frame;
+        if (flags & Loopback) {
+            tx_item.loopback = true;
+        }
+        if (flags & AbortOnError) {
+            tx_item.abort_on_error = true;
+        }
+        tx_item.setup = true;
+        tx_item.index = _tx_frame_counter;
+        tx_item.deadline = tx_deadline;
+        tx.queued_us = AP_HAL::micros64();
+        tx.actuator_command = (flags & IsActuatorCommand) != 0;
+        if (_tx_queue.push(tx)) {
+            _tx_frame_counter++;
+            stats.tx_requests++;
+        } else {
+            stats.tx_overflow++;
+        }
     }
-    _pollRead();     // Read poll is necessary because it can release the pending TX flag
     _pollWrite();
 
     return AP_HAL::CANIface::send(frame, tx_deadline, flags);
@@ -89,20 +131,19 @@ int16_t CANIface::send(const AP_HAL::CANFrame& frame, const uint64_t tx_deadline
 int16_t CANIface::receive(AP_HAL::CANFrame& out_frame, uint64_t& out_timestamp_us,
                           CANIface::CanIOFlags& out_flags)
 {
-    WITH_SEMAPHORE(sem);
-    if (_rx_queue.is_empty()) {
-        _pollRead();            // This allows to use the socket not calling poll() explicitly.
-        if (_rx_queue.is_empty()) {
-            return 0;
-        }
-    }
-    {
-        const CanRxItem &rx = *_rx_queue[0];
-        out_frame        = rx.frame;
-        out_timestamp_us = rx.timestamp_us;
-        out_flags        = rx.flags;
+    CanRxItem rx;
+    if (!_rx_forwarded.pop(rx)) {
+        // skip frames queued before the last clear_rx()
+        const uint64_t cleared_us = rx_cleared_us;
+        do {
+            if (!_rx_queue.pop(rx)) {
+                return 0;
+            }
+        } while (rx.timestamp_us <= cleared_us);
     }
-    IGNORE_RETURN(_rx_queue.pop());
+    out_frame        = rx.frame;
+    out_timestamp_us = rx.timestamp_us;
+    out_flags        = rx.flags;
     return AP_HAL::CANIface::receive(out_frame, out_timestamp_us, out_flags);
 }
 
@@ -114,18 +155,7 @@ bool CANIface::_hasReadyTx()
 
 bool CANIface::_hasReadyRx()
 {
-    WITH_SEMAPHORE(sem);
-    return !_rx_queue.is_empty();
-}
-
-void CANIface::_poll(bool read, bool write)
-{
-    if (read) {
-        _pollRead(); // Read poll must be executed first because it may decrement _frames_in_socket_tx_queue
-    }
-    if (write) {
-        _pollWrite();
-    }
+    return !_rx_queue.is_empty() || !_rx_forwarded.is_empty();
 }
 
 uint32_t CANIface::getErrorCount() const
@@ -133,66 +163,154 @@ uint32_t CANIface::getErrorCount() const
     return 0;
 }
 
+/*
+  send queued frames, handing the transport as many as possible per call
+ */
 void CANIface::_pollWrite()
 {
+    WITH_SEMAPHORE(sem);
     if (transport == nullptr) {
         return;
     }
-    while (_hasReadyTx()) {
-        WITH_SEMAPHORE(sem);
-        const CanTxItem *tx = _tx_queue[0];
-        if (tx == nullptr) {
+    AP_HAL::CANFrame frames[max_batch];
+    while (!_tx_queue.is_empty()) {
+        // drop expired frames from the head of the queue
+        const uint64_t curr_time = AP_HAL::micros64();
+        const TxItem *tx = _tx_queue[0];
+        if (tx->item.deadline < curr_time) {
+            stats.tx_timedout++;
+            IGNORE_RETURN(_tx_queue.pop());
+            continue;
+        }
+        uint16_t n = 0;
+        while (n < max_batch && n < _tx_queue.available()) {
+            tx = _tx_queue[n];
+            if (tx->item.deadline < curr_time) {
+                break;
+            }
+            frames[n++] = tx->item.frame;
+        }
+        const uint16_t sent = transport->send_batch(frames, n);
+        const uint64_t sent_us = AP_HAL::micros64();
+        for (uint16_t i=0; i<sent; i++) {
+            tx = _tx_queue[0];
+            const uint32_t latency_us = sent_us - tx->queued_us;
+            tx_latency.add(latency_us);
+            if (tx->actuator_command) {
+                command_latency.add(latency_us);
+            }
+            stats.tx_success++;
+            IGNORE_RETURN(_tx_queue.pop());
+        }
+        if (sent > 0) {
+            stats.last_transmit_us = sent_us;
+        }
+        if (sent < n) {
+            // transport is full, try again on the next poll
             break;
         }
-        const uint64_t curr_time = AP_HAL::micros64();
-        if (tx->deadline >= curr_time) {
-            bool ok = transport->send(tx->frame);
-            if (ok) {
-                stats.tx_success++;
-                stats.last_transmit_us = curr_time;
+    }
+}
+
+/*
+  per-bus receive thread, moving frames from the transport to the
+  RX queue in batches and waking the CAN thread once per batch
+ */
+void CANIface::rx_thread()
+{
+    AP_HAL::CANFrame frames[max_batch];
+    while (true) {
+        uint16_t n = 0;
+        bool have_transport;
+        {
+            // init() takes this before replacing the transport
+            WITH_SEMAPHORE(rx_transport_sem);
+            have_transport = transport != nullptr;
+            if (have_transport) {
+                struct pollfd fds {};
+                fds.fd = transport->get_read_fd();
+                fds.events = POLLIN;
+                if (::poll(&fds, 1, CAN_RX_THREAD_POLL_MS) > 0) {
+                    n = transport->receive_batch(frames, max_batch);
+                }
+            }
+        }
+        if (!have_transport) {
+            hal.scheduler->delay(CAN_RX_THREAD_POLL_MS);
+            continue;
+        }
+        if (n == 0) {
+            continue;
+        }
+        rx_batches++;
+        const uint64_t now_us = AP_HAL::micros64();
+        WITH_SEMAPHORE(filter_sem);
+        for (uint16_t i=0; i<n; i++) {
+            if (!filter_accepts(frames[i])) {
+                rx_filtered++;
+                continue;
+            }
+            CanRxItem rx {};
+            rx.frame = frames[i];
+            rx.timestamp_us = now_us;
+            if (_rx_queue.push(rx)) {
+                stats.rx_received++;
             } else {
-                break;
+                stats.rx_overflow++;
             }
-        } else {
-            stats.tx_timedout++;
         }
+        if (sem_handle != nullptr) {
+            sem_handle->signal();
+        }
+    }
+}
 
-        // Removing the frame from the queue
-        IGNORE_RETURN(_tx_queue.pop());
+/*
+  true if a frame passes the acceptance filters, or there are none.
+  Caller must hold filter_sem
+ */
+bool CANIface::filter_accepts(const AP_HAL::CANFrame &frame) const
+{
+    if (num_filters == 0) {
+        return true;
+    }
+    for (uint8_t i=0; i<num_filters; i++) {
+        const CanFilterConfig &f = filters[i];
+        if ((frame.id & f.mask) == (f.id & f.mask)) {
+            return true;
+        }
     }
+    return false;
 }
 
-bool CANIface::_pollRead()
+bool CANIface::configureFilters(const CanFilterConfig* filter_configs, uint16_t num_configs)
 {
-    if (transport == nullptr) {
+    if (num_configs > max_filters || (filter_configs == nullptr && num_configs > 0)) {
         return false;
     }
-    CanRxItem rx {};
-    bool ok = transport->receive(rx.frame);
-    if (!ok) {
-        return false;
+    WITH_SEMAPHORE(filter_sem);
+    for (uint8_t i=0; i<num_configs; i++) {
+        filters[i] = filter_configs[i];
     }
-    rx.timestamp_us = AP_HAL::micros64();
-    WITH_SEMAPHORE(sem);
-    add_to_rx_queue(rx);
-    stats.rx_received++;
+    num_filters = num_configs;
     return true;
 }
 
 // Might block forever, only to be used for testing
 void CANIface::flush_tx()
 {
-    WITH_SEMAPHORE(sem);
-    do {
-        _poll(true, true);
-    } while(!_tx_queue.is_empty());
+    while (_hasReadyTx()) {
+        _pollWrite();
+    }
 }
 
 void CANIface::clear_rx()
 {
-    WITH_SEMAPHORE(sem);
-    // Clean Rx Queue
-    _rx_queue.clear();
+    // the RX thread stamps every frame it queues, so receive(), the
+    // only reader of _rx_queue, drops what is older than this. That
+    // keeps the queue single producer, single consumer
+    rx_cleared_us = AP_HAL::micros64();
+    _rx_forwarded.clear();
 }
 
 void CANIface::_confirmSentFrame()
@@ -216,35 +334,61 @@ bool CANIface::init(const uint32_t bitrate, const OperatingMode mode)
     if (_self_index >= HAL_NUM_CAN_IFACES) {
         return false;
     }
+    // stop the RX thread and the TX path using the old transport
+    // before it is freed
+    set_transport(nullptr);
+
+    CAN_Transport *new_transport = nullptr;
     const SITL::SIM::CANTransport can_type = _sitl->can_transport[_self_index];
     switch (can_type) {
     case SITL::SIM::CANTransport::MulticastUDP:
-        transport = NEW_NOTHROW CAN_Multicast();
+        new_transport = NEW_NOTHROW CAN_Multicast();
         break;
 #if HAL_CAN_WITH_SOCKETCAN
     case SITL::SIM::CANTransport::SocketCAN:
-        transport = NEW_NOTHROW CAN_SocketCAN();
+        new_transport = NEW_NOTHROW CAN_SocketCAN();
         break;
 #endif
     case SITL::SIM::CANTransport::None:
     default: // if user supplies an invalid value for the parameter
-        transport = nullptr;
         break;
     }
-    if (transport == nullptr) {
+    if (new_transport == nullptr) {
         return false;
     }
-    if (!transport->init(_self_index)) {
-        delete transport;
-        transport = nullptr;
+    if (!new_transport->init(_self_index)) {
+        delete new_transport;
         return false;
     }
-    if (sem_handle != nullptr) {
-        transport->set_event_handle(sem_handle);
+    if (!rx_thread_started) {
+        hal.util->snprintf(rx_thread_name, sizeof(rx_thread_name), "CANRX%u", unsigned(_self_index));
+        if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&CANIface::rx_thread, void),
+                                          rx_thread_name, 4096, AP_HAL::Scheduler::PRIORITY_CAN, 0)) {
+            delete new_transport;
+            return false;
+        }
+        rx_thread_started = true;
     }
+    set_transport(new_transport);
     return true;
 }
 
+/*
+  replace the transport, freeing the old one once neither the RX
+  thread nor the TX path can be using it
+ */
+void CANIface::set_transport(CAN_Transport *new_transport)
+{
+    CAN_Transport *old_transport;
+    {
+        WITH_SEMAPHORE(rx_transport_sem);
+        WITH_SEMAPHORE(sem);
+        old_transport = transport;
+        transport = new_transport;
+    }
+    delete old_transport;
+}
+
 bool CANIface::select(bool &read_select, bool &write_select,
                       const AP_HAL::CANFrame* const pending_tx, uint64_t blocking_deadline)
 {
@@ -255,18 +399,15 @@ bool CANIface::select(bool &read_select, bool &write_select,
     bool need_block = !write_select;    // Write queue is infinite
 
     // call poll here to flush some tx
-    _poll(true, true);
+    _pollWrite();
 
     if (read_select && _hasReadyRx()) {
         need_block = false;
     }
 
-    if (need_block) {
-        _pollfd.fd = transport->get_read_fd();
-        _pollfd.events |= POLLIN;
-    }
+    // the RX thread signals sem_handle when frames arrive
     const uint64_t now_us = AP_HAL::micros64();
-    if (sem_handle != nullptr && blocking_deadline > now_us) {
+    if (need_block && sem_handle != nullptr && blocking_deadline > now_us) {
         IGNORE_RETURN(sem_handle->wait(blocking_deadline - now_us));
     }
 
@@ -280,9 +421,6 @@ bool CANIface::select(bool &read_select, bool &write_select,
 bool CANIface::set_event_handle(AP_HAL::BinarySemaphore *handle)
 {
     sem_handle = handle;
-    if (transport != nullptr) {
-        transport->set_event_handle(handle);
-    }
     return true;
 }
 
@@ -293,14 +431,25 @@ void CANIface::get_stats(ExpandingString &str)
                "tx_rejected:    %u\n"
                "tx_success:     %u\n"
                "tx_timedout:    %u\n"
+               "tx_overflow:    %u\n"
                "rx_received:    %u\n"
-               "rx_errors:      %u\n",
+               "rx_overflow:    %u\n"
+               "rx_errors:      %u\n"
+               "rx_batches:     %u\n"
+               "rx_filtered:    %u\n",
                stats.tx_requests,
                stats.tx_rejected,
                stats.tx_success,
                stats.tx_timedout,
+               stats.tx_overflow,
                stats.rx_received,
-               stats.rx_errors);
+               stats.rx_overflow,
+               stats.rx_errors,
+               unsigned(rx_batches),
+               unsigned(rx_filtered));
+    WITH_SEMAPHORE(sem);
+    tx_latency.print(str, "tx");
+    command_latency.print(str, "actuator command");
 }
 
 #endif
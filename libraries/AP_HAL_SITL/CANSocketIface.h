@@ -21,6 +21,7 @@
 
 #include <AP_HAL/CANIface.h>
 #include <AP_HAL/utility/RingBuffer.h>
+#include <atomic>
 #include <string>
 #include <memory>
 #include <map>
@@ -89,6 +90,12 @@ public:
     // setup event handle for waiting on events
     bool set_event_handle(AP_HAL::BinarySemaphore *handle) override;
 
+    // acceptance filters, applied in software by the RX thread
+    bool configureFilters(const CanFilterConfig* filter_configs, uint16_t num_configs) override;
+    uint16_t getNumFilters() const override {
+        return max_filters;
+    }
+
     // fetch stats text and return the size of the same,
     // results available via @SYS/can0_stats.txt or @SYS/can1_stats.txt 
     void get_stats(ExpandingString &str) override;
@@ -101,9 +108,39 @@ public:
     }
     
 private:
+    // most frames moved per transport call
+    static const uint8_t max_batch = 32;
+
+    static const uint8_t max_filters = 32;
+    CanFilterConfig filters[max_filters];
+    uint8_t num_filters;
+    HAL_Semaphore filter_sem;
+    uint32_t rx_filtered;
+    bool filter_accepts(const AP_HAL::CANFrame &frame) const;
+
+    // queue to wire latency histogram, bucket upper bounds in microseconds
+    static const uint8_t num_latency_buckets = 8;
+    static const uint16_t latency_bucket_us[num_latency_buckets-1];
+    struct LatencyHistogram {
+        uint32_t count[num_latency_buckets];
+        uint32_t max_us;
+        uint64_t total_us;
+        void add(uint32_t latency_us);
+        void print(ExpandingString &str, const char *name) const;
+    };
+
+    struct TxItem {
+        CanTxItem item;
+        uint64_t queued_us;
+        bool actuator_command;
+    };
+
     void _pollWrite();
 
-    bool _pollRead();
+    void rx_thread();
+
+    // swap in a new transport, freeing the old one
+    void set_transport(CAN_Transport *new_transport);
 
     void _confirmSentFrame();
 
@@ -111,13 +148,11 @@ private:
 
     bool _hasReadyRx();
 
-    void _poll(bool read, bool write);
-
-    int _openSocket(const std::string& iface_name);
-
-    void _updateDownStatusFromPollResult(const pollfd& pfd);
 
+    // replaced under both sem and rx_transport_sem, so holding either
+    // keeps it alive
     CAN_Transport *transport;
+    HAL_Semaphore rx_transport_sem;
 
     const uint8_t _self_index;
 
@@ -125,9 +160,20 @@ private:
     uint32_t _tx_frame_counter;
     AP_HAL::BinarySemaphore *sem_handle;
 
-    pollfd _pollfd;
-    ObjectArray<CanTxItem> _tx_queue{100};
-    ObjectArray<CanRxItem> _rx_queue{100};
+    ObjectArray<TxItem> _tx_queue{100};
+
+    // filled by the RX thread and emptied by receive() without locking
+    ObjectBuffer<CanRxItem> _rx_queue{256};
+    // frames queued at or before this time were discarded by clear_rx()
+    std::atomic<uint64_t> rx_cleared_us {0};
+    // frames forwarded from other interfaces, may be pushed from any thread
+    ObjectBuffer_TS<CanRxItem> _rx_forwarded{16};
+    bool rx_thread_started;
+    char rx_thread_name[8];
+    uint32_t rx_batches;
+
+    LatencyHistogram tx_latency;
+    LatencyHistogram command_latency;
 
     /*
       bus statistics
@@ -137,8 +183,7 @@ private:
     HAL_Semaphore sem;
 
     bool add_to_rx_queue(const CanRxItem &rx_item) override {
-        _rx_queue.push(rx_item);
-        return true;
+        return _rx_forwarded.push(rx_item);
     }
 
     int8_t get_iface_num(void) const override {
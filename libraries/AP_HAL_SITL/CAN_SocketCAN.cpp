@@ -13,6 +13,8 @@
 #include <linux/can.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <sys/socket.h>
+#include <AP_Math/AP_Math.h>
 #include "CAN_SocketCAN.h"
 
 /*
@@ -53,6 +55,14 @@ fail:
     return false;
 }
 
+static void to_can_frame(const AP_HAL::CANFrame &frame, struct can_frame &out)
+{
+    memset(&out, 0, sizeof(out));
+    out.can_id = frame.id;
+    out.can_dlc = frame.dlc;
+    memcpy(out.data, frame.data, AP_HAL::CANFrame::dlcToDataLength(frame.dlc));
+}
+
 /*
   send a CAN frame
  */
@@ -62,16 +72,38 @@ bool CAN_SocketCAN::send(const AP_HAL::CANFrame &frame)
         // not supported on socketcan
         return false;
     }
-    struct can_frame transmit_frame {};
-    transmit_frame.can_id = frame.id;
-    transmit_frame.can_dlc = frame.dlc;
-
-    const uint8_t data_length = AP_HAL::CANFrame::dlcToDataLength(frame.dlc);
-    memcpy(transmit_frame.data, frame.data, data_length);
+    struct can_frame transmit_frame;
+    to_can_frame(frame, transmit_frame);
 
     return ::write(fd, &transmit_frame, sizeof(transmit_frame)) == sizeof(transmit_frame);
 }
 
+/*
+  send frames with one sendmmsg() call, stopping at the first CANFD
+  frame or when the socket buffer is full
+ */
+uint16_t CAN_SocketCAN::send_batch(const AP_HAL::CANFrame *frames, uint16_t count)
+{
+    struct can_frame cf[max_batch];
+    struct iovec iov[max_batch];
+    struct mmsghdr msgs[max_batch] {};
+
+    uint16_t n = 0;
+    while (n < count && n < max_batch && !frames[n].canfd) {
+        to_can_frame(frames[n], cf[n]);
+        iov[n].iov_base = &cf[n];
+        iov[n].iov_len = sizeof(cf[n]);
+        msgs[n].msg_hdr.msg_iov = &iov[n];
+        msgs[n].msg_hdr.msg_iovlen = 1;
+        n++;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    const int ret = ::sendmmsg(fd, msgs, n, 0);
+    return ret > 0 ? ret : 0;
+}
+
 /*
   receive a CAN frame
  */
@@ -86,10 +118,38 @@ bool CAN_SocketCAN::receive(AP_HAL::CANFrame &frame)
     // run constructor to initialise
     new(&frame) AP_HAL::CANFrame(receive_frame.can_id, receive_frame.data, receive_frame.can_dlc, false);
 
-    if (sem_handle != nullptr) {
-        sem_handle->signal();
-    }
     return true;
 }
 
+/*
+  receive all waiting frames, up to max, with one recvmmsg() call
+ */
+uint16_t CAN_SocketCAN::receive_batch(AP_HAL::CANFrame *frames, uint16_t max)
+{
+    struct can_frame cf[max_batch];
+    struct iovec iov[max_batch];
+    struct mmsghdr msgs[max_batch] {};
+
+    const uint16_t n = MIN(max, uint16_t(max_batch));
+    for (uint16_t i=0; i<n; i++) {
+        iov[i].iov_base = &cf[i];
+        iov[i].iov_len = sizeof(cf[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    const int ret = ::recvmmsg(fd, msgs, n, MSG_DONTWAIT, nullptr);
+    if (ret <= 0) {
+        return 0;
+    }
+    uint16_t count = 0;
+    for (int i=0; i<ret; i++) {
+        if (msgs[i].msg_len != sizeof(cf[i])) {
+            continue;
+        }
+        new(&frames[count]) AP_HAL::CANFrame(cf[i].can_id, cf[i].data, cf[i].can_dlc, false);
+        count++;
+    }
+    return count;
+}
+
 #endif // HAL_NUM_CAN_IFACES
@@ -12,12 +12,17 @@ public:
     bool init(uint8_t instance) override;
     bool send(const AP_HAL::CANFrame &frame) override;
     bool receive(AP_HAL::CANFrame &frame) override;
+    uint16_t receive_batch(AP_HAL::CANFrame *frames, uint16_t max) override;
+    uint16_t send_batch(const AP_HAL::CANFrame *frames, uint16_t count) override;
     int get_read_fd(void) const override {
         return fd;
     }
 
 private:
     int fd = -1;
+
+    // most frames moved in one system call
+    static const uint8_t max_batch = 32;
 };
 
 #endif // HAL_NUM_CAN_IFACES
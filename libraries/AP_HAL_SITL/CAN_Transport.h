@@ -17,12 +17,29 @@ public:
     virtual bool receive(AP_HAL::CANFrame &frame) = 0;
     virtual int get_read_fd(void) const = 0;
 
-    void set_event_handle(AP_HAL::BinarySemaphore *handle) {
-        sem_handle = handle;
+    /*
+      receive up to max frames, returning the number received.
+      Transports which can read several frames in one system call
+      override this
+     */
+    virtual uint16_t receive_batch(AP_HAL::CANFrame *frames, uint16_t max) {
+        uint16_t n = 0;
+        while (n < max && receive(frames[n])) {
+            n++;
+        }
+        return n;
     }
 
-protected:
-    AP_HAL::BinarySemaphore *sem_handle;
+    /*
+      send count frames in order, returning the number sent
+     */
+    virtual uint16_t send_batch(const AP_HAL::CANFrame *frames, uint16_t count) {
+        uint16_t n = 0;
+        while (n < count && send(frames[n])) {
+            n++;
+        }
+        return n;
+    }
 };
 
 #endif // HAL_NUM_CAN_IFACES
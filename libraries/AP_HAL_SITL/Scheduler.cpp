@@ -13,6 +13,7 @@
 #include <malloc.h>
 #endif
 #include <AP_RCProtocol/AP_RCProtocol.h>
+#include <AP_HAL/utility/ThreadTrace.h>
 #ifdef UBSAN_ENABLED
 #include <fcntl.h>
 #include <sanitizer/asan_interface.h>
@@ -95,6 +96,9 @@ void __ubsan_on_report()
 void Scheduler::init()
 {
     _main_ctx = pthread_self();
+#if AP_HAL_THREAD_TRACE_ENABLED
+    ThreadTrace::init();
+#endif
 }
 
 bool Scheduler::in_main_thread() const
@@ -133,6 +137,9 @@ void Scheduler::delay_microseconds(uint16_t usec)
         hal.scheduler->stop_clock(AP_HAL::micros64()+usec);
         return;
     }
+#if AP_HAL_THREAD_TRACE_ENABLED
+    const uint64_t trace_start_us = ThreadTrace::begin();
+#endif
     uint64_t start = AP_HAL::micros64();
     do {
         uint64_t dtime = AP_HAL::micros64() - start;
@@ -141,6 +148,9 @@ void Scheduler::delay_microseconds(uint16_t usec)
         }
         _sitlState->wait_clock(start + usec);
     } while (true);
+#if AP_HAL_THREAD_TRACE_ENABLED
+    ThreadTrace::end(ThreadTrace::Kind::DELAY, trace_start_us, usec);
+#endif
 }
 
 void Scheduler::delay(uint16_t ms)
@@ -246,6 +256,9 @@ void Scheduler::_run_timer_procs()
         return;
     }
     _in_timer_proc = true;
+#if AP_HAL_THREAD_TRACE_ENABLED
+    const uint64_t trace_start_us = ThreadTrace::begin();
+#endif
 
     // now call the timer based drivers
     for (int i = 0; i < _num_timer_procs; i++) {
@@ -259,6 +272,9 @@ void Scheduler::_run_timer_procs()
         _failsafe();
     }
 
+#if AP_HAL_THREAD_TRACE_ENABLED
+    ThreadTrace::end(ThreadTrace::Kind::TIMER_PROCS, trace_start_us, _num_timer_procs);
+#endif
     _in_timer_proc = false;
 }
 
@@ -268,6 +284,9 @@ void Scheduler::_run_io_procs()
         return;
     }
     _in_io_proc = true;
+#if AP_HAL_THREAD_TRACE_ENABLED
+    const uint64_t trace_start_us = ThreadTrace::begin();
+#endif
 
     // now call the IO based drivers
     for (int i = 0; i < _num_io_procs; i++) {
@@ -278,6 +297,7 @@ void Scheduler::_run_io_procs()
 
     _in_io_proc = false;
 
+    UARTDriver::poll_all();
     for (uint8_t i=0; i<hal.num_serial; i++) {
         hal.serial(i)->_timer_tick();
     }
@@ -293,6 +313,10 @@ void Scheduler::_run_io_procs()
 #if AP_RCPROTOCOL_ENABLED
     AP::RC().update();
 #endif
+
+#if AP_HAL_THREAD_TRACE_ENABLED
+    ThreadTrace::end(ThreadTrace::Kind::IO_PROCS, trace_start_us, _num_io_procs);
+#endif
 }
 
 /*
@@ -4,6 +4,7 @@
 
 #include "Semaphores.h"
 #include "Scheduler.h"
+#include <AP_HAL/utility/ThreadTrace.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -21,6 +22,11 @@ Semaphore::Semaphore()
 
 bool Semaphore::give()
 {
+#if AP_HAL_THREAD_TRACE_ENABLED
+    if (take_count == 1 && trace) {
+        ThreadTrace::end(ThreadTrace::Kind::SEM_HOLD, trace_hold_start_us, uintptr_t(this));
+    }
+#endif
     take_count--;
     if (pthread_mutex_unlock(&_lock) != 0) {
         AP_HAL::panic("Bad semaphore usage");
@@ -40,11 +46,29 @@ void Semaphore::check_owner() const
 }
 
 bool Semaphore::take(uint32_t timeout_ms)
+{
+#if AP_HAL_THREAD_TRACE_ENABLED
+    if (!trace || !ThreadTrace::active()) {
+        return _take(timeout_ms);
+    }
+    // only a take which has to wait is traced
+    if (take_nonblocking()) {
+        return true;
+    }
+    const uint64_t trace_start_us = ThreadTrace::begin();
+    const bool ret = _take(timeout_ms);
+    ThreadTrace::end(ThreadTrace::Kind::SEM_WAIT, trace_start_us, uintptr_t(this));
+    return ret;
+#else
+    return _take(timeout_ms);
+#endif
+}
+
+bool Semaphore::_take(uint32_t timeout_ms)
 {
     if (timeout_ms == HAL_SEMAPHORE_BLOCK_FOREVER) {
         if (pthread_mutex_lock(&_lock) == 0) {
-            owner = pthread_self();
-            take_count++;
+            taken();
             return true;
         }
         return false;
@@ -66,11 +90,22 @@ bool Semaphore::take(uint32_t timeout_ms)
     return false;
 }
 
+// called with the mutex newly taken
+void Semaphore::taken()
+{
+    owner = pthread_self();
+    take_count++;
+#if AP_HAL_THREAD_TRACE_ENABLED
+    if (take_count == 1 && trace) {
+        trace_hold_start_us = ThreadTrace::begin();
+    }
+#endif
+}
+
 bool Semaphore::take_nonblocking()
 {
     if (pthread_mutex_trylock(&_lock) == 0) {
-        owner = pthread_self();
-        take_count++;
+        taken();
         return true;
     }
     return false;
@@ -86,6 +121,9 @@ BinarySemaphore::BinarySemaphore(bool initial_state) :
 {
     pthread_cond_init(&cond, NULL);
     pending = initial_state;
+#if AP_HAL_THREAD_TRACE_ENABLED
+    mtx.trace = false;
+#endif
 }
 
 bool BinarySemaphore::wait(uint32_t timeout_us)
@@ -18,12 +18,22 @@ public:
     void check_owner() const;  // asserts that current thread owns semaphore
 
 protected:
+    bool _take(uint32_t timeout_ms);
+    void taken();
+
     pthread_mutex_t _lock;
     pthread_t owner;
 
     // keep track the recursion level to ensure we only disown the
     // semaphore once we're done with it
     uint8_t take_count;
+
+#if AP_HAL_THREAD_TRACE_ENABLED
+    // the mutex of a BinarySemaphore is released while waiting on
+    // its condition, so its hold times would be wrong
+    bool trace = true;
+    uint64_t trace_hold_start_us;
+#endif
 };
 
 
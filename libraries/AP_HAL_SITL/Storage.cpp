@@ -88,6 +88,13 @@ void Storage::_storage_open(void)
             return;
         }
 
+#if AP_HAL_STORAGE_JOURNAL_ENABLED
+        if (!_journal.init(HAL_STORAGE_FILE)) {
+            hal.console->printf("journal setup failed for " HAL_STORAGE_FILE "\n");
+            log_fd = -1;
+            return;
+        }
+#else
         log_fd = open(HAL_STORAGE_FILE, O_RDWR|O_CREAT, 0644);
         if (log_fd == -1) {
             hal.console->printf("open failed of " HAL_STORAGE_FILE "\n");
@@ -111,6 +118,7 @@ void Storage::_storage_open(void)
             log_fd = -1;
             return;
         }
+#endif // AP_HAL_STORAGE_JOURNAL_ENABLED
         _initialisedType = StorageBackend::SDCard;  // AKA POSIX
         return;
     }
@@ -155,6 +163,13 @@ void Storage::write_block(uint16_t loc, const void *src, size_t n)
     }
     if (memcmp(src, &_buffer[loc], n) != 0) {
         _storage_open();
+#if STORAGE_USE_POSIX && AP_HAL_STORAGE_JOURNAL_ENABLED
+        if (_initialisedType == StorageBackend::SDCard) {
+            // copy under the journal lock so a commit never holds half a write
+            _journal.write(loc, src, n);
+            return;
+        }
+#endif
         memcpy(&_buffer[loc], src, n);
         _mark_dirty(loc, n);
     }
@@ -165,8 +180,21 @@ void Storage::_timer_tick(void)
     if (_initialisedType == StorageBackend::None) {
         return;
     }
+#if STORAGE_USE_POSIX && AP_HAL_STORAGE_JOURNAL_ENABLED
+    if (_initialisedType == StorageBackend::SDCard) {
+        // the journal coalesces writes and commits them itself
+        _journal.update();
+        return;
+    }
+#endif
     if (_dirty_mask.empty()) {
         _last_empty_ms = AP_HAL::millis();
+#if STORAGE_USE_FLASH
+        if (_initialisedType == StorageBackend::Flash) {
+            // use idle time to progress any pending sector switch
+            _flash.update();
+        }
+#endif
         return;
     }
 
@@ -190,7 +218,7 @@ void Storage::_timer_tick(void)
         }
 #endif
 
-#if STORAGE_USE_POSIX
+#if STORAGE_USE_POSIX && !AP_HAL_STORAGE_JOURNAL_ENABLED
     if (hal.get_storage_posix_enabled()) {
         if (log_fd != -1) {
             const off_t offset = STORAGE_LINE_SIZE*i;
@@ -385,9 +413,27 @@ bool Storage::healthy(void)
     if (_initialisedType == StorageBackend::None) {
         return false;
     }
+#if STORAGE_USE_POSIX && AP_HAL_STORAGE_JOURNAL_ENABLED
+    if (_initialisedType == StorageBackend::SDCard) {
+        return _journal.healthy();
+    }
+#endif
     return AP_HAL::millis() - _last_empty_ms < 2000;
 }
 
+/*
+  the journal commits consistent snapshots in order, the line based
+  backends write dirty lines in line order
+ */
+bool Storage::keeps_write_order(void)
+{
+#if STORAGE_USE_POSIX && AP_HAL_STORAGE_JOURNAL_ENABLED
+    return _initialisedType == StorageBackend::SDCard;
+#else
+    return false;
+#endif
+}
+
 /*
   get storage size and ptr
  */
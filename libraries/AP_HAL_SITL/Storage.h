@@ -5,6 +5,7 @@
 #include "AP_HAL_SITL_Namespace.h"
 #include <AP_FlashStorage/AP_FlashStorage.h>
 #include <AP_RAMTRON/AP_RAMTRON.h>
+#include <AP_HAL/utility/StorageJournal.h>
 
 #ifndef STORAGE_USE_FLASH
 #define STORAGE_USE_FLASH 1
@@ -32,6 +33,7 @@ public:
 
     void _timer_tick(void) override;
     bool healthy(void) override;
+    bool keeps_write_order(void) override;
 
 private:
     enum class StorageBackend: uint8_t {
@@ -73,6 +75,9 @@ private:
 
 #if STORAGE_USE_POSIX
     int log_fd;
+#if AP_HAL_STORAGE_JOURNAL_ENABLED
+    StorageJournal _journal{_buffer};
+#endif
 #endif
 
 #if STORAGE_USE_FRAM
@@ -34,6 +34,10 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/select.h>
+#include <sys/uio.h>
+#if AP_HAL_SITL_UART_EPOLL_ENABLED
+#include <sys/epoll.h>
+#endif
 #include <termios.h>
 #include <sys/time.h>
 #include <arpa/inet.h>
@@ -53,6 +57,9 @@ extern const AP_HAL::HAL& hal;
 using namespace HALSITL;
 
 bool UARTDriver::_console;
+#if AP_HAL_SITL_UART_EPOLL_ENABLED
+int UARTDriver::_epoll_fd = -1;
+#endif
 
 /* UARTDriver method implementations */
 
@@ -323,9 +330,7 @@ void UARTDriver::_tcp_start_connection(uint16_t port, bool wait_for_connection)
         return;
     }
 
-    if (_fd != -1) {
-        close(_fd);
-    }
+    _close_fd(_fd);
 
     if (_listen_fd == -1) {
         memset(&_listen_sockaddr,0,sizeof(_listen_sockaddr));
@@ -409,9 +414,7 @@ void UARTDriver::_tcp_start_client(const char *address, uint16_t port)
 
     _use_send_recv = true;
 
-    if (_fd != -1) {
-        close(_fd);
-    }
+    _close_fd(_fd);
 
     struct sockaddr_in sockaddr;
     memset(&sockaddr,0,sizeof(sockaddr));
@@ -481,9 +484,7 @@ void UARTDriver::_udp_start_client(const char *address, uint16_t port)
 
     _use_send_recv = true;
     
-    if (_fd != -1) {
-        close(_fd);
-    }
+    _close_fd(_fd);
 
     memset(&sockaddr,0,sizeof(sockaddr));
 
@@ -658,7 +659,8 @@ void UARTDriver::_check_connection(void)
         // we only want 1 connection at a time
         return;
     }
-    if (_select_check(_listen_fd)) {
+    if (poll_ready(_listen_fd)) {
+        _poll_ready = false;
         _fd = accept(_listen_fd, nullptr, nullptr);
         if (_fd != -1) {
             int one = 1;
@@ -697,6 +699,114 @@ bool UARTDriver::_select_check(int fd)
     return false;
 }
 
+/*
+  the fd to watch for input: the listening socket until a client
+  connects, nothing for in-process devices
+ */
+int UARTDriver::poll_fd() const
+{
+    if (!_connected) {
+        return _listen_fd;
+    }
+    if (_mc_fd >= 0) {
+        return _mc_fd;
+    }
+    if (_sim_serial_device != nullptr || logic_async_csv.active) {
+        return -1;
+    }
+    return _console?0:_fd;
+}
+
+/*
+  keep the registered fd in step with the connection state
+ */
+void UARTDriver::update_poll_fd()
+{
+    const int fd = poll_fd();
+    if (fd == _poll_fd) {
+        return;
+    }
+#if AP_HAL_SITL_UART_EPOLL_ENABLED
+    if (_poll_fd != -1 && !_poll_always) {
+        epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, _poll_fd, nullptr);
+    }
+#endif
+    _poll_fd = fd;
+    _poll_always = false;
+    _poll_ready = false;
+#if AP_HAL_SITL_UART_EPOLL_ENABLED
+    if (fd != -1) {
+        struct epoll_event ev {};
+        ev.events = EPOLLIN;
+        ev.data.ptr = this;
+        if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            // regular files can't be polled, and are always readable
+            _poll_always = true;
+        }
+    }
+#endif
+}
+
+bool UARTDriver::poll_ready(int fd) const
+{
+    return fd != -1 && fd == _poll_fd && (_poll_ready || _poll_always);
+}
+
+/*
+  one readiness check covering every SITL UART, instead of a select()
+  per port per tick. Ports with nothing pending then make no syscalls
+  at all in their _timer_tick()
+ */
+void UARTDriver::poll_all(void)
+{
+#if !APM_BUILD_TYPE(APM_BUILD_Replay)
+#if AP_HAL_SITL_UART_EPOLL_ENABLED
+    if (_epoll_fd == -1) {
+        _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (_epoll_fd == -1) {
+            AP_HAL::panic("epoll_create1 failed: %s", strerror(errno));
+        }
+    }
+#endif
+    for (uint8_t i=0; i<hal.num_serial; i++) {
+        auto *uart = (UARTDriver *)hal.serial(i);
+        uart->update_poll_fd();
+#if AP_HAL_SITL_UART_EPOLL_ENABLED
+        uart->_poll_ready = false;
+#else
+        uart->_poll_ready = !uart->_poll_always && _select_check(uart->_poll_fd);
+#endif
+    }
+#if AP_HAL_SITL_UART_EPOLL_ENABLED
+    // anything not returned here is still pending next time
+    struct epoll_event events[16];
+    const int n = epoll_wait(_epoll_fd, events, ARRAY_SIZE(events), 0);
+    for (int i=0; i<n; i++) {
+        ((UARTDriver *)events[i].data.ptr)->_poll_ready = true;
+    }
+#endif
+#endif  // APM_BUILD_Replay
+}
+
+void UARTDriver::_close_fd(int &fd)
+{
+    if (fd == -1) {
+        return;
+    }
+    if (fd == _poll_fd) {
+        // deregister before the fd number can be reused
+#if AP_HAL_SITL_UART_EPOLL_ENABLED
+        if (!_poll_always) {
+            epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+#endif
+        _poll_fd = -1;
+        _poll_ready = false;
+    }
+    close(fd);
+    fd = -1;
+}
+
 void UARTDriver::_set_nonblocking(int fd)
 {
     unsigned v = fcntl(fd, F_GETFL, 0);
@@ -856,27 +966,48 @@ void UARTDriver::handle_writing_from_writebuffer_to_device()
             }
         }
     } else {
-        uint32_t navail;
-        const uint8_t *readptr = _writebuffer.readptr(navail);
-        if (readptr && navail > 0) {
-            navail = MIN(navail, max_bytes);
-            if (_sim_serial_device != nullptr) {
-                nwritten = _sim_serial_device->write_to_device((const char*)readptr, navail);
-            } else if (!_use_send_recv) {
-                nwritten = ::write(_fd, readptr, navail);
+        // send both parts of a wrapped buffer at once
+        ByteBuffer::IoVec vec[2];
+        const uint8_t n_vec = _writebuffer.peekiovec(vec, max_bytes);
+        if (n_vec == 0) {
+            return;
+        }
+        if (_sim_serial_device != nullptr) {
+            // in-process device, straight into its ring buffer
+            nwritten = 0;
+            for (uint8_t i=0; i<n_vec; i++) {
+                const ssize_t ret = _sim_serial_device->write_to_device((const char*)vec[i].data, vec[i].len);
+                if (ret <= 0) {
+                    break;
+                }
+                nwritten += ret;
+                if (uint32_t(ret) < vec[i].len) {
+                    break;
+                }
+            }
+        } else {
+            struct iovec iov[2];
+            for (uint8_t i=0; i<n_vec; i++) {
+                iov[i].iov_base = vec[i].data;
+                iov[i].iov_len = vec[i].len;
+            }
+            if (!_use_send_recv) {
+                nwritten = ::writev(_fd, iov, n_vec);
                 if (nwritten == -1 && errno != EAGAIN && _uart_path) {
-                    close(_fd);
-                    _fd = -1;
+                    _close_fd(_fd);
                     _connected = false;
                 }
             } else {
-                nwritten = send(_fd, readptr, navail, MSG_DONTWAIT);
-            }
-            if (nwritten > 0) {
-                _writebuffer.advance(nwritten);
-                _tx_stats_bytes += nwritten;
+                struct msghdr msg {};
+                msg.msg_iov = iov;
+                msg.msg_iovlen = n_vec;
+                nwritten = sendmsg(_fd, &msg, MSG_DONTWAIT);
             }
         }
+        if (nwritten > 0) {
+            _writebuffer.advance(nwritten);
+            _tx_stats_bytes += nwritten;
+        }
     }
 }
 
@@ -907,13 +1038,25 @@ void UARTDriver::handle_reading_from_device_to_readbuffer()
 
     space = MIN(space, max_bytes);
 
-    char buf[space];
+    // read straight into the free part of the ring buffer
+    ByteBuffer::IoVec vec[2];
+    const uint8_t n_vec = _readbuffer.reserve(vec, space);
+    struct iovec iov[2];
+    for (uint8_t i=0; i<n_vec; i++) {
+        iov[i].iov_base = vec[i].data;
+        iov[i].iov_len = vec[i].len;
+    }
+
     ssize_t nread = 0;
     if (_mc_fd >= 0) {
-        if (_select_check(_mc_fd)) {
-            struct sockaddr_in from;
-            socklen_t fromlen = sizeof(from);
-            nread = recvfrom(_mc_fd, buf, space, MSG_DONTWAIT, (struct sockaddr *)&from, &fromlen);
+        if (poll_ready(_mc_fd)) {
+            struct sockaddr_in from {};
+            struct msghdr msg {};
+            msg.msg_name = &from;
+            msg.msg_namelen = sizeof(from);
+            msg.msg_iov = iov;
+            msg.msg_iovlen = n_vec;
+            nread = recvmsg(_mc_fd, &msg, MSG_DONTWAIT);
             uint16_t port = ntohs(from.sin_port);
             if (_mc_myport == 0) {
                 // get our own address, so we can recognise packets from ourself
@@ -932,27 +1075,41 @@ void UARTDriver::handle_reading_from_device_to_readbuffer()
                 nread = 0;
             }
         }
-    } else if (_sim_serial_device != nullptr) {
-        nread = _sim_serial_device->read_from_device(buf, space);
-    } else if (logic_async_csv.active) {
-        nread = read_from_async_csv((uint8_t*)buf, space);
+    } else if (_sim_serial_device != nullptr || logic_async_csv.active) {
+        // in-process sources, no syscalls needed
+        for (uint8_t i=0; i<n_vec; i++) {
+            ssize_t ret;
+            if (_sim_serial_device != nullptr) {
+                ret = _sim_serial_device->read_from_device((char*)vec[i].data, vec[i].len);
+            } else {
+                ret = read_from_async_csv(vec[i].data, vec[i].len);
+            }
+            if (ret <= 0) {
+                break;
+            }
+            nread += ret;
+            if (size_t(ret) < vec[i].len) {
+                break;
+            }
+        }
     } else if (!_use_send_recv) {
-        if (!_select_check(_fd)) {
+        const int fd = _console?0:_fd;
+        if (!poll_ready(fd)) {
             return;
         }
-        int fd = _console?0:_fd;
-        nread = ::read(fd, buf, space);
+        nread = ::readv(fd, iov, n_vec);
         if (nread == -1 && errno != EAGAIN && _uart_path) {
-            close(_fd);
-            _fd = -1;
+            _close_fd(_fd);
             _connected = false;
         }
-    } else if (_select_check(_fd)) {
-        nread = recv(_fd, buf, space, MSG_DONTWAIT);
-        if (nread <= 0 && !_is_udp) {
+    } else if (poll_ready(_fd)) {
+        struct msghdr msg {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n_vec;
+        nread = recvmsg(_fd, &msg, MSG_DONTWAIT);
+        if (!_is_udp && (nread == 0 || (nread == -1 && errno != EAGAIN))) {
             // the socket has reached EOF
-            close(_fd);
-            _fd = -1;
+            _close_fd(_fd);
             _connected = false;
             fprintf(stdout, "Closed connection on SERIAL%u\n", _portNumber);
             fflush(stdout);
@@ -968,7 +1125,7 @@ void UARTDriver::handle_reading_from_device_to_readbuffer()
         }
     }
     if (nread > 0) {
-        _readbuffer.write((uint8_t *)buf, nread);
+        _readbuffer.commit(nread);
         _receive_timestamp = AP_HAL::micros64();
     }
 }
@@ -13,6 +13,14 @@
 
 #include <SITL/SIM_SerialDevice.h>
 
+#ifndef AP_HAL_SITL_UART_EPOLL_ENABLED
+#ifdef __linux__
+#define AP_HAL_SITL_UART_EPOLL_ENABLED 1
+#else
+#define AP_HAL_SITL_UART_EPOLL_ENABLED 0
+#endif
+#endif
+
 class HALSITL::UARTDriver : public AP_HAL::UARTDriver {
 public:
     friend class HALSITL::SITL_State;
@@ -51,6 +59,10 @@ public:
 
     void _timer_tick(void) override;
 
+    // check all the SITL UARTs for pending input with a single
+    // syscall, ready for their next _timer_tick()
+    static void poll_all(void);
+
     /*
       return timestamp estimate in microseconds for when the start of
       a nbytes packet arrived on the uart. This should be treated as a
@@ -104,6 +116,7 @@ private:
     void _udp_start_multicast(const char *address, uint16_t port);
     void _check_connection(void);
     static bool _select_check(int );
+    void _close_fd(int &fd);
     static void _set_nonblocking(int );
     bool set_speed(int speed) const;
 
@@ -123,6 +136,17 @@ private:
 
     SITL::SerialDevice *_sim_serial_device;
 
+    // readiness from the last poll_all()
+    int poll_fd() const;
+    void update_poll_fd();
+    bool poll_ready(int fd) const;
+    int _poll_fd = -1;      // fd registered for polling
+    bool _poll_always;      // fd can't be polled, always try IO
+    bool _poll_ready;       // _poll_fd had input at the last poll
+#if AP_HAL_SITL_UART_EPOLL_ENABLED
+    static int _epoll_fd;
+#endif
+
     struct {
         bool active;
         uint8_t term[20];
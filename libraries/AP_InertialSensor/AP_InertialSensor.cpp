@@ -1977,6 +1977,10 @@ void AP_InertialSensor::update(void)
     
     _have_sample = false;
 
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    AP::scheduler().loop_trace.mark(AP::LoopTrace::Point::INS_UPDATE);
+#endif
+
 #if HAL_INS_TEMPERATURE_CAL_ENABLE
     if (tcal_learning && !temperature_cal_running()) {
         AP_Notify::flags.temp_cal_running = false;
@@ -243,9 +243,9 @@ bool MSP::msp_parse_received_data(msp_port_t *msp, uint8_t c)
     case MSP_HEADER_V2_OVER_V1:     // V2 header is part of V1 payload - we need to calculate both checksums now
         msp->in_buf[msp->offset++] = c;
         msp->checksum1 ^= c;
-        msp->checksum2 = crc8_dvb_s2(msp->checksum2, c);
         if (msp->offset == (sizeof(msp_header_v2_t) + sizeof(msp_header_v1_t))) {
             msp_header_v2_t * hdrv2 = (msp_header_v2_t *)&msp->in_buf[sizeof(msp_header_v1_t)];
+            msp->checksum2 = crc8_dvb_s2_update(0, hdrv2, sizeof(msp_header_v2_t));
             msp->data_size = hdrv2->size;
 
             // Check for potential buffer overflow
@@ -261,11 +261,12 @@ bool MSP::msp_parse_received_data(msp_port_t *msp, uint8_t c)
         break;
 
     case MSP_PAYLOAD_V2_OVER_V1:
-        msp->checksum2 = crc8_dvb_s2(msp->checksum2, c);
         msp->checksum1 ^= c;
         msp->in_buf[msp->offset++] = c;
 
         if (msp->offset == msp->data_size) {
+            // crc the whole payload at once
+            msp->checksum2 = crc8_dvb_s2_update(msp->checksum2, msp->in_buf, msp->data_size);
             msp->c_state = MSP_CHECKSUM_V2_OVER_V1;
         }
         break;
@@ -281,9 +282,9 @@ bool MSP::msp_parse_received_data(msp_port_t *msp, uint8_t c)
 
     case MSP_HEADER_V2_NATIVE:
         msp->in_buf[msp->offset++] = c;
-        msp->checksum2 = crc8_dvb_s2(msp->checksum2, c);
         if (msp->offset == sizeof(msp_header_v2_t)) {
             msp_header_v2_t * hdrv2 = (msp_header_v2_t *)&msp->in_buf[0];
+            msp->checksum2 = crc8_dvb_s2_update(0, hdrv2, sizeof(msp_header_v2_t));
 
             // Check for potential buffer overflow
             if (hdrv2->size > MSP_PORT_INBUF_SIZE) {
@@ -299,10 +300,10 @@ bool MSP::msp_parse_received_data(msp_port_t *msp, uint8_t c)
         break;
 
     case MSP_PAYLOAD_V2_NATIVE:
-        msp->checksum2 = crc8_dvb_s2(msp->checksum2, c);
         msp->in_buf[msp->offset++] = c;
 
         if (msp->offset == msp->data_size) {
+            msp->checksum2 = crc8_dvb_s2_update(msp->checksum2, msp->in_buf, msp->data_size);
             msp->c_state = MSP_CHECKSUM_V2_NATIVE;
         }
         break;
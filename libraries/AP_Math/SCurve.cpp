@@ -52,6 +52,7 @@ void SCurve::init()
     time = 0.0f;
     num_segs = SEG_INIT;
     add_segment(num_segs, 0.0f, SegmentType::CONSTANT_JERK, 0.0f, 0.0f, 0.0f, 0.0f);
+    seg_hint = 0;
     track.zero();
     delta_unit.zero();
     position_sq = 0.0f;
@@ -643,15 +644,21 @@ void SCurve::get_jerk_accel_vel_pos_at_time(float time_now, float &Jt_out, float
     }
 
     SegmentType Jtype;
-    uint8_t pnt = num_segs;
     float Jm, tj, T0, A0, V0, P0;
 
-    // find active segment at time_now
-    for (uint8_t i = 0; i < num_segs; i++) {
-        if (time_now < segment[num_segs - 1 - i].end_time) {
-            pnt = num_segs - 1 - i;
+    // find active segment at time_now, the first segment ending after time_now
+    // time normally advances a little each call so start from the last segment used
+    uint8_t pnt = MIN(seg_hint, num_segs);
+    if (pnt == num_segs || time_now < segment[pnt].end_time) {
+        while (pnt > 0 && time_now < segment[pnt - 1].end_time) {
+            pnt--;
+        }
+    } else {
+        while (pnt < num_segs && !(time_now < segment[pnt].end_time)) {
+            pnt++;
         }
     }
+    seg_hint = pnt;
     if (pnt == 0) {
         Jtype = SegmentType::CONSTANT_JERK;
         Jm = 0.0f;
@@ -702,7 +709,7 @@ void SCurve::calc_javp_for_segment_const_jerk(float time_now, float J0, float A0
 }
 
 // Calculate the jerk, acceleration, velocity and position at time time_now when running the increasing jerk magnitude time segment based on a raised cosine profile
-void SCurve::calc_javp_for_segment_incr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const
+void SCurve::calc_javp_for_segment_incr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt)
 {
     if (!is_positive(tj)) {
         Jt = 0.0;
@@ -713,14 +720,19 @@ void SCurve::calc_javp_for_segment_incr_jerk(float time_now, float tj, float Jm,
     }
     const float Alpha = Jm * 0.5f;
     const float Beta = M_PI / tj;
-    Jt = Alpha * (1.0f - cosf(Beta * time_now));
-    At = A0 + Alpha * time_now - (Alpha / Beta) * sinf(Beta * time_now);
-    Vt = V0 + A0 * time_now + (Alpha * 0.5f) * (time_now * time_now) + (Alpha / (Beta * Beta)) * cosf(Beta * time_now) - Alpha / (Beta * Beta);
-    Pt = P0 + V0 * time_now + 0.5f * A0 * (time_now * time_now) + (-Alpha / (Beta * Beta)) * time_now + Alpha * (time_now * time_now * time_now) / 6.0f + (Alpha / (Beta * Beta * Beta)) * sinf(Beta * time_now);
+    const float AB = Alpha / Beta;
+    const float AB2 = AB / Beta;
+    const float AB3 = AB2 / Beta;
+    const float sin_bt = sinf(Beta * time_now);
+    const float cos_bt = cosf(Beta * time_now);
+    Jt = Alpha * (1.0f - cos_bt);
+    At = A0 + Alpha * time_now - AB * sin_bt;
+    Vt = V0 + A0 * time_now + (Alpha * 0.5f) * (time_now * time_now) + AB2 * cos_bt - AB2;
+    Pt = P0 + V0 * time_now + 0.5f * A0 * (time_now * time_now) - AB2 * time_now + Alpha * (time_now * time_now * time_now) / 6.0f + AB3 * sin_bt;
 }
 
 // Calculate the jerk, acceleration, velocity and position at time time_now when running the decreasing jerk magnitude time segment based on a raised cosine profile
-void SCurve::calc_javp_for_segment_decr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const
+void SCurve::calc_javp_for_segment_decr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt)
 {
     if (!is_positive(tj)) {
         Jt = 0.0;
@@ -731,13 +743,19 @@ void SCurve::calc_javp_for_segment_decr_jerk(float time_now, float tj, float Jm,
     }
     const float Alpha = Jm * 0.5f;
     const float Beta = M_PI / tj;
+    const float AB = Alpha / Beta;
+    const float AB2 = AB / Beta;
+    const float AB3 = AB2 / Beta;
     const float AT = Alpha * tj;
-    const float VT = Alpha * ((tj * tj) * 0.5f - 2.0f / (Beta * Beta));
-    const float PT = Alpha * ((-1.0f / (Beta * Beta)) * tj + (1.0f / 6.0f) * (tj * tj * tj));
-    Jt = Alpha * (1.0f - cosf(Beta * (time_now + tj)));
-    At = (A0 - AT) + Alpha * (time_now + tj) - (Alpha / Beta) * sinf(Beta * (time_now + tj));
-    Vt = (V0 - VT) + (A0 - AT) * time_now + 0.5f * Alpha * (time_now + tj) * (time_now + tj) + (Alpha / (Beta * Beta)) * cosf(Beta * (time_now + tj)) - Alpha / (Beta * Beta);
-    Pt = (P0 - PT) + (V0 - VT) * time_now + 0.5f * (A0 - AT) * (time_now * time_now) + (-Alpha / (Beta * Beta)) * (time_now + tj) + (Alpha / 6.0f) * (time_now + tj) * (time_now + tj) * (time_now + tj) + (Alpha / (Beta * Beta * Beta)) * sinf(Beta * (time_now + tj));
+    const float VT = Alpha * (tj * tj) * 0.5f - 2.0f * AB2;
+    const float PT = -AB2 * tj + (Alpha / 6.0f) * (tj * tj * tj);
+    const float t = time_now + tj;
+    const float sin_bt = sinf(Beta * t);
+    const float cos_bt = cosf(Beta * t);
+    Jt = Alpha * (1.0f - cos_bt);
+    At = (A0 - AT) + Alpha * t - AB * sin_bt;
+    Vt = (V0 - VT) + (A0 - AT) * time_now + 0.5f * Alpha * t * t + AB2 * cos_bt - AB2;
+    Pt = (P0 - PT) + (V0 - VT) * time_now + 0.5f * (A0 - AT) * (time_now * time_now) - AB2 * t + (Alpha / 6.0f) * t * t * t + AB3 * sin_bt;
 }
 
 // generate the segments for a path of length L
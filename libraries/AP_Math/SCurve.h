@@ -94,6 +94,14 @@ public:
     // time has reached the end of the sequence
     bool finished() const WARN_IF_UNUSED;
 
+    // Calculate the jerk, acceleration, velocity and position at time t when running the increasing jerk magnitude time segment based on a raised cosine profile
+    // this is an internal function, static for test suite
+    static void calc_javp_for_segment_incr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt);
+
+    // Calculate the jerk, acceleration, velocity and position at time t when running the decreasing jerk magnitude time segment based on a raised cosine profile
+    // this is an internal function, static for test suite
+    static void calc_javp_for_segment_decr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt);
+
 private:
 
     // increment time and return the position, velocity and acceleration vectors relative to the origin
@@ -147,12 +155,6 @@ private:
     // calculate the jerk, acceleration, velocity and position at time t when running the constant jerk time segment
     void calc_javp_for_segment_const_jerk(float time_now, float J0, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const;
 
-    // Calculate the jerk, acceleration, velocity and position at time t when running the increasing jerk magnitude time segment based on a raised cosine profile
-    void calc_javp_for_segment_incr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const;
-
-    // Calculate the jerk, acceleration, velocity and position at time t when running the decreasing jerk magnitude time segment based on a raised cosine profile
-    void calc_javp_for_segment_decr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const;
-
     // generate time segments for straight segment
     void add_segments(float L);
 
@@ -210,6 +212,7 @@ private:
     const static uint8_t segments_max = 23; // maximum number of time segments
 
     uint8_t num_segs;       // number of time segments being used
+    mutable uint8_t seg_hint;   // segment found by the last get_jerk_accel_vel_pos_at_time() call, where the next search starts
     struct {
         float jerk_ref;     // jerk reference value for time segment (the jerk at the beginning, middle or end depending upon the segment type)
         SegmentType seg_type;   // segment type (jerk is constant, increasing or decreasing)
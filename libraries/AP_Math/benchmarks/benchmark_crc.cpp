@@ -0,0 +1,85 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+static uint8_t data[1024];
+
+static void setup_data()
+{
+    for (uint16_t i=0; i<sizeof(data); i++) {
+        data[i] = uint8_t(i * 31 + 7);
+    }
+}
+
+// run fn over the first state.range(0) bytes, reporting bytes/sec
+template <typename F>
+static void run_crc(benchmark::State& state, F fn)
+{
+    setup_data();
+    const uint16_t len = state.range(0);
+    while (state.KeepRunning()) {
+        uint32_t crc = fn(len);
+        gbenchmark_escape(&crc);
+    }
+    state.SetBytesProcessed(int64_t(state.iterations()) * len);
+}
+
+static void BM_CRC32(benchmark::State& state)
+{
+    run_crc(state, [](uint16_t len) { return crc_crc32(0, data, len); });
+}
+
+static void BM_CRC32Small(benchmark::State& state)
+{
+    run_crc(state, [](uint16_t len) { return crc32_small(0, data, len); });
+}
+
+static void BM_CRC24(benchmark::State& state)
+{
+    run_crc(state, [](uint16_t len) { return crc_crc24(data, len); });
+}
+
+static void BM_CRC16CCITT(benchmark::State& state)
+{
+    run_crc(state, [](uint16_t len) { return uint32_t(crc16_ccitt(data, len, 0)); });
+}
+
+static void BM_CRCXModem(benchmark::State& state)
+{
+    run_crc(state, [](uint16_t len) { return uint32_t(crc_xmodem(data, len)); });
+}
+
+static void BM_CRC8(benchmark::State& state)
+{
+    run_crc(state, [](uint16_t len) { return uint32_t(crc_crc8(data, MIN(len, 255))); });
+}
+
+static void BM_CRC8DVBS2(benchmark::State& state)
+{
+    run_crc(state, [](uint16_t len) { return uint32_t(crc8_dvb_s2_update(0, data, len)); });
+}
+
+static void BM_Fletcher16(benchmark::State& state)
+{
+    run_crc(state, [](uint16_t len) { return uint32_t(crc_fletcher16(data, len)); });
+}
+
+static void BM_Modbus(benchmark::State& state)
+{
+    run_crc(state, [](uint16_t len) { return uint32_t(calc_crc_modbus(data, len)); });
+}
+
+// typical frame sizes: RC protocols, MAVLink and log blocks
+BENCHMARK(BM_CRC32)->Arg(32)->Arg(280)->Arg(1024);
+BENCHMARK(BM_CRC32Small)->Arg(32)->Arg(280)->Arg(1024);
+BENCHMARK(BM_CRC24)->Arg(32)->Arg(280)->Arg(1024);
+BENCHMARK(BM_CRC16CCITT)->Arg(32)->Arg(280)->Arg(1024);
+BENCHMARK(BM_CRCXModem)->Arg(32)->Arg(280)->Arg(1024);
+BENCHMARK(BM_CRC8)->Arg(32)->Arg(255);
+BENCHMARK(BM_CRC8DVBS2)->Arg(32)->Arg(280)->Arg(1024);
+BENCHMARK(BM_Fletcher16)->Arg(32)->Arg(280)->Arg(1024);
+BENCHMARK(BM_Modbus)->Arg(32)->Arg(280)->Arg(1024);
+
+BENCHMARK_MAIN();
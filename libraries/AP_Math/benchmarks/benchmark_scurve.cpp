@@ -0,0 +1,36 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/SCurve.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+// cost of one 400Hz target update while flying a leg with a fast
+// waypoint turn onto the next leg
+static void BM_SCurveAdvance(benchmark::State& state)
+{
+    const Vector3f origin{0, 0, 0};
+    const Vector3f destination{10000, 2000, -500};
+    const Vector3f next_destination{15000, 8000, 0};
+
+    SCurve prev_leg, this_leg, next_leg;
+    this_leg.calculate_track(origin, destination, 1000, 250, 150, 250, 100, 6200, 1000);
+    next_leg.calculate_track(destination, next_destination, 1000, 250, 150, 250, 100, 6200, 1000);
+    SCurve this_start = this_leg;
+    SCurve next_start = next_leg;
+
+    while (state.KeepRunning()) {
+        Vector3f pos = origin;
+        Vector3f vel, accel;
+        if (this_leg.advance_target_along_track(prev_leg, next_leg, 200, 250, true, 0.0025, pos, vel, accel)) {
+            // start the leg again rather than promoting the legs
+            this_leg = this_start;
+            next_leg = next_start;
+        }
+        gbenchmark_escape(&pos);
+    }
+}
+
+BENCHMARK(BM_SCurveAdvance);
+
+BENCHMARK_MAIN();
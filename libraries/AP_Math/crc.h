@@ -14,6 +14,11 @@
 */
 /*
   interfaces to ArduPilot collection of CRCs.
+
+  Functions that take the running crc as an argument (crc_crc32,
+  crc16_ccitt, crc_xmodem_update, crc8_dvb_s2_update and
+  crc8_dvb_update) can be fed a frame in pieces. Prefer passing whole
+  blocks to calling the per-byte variants in a loop.
  */
 #pragma once
 
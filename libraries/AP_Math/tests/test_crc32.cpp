@@ -0,0 +1,60 @@
+#include <AP_gtest.h>
+
+#include <AP_Math/AP_Math.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+// bitwise reference for the reflected 0xEDB88320 polynomial
+static uint32_t crc32_reference(uint32_t crc, const uint8_t *buf, uint32_t size)
+{
+    while (size--) {
+        crc ^= *buf++;
+        for (uint8_t i=0; i<8; i++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320U : 0);
+        }
+    }
+    return crc;
+}
+
+TEST(CRC32, check_value)
+{
+    const uint8_t check[] = "123456789";
+    EXPECT_EQ(0xCBF43926U, ~crc_crc32(~0U, check, 9));
+    EXPECT_EQ(0xCBF43926U, ~crc32_small(~0U, check, 9));
+}
+
+/*
+  the word at a time paths (slicing-by-8 or the ARMv8 instructions)
+  must match the bytewise crc for any length and alignment, and when
+  a buffer is fed in pieces
+ */
+TEST(CRC32, random_length_alignment)
+{
+    uint8_t buf[1024+8];
+    uint32_t state = 0x12345678;
+    auto next = [&state]() {
+        // xorshift32
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+    for (uint16_t i=0; i<sizeof(buf); i++) {
+        buf[i] = next();
+    }
+    for (uint16_t n=0; n<2000; n++) {
+        const uint8_t align = next() % 8;
+        const uint16_t len = next() % (sizeof(buf) - align + 1);
+        const uint32_t seed = next();
+        const uint8_t *p = &buf[align];
+        const uint32_t expected = crc32_reference(seed, p, len);
+        EXPECT_EQ(expected, crc_crc32(seed, p, len)) << "align " << unsigned(align) << " len " << len;
+
+        const uint16_t split = len > 0 ? next() % len : 0;
+        EXPECT_EQ(expected, crc_crc32(crc_crc32(seed, p, split), &p[split], len - split))
+            << "align " << unsigned(align) << " len " << len << " split " << split;
+    }
+}
+
+AP_GTEST_PANIC()
+AP_GTEST_MAIN()
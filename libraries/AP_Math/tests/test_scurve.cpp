@@ -18,5 +18,103 @@ TEST(LinesScurve, test_calculate_path)
 }
 
 
+/*
+  the raised cosine segment equations as they were before the Alpha/Beta
+  terms were shared. The shared terms round differently, so results
+  are compared within a tolerance
+ */
+static void ref_incr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt)
+{
+    const float Alpha = Jm * 0.5f;
+    const float Beta = M_PI / tj;
+    Jt = Alpha * (1.0f - cosf(Beta * time_now));
+    At = A0 + Alpha * time_now - (Alpha / Beta) * sinf(Beta * time_now);
+    Vt = V0 + A0 * time_now + (Alpha * 0.5f) * (time_now * time_now) + (Alpha / (Beta * Beta)) * cosf(Beta * time_now) - Alpha / (Beta * Beta);
+    Pt = P0 + V0 * time_now + 0.5f * A0 * (time_now * time_now) + (-Alpha / (Beta * Beta)) * time_now + Alpha * (time_now * time_now * time_now) / 6.0f + (Alpha / (Beta * Beta * Beta)) * sinf(Beta * time_now);
+}
+
+static void ref_decr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt)
+{
+    const float Alpha = Jm * 0.5f;
+    const float Beta = M_PI / tj;
+    const float AT = Alpha * tj;
+    const float VT = Alpha * ((tj * tj) * 0.5f - 2.0f / (Beta * Beta));
+    const float PT = Alpha * ((-1.0f / (Beta * Beta)) * tj + (1.0f / 6.0f) * (tj * tj * tj));
+    Jt = Alpha * (1.0f - cosf(Beta * (time_now + tj)));
+    At = (A0 - AT) + Alpha * (time_now + tj) - (Alpha / Beta) * sinf(Beta * (time_now + tj));
+    Vt = (V0 - VT) + (A0 - AT) * time_now + 0.5f * Alpha * (time_now + tj) * (time_now + tj) + (Alpha / (Beta * Beta)) * cosf(Beta * (time_now + tj)) - Alpha / (Beta * Beta);
+    Pt = (P0 - PT) + (V0 - VT) * time_now + 0.5f * (A0 - AT) * (time_now * time_now) + (-Alpha / (Beta * Beta)) * (time_now + tj) + (Alpha / 6.0f) * (time_now + tj) * (time_now + tj) * (time_now + tj) + (Alpha / (Beta * Beta * Beta)) * sinf(Beta * (time_now + tj));
+}
+
+// tolerance relative to the size of the terms summed, which can be
+// much larger than the result
+#define EXPECT_CLOSE(ref, val, scale) EXPECT_NEAR(ref, val, 1.0e-5f * MAX(1.0f, scale))
+
+TEST(LinesScurve, test_raised_cosine_segments)
+{
+    const float tjs[] { 0.05, 0.25, 1.0, 3.0 };
+    const float Jms[] { -20.0, -1.0, 0.5, 10.0 };
+    const float A0s[] { -5.0, 0.0, 2.0 };
+    const float V0s[] { -3.0, 0.0, 15.0 };
+    const float P0s[] { 0.0, 250.0 };
+    for (const float tj : tjs) {
+        for (const float Jm : Jms) {
+            for (const float A0 : A0s) {
+                for (const float V0 : V0s) {
+                    for (const float P0 : P0s) {
+                        const float J_scale = fabsf(Jm);
+                        const float A_scale = fabsf(A0) + J_scale * tj;
+                        const float V_scale = fabsf(V0) + A_scale * tj;
+                        const float P_scale = fabsf(P0) + V_scale * tj;
+                        for (uint8_t i=0; i<=20; i++) {
+                            const float t = tj * i / 20;
+                            float Jr, Ar, Vr, Pr, J, A, V, P;
+                            ref_incr_jerk(t, tj, Jm, A0, V0, P0, Jr, Ar, Vr, Pr);
+                            SCurve::calc_javp_for_segment_incr_jerk(t, tj, Jm, A0, V0, P0, J, A, V, P);
+                            EXPECT_CLOSE(Jr, J, J_scale);
+                            EXPECT_CLOSE(Ar, A, A_scale);
+                            EXPECT_CLOSE(Vr, V, V_scale);
+                            EXPECT_CLOSE(Pr, P, P_scale);
+                            ref_decr_jerk(t, tj, Jm, A0, V0, P0, Jr, Ar, Vr, Pr);
+                            SCurve::calc_javp_for_segment_decr_jerk(t, tj, Jm, A0, V0, P0, J, A, V, P);
+                            EXPECT_CLOSE(Jr, J, J_scale);
+                            EXPECT_CLOSE(Ar, A, A_scale);
+                            EXPECT_CLOSE(Vr, V, V_scale);
+                            EXPECT_CLOSE(Pr, P, P_scale);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(LinesScurve, test_track_reaches_destination)
+{
+    // stepping along a track searches segments from the last one used
+    SCurve prev_leg, leg, next_leg;
+    const Vector3f origin { 0, 0, 0 };
+    const Vector3f destination { 100, 50, 10 };
+    leg.calculate_track(origin, destination, 10, 2.5, 1.5, 2.5, 1, 20, 5);
+    Vector3f pos, vel, accel;
+    float last_dist = -1;
+    uint32_t steps = 0;
+    while (!leg.finished() && steps < 100000) {
+        pos = origin;
+        vel.zero();
+        accel.zero();
+        UNUSED_RESULT(leg.advance_target_along_track(prev_leg, next_leg, 2, 2.5, false, 0.0025, pos, vel, accel));
+        // the target never moves backwards along the track
+        const float dist = (pos - origin).length();
+        EXPECT_GE(dist, last_dist - 1.0e-4f);
+        last_dist = dist;
+        steps++;
+    }
+    EXPECT_TRUE(leg.finished());
+    EXPECT_NEAR(0, (pos - destination).length(), 0.01);
+    EXPECT_NEAR(0, vel.length(), 0.01);
+}
+
+
 AP_GTEST_MAIN()
 int hal = 0; //weirdly the build will fail without this
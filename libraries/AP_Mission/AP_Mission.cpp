@@ -78,6 +78,14 @@ void AP_Mission::init()
     }
 #endif
 
+#if AP_MISSION_CACHE_ENABLED
+    // storage may have moved to the sdcard
+    for (auto &c : _cmd_cache) {
+        c.index = 0;
+    }
+#endif
+    _change_count++;
+
     // work out maximum index for our storage size
     if (_storage.size() >= AP_MISSION_EEPROM_COMMAND_SIZE+4) {
         _commands_max = (_storage.size()-4U) / AP_MISSION_EEPROM_COMMAND_SIZE;
@@ -302,6 +310,10 @@ void AP_Mission::truncate(uint16_t index)
     if ((unsigned)_cmd_total > index) {
         _cmd_total.set_and_save(index);
         _last_change_time_ms = AP_HAL::millis();
+        _change_count++;
+#if AP_MISSION_CACHE_ENABLED
+        cache_update(AP_MISSION_CMD_INDEX_NONE, 0);
+#endif
     }
 }
 
@@ -536,14 +548,14 @@ bool AP_Mission::replace_cmd(uint16_t index, const Mission_Command& cmd)
     return write_cmd_to_storage(index, cmd);
 }
 
-/// is_nav_cmd - returns true if the command's id is a "navigation" command, false if "do" or "conditional" command
-bool AP_Mission::is_nav_cmd(const Mission_Command& cmd)
+/// is_nav_cmd_id - returns true if the command id is a "navigation" command, false if "do" or "conditional" command
+bool AP_Mission::is_nav_cmd_id(uint16_t id)
 {
     // NAV commands all have ids below MAV_CMD_NAV_LAST, plus some exceptions
-    return (cmd.id <= MAV_CMD_NAV_LAST ||
-            cmd.id == MAV_CMD_NAV_SET_YAW_SPEED ||
-            cmd.id == MAV_CMD_NAV_SCRIPT_TIME ||
-            cmd.id == MAV_CMD_NAV_ATTITUDE_TIME);
+    return (id <= MAV_CMD_NAV_LAST ||
+            id == MAV_CMD_NAV_SET_YAW_SPEED ||
+            id == MAV_CMD_NAV_SCRIPT_TIME ||
+            id == MAV_CMD_NAV_ATTITUDE_TIME);
 }
 
 /// get_next_nav_cmd - gets next "navigation" command found at or after start_index
@@ -553,6 +565,15 @@ bool AP_Mission::get_next_nav_cmd(uint16_t start_index, Mission_Command& cmd)
 {
     // search until the end of the mission command list
     for (uint16_t cmd_index = start_index; cmd_index < (unsigned)_cmd_total; cmd_index++) {
+#if AP_MISSION_CACHE_ENABLED
+        // get_next_cmd would hand back any other "do" command as it
+        // is, so skip straight to the next command that may resolve
+        // to a navigation command
+        cmd_index = next_nav_or_jump_index(cmd_index);
+        if (cmd_index >= (unsigned)_cmd_total) {
+            break;
+        }
+#endif
         // get next command
         if (!get_next_cmd(cmd_index, cmd, false)) {
             // no more commands so return failure
@@ -832,6 +853,14 @@ bool AP_Mission::read_cmd_from_storage(uint16_t index, Mission_Command& cmd) con
         return false;
     }
 
+#if AP_MISSION_CACHE_ENABLED
+    Mission_Command &cached = _cmd_cache[index % AP_MISSION_CMD_CACHE_SIZE];
+    if (cached.index == index) {
+        cmd = cached;
+        return true;
+    }
+#endif
+
     // ensure all bytes of cmd are zeroed
     cmd = {};
 
@@ -890,6 +919,10 @@ bool AP_Mission::read_cmd_from_storage(uint16_t index, Mission_Command& cmd) con
     // set command's index to it's position in eeprom
     cmd.index = index;
 
+#if AP_MISSION_CACHE_ENABLED
+    cached = cmd;
+#endif
+
     // return success
     return true;
 }
@@ -928,18 +961,9 @@ bool AP_Mission::stored_in_location(uint16_t id)
     }
 }
 
-/// write_cmd_to_storage - write a command to storage
-///     index is used to calculate the storage location
-///     true is returned if successful
-bool AP_Mission::write_cmd_to_storage(uint16_t index, const Mission_Command& cmd)
+/// cmd_to_record - pack a command into the record format used in storage
+void AP_Mission::cmd_to_record(const Mission_Command& cmd, uint8_t record[AP_MISSION_EEPROM_COMMAND_SIZE])
 {
-    WITH_SEMAPHORE(_rsem);
-
-    // range check cmd's index
-    if (index >= num_commands_max()) {
-        return false;
-    }
-
     PackedContent packed {};
     if (stored_in_location(cmd.id)) {
         // Location is not PACKED; field-wise copy it:
@@ -960,14 +984,11 @@ bool AP_Mission::write_cmd_to_storage(uint16_t index, const Mission_Command& cmd
         memcpy(packed.bytes, &cmd.content, 12);
     }
 
-    // calculate where in storage the command should be placed
-    uint16_t pos_in_storage = 4 + (index * AP_MISSION_EEPROM_COMMAND_SIZE);
-
     if (cmd.id < 256) {
         // for commands below 256 we store up to 12 bytes
-        _storage.write_byte(pos_in_storage, cmd.id);
-        _storage.write_uint16(pos_in_storage+1, cmd.p1);
-        _storage.write_block(pos_in_storage+3, packed.bytes, 12);
+        record[0] = cmd.id;
+        memcpy(&record[1], &cmd.p1, 2);
+        memcpy(&record[3], packed.bytes, 12);
     } else {
         // if the command ID is above 256 we store a tag byte followed
         // by the 16 bit command ID. The tag byte is 1 for commands
@@ -978,22 +999,175 @@ bool AP_Mission::write_cmd_to_storage(uint16_t index, const Mission_Command& cmd
         if (cmd.id == MAV_CMD_NAV_SCRIPT_TIME) {
             tag_byte = 1;
         }
-        _storage.write_byte(pos_in_storage, tag_byte);
-        _storage.write_uint16(pos_in_storage+1, cmd.id);
-        _storage.write_uint16(pos_in_storage+3, cmd.p1);
-        _storage.write_block(pos_in_storage+5, packed.bytes, 10);
+        record[0] = tag_byte;
+        memcpy(&record[1], &cmd.id, 2);
+        memcpy(&record[3], &cmd.p1, 2);
+        memcpy(&record[5], packed.bytes, 10);
+    }
+}
+
+/// write_cmd_to_storage - write a command to storage
+///     index is used to calculate the storage location
+///     true is returned if successful
+bool AP_Mission::write_cmd_to_storage(uint16_t index, const Mission_Command& cmd)
+{
+    WITH_SEMAPHORE(_rsem);
+
+    // range check cmd's index
+    if (index >= num_commands_max()) {
+        return false;
     }
 
+    uint8_t record[AP_MISSION_EEPROM_COMMAND_SIZE];
+    cmd_to_record(cmd, record);
+
+    // calculate where in storage the command should be placed
+    uint16_t pos_in_storage = 4 + (index * AP_MISSION_EEPROM_COMMAND_SIZE);
+
+    _storage.write_block(pos_in_storage, record, sizeof(record));
+
     // remember when the mission last changed
     if (index != 0) {
         // Update of home location is not a true change
         _last_change_time_ms = AP_HAL::millis();
+        _change_count++;
+#if AP_MISSION_CACHE_ENABLED
+        cache_update(index, cmd.id);
+#endif
     }
 
     // return success
     return true;
 }
 
+/*
+  marker record written in the unused home slot of a staged mission
+  replacement, so a reboot can tell a complete staging from a
+  partial one
+ */
+struct PACKED StagedReplaceMarker {
+    uint16_t count;
+    uint32_t crc;
+};
+static_assert(sizeof(StagedReplaceMarker) <= AP_MISSION_EEPROM_COMMAND_SIZE, "staged marker must fit in a record");
+
+/*
+  replace the whole mission with count records made by
+  cmd_to_record(). The first record is for home and is ignored; home
+  is always taken from the AHRS. The switch is made in one go under
+  the mission semaphore, so nothing sees a mix of old and new commands.
+
+  When storage keeps write order and there is room, the new records
+  are first written to the end of storage, past the old mission,
+  followed by a marker holding their count and CRC. The replacement
+  is committed by putting the staged index in the top half of the
+  version word, which can't reach storage before the records it
+  points at. If power is lost after that check_eeprom_version()
+  finishes the copy on the next boot, and before it the old mission
+  is untouched. Other backends could persist the version word first,
+  and staging doubles the writes, so they write in place
+ */
+bool AP_Mission::replace_all_cmds(const uint8_t *records, uint16_t count)
+{
+    WITH_SEMAPHORE(_rsem);
+
+    if (count == 0 || count > num_commands_max()) {
+        return false;
+    }
+
+    const uint16_t staged_index = _commands_max - count;
+    const bool staged = _storage.keeps_write_order() &&
+        staged_index >= count && staged_index >= unsigned(_cmd_total);
+    if (staged) {
+        const uint16_t len = (count-1) * AP_MISSION_EEPROM_COMMAND_SIZE;
+        uint8_t marker[AP_MISSION_EEPROM_COMMAND_SIZE] {};
+        const StagedReplaceMarker m {
+            count,
+            crc_crc32(0, &records[AP_MISSION_EEPROM_COMMAND_SIZE], len)
+        };
+        memcpy(marker, &m, sizeof(m));
+        if ((count > 1 &&
+             !_storage.write_block(4 + (staged_index+1) * AP_MISSION_EEPROM_COMMAND_SIZE,
+                                   &records[AP_MISSION_EEPROM_COMMAND_SIZE], len)) ||
+            !_storage.write_block(4 + staged_index * AP_MISSION_EEPROM_COMMAND_SIZE,
+                                  marker, sizeof(marker))) {
+            return false;
+        }
+        _storage.write_uint32(0, AP_MISSION_EEPROM_VERSION | (uint32_t(staged_index) << 16));
+    }
+    // otherwise the mission is written in place, which is no worse
+    // than an upload stored item by item
+
+    write_home_to_storage();
+    if (count > 1 &&
+        !_storage.write_block(4 + AP_MISSION_EEPROM_COMMAND_SIZE,
+                              &records[AP_MISSION_EEPROM_COMMAND_SIZE],
+                              (count-1) * AP_MISSION_EEPROM_COMMAND_SIZE)) {
+        return false;
+    }
+    // the total must be in storage before the commit is cleared
+    _cmd_total.set(count);
+    _cmd_total.save_sync(false, true);
+    if (staged) {
+        _storage.write_uint32(0, AP_MISSION_EEPROM_VERSION);
+    }
+
+    _last_change_time_ms = AP_HAL::millis();
+    _change_count++;
+#if AP_MISSION_CACHE_ENABLED
+    // the indexes are rebuilt as the change count has moved on
+    for (auto &c : _cmd_cache) {
+        c.index = 0;
+    }
+#endif
+
+    return true;
+}
+
+/*
+  finish a replace_all_cmds() interrupted by a reboot by copying the
+  records staged at staged_index into place. Nothing is copied unless
+  the marker and the CRC of the staged records match
+ */
+bool AP_Mission::complete_staged_replace(uint16_t staged_index)
+{
+    const uint32_t storage_records = (_storage.size() - 4U) / AP_MISSION_EEPROM_COMMAND_SIZE;
+    StagedReplaceMarker m;
+    if (staged_index == 0 || staged_index >= storage_records ||
+        !_storage.read_block(&m, 4 + staged_index * AP_MISSION_EEPROM_COMMAND_SIZE, sizeof(m))) {
+        return false;
+    }
+    const uint16_t count = m.count;
+    if (count == 0 || count > _commands_max || staged_index < count ||
+        uint32_t(staged_index) + count > storage_records) {
+        // not something replace_all_cmds() would have written
+        return false;
+    }
+
+    uint32_t crc = 0;
+    uint8_t record[AP_MISSION_EEPROM_COMMAND_SIZE];
+    for (uint16_t i=1; i<count; i++) {
+        if (!_storage.read_block(record, 4 + (staged_index+i) * AP_MISSION_EEPROM_COMMAND_SIZE, sizeof(record))) {
+            return false;
+        }
+        crc = crc_crc32(crc, record, sizeof(record));
+    }
+    if (crc != m.crc) {
+        return false;
+    }
+
+    for (uint16_t i=1; i<count; i++) {
+        if (!_storage.read_block(record, 4 + (staged_index+i) * AP_MISSION_EEPROM_COMMAND_SIZE, sizeof(record)) ||
+            !_storage.write_block(4 + i * AP_MISSION_EEPROM_COMMAND_SIZE, record, sizeof(record))) {
+            return false;
+        }
+    }
+    _cmd_total.set(count);
+    _cmd_total.save_sync(false, false);
+    _storage.write_uint32(0, AP_MISSION_EEPROM_VERSION);
+    return true;
+}
+
 /// write_home_to_storage - writes the special purpose cmd 0 (home) to storage
 ///     home is taken directly from ahrs
 void AP_Mission::write_home_to_storage()
@@ -2299,6 +2473,32 @@ bool AP_Mission::jump_to_tag(const uint16_t tag)
 // Returns 0 if no appropriate JUMP_TAG match can be found.
 uint16_t AP_Mission::get_index_of_jump_tag(const uint16_t tag) const
 {
+#if AP_MISSION_CACHE_ENABLED
+    {
+        WITH_SEMAPHORE(_rsem);
+        if (index_available()) {
+            // binary search for the first entry with this tag
+            uint16_t lo = 0;
+            uint16_t hi = _index.num_tags;
+            while (lo < hi) {
+                const uint16_t mid = (lo + hi) / 2;
+                if (_index.tags[mid].tag < tag) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            // entries for a tag are in mission order so only the
+            // first can be the one we want
+            if (lo < _index.num_tags && _index.tags[lo].tag == tag &&
+                _index.tags[lo].index < num_commands()) {
+                return _index.tags[lo].index;
+            }
+            return 0;
+        }
+    }
+#endif
+
     const auto count = num_commands();
     for (uint16_t i = 1; i < count; i++) {
         if (get_command_id(i) != uint16_t(MAV_CMD_JUMP_TAG)) {
@@ -2402,6 +2602,16 @@ void AP_Mission::check_eeprom_version()
 {
     uint32_t eeprom_version = _storage.read_uint32(0);
 
+    // the top half holds the index of an unfinished mission replacement
+    if ((eeprom_version & 0xFFFF) == AP_MISSION_EEPROM_VERSION &&
+        (eeprom_version >> 16) != 0) {
+        if (!complete_staged_replace(eeprom_version >> 16)) {
+            // a bad marker leaves the stored mission as it was
+            _storage.write_uint32(0, AP_MISSION_EEPROM_VERSION);
+        }
+        return;
+    }
+
     // if eeprom version does not match, clear the command list and update the eeprom version
     if (eeprom_version != AP_MISSION_EEPROM_VERSION) {
         if (clear()) {
@@ -2420,10 +2630,7 @@ uint16_t AP_Mission::get_landing_sequence_start(const Location &current_loc)
 
     // Go through mission looking for nearest landing start command
     const auto count = num_commands();
-    for (uint16_t i = 1; i < count; i++) {
-        if (get_command_id(i) != uint16_t(MAV_CMD_DO_LAND_START)) {
-            continue;
-        }
+    for (uint16_t i = next_land_start_index(1); i < count; i = next_land_start_index(i+1)) {
         Mission_Command tmp;
         if (!read_cmd_from_storage(i, tmp)) {
             continue;
@@ -2930,6 +3137,20 @@ const char *AP_Mission::Mission_Command::type() const
   get the command ID of a mission index. Caller should have checked the index is in range
  */
 uint16_t AP_Mission::get_command_id(uint16_t index) const
+{
+#if AP_MISSION_CACHE_ENABLED
+    WITH_SEMAPHORE(_rsem);
+    if (index_available() && index < _index.size) {
+        return _index.ids[index];
+    }
+#endif
+    return read_command_id(index);
+}
+
+/*
+  read the command ID of a mission index from storage
+ */
+uint16_t AP_Mission::read_command_id(uint16_t index) const
 {
     const uint16_t pos_in_storage = 4 + (index * AP_MISSION_EEPROM_COMMAND_SIZE);
     uint8_t b[3] {};
@@ -2945,6 +3166,32 @@ uint16_t AP_Mission::get_command_id(uint16_t index) const
     return id;
 }
 
+/*
+  find the first DO_LAND_START at or after start_index. Returns
+  num_commands() if there are no more
+ */
+uint16_t AP_Mission::next_land_start_index(uint16_t start_index) const
+{
+    const uint16_t count = num_commands();
+#if AP_MISSION_CACHE_ENABLED
+    WITH_SEMAPHORE(_rsem);
+    if (index_available()) {
+        for (uint16_t i = 0; i < _index.num_land_starts; i++) {
+            if (_index.land_starts[i] >= start_index) {
+                return MIN(_index.land_starts[i], count);
+            }
+        }
+        return count;
+    }
+#endif
+    for (uint16_t i = start_index; i < count; i++) {
+        if (get_command_id(i) == uint16_t(MAV_CMD_DO_LAND_START)) {
+            return i;
+        }
+    }
+    return count;
+}
+
 /*
   see if the mission contains a particular item
  */
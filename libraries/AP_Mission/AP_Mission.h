@@ -55,6 +55,10 @@
 #define AP_MISSION_SDCARD_FILENAME "mission.stg"
 #endif
 
+#ifndef AP_MISSION_CMD_CACHE_SIZE
+#define AP_MISSION_CMD_CACHE_SIZE           32      // number of decoded commands kept in RAM
+#endif
+
 union PackedContent;
 
 /// @class    AP_Mission
@@ -555,7 +559,8 @@ public:
     bool replace_cmd(uint16_t index, const Mission_Command& cmd);
 
     /// is_nav_cmd - returns true if the command's id is a "navigation" command, false if "do" or "conditional" command
-    static bool is_nav_cmd(const Mission_Command& cmd);
+    static bool is_nav_cmd(const Mission_Command& cmd) { return is_nav_cmd_id(cmd.id); }
+    static bool is_nav_cmd_id(uint16_t id);
 
     /// get_current_nav_cmd - returns the current "navigation" command
     const Mission_Command& get_current_nav_cmd() const
@@ -638,6 +643,14 @@ public:
     ///     home is taken directly from ahrs
     void write_home_to_storage();
 
+    /// cmd_to_record - pack a command into the record format used in storage
+    static void cmd_to_record(const Mission_Command& cmd, uint8_t record[AP_MISSION_EEPROM_COMMAND_SIZE]);
+
+    /// replace_all_cmds - replace the whole mission with count records from cmd_to_record
+    ///     the first record is for home and is ignored
+    ///     true is returned if successful
+    bool replace_all_cmds(const uint8_t *records, uint16_t count);
+
     static MAV_MISSION_RESULT convert_MISSION_ITEM_to_MISSION_ITEM_INT(const mavlink_mission_item_t &mission_item,
             mavlink_mission_item_int_t &mission_item_int) WARN_IF_UNUSED;
     static MAV_MISSION_RESULT convert_MISSION_ITEM_INT_to_MISSION_ITEM(const mavlink_mission_item_int_t &mission_item_int,
@@ -657,6 +670,14 @@ public:
         return _last_change_time_ms;
     }
 
+    // return a count which increments every time a stored command
+    // changes or the mission is truncated. Unlike the change time
+    // this can't miss two changes made in the same millisecond
+    uint32_t change_count(void) const
+    {
+        return _change_count;
+    }
+
     // find the nearest landing sequence starting point (DO_LAND_START) and
     // return its index.  Returns 0 if no appropriate DO_LAND_START point can
     // be found.
@@ -862,6 +883,10 @@ private:
     /// command list will be cleared if they do not match
     void check_eeprom_version();
 
+    /// complete_staged_replace - finish copying the records staged by replace_all_cmds at staged_index into place
+    ///     false is returned if the staged marker or CRC does not match
+    bool complete_staged_replace(uint16_t staged_index);
+
     // check if command is a landing type command.  Asside the obvious, MAV_CMD_DO_PARACHUTE is considered a type of landing
     bool is_landing_type_cmd(uint16_t id) const;
 
@@ -919,6 +944,7 @@ private:
     // last time that mission changed
     uint32_t _last_change_time_ms;
     uint32_t _last_change_time_prev_ms;
+    uint32_t _change_count;
 
     // maximum number of commands that will fit in storage
     uint16_t _commands_max;
@@ -929,6 +955,52 @@ private:
 
     // fast call to get command ID of a mission index
     uint16_t get_command_id(uint16_t index) const;
+    uint16_t read_command_id(uint16_t index) const;
+
+    // first DO_LAND_START at or after start_index, or num_commands() if none
+    uint16_t next_land_start_index(uint16_t start_index) const;
+
+#if AP_MISSION_CACHE_ENABLED
+    /*
+      recently decoded commands, direct mapped on index. Home (index 0)
+      is never cached, so a zeroed entry is empty
+     */
+    mutable Mission_Command _cmd_cache[AP_MISSION_CMD_CACHE_SIZE];
+
+    /*
+      indexes over the whole mission, built on first use after the
+      mission changes. All access is under _rsem
+     */
+    struct JumpTag {
+        uint16_t tag;
+        uint16_t index;
+    };
+    mutable struct {
+        bool valid;
+        uint32_t change_count;      // _change_count when built
+        uint16_t size;              // number of items covered, may be beyond _cmd_total
+        uint16_t *ids;              // command id of each item
+        uint16_t *next_nav;         // first nav, DO_JUMP or DO_JUMP_TAG at or after each item
+        JumpTag *tags;              // JUMP_TAGs sorted by tag, then by index
+        uint16_t num_tags;
+        uint16_t tags_size;
+        uint16_t *land_starts;      // DO_LAND_STARTs in mission order
+        uint16_t num_land_starts;
+        uint16_t land_starts_size;
+    } _index;
+
+    // true if the indexes are up to date, building them if needed
+    bool index_available() const;
+    bool build_index() const;
+
+    // first nav, DO_JUMP or DO_JUMP_TAG at or after index
+    uint16_t next_nav_or_jump_index(uint16_t index) const;
+
+    // keep the cache in step with a change to the stored
+    // mission. index is the command written, or
+    // AP_MISSION_CMD_INDEX_NONE if the mission was truncated
+    void cache_update(uint16_t index, uint16_t id);
+#endif
 
     // memoisation of contains-relative:
     bool _contains_terrain_alt_items;  // true if the mission has terrain-relative items
@@ -0,0 +1,218 @@
+/*
+  decoded command cache and whole mission indexes for AP_Mission
+
+  Reading a command means reading and unpacking a 15 byte record
+  through StorageAccess, which on sdcard backed storage is a file
+  read. Walking DO_JUMP chains, resolving jump tags and looking for
+  landing sequences all read the same commands over and over, so we
+  keep recently decoded commands in RAM, plus a few indexes over the
+  whole mission built on first use after the mission changes.
+
+  The indexes cover the stored commands rather than the mission, so a
+  truncate doesn't invalidate them and appending commands only means
+  a rebuild when we run past the end of what was indexed. Writes that
+  don't touch a JUMP_TAG or DO_LAND_START are applied in place.
+ */
+
+#include "AP_Mission_config.h"
+
+#if AP_MISSION_ENABLED && AP_MISSION_CACHE_ENABLED
+
+#include "AP_Mission.h"
+
+#include <stdlib.h>
+
+// extra items indexed beyond the end of the mission, so a mission
+// being uploaded item by item isn't re-indexed on every item
+#define AP_MISSION_INDEX_MARGIN 64
+
+// true if get_next_cmd() could resolve a command with this id to a
+// navigation command
+static bool may_resolve_to_nav(uint16_t id)
+{
+    return AP_Mission::is_nav_cmd_id(id) ||
+        id == MAV_CMD_DO_JUMP ||
+        id == MAV_CMD_DO_JUMP_TAG;
+}
+
+/*
+  return true if the indexes are up to date, building them if the
+  mission has changed. Caller must hold _rsem
+ */
+bool AP_Mission::index_available() const
+{
+    if (_index.change_count == _change_count) {
+        if (!_index.valid) {
+            // failed to build, don't try again until the mission changes
+            return false;
+        }
+        if (num_commands() <= _index.size) {
+            return true;
+        }
+    }
+    _index.valid = build_index();
+    _index.change_count = _change_count;
+    return _index.valid;
+}
+
+/*
+  read the ids of all stored commands and build the indexes
+ */
+bool AP_Mission::build_index() const
+{
+    const uint16_t size = MIN(uint32_t(num_commands()) * 5 / 4 + AP_MISSION_INDEX_MARGIN, uint32_t(_commands_max));
+    if (size == 0 || size < num_commands()) {
+        return false;
+    }
+
+    if (size > _index.size || _index.ids == nullptr) {
+        delete[] _index.ids;
+        delete[] _index.next_nav;
+        _index.size = 0;
+        _index.ids = NEW_NOTHROW uint16_t[size];
+        _index.next_nav = NEW_NOTHROW uint16_t[size];
+        if (_index.ids == nullptr || _index.next_nav == nullptr) {
+            delete[] _index.ids;
+            delete[] _index.next_nav;
+            _index.ids = nullptr;
+            _index.next_nav = nullptr;
+            return false;
+        }
+    }
+    _index.size = size;
+
+    // item 0 is always home
+    _index.ids[0] = MAV_CMD_NAV_WAYPOINT;
+    uint16_t num_tags = 0;
+    uint16_t num_land_starts = 0;
+    for (uint16_t i = 1; i < size; i++) {
+        const uint16_t id = read_command_id(i);
+        _index.ids[i] = id;
+        if (id == MAV_CMD_JUMP_TAG) {
+            num_tags++;
+        } else if (id == MAV_CMD_DO_LAND_START) {
+            num_land_starts++;
+        }
+    }
+
+    uint16_t next = size;
+    for (int32_t i = size-1; i >= 0; i--) {
+        if (may_resolve_to_nav(_index.ids[i])) {
+            next = i;
+        }
+        _index.next_nav[i] = next;
+    }
+
+    if (num_tags > _index.tags_size) {
+        delete[] _index.tags;
+        _index.tags_size = 0;
+        _index.tags = NEW_NOTHROW JumpTag[num_tags];
+        if (_index.tags == nullptr) {
+            return false;
+        }
+        _index.tags_size = num_tags;
+    }
+    if (num_land_starts > _index.land_starts_size) {
+        delete[] _index.land_starts;
+        _index.land_starts_size = 0;
+        _index.land_starts = NEW_NOTHROW uint16_t[num_land_starts];
+        if (_index.land_starts == nullptr) {
+            return false;
+        }
+        _index.land_starts_size = num_land_starts;
+    }
+
+    _index.num_tags = 0;
+    _index.num_land_starts = 0;
+    for (uint16_t i = 1; i < size; i++) {
+        if (_index.ids[i] == MAV_CMD_DO_LAND_START) {
+            _index.land_starts[_index.num_land_starts++] = i;
+        }
+        if (_index.ids[i] != MAV_CMD_JUMP_TAG) {
+            continue;
+        }
+        // items beyond the end of the mission can't be read as
+        // commands, so go straight to storage for the tag
+        const uint16_t pos_in_storage = 4 + (i * AP_MISSION_EEPROM_COMMAND_SIZE);
+        const uint8_t b1 = _storage.read_byte(pos_in_storage);
+        JumpTag &t = _index.tags[_index.num_tags++];
+        t.index = i;
+        // the tag is the first field of the packed content, which
+        // follows the id and p1
+        t.tag = _storage.read_uint16(pos_in_storage + ((b1 == 0 || b1 == 1) ? 5 : 3));
+    }
+    qsort(_index.tags, _index.num_tags, sizeof(JumpTag), [](const void *a, const void *b) {
+        const JumpTag *t1 = (const JumpTag *)a;
+        const JumpTag *t2 = (const JumpTag *)b;
+        if (t1->tag != t2->tag) {
+            return t1->tag < t2->tag ? -1 : 1;
+        }
+        return int(t1->index) - int(t2->index);
+    });
+
+    return true;
+}
+
+/*
+  return the first nav, DO_JUMP or DO_JUMP_TAG at or after index, or
+  an index at or beyond the end of the mission if there are none. If
+  the index isn't available then index is returned so the caller
+  checks each command
+ */
+uint16_t AP_Mission::next_nav_or_jump_index(uint16_t index) const
+{
+    WITH_SEMAPHORE(_rsem);
+    if (!index_available() || index >= _index.size) {
+        return index;
+    }
+    return _index.next_nav[index];
+}
+
+void AP_Mission::cache_update(uint16_t index, uint16_t id)
+{
+    WITH_SEMAPHORE(_rsem);
+
+    if (index != AP_MISSION_CMD_INDEX_NONE) {
+        Mission_Command &cached = _cmd_cache[index % AP_MISSION_CMD_CACHE_SIZE];
+        if (cached.index == index) {
+            cached.index = 0;
+        }
+    }
+
+    // only an index which was up to date before this change can be
+    // patched, anything else is rebuilt on next use
+    if (!_index.valid || _index.change_count + 1 != _change_count) {
+        return;
+    }
+    if (index == AP_MISSION_CMD_INDEX_NONE) {
+        // truncating doesn't change any stored command
+        _index.change_count = _change_count;
+        return;
+    }
+    if (index >= _index.size) {
+        return;
+    }
+    const uint16_t old_id = _index.ids[index];
+    if (old_id == MAV_CMD_JUMP_TAG || id == MAV_CMD_JUMP_TAG ||
+        old_id == MAV_CMD_DO_LAND_START || id == MAV_CMD_DO_LAND_START) {
+        return;
+    }
+    _index.ids[index] = id;
+
+    // fix up next_nav back to where it no longer changes
+    for (int32_t i = index; i >= 0; i--) {
+        uint16_t next = _index.size;
+        if (may_resolve_to_nav(_index.ids[i])) {
+            next = i;
+        } else if (i+1 < _index.size) {
+            next = _index.next_nav[i+1];
+        }
+        if (i < index && next == _index.next_nav[i]) {
+            break;
+        }
+        _index.next_nav[i] = next;
+    }
+    _index.change_count = _change_count;
+}
+
+#endif  // AP_MISSION_ENABLED && AP_MISSION_CACHE_ENABLED
@@ -13,16 +13,17 @@ bool AP_Mission_ChangeDetector::check_for_mission_change()
         return false;
     }
 
-    // check if mission has been updated
-    const uint32_t change_time_ms = mission->last_change_time_ms();
-    const bool update_time_changed = (change_time_ms != mis_change_detect.last_change_time_ms);
+    // check if mission has been updated. The change count catches
+    // changes made in the same millisecond as the last check
+    const uint32_t change_count = mission->change_count();
+    const bool mission_updated = (change_count != mis_change_detect.change_count);
 
     // check if active command index has changed
     const uint16_t curr_cmd_idx = mission->get_current_nav_index();
     const bool curr_cmd_idx_changed = (curr_cmd_idx != mis_change_detect.curr_cmd_index);
 
     // no changes if neither mission update time nor active command index has changed
-    if (!update_time_changed && !curr_cmd_idx_changed) {
+    if (!mission_updated && !curr_cmd_idx_changed) {
         return false;
     }
 
@@ -50,8 +51,8 @@ bool AP_Mission_ChangeDetector::check_for_mission_change()
         cmds_changed = true;
     }
 
-    // update mis_change_detect with last change time, command index and number of commands
-    mis_change_detect.last_change_time_ms = change_time_ms;
+    // update mis_change_detect with change count, command index and number of commands
+    mis_change_detect.change_count = change_count;
     mis_change_detect.curr_cmd_index = curr_cmd_idx;
     mis_change_detect.cmd_count = num_cmds;
 
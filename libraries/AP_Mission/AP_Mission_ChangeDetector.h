@@ -31,7 +31,7 @@ private:
     // number of upcoming commands to monitor for changes
     static const uint8_t mis_change_detect_cmd_max = 3;
     struct {
-        uint32_t last_change_time_ms;       // local copy of last time mission was changed
+        uint32_t change_count;              // local copy of AP_Mission's change count
         uint16_t curr_cmd_index;            // local copy of AP_Mission's current command index
         uint8_t cmd_count;                  // number of commands in the cmd array
         AP_Mission::Mission_Command cmd[mis_change_detect_cmd_max]; // local copy of the next few mission commands
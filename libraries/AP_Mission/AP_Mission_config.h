@@ -7,3 +7,7 @@
 #ifndef AP_MISSION_NAV_PAYLOAD_PLACE_ENABLED
 #define AP_MISSION_NAV_PAYLOAD_PLACE_ENABLED 1
 #endif
+
+#ifndef AP_MISSION_CACHE_ENABLED
+#define AP_MISSION_CACHE_ENABLED (HAL_MEM_CLASS >= HAL_MEM_CLASS_500)
+#endif
@@ -18,6 +18,7 @@
 #include "AP_MotorsHeli.h"
 #include <GCS_MAVLink/GCS.h>
 #include <AP_Logger/AP_Logger.h>
+#include <AP_Scheduler/AP_Scheduler.h>
 #include <AC_Autorotation/RSC_Autorotation.h>
 
 extern const AP_HAL::HAL& hal;
@@ -226,6 +227,9 @@ void AP_MotorsHeli::output()
 
     output_to_motors();
 
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    AP::scheduler().loop_trace.mark(AP::LoopTrace::Point::MIXER);
+#endif
 };
 
 // sends commands to the motors
@@ -117,13 +117,25 @@ void AP_MotorsMatrix::set_update_rate(uint16_t speed_hz)
     // record requested speed
     _speed_hz = speed_hz;
 
+    // every path that finishes setting up the motors ends up here
+    update_enabled_motors();
+
     uint32_t mask = 0;
+    for (uint8_t n = 0; n < _num_enabled_motors; n++) {
+        mask |= 1U << _enabled_motors[n];
+    }
+    rc_set_freq(mask, _speed_hz);
+}
+
+// rebuild the list of enabled motors used by the mixer
+void AP_MotorsMatrix::update_enabled_motors()
+{
+    _num_enabled_motors = 0;
     for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
         if (motor_enabled[i]) {
-            mask |= 1U << i;
+            _enabled_motors[_num_enabled_motors++] = i;
         }
     }
-    rc_set_freq(mask, _speed_hz);
 }
 
 // set frame class (i.e. quad, hexa, heli) and type (i.e. x, plus)
@@ -164,21 +176,25 @@ void AP_MotorsMatrix::output_to_motors()
             break;
         case SpoolState::SPOOLING_UP:
         case SpoolState::THROTTLE_UNLIMITED:
-        case SpoolState::SPOOLING_DOWN:
+        case SpoolState::SPOOLING_DOWN: {
             // set motor output based on thrust requests
-            for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-                if (motor_enabled[i]) {
-                    set_actuator_with_slew(_actuator[i], thr_lin.thrust_to_actuator(_thrust_rpyt_out[i]));
-                }
+            float thrust[AP_MOTORS_MAX_NUM_MOTORS];
+            float actuator[AP_MOTORS_MAX_NUM_MOTORS];
+            for (uint8_t n = 0; n < _num_enabled_motors; n++) {
+                thrust[n] = _thrust_rpyt_out[_enabled_motors[n]];
+            }
+            thr_lin.thrust_to_actuator(thrust, actuator, _num_enabled_motors);
+            for (uint8_t n = 0; n < _num_enabled_motors; n++) {
+                set_actuator_with_slew(_actuator[_enabled_motors[n]], actuator[n]);
             }
             break;
+        }
     }
 
     // convert output to PWM and send to each motor
-    for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            rc_write(i, output_to_pwm(_actuator[i]));
-        }
+    for (uint8_t n = 0; n < _num_enabled_motors; n++) {
+        i = _enabled_motors[n];
+        rc_write(i, output_to_pwm(_actuator[i]));
     }
 }
 
@@ -274,26 +290,25 @@ void AP_MotorsMatrix::output_armed_stabilizing()
     // calculate amount of yaw we can fit into the throttle range
     // this is always equal to or less than the requested yaw from the pilot or rate controller
     float yaw_allowed = 1.0f; // amount of yaw we can fit in
-    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            // calculate the thrust outputs for roll and pitch
-            _thrust_rpyt_out[i] = roll_thrust * _roll_factor[i] + pitch_thrust * _pitch_factor[i];
-
-            // Check the maximum yaw control that can be used on this channel
-            // Exclude any lost motors if thrust boost is enabled
-            if (!is_zero(_yaw_factor[i]) && (!_thrust_boost || i != _motor_lost_index)) {
-                const float thrust_rp_best_throttle = throttle_thrust_best_rpy + _thrust_rpyt_out[i];
-                float motor_room;
-                if (is_positive(yaw_thrust * _yaw_factor[i])) {
-                    // room to upper limit
-                    motor_room = 1.0 - thrust_rp_best_throttle;
-                } else {
-                    // room to lower limit
-                    motor_room = thrust_rp_best_throttle;
-                }
-                const float motor_yaw_allowed = MAX(motor_room, 0.0)/fabsf(_yaw_factor[i]);
-                yaw_allowed = MIN(yaw_allowed, motor_yaw_allowed);
+    for (uint8_t n = 0; n < _num_enabled_motors; n++) {
+        const uint8_t i = _enabled_motors[n];
+        // calculate the thrust outputs for roll and pitch
+        _thrust_rpyt_out[i] = roll_thrust * _roll_factor[i] + pitch_thrust * _pitch_factor[i];
+
+        // Check the maximum yaw control that can be used on this channel
+        // Exclude any lost motors if thrust boost is enabled
+        if (!is_zero(_yaw_factor[i]) && (!_thrust_boost || i != _motor_lost_index)) {
+            const float thrust_rp_best_throttle = throttle_thrust_best_rpy + _thrust_rpyt_out[i];
+            float motor_room;
+            if (is_positive(yaw_thrust * _yaw_factor[i])) {
+                // room to upper limit
+                motor_room = 1.0 - thrust_rp_best_throttle;
+            } else {
+                // room to lower limit
+                motor_room = thrust_rp_best_throttle;
             }
+            const float motor_yaw_allowed = MAX(motor_room, 0.0)/fabsf(_yaw_factor[i]);
+            yaw_allowed = MIN(yaw_allowed, motor_yaw_allowed);
         }
     }
 
@@ -333,19 +348,18 @@ void AP_MotorsMatrix::output_armed_stabilizing()
     // add yaw control to thrust outputs
     float rpy_low = 1.0f;   // lowest thrust value
     float rpy_high = -1.0f; // highest thrust value
-    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            _thrust_rpyt_out[i] = _thrust_rpyt_out[i] + yaw_thrust * _yaw_factor[i];
+    for (uint8_t n = 0; n < _num_enabled_motors; n++) {
+        const uint8_t i = _enabled_motors[n];
+        _thrust_rpyt_out[i] = _thrust_rpyt_out[i] + yaw_thrust * _yaw_factor[i];
 
-            // record lowest roll + pitch + yaw command
-            if (_thrust_rpyt_out[i] < rpy_low) {
-                rpy_low = _thrust_rpyt_out[i];
-            }
-            // record highest roll + pitch + yaw command
-            // Exclude any lost motors if thrust boost is enabled
-            if (_thrust_rpyt_out[i] > rpy_high && (!_thrust_boost || i != _motor_lost_index)) {
-                rpy_high = _thrust_rpyt_out[i];
-            }
+        // record lowest roll + pitch + yaw command
+        if (_thrust_rpyt_out[i] < rpy_low) {
+            rpy_low = _thrust_rpyt_out[i];
+        }
+        // record highest roll + pitch + yaw command
+        // Exclude any lost motors if thrust boost is enabled
+        if (_thrust_rpyt_out[i] > rpy_high && (!_thrust_boost || i != _motor_lost_index)) {
+            rpy_high = _thrust_rpyt_out[i];
         }
     }
     // Include the lost motor scaled by _thrust_boost_ratio to smoothly transition this motor in and out of the calculation
@@ -391,10 +405,9 @@ void AP_MotorsMatrix::output_armed_stabilizing()
 
     // add scaled roll, pitch, constrained yaw and throttle for each motor
     const float throttle_thrust_best_plus_adj = throttle_thrust_best_rpy + thr_adj;
-    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            _thrust_rpyt_out[i] = (throttle_thrust_best_plus_adj * _throttle_factor[i]) + (rpy_scale * _thrust_rpyt_out[i]);
-        }
+    for (uint8_t n = 0; n < _num_enabled_motors; n++) {
+        const uint8_t i = _enabled_motors[n];
+        _thrust_rpyt_out[i] = (throttle_thrust_best_plus_adj * _throttle_factor[i]) + (rpy_scale * _thrust_rpyt_out[i]);
     }
 
     // determine throttle thrust for harmonic notch
@@ -417,26 +430,19 @@ void AP_MotorsMatrix::check_for_failed_motor(float throttle_thrust_best_plus_adj
 {
     // record filtered and scaled thrust output for motor loss monitoring purposes
     float alpha = _dt_s / (_dt_s + 0.5f);
-    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            _thrust_rpyt_out_filt[i] += alpha * (_thrust_rpyt_out[i] - _thrust_rpyt_out_filt[i]);
-        }
-    }
-
     float rpyt_high = 0.0f;
     float rpyt_sum = 0.0f;
-    uint8_t number_motors = 0.0f;
-    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            number_motors += 1;
-            rpyt_sum += _thrust_rpyt_out_filt[i];
-            // record highest filtered thrust command
-            if (_thrust_rpyt_out_filt[i] > rpyt_high) {
-                rpyt_high = _thrust_rpyt_out_filt[i];
-                // hold motor lost index constant while thrust boost is active
-                if (!_thrust_boost) {
-                    _motor_lost_index = i;
-                }
+    const uint8_t number_motors = _num_enabled_motors;
+    for (uint8_t n = 0; n < _num_enabled_motors; n++) {
+        const uint8_t i = _enabled_motors[n];
+        _thrust_rpyt_out_filt[i] += alpha * (_thrust_rpyt_out[i] - _thrust_rpyt_out_filt[i]);
+        rpyt_sum += _thrust_rpyt_out_filt[i];
+        // record highest filtered thrust command
+        if (_thrust_rpyt_out_filt[i] > rpyt_high) {
+            rpyt_high = _thrust_rpyt_out_filt[i];
+            // hold motor lost index constant while thrust boost is active
+            if (!_thrust_boost) {
+                _motor_lost_index = i;
             }
         }
     }
@@ -127,6 +127,9 @@ protected:
     // normalizes the roll, pitch and yaw factors so maximum magnitude is 0.5
     void                normalise_rpy_factors();
 
+    // rebuild the list of enabled motors used by the mixer
+    void                update_enabled_motors();
+
     // call vehicle supplied thrust compensation if set
     void                thrust_compensation(void) override;
 
@@ -145,6 +148,10 @@ protected:
     float               _thrust_rpyt_out[AP_MOTORS_MAX_NUM_MOTORS]; // combined roll, pitch, yaw and throttle outputs to motors in 0~1 range
     uint8_t             _test_order[AP_MOTORS_MAX_NUM_MOTORS];  // order of the motors in the test sequence
 
+    // enabled motor numbers in ascending order, so the mixer doesn't have to check every possible motor
+    uint8_t             _enabled_motors[AP_MOTORS_MAX_NUM_MOTORS];
+    uint8_t             _num_enabled_motors = 0;
+
     // motor failure handling
     float               _thrust_rpyt_out_filt[AP_MOTORS_MAX_NUM_MOTORS];    // filtered thrust outputs with 1 second time constant
     uint8_t             _motor_lost_index;  // index number of the lost motor
@@ -18,6 +18,7 @@
 #include <AP_BattMonitor/AP_BattMonitor.h>
 #include <SRV_Channel/SRV_Channel.h>
 #include <AP_Logger/AP_Logger.h>
+#include <AP_Scheduler/AP_Scheduler.h>
 
 #include <AP_Vehicle/AP_Vehicle_Type.h>
 #if APM_BUILD_TYPE(APM_BUILD_ArduPlane)
@@ -263,6 +264,10 @@ void AP_MotorsMulticopter::output()
     // convert rpy_thrust values to pwm
     output_to_motors();
 
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    AP::scheduler().loop_trace.mark(AP::LoopTrace::Point::MIXER);
+#endif
+
     // output any booster throttle
     output_boost_throttle();
 
@@ -104,6 +104,34 @@ float Thrust_Linearization::thrust_to_actuator(float thrust_in) const
     return spin_min + (spin_max - spin_min) * apply_thrust_curve_and_volt_scaling(thrust_in);
 }
 
+// converts count desired thrusts, the same as calling the above for each one
+// the terms that don't depend on the thrust are only calculated once
+void Thrust_Linearization::thrust_to_actuator(const float *thrust_in, float *actuator_out, uint8_t count) const
+{
+    const float actuator_min = spin_min;
+    const float actuator_range = spin_max - spin_min;
+    float battery_scale = 1.0;
+    if (is_positive(batt_voltage_filt.get())) {
+        battery_scale = 1.0 / batt_voltage_filt.get();
+    }
+    const float thrust_curve_expo = constrain_float(curve_expo, -1.0, 1.0);
+    if (is_zero(thrust_curve_expo)) {
+        for (uint8_t i = 0; i < count; i++) {
+            const float thrust = constrain_float(thrust_in[i], 0.0, 1.0);
+            actuator_out[i] = actuator_min + actuator_range * (lift_max * thrust * battery_scale);
+        }
+        return;
+    }
+    const float one_minus_expo_sq = (1.0 - thrust_curve_expo) * (1.0 - thrust_curve_expo);
+    const float lift_gain = 4.0 * thrust_curve_expo * lift_max;
+    const float expo_x2 = 2.0 * thrust_curve_expo;
+    for (uint8_t i = 0; i < count; i++) {
+        const float thrust = constrain_float(thrust_in[i], 0.0, 1.0);
+        const float throttle_ratio = ((thrust_curve_expo - 1.0) + safe_sqrt(one_minus_expo_sq + lift_gain * thrust)) / expo_x2;
+        actuator_out[i] = actuator_min + actuator_range * constrain_float(throttle_ratio * battery_scale, 0.0, 1.0);
+    }
+}
+
 // inverse of above, tested with AP_Motors/examples/expo_inverse_test
 // used to calculate equivelent motor throttle level to direct ouput, used in tailsitter transtions
 float Thrust_Linearization::actuator_to_thrust(float actuator) const
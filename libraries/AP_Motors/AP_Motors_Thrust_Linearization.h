@@ -20,6 +20,9 @@ public:
     // Converts desired thrust to linearized actuator output in a range of 0~1
     float thrust_to_actuator(float thrust_in) const;
 
+    // Converts count desired thrusts, the same as calling the above for each one
+    void thrust_to_actuator(const float *thrust_in, float *actuator_out, uint8_t count) const;
+
     // Inverse of above
     float actuator_to_thrust(float actuator) const;
 
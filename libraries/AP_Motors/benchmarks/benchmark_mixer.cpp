@@ -0,0 +1,48 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_BattMonitor/AP_BattMonitor.h>
+#include <AP_Motors/AP_Motors.h>
+#include <SRV_Channel/SRV_Channel.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+// singletons the motors library expects
+static SRV_Channels srvs;
+static AP_BattMonitor battmonitor{0, nullptr, nullptr};
+
+// the matrix mixer is a singleton, so share one between frames
+static AP_MotorsMatrix *motors;
+
+// cost of one fast loop motors update, flying with changing demands
+static void BM_MatrixMixer(benchmark::State& state)
+{
+    if (motors == nullptr) {
+        motors = new AP_MotorsMatrix(400);
+    }
+    motors->armed(false);
+    motors->set_frame_class_and_type(AP_Motors::motor_frame_class(state.range(0)), AP_Motors::MOTOR_FRAME_TYPE_X);
+    if (!motors->initialised_ok()) {
+        state.SkipWithError("frame init failed");
+        return;
+    }
+    motors->armed(true);
+    motors->set_interlock(true);
+    motors->set_desired_spool_state(AP_Motors::DesiredSpoolState::THROTTLE_UNLIMITED);
+
+    uint16_t count = 0;
+    while (state.KeepRunning()) {
+        const float demand = (count++ % 200) * 0.01 - 1.0;
+        motors->set_roll(demand);
+        motors->set_pitch(-0.5 * demand);
+        motors->set_yaw(0.3 * demand);
+        motors->set_throttle(0.5 + 0.2 * demand);
+        motors->output();
+    }
+}
+
+BENCHMARK(BM_MatrixMixer)
+    ->Arg(AP_Motors::MOTOR_FRAME_QUAD)
+    ->Arg(AP_Motors::MOTOR_FRAME_OCTA)
+    ->Arg(AP_Motors::MOTOR_FRAME_DODECAHEXA);
+
+BENCHMARK_MAIN();
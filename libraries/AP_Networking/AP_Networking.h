@@ -265,10 +265,37 @@ private:
 
         bool send_receive(void);
 
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+        // use batched socket IO, cleared by the port benchmark to
+        // compare with the simple path
+        bool batched_io = true;
+#endif
+
     private:
         bool init_buffers(const uint32_t size_rx, const uint32_t size_tx);
         void thread_create(AP_HAL::MemberProc);
 
+        // wait for something to do after a loop that did nothing
+        void idle_wait(void);
+
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+        bool wait_event(void);
+        bool receive_batched(bool &closed);
+        bool send_batched(bool &closed);
+
+        // eventfd used by writers to wake the port thread
+        int wake_fd = -1;
+        // the port thread is waiting for events, protected by sem
+        bool sleeping;
+        // the socket refused data, wait until it is writable
+        bool tx_blocked;
+        // bytes left in writebuffer after the last send
+        uint32_t tx_seen;
+        // socket IO goes through here, outside the semaphore
+        static const uint32_t io_buf_size = SocketAPM::max_batch * AP_NETWORKING_PORT_DATAGRAM_SIZE;
+        uint8_t *io_buf;
+#endif
+
         uint32_t txspace() override;
         void _begin(uint32_t b, uint16_t rxS, uint16_t txS) override;
         size_t _write(const uint8_t *buffer, size_t size) override;
@@ -322,6 +349,7 @@ private:
         TEST_TCP_DISCARD = (1U<<2),
         TEST_TCP_REFLECT = (1U<<3),
         TEST_CONNECTOR_LOOPBACK = (1U<<4),
+        TEST_PORT_BENCH = (1U<<5),
     };
     void start_tests(void);
     void test_UDP_client(void);
@@ -329,6 +357,9 @@ private:
     void test_TCP_discard(void);
     void test_TCP_reflect(void);
     void test_connector_loopback(void);
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+    void test_port_bench(void);
+#endif
 #endif // AP_NETWORKING_TESTS_ENABLED
 
 #if AP_NETWORKING_REGISTER_PORT_ENABLED
@@ -42,6 +42,24 @@
 #define AP_NETWORKING_SOCKETS_ENABLED AP_NETWORKING_ENABLED
 #endif
 
+/*
+  scatter/gather and batched socket IO, using sendmsg, recvmsg and
+  sendmmsg on native Linux sockets
+ */
+#ifndef AP_NETWORKING_BATCHED_IO_ENABLED
+#if defined(__linux__) && !AP_NETWORKING_BACKEND_CHIBIOS && !AP_NETWORKING_BACKEND_PPP
+#define AP_NETWORKING_BATCHED_IO_ENABLED AP_NETWORKING_SOCKETS_ENABLED
+#else
+#define AP_NETWORKING_BATCHED_IO_ENABLED 0
+#endif
+#endif
+
+#if AP_NETWORKING_BATCHED_IO_ENABLED && !defined(AP_NETWORKING_PORT_DATAGRAM_SIZE)
+// largest datagram a port packs whole MAVLink packets into, small
+// enough to avoid fragmentation on ethernet
+#define AP_NETWORKING_PORT_DATAGRAM_SIZE 1400
+#endif
+
 #ifndef AP_NETWORKING_CONTROLS_HOST_IP_SETTINGS_ENABLED
 // AP_NETWORKING_CONTROLS_HOST_IP_SETTINGS_ENABLED should only be true if we have the ability to
 // change the IP address. If not then the IP, GW, NetMask, MAC and DHCP params are hidden. 
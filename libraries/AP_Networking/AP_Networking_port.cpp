@@ -14,6 +14,10 @@
 #include <AP_SerialManager/AP_SerialManager.h>
 #include <AP_HAL/utility/packetise.h>
 #include <errno.h>
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+#include <poll.h>
+#include <sys/eventfd.h>
+#endif
 
 extern const AP_HAL::HAL& hal;
 
@@ -29,6 +33,13 @@ extern const AP_HAL::HAL& hal;
 #define AP_NETWORKING_PORT_STACK_SIZE 1024
 #endif
 
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+// longest wait for events, so UDP server address changes are noticed
+#ifndef AP_NETWORKING_PORT_IDLE_MS
+#define AP_NETWORKING_PORT_IDLE_MS 10
+#endif
+#endif
+
 const AP_Param::GroupInfo AP_Networking::Port::var_info[] = {
     // @Param: TYPE
     // @DisplayName: Port type
@@ -106,6 +117,13 @@ void AP_Networking::Port::thread_create(AP_HAL::MemberProc proc)
         return;
     }
 
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+    // without it we fall back to polling
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    // and without this to sending and receiving 300 bytes at a time
+    io_buf = NEW_NOTHROW uint8_t[io_buf_size];
+#endif
+
     if (!hal.scheduler->thread_create(proc, thread_name, AP_NETWORKING_PORT_STACK_SIZE, AP_HAL::Scheduler::PRIORITY_UART, 0)) {
         AP_BoardConfig::allocation_error("Failed to allocate %s client thread", thread_name);
     }
@@ -195,7 +213,7 @@ void AP_Networking::Port::udp_client_loop(void)
     bool active = false;
     while (true) {
         if (!active) {
-            hal.scheduler->delay_microseconds(100);
+            idle_wait();
         }
         active = send_receive();
     }
@@ -222,7 +240,7 @@ void AP_Networking::Port::udp_server_loop(void)
     bool active = false;
     while (true) {
         if (!active) {
-            hal.scheduler->delay_microseconds(100);
+            idle_wait();
         }
         active = send_receive();
     }
@@ -250,7 +268,7 @@ void AP_Networking::Port::tcp_server_loop(void)
     bool active = false;
     while (true) {
         if (!active) {
-            hal.scheduler->delay_microseconds(100);
+            idle_wait();
         }
         if (sock == nullptr) {
             sock = listen_sock->accept(100);
@@ -284,7 +302,7 @@ void AP_Networking::Port::tcp_client_loop(void)
     bool active = false;
     while (true) {
         if (!active) {
-            hal.scheduler->delay_microseconds(100);
+            idle_wait();
         }
         if (sock == nullptr) {
             sock = NEW_NOTHROW SocketAPM(false);
@@ -313,6 +331,200 @@ void AP_Networking::Port::tcp_client_loop(void)
     }
 }
 
+/*
+  wait for something to do after a loop that did nothing
+ */
+void AP_Networking::Port::idle_wait(void)
+{
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+    if (wait_event()) {
+        return;
+    }
+#endif
+    hal.scheduler->delay_microseconds(100);
+}
+
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+/*
+  sleep until the socket has data for us, a writer has given us more
+  to send or the socket can take data it refused. Returns false if
+  we can't wait on events
+ */
+bool AP_Networking::Port::wait_event(void)
+{
+    if (wake_fd == -1 || sock == nullptr || !batched_io || io_buf == nullptr) {
+        return false;
+    }
+    bool can_read;
+    {
+        WITH_SEMAPHORE(sem);
+        if (connected && !tx_blocked && writebuffer->available() != tx_seen) {
+            // written to since we last looked
+            return true;
+        }
+        sleeping = true;
+        can_read = readbuffer->space() > 0;
+    }
+
+    struct pollfd fds[3] {};
+    nfds_t nfds = 2;
+    // with a full read buffer we would wake straight away, so wait
+    // for the timeout and look again
+    fds[0].fd = can_read ? sock->get_read_fd() : -1;
+    fds[0].events = POLLIN;
+    fds[1].fd = wake_fd;
+    fds[1].events = POLLIN;
+    if (tx_blocked) {
+        fds[2].fd = sock->get_write_fd();
+        fds[2].events = POLLOUT;
+        nfds++;
+    }
+    ::poll(fds, nfds, AP_NETWORKING_PORT_IDLE_MS);
+    if (fds[1].revents & POLLIN) {
+        eventfd_t v;
+        IGNORE_RETURN(eventfd_read(wake_fd, &v));
+    }
+
+    WITH_SEMAPHORE(sem);
+    sleeping = false;
+    // retry, if the socket is still full we'll be told again
+    tx_blocked = false;
+    return true;
+}
+
+/*
+  read from the socket until it is drained or the read buffer is
+  full. The socket is read outside the semaphore, so writers and
+  readers of the port never wait on a system call
+ */
+bool AP_Networking::Port::receive_batched(bool &closed)
+{
+    bool active = false;
+    while (true) {
+        uint32_t space;
+        {
+            WITH_SEMAPHORE(sem);
+            space = readbuffer->space();
+        }
+        if (space == 0) {
+            break;
+        }
+        const ssize_t ret = sock->recv(io_buf, MIN(space, io_buf_size), 0);
+        if (close_on_recv_error && ret == 0) {
+            closed = true;
+            break;
+        }
+        if (ret <= 0) {
+            break;
+        }
+        {
+            WITH_SEMAPHORE(sem);
+            readbuffer->write(io_buf, ret);
+        }
+        // Cant track dropped read packets because we only read in what there is space for
+        // The socket buffer becomes full and data is lost there
+        rx_stats_bytes += ret;
+        active = true;
+        have_received = true;
+    }
+    return active;
+}
+
+/*
+  send from the write buffer. A stream gets everything in one
+  call. Datagrams are cut on MAVLink packet boundaries, packing as
+  many whole packets as fit, and a batch of them goes in one
+  call. The data is copied out under the semaphore and sent after
+  releasing it
+ */
+bool AP_Networking::Port::send_batched(bool &closed)
+{
+    const bool udp = (type == NetworkPortType::UDP_CLIENT || type == NetworkPortType::UDP_SERVER);
+    if (type == NetworkPortType::UDP_SERVER &&
+        (last_udp_connect_address == 0 || last_udp_connect_port == 0)) {
+        // nobody to send to yet, keep the data until there is
+        WITH_SEMAPHORE(sem);
+        tx_seen = writebuffer->available();
+        return false;
+    }
+
+    ByteBuffer::IoVec vec[SocketAPM::max_batch];
+    uint8_t vec_counts[SocketAPM::max_batch];
+    uint8_t num = 0;
+    uint32_t total = 0;
+    {
+        WITH_SEMAPHORE(sem);
+        const uint32_t available = MIN(writebuffer->available(), io_buf_size);
+        if (udp) {
+            while (num < SocketAPM::max_batch && total < available) {
+                uint32_t len = 0;
+                while (total + len < available) {
+                    uint32_t n = MIN(available - (total + len), uint32_t(AP_NETWORKING_PORT_DATAGRAM_SIZE));
+#if AP_MAVLINK_PACKETISE_ENABLED
+                    if (packetise) {
+                        n = mavlink_packetise(*writebuffer, n, total + len);
+                    }
+#endif
+                    if (n == 0 || len + n > AP_NETWORKING_PORT_DATAGRAM_SIZE) {
+                        break;
+                    }
+                    len += n;
+                    if (!packetise) {
+                        break;
+                    }
+                }
+                if (len == 0) {
+                    break;
+                }
+                vec[num].data = &io_buf[total];
+                vec[num].len = len;
+                vec_counts[num++] = 1;
+                total += len;
+            }
+        } else {
+            total = available;
+        }
+        total = writebuffer->peekbytes(io_buf, total);
+        if (total == 0) {
+            tx_seen = writebuffer->available();
+            return false;
+        }
+    }
+
+    ssize_t sent;
+    if (udp) {
+        // UDP Server sends to the last address we heard from
+        const int num_sent = (type == NetworkPortType::UDP_CLIENT) ?
+            sock->send_batch(vec, vec_counts, num, 0, 0) :
+            sock->send_batch(vec, vec_counts, num, last_udp_connect_address, last_udp_connect_port);
+        sent = (num_sent < 0) ? -1 : 0;
+        for (int i=0; i<num_sent; i++) {
+            sent += vec[i].len;
+        }
+    } else {
+        // TCP Server and Client
+        sent = sock->send(io_buf, total);
+    }
+    const int send_errno = errno;
+
+    bool active = false;
+    WITH_SEMAPHORE(sem);
+    if (sent > 0) {
+        writebuffer->advance(sent);
+        tx_stats_bytes += sent;
+        active = true;
+    } else if (sent < 0) {
+        if (send_errno == EAGAIN || send_errno == EWOULDBLOCK || send_errno == ENOBUFS) {
+            tx_blocked = true;
+        } else if (send_errno == ENOTCONN && !udp) {
+            closed = true;
+        }
+    }
+    tx_seen = writebuffer->available();
+    return active;
+}
+#endif  // AP_NETWORKING_BATCHED_IO_ENABLED
+
 /*
   run one send/receive loop
  */
@@ -320,11 +532,27 @@ bool AP_Networking::Port::send_receive(void)
 {
 
     bool active = false;
-    uint32_t space;
 
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+    const bool batched = batched_io && io_buf != nullptr;
+    bool closed = false;
+    if (batched) {
+        active = receive_batched(closed);
+    }
+    if (closed) {
+        GCS_SEND_TEXT(MAV_SEVERITY_INFO, "TCP[%u]: closed connection", unsigned(state.idx));
+        delete sock;
+        sock = nullptr;
+        return false;
+    }
+#else
+    const bool batched = false;
+#endif
+
+    uint32_t space = 0;
 
     // handle incoming packets
-    {
+    if (!batched) {
         WITH_SEMAPHORE(sem);
         space = readbuffer->space();
     }
@@ -375,6 +603,23 @@ bool AP_Networking::Port::send_receive(void)
         }
     }
 
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+    if (connected && batched) {
+        if (send_batched(closed)) {
+            active = true;
+        }
+        if (closed) {
+            // close socket and mark as disconnected, so we can reconnect with another client or when server comes back
+            GCS_SEND_TEXT(MAV_SEVERITY_INFO, "TCP[%u]: disconnected", unsigned(state.idx));
+            sock->close();
+            delete sock;
+            sock = nullptr;
+            connected = false;
+        }
+        return active;
+    }
+#endif
+
     if (connected) {
         // handle outgoing packets
         uint32_t available;
@@ -453,7 +698,15 @@ void AP_Networking::Port::_begin(uint32_t b, uint16_t rxS, uint16_t txS)
 size_t AP_Networking::Port::_write(const uint8_t *buffer, size_t size)
 {
     WITH_SEMAPHORE(sem);
-    return writebuffer->write(buffer, size);
+    const size_t ret = writebuffer->write(buffer, size);
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+    if (sleeping && ret > 0) {
+        // wake the port thread
+        sleeping = false;
+        IGNORE_RETURN(eventfd_write(wake_fd, 1));
+    }
+#endif
+    return ret;
 }
 
 ssize_t AP_Networking::Port::_read(uint8_t *buffer, uint16_t count)
@@ -9,6 +9,7 @@
 
 #include <GCS_MAVLink/GCS.h>
 #include <AP_HAL/utility/Socket.h>
+#include <AP_Math/AP_Math.h>
 #include <stdio.h>
 
 extern const AP_HAL::HAL& hal;
@@ -43,6 +44,13 @@ void AP_Networking::start_tests(void)
                                      "connector_loopback",
                                      8192, AP_HAL::Scheduler::PRIORITY_IO, -1);
     }
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+    if (param.tests & TEST_PORT_BENCH) {
+        hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&AP_Networking::test_port_bench, void),
+                                     "port_bench",
+                                     8192, AP_HAL::Scheduler::PRIORITY_IO, -1);
+    }
+#endif
 }
 
 /*
@@ -273,4 +281,131 @@ void AP_Networking::test_connector_loopback(void)
     }
 }
 
+#if AP_NETWORKING_BATCHED_IO_ENABLED
+// loopback port the benchmark sink listens on
+#define PORT_BENCH_SINK_PORT 15760
+
+// size of the frames we pretend are MAVLink packets
+#define PORT_BENCH_FRAME_SIZE 64
+#define PORT_BENCH_FRAMES_PER_WRITE 16
+
+/*
+  benchmark a network port. Needs a UDP client port sending to
+  127.0.0.1:15760 with nothing else writing to it, eg. NET_P1_TYPE=1,
+  NET_P1_IP=127.0.0.1, NET_P1_PORT=15760 and NET_P1_PROTOCOL=-1.
+
+  The same stream of frames is written to the port with the simple and
+  the batched port IO, and the throughput measured at a sink. Then the
+  sink echoes frames back through the port to measure round trip
+  latency
+ */
+void AP_Networking::test_port_bench(void)
+{
+    Port *p = nullptr;
+    for (auto &port : ports) {
+        if (port.type == NetworkPortType::UDP_CLIENT && port.port == PORT_BENCH_SINK_PORT && port.sock != nullptr) {
+            p = &port;
+            break;
+        }
+    }
+    if (p == nullptr) {
+        GCS_SEND_TEXT(MAV_SEVERITY_ERROR, "port_bench: needs a UDP client port to 127.0.0.1:%u", PORT_BENCH_SINK_PORT);
+        return;
+    }
+    auto *sink = NEW_NOTHROW SocketAPM(true);
+    if (sink == nullptr || !sink->bind("127.0.0.1", PORT_BENCH_SINK_PORT)) {
+        GCS_SEND_TEXT(MAV_SEVERITY_ERROR, "port_bench: sink failed to bind");
+        delete sink;
+        return;
+    }
+    GCS_SEND_TEXT(MAV_SEVERITY_INFO, "port_bench: starting on NET_P%u", unsigned(p - &ports[0]) + 1);
+    // the port as the rest of the system sees it
+    AP_HAL::UARTDriver &uart = *p;
+
+    uint8_t frames[PORT_BENCH_FRAME_SIZE * PORT_BENCH_FRAMES_PER_WRITE];
+    for (uint16_t i=0; i<sizeof(frames); i++) {
+        frames[i] = i & 0xFF;
+    }
+    uint8_t buf[1500];
+    const uint32_t duration_us = 1000000;
+
+    while (true) {
+        if ((param.tests & TEST_PORT_BENCH) == 0) {
+            hal.scheduler->delay(100);
+            continue;
+        }
+
+        for (uint8_t batched=0; batched<2; batched++) {
+            p->batched_io = batched;
+            // let the port go idle and empty the sink
+            hal.scheduler->delay(100);
+            while (sink->recv(buf, sizeof(buf), 0) > 0) {
+            }
+
+            uint32_t total_rx = 0;
+            uint32_t datagrams = 0;
+            const uint32_t start_us = AP_HAL::micros();
+            while (AP_HAL::micros() - start_us < duration_us) {
+                if (uart.txspace() >= sizeof(frames)) {
+                    uart.write(frames, sizeof(frames));
+                } else {
+                    hal.scheduler->delay_microseconds(100);
+                }
+                while (true) {
+                    const ssize_t ret = sink->recv(buf, sizeof(buf), 0);
+                    if (ret <= 0) {
+                        break;
+                    }
+                    total_rx += ret;
+                    datagrams++;
+                }
+            }
+            const float dt = (AP_HAL::micros() - start_us) * 1.0e-6f;
+            GCS_SEND_TEXT(MAV_SEVERITY_INFO, "port_bench %s: %.0f kbyte/sec in %.0f datagrams/sec",
+                          batched ? "batched" : "simple",
+                          double(total_rx * 1.0e-3f / dt), double(datagrams / dt));
+        }
+        p->batched_io = true;
+
+        // round trip out through the port, back from the sink and in
+        // through the port
+        hal.scheduler->delay(100);
+        while (sink->recv(buf, sizeof(buf), 0) > 0) {
+        }
+        uint8_t drain[PORT_BENCH_FRAME_SIZE];
+        while (uart.read(drain, sizeof(drain)) > 0) {
+        }
+        uint32_t min_us = UINT32_MAX, max_us = 0, total_us = 0;
+        uint16_t count = 0;
+        for (uint16_t i=0; i<1000; i++) {
+            const uint32_t t0 = AP_HAL::micros();
+            uart.write(frames, PORT_BENCH_FRAME_SIZE);
+            const ssize_t ret = sink->recv(buf, sizeof(buf), 100);
+            uint32_t addr;
+            uint16_t port;
+            if (ret != PORT_BENCH_FRAME_SIZE || !sink->last_recv_address(addr, port)) {
+                continue;
+            }
+            sink->sendto(buf, ret, addr, port);
+            while (uart.available() < PORT_BENCH_FRAME_SIZE && AP_HAL::micros() - t0 < 100000) {
+                hal.scheduler->delay_microseconds(20);
+            }
+            if (uart.read(buf, PORT_BENCH_FRAME_SIZE) != PORT_BENCH_FRAME_SIZE) {
+                continue;
+            }
+            const uint32_t rtt_us = AP_HAL::micros() - t0;
+            min_us = MIN(min_us, rtt_us);
+            max_us = MAX(max_us, rtt_us);
+            total_us += rtt_us;
+            count++;
+        }
+        if (count > 0) {
+            GCS_SEND_TEXT(MAV_SEVERITY_INFO, "port_bench rtt: min %uus avg %uus max %uus lost %u",
+                          unsigned(min_us), unsigned(total_us / count), unsigned(max_us), unsigned(1000 - count));
+        }
+        hal.scheduler->delay(5000);
+    }
+}
+#endif // AP_NETWORKING_BATCHED_IO_ENABLED
+
 #endif // AP_NETWORKING_ENABLED && AP_NETWORKING_TESTS_ENABLED
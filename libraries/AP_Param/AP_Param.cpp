@@ -35,7 +35,9 @@
 #include <AP_InternalError/AP_InternalError.h>
 #include <AP_Filesystem/AP_Filesystem.h>
 #include <stdio.h>
+#include <ctype.h>
 #include <AP_ROMFS/AP_ROMFS.h>
+#include <AP_Common/ExpandingString.h>
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
     #include <SITL/SITL.h>
@@ -104,6 +106,17 @@ uint16_t AP_Param::_count_marker;
 uint16_t AP_Param::_count_marker_done;
 HAL_Semaphore AP_Param::_count_sem;
 
+#if AP_PARAM_INDEX_ENABLED
+AP_Param::index_entry *AP_Param::_index;
+AP_Param::index_name *AP_Param::_index_names;
+uint16_t AP_Param::_index_len;
+uint16_t AP_Param::_index_alloc;
+uint16_t AP_Param::_index_marker;
+bool AP_Param::_index_valid;
+uint16_t AP_Param::_index_hint;
+uint32_t AP_Param::_index_build_us;
+#endif
+
 // storage and naming information about all types that can be saved
 const AP_Param::Info *AP_Param::_var_info;
 
@@ -917,6 +930,27 @@ AP_Param::find_group(const char *name, uint16_t vindex, ptrdiff_t group_offset,
 AP_Param *
 AP_Param::find(const char *name, enum ap_var_type *ptype, uint16_t *flags)
 {
+#if AP_PARAM_INDEX_ENABLED
+    {
+        ParamToken token;
+        AP_Param *ap = index_find(name, ptype, &token);
+        if (ap != nullptr) {
+            if (flags != nullptr && var_info(token.key).type == AP_PARAM_GROUP) {
+                uint32_t group_element = 0;
+                const struct GroupInfo *ginfo;
+                struct GroupNesting group_nesting {};
+                uint8_t idx;
+                ap->find_var_info(&group_element, ginfo, group_nesting, &idx);
+                if (ginfo != nullptr) {
+                    *flags = ginfo->flags;
+                }
+            }
+            return ap;
+        }
+    }
+    // not in the index, which is expected for parameters in
+    // disabled groups and for whole Vector3f parameters
+#endif
     for (uint16_t i=0; i<_num_vars; i++) {
         const auto &info = var_info(i);
         uint8_t type = info.type;
@@ -958,11 +992,27 @@ AP_Param::find(const char *name, enum ap_var_type *ptype, uint16_t *flags)
     return nullptr;
 }
 
-// Find a variable by index. Note that this is quite slow.
+// Find a variable by index. Note that this is quite slow unless the
+// lookup index is available
 //
 AP_Param *
 AP_Param::find_by_index(uint16_t idx, enum ap_var_type *ptype, ParamToken *token)
 {
+#if AP_PARAM_INDEX_ENABLED
+    {
+        WITH_SEMAPHORE(_count_sem);
+        if (index_current()) {
+            if (idx >= _index_len) {
+                return nullptr;
+            }
+            const auto &e = _index[idx];
+            *token = e.token;
+            *ptype = (enum ap_var_type)e.type;
+            _index_hint = idx;
+            return e.ap;
+        }
+    }
+#endif
     AP_Param *ap;
     uint16_t count=0;
     for (ap=AP_Param::first(token, ptype);
@@ -1747,6 +1797,10 @@ AP_Param *AP_Param::first(ParamToken *token, enum ap_var_type *ptype, float *def
     if (_num_vars == 0) {
         return nullptr;
     }
+#if AP_PARAM_INDEX_ENABLED
+    // let a following next_scalar() use the index
+    _index_hint = 0;
+#endif
     ptrdiff_t base;
     if (!get_base(var_info(0), base)) {
         // should be impossible, first var needs to be non-pointer
@@ -1933,6 +1987,35 @@ AP_Param *AP_Param::next(ParamToken *token, enum ap_var_type *ptype, bool skip_d
 /// as needed
 AP_Param *AP_Param::next_scalar(ParamToken *token, enum ap_var_type *ptype, float *default_val)
 {
+#if AP_PARAM_INDEX_ENABLED
+    /*
+      use the index if the token is the one we last handed out. We
+      don't block on the semaphore as the IO thread may be rebuilding
+      the index
+     */
+    if (default_val == nullptr && _count_sem.take_nonblocking()) {
+        AP_Param *ret = nullptr;
+        bool found = false;
+        const uint16_t hint = _index_hint;
+        if (index_current() && hint < _index_len &&
+            token_equal(_index[hint].token, *token)) {
+            found = true;
+            if (hint+1U < _index_len) {
+                const auto &e = _index[hint+1];
+                *token = e.token;
+                if (ptype != nullptr) {
+                    *ptype = (enum ap_var_type)e.type;
+                }
+                _index_hint = hint+1;
+                ret = e.ap;
+            }
+        }
+        _count_sem.give();
+        if (found) {
+            return ret;
+        }
+    }
+#endif
     AP_Param *ap;
     enum ap_var_type type;
     while ((ap = next(token, &type, true, default_val)) != nullptr && type > AP_PARAM_FLOAT) ;
@@ -2702,10 +2785,164 @@ uint16_t AP_Param::count_parameters(void)
         }
         _parameter_count = count;
         _count_marker_done = marker;
+#if AP_PARAM_INDEX_ENABLED
+        build_index(count, marker);
+#endif
     }
     return _parameter_count;
 }
 
+#if AP_PARAM_INDEX_ENABLED
+/*
+  compare two tokens
+ */
+bool AP_Param::token_equal(const ParamToken &t1, const ParamToken &t2)
+{
+    return t1.key == t2.key &&
+        t1.idx == t2.idx &&
+        t1.group_element == t2.group_element &&
+        t1.last_disabled == t2.last_disabled;
+}
+
+/*
+  case insensitive hash of a parameter name
+ */
+uint32_t AP_Param::index_hash(const char *name)
+{
+    uint8_t upper[AP_MAX_NAME_SIZE];
+    uint8_t len;
+    for (len=0; len<AP_MAX_NAME_SIZE && name[len] != 0; len++) {
+        upper[len] = toupper(name[len]);
+    }
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash_fnv_1a(len, upper, &hash);
+    return uint32_t(hash ^ (hash >> 32));
+}
+
+/*
+  qsort comparison for name hashes, keeping index order for equal hashes
+ */
+int AP_Param::index_name_cmp(const void *v1, const void *v2)
+{
+    const auto *n1 = (const index_name *)v1;
+    const auto *n2 = (const index_name *)v2;
+    if (n1->hash != n2->hash) {
+        return n1->hash < n2->hash ? -1 : 1;
+    }
+    return int(n1->idx) - int(n2->idx);
+}
+
+/*
+  build the lookup index. This walks the whole tree once, so is
+  called with _count_sem held from count_parameters(), which normally
+  runs on the IO thread
+ */
+void AP_Param::build_index(uint16_t count, uint16_t marker)
+{
+    _index_valid = false;
+    const uint32_t tstart = AP_HAL::micros();
+
+    if (count > _index_alloc) {
+        free(_index);
+        free(_index_names);
+        _index_alloc = 0;
+        // allow some headroom for groups being enabled
+        const uint16_t alloc = count + 32;
+        _index = (index_entry *)calloc(alloc, sizeof(index_entry));
+        _index_names = (index_name *)calloc(alloc, sizeof(index_name));
+        if (_index == nullptr || _index_names == nullptr) {
+            free(_index);
+            free(_index_names);
+            _index = nullptr;
+            _index_names = nullptr;
+            return;
+        }
+        _index_alloc = alloc;
+    }
+
+    ParamToken token {};
+    enum ap_var_type ptype;
+    uint16_t n = 0;
+    for (AP_Param *ap = first(&token, &ptype);
+         ap != nullptr && n < count;
+         ap = next_scalar(&token, &ptype)) {
+        auto &e = _index[n];
+        e.ap = ap;
+        e.token = token;
+        e.type = ptype;
+        char name[AP_MAX_NAME_SIZE+1];
+        ap->copy_name_token(token, name, sizeof(name), true);
+        name[AP_MAX_NAME_SIZE] = 0;
+        _index_names[n].hash = index_hash(name);
+        _index_names[n].idx = n;
+        n++;
+    }
+    if (n != count) {
+        // tree changed while we were walking it
+        return;
+    }
+    qsort(_index_names, n, sizeof(index_name), index_name_cmp);
+
+    _index_len = n;
+    _index_marker = marker;
+    _index_build_us = AP_HAL::micros() - tstart;
+    _index_valid = true;
+}
+
+/*
+  find a parameter by name using the index, returning nullptr if the
+  index is not available or the name is not in the index
+ */
+AP_Param *AP_Param::index_find(const char *name, enum ap_var_type *ptype, ParamToken *token)
+{
+    if (!_count_sem.take_nonblocking()) {
+        return nullptr;
+    }
+    AP_Param *ret = nullptr;
+    if (index_current()) {
+        const uint32_t hash = index_hash(name);
+        // bisect for the first entry with a matching hash
+        uint16_t lo = 0, hi = _index_len;
+        while (lo < hi) {
+            const uint16_t mid = (lo + hi) / 2;
+            if (_index_names[mid].hash < hash) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for (; lo < _index_len && _index_names[lo].hash == hash; lo++) {
+            const auto &e = _index[_index_names[lo].idx];
+            char name2[AP_MAX_NAME_SIZE+1];
+            e.ap->copy_name_token(e.token, name2, sizeof(name2), true);
+            name2[AP_MAX_NAME_SIZE] = 0;
+            if (strncasecmp(name, name2, AP_MAX_NAME_SIZE) == 0) {
+                *ptype = (enum ap_var_type)e.type;
+                *token = e.token;
+                ret = e.ap;
+                break;
+            }
+        }
+    }
+    _count_sem.give();
+    return ret;
+}
+
+/*
+  report on the lookup index for @SYS/params.txt
+ */
+void AP_Param::index_info(ExpandingString &str)
+{
+    WITH_SEMAPHORE(_count_sem);
+    str.printf("ParamIndex valid=%u count=%u alloc=%u bytes=%u build_us=%u\n",
+               unsigned(index_current()),
+               unsigned(_index_len),
+               unsigned(_index_alloc),
+               unsigned(_index_alloc * (sizeof(index_entry) + sizeof(index_name))),
+               unsigned(_index_build_us));
+}
+#endif // AP_PARAM_INDEX_ENABLED
+
 /*
   invalidate parameter count cache
  */
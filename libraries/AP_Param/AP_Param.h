@@ -579,6 +579,11 @@ public:
     // invalidate parameter count
     static void invalidate_count(void);
 
+#if AP_PARAM_INDEX_ENABLED
+    // report size and state of the parameter lookup index
+    static void index_info(ExpandingString &str);
+#endif
+
     static void set_hide_disabled_groups(bool value) { _hide_disabled_groups = value; }
 
     // set frame type flags. Used to unhide frame specific parameters
@@ -834,6 +839,40 @@ private:
     }
 #endif
 
+#if AP_PARAM_INDEX_ENABLED
+    /*
+      lookup index of all scalar parameters in next_scalar() order,
+      plus a list of name hashes sorted for bisection. It is rebuilt
+      by count_parameters() and shares its invalidation marker
+     */
+    struct PACKED index_entry {
+        AP_Param *ap;
+        ParamToken token;
+        uint8_t type;
+    };
+    struct PACKED index_name {
+        uint32_t hash;
+        uint16_t idx;
+    };
+    static index_entry *_index;
+    static index_name *_index_names;
+    static uint16_t _index_len;
+    static uint16_t _index_alloc;
+    static uint16_t _index_marker;
+    static bool _index_valid;
+    static uint16_t _index_hint;
+    static uint32_t _index_build_us;
+
+    static void build_index(uint16_t count, uint16_t marker);
+    static bool index_current(void) {
+        return _index_valid && _index_marker == _count_marker;
+    }
+    static uint32_t index_hash(const char *name);
+    static AP_Param *index_find(const char *name, enum ap_var_type *ptype, ParamToken *token);
+    static bool token_equal(const ParamToken &t1, const ParamToken &t2);
+    static int index_name_cmp(const void *v1, const void *v2);
+#endif
+
     /*
       list of overridden values from load_defaults_file()
     */
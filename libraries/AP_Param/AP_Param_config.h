@@ -11,3 +11,11 @@
 #ifndef FORCE_APJ_DEFAULT_PARAMETERS
 #define FORCE_APJ_DEFAULT_PARAMETERS 0
 #endif
+
+/*
+  lookup index for find(), find_by_index() and next_scalar(). Costs
+  about 15 bytes of RAM per parameter on 32 bit boards
+ */
+#ifndef AP_PARAM_INDEX_ENABLED
+#define AP_PARAM_INDEX_ENABLED (HAL_MEM_CLASS >= HAL_MEM_CLASS_500)
+#endif
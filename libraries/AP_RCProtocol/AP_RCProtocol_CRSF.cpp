@@ -390,11 +390,7 @@ void AP_RCProtocol_CRSF::write_frame(Frame* frame)
         return;
     }
     // calculate crc
-    uint8_t crc = crc8_dvb_s2(0, frame->type);
-    for (uint8_t i = 0; i < frame->length - 2; i++) {
-        crc = crc8_dvb_s2(crc, frame->payload[i]);
-    }
-    frame->payload[frame->length - 2] = crc;
+    frame->payload[frame->length - 2] = crc8_dvb_s2_update(0, &frame->type, frame->length - 1);
 
     uart->write((uint8_t*)frame, frame->length + 2);
     uart->flush();
@@ -158,7 +158,6 @@ void AP_RCProtocol_GHST::_process_byte(uint32_t timestamp_us, uint8_t byte)
 
     // parse the length
     if (_frame_ofs == GHST_HEADER_TYPE_LEN) {
-        _frame_crc = crc8_dvb_s2(0, _frame.type);
         // check for garbage frame
         if (_frame.length > GHST_FRAME_PAYLOAD_MAX) {
             _frame_ofs = 0;
@@ -166,11 +165,6 @@ void AP_RCProtocol_GHST::_process_byte(uint32_t timestamp_us, uint8_t byte)
         return;
     }
 
-    // update crc
-    if (_frame_ofs < _frame.length + GHST_HEADER_LEN) {
-        _frame_crc = crc8_dvb_s2(_frame_crc, byte);
-    }
-
     // overflow check
     if (_frame_ofs > _frame.length + GHST_HEADER_LEN) {
         _frame_ofs = 0;
@@ -191,7 +185,8 @@ void AP_RCProtocol_GHST::_process_byte(uint32_t timestamp_us, uint8_t byte)
         _frame_ofs = 0;
 
         // bad CRC (payload start is +1 from frame start, so need to subtract that from frame length to get index)
-        if (_frame_crc != _frame.payload[_frame.length - 2]) {
+        const uint8_t crc = crc8_dvb_s2_update(0, &_frame.type, _frame.length - 1);
+        if (crc != _frame.payload[_frame.length - 2]) {
             return;
         }
 
@@ -230,11 +225,7 @@ bool AP_RCProtocol_GHST::write_frame(Frame* frame)
     }
 
     // calculate crc
-    uint8_t crc = crc8_dvb_s2(0, frame->type);
-    for (uint8_t i = 0; i < frame->length - 2; i++) {
-        crc = crc8_dvb_s2(crc, frame->payload[i]);
-    }
-    frame->payload[frame->length - 2] = crc;
+    frame->payload[frame->length - 2] = crc8_dvb_s2_update(0, &frame->type, frame->length - 1);
 
     uart->write((uint8_t*)frame, frame->length + 2);
     uart->flush();
@@ -79,7 +79,6 @@ void AP_RCProtocol_SUMD::_process_byte(uint32_t timestamp_us, uint8_t byte)
 #endif
         if (byte == SUMD_HEADER_ID) {
             _rxlen = 0;
-            _crc16 = crc_xmodem_update(0, byte);
             _decode_state = SUMD_DECODE_STATE_GOT_HEADER;
 
 #ifdef SUMD_DEBUG
@@ -92,7 +91,6 @@ void AP_RCProtocol_SUMD::_process_byte(uint32_t timestamp_us, uint8_t byte)
     case SUMD_DECODE_STATE_GOT_HEADER:
         if ((byte == SUMD_ID_SUMD) || (byte == SUMD_ID_FAILSAFE)) {
             _rxpacket.status = byte;
-            _crc16 = crc_xmodem_update(_crc16, byte);
             _decode_state = SUMD_DECODE_STATE_GOT_STATE;
 #ifdef SUMD_DEBUG
             hal.console->printf(" SUMD_DECODE_STATE_GOT_STATE: %x \n", byte) ;
@@ -106,7 +104,6 @@ void AP_RCProtocol_SUMD::_process_byte(uint32_t timestamp_us, uint8_t byte)
     case SUMD_DECODE_STATE_GOT_STATE:
         if (byte >= 2 && byte <= SUMD_MAX_CHANNELS) {
             _rxpacket.length = byte;
-            _crc16 = crc_xmodem_update(_crc16, byte);
             _rxlen++;
             _decode_state = SUMD_DECODE_STATE_GOT_LEN;
 
@@ -121,7 +118,6 @@ void AP_RCProtocol_SUMD::_process_byte(uint32_t timestamp_us, uint8_t byte)
 
     case SUMD_DECODE_STATE_GOT_LEN:
         _rxpacket.sumd_data[_rxlen] = byte;
-        _crc16 = crc_xmodem_update(_crc16, byte);
         _rxlen++;
         if (_rxlen <= ((_rxpacket.length * 2))) {
 #ifdef SUMD_DEBUG
@@ -140,18 +136,21 @@ void AP_RCProtocol_SUMD::_process_byte(uint32_t timestamp_us, uint8_t byte)
         _rxpacket.crc16_high = byte;
         _decode_state = SUMD_DECODE_STATE_GOT_CRC;
 #ifdef SUMD_DEBUG
-        hal.console->printf(" SUMD_DECODE_STATE_GOT_CRC16[1]: %x   [%x]\n", byte, ((_crc16 >> 8) & 0xff)) ;
+        hal.console->printf(" SUMD_DECODE_STATE_GOT_CRC16[1]: %x\n", byte) ;
 #endif
         break;
 
-    case SUMD_DECODE_STATE_GOT_CRC:
+    case SUMD_DECODE_STATE_GOT_CRC: {
+        // the crc covers the header, status, length and channel data
+        const uint8_t header[] { SUMD_HEADER_ID, _rxpacket.status, _rxpacket.length };
+        const uint16_t crc16 = crc16_ccitt(&_rxpacket.sumd_data[1], _rxlen - 1, crc_xmodem(header, sizeof(header)));
 #ifdef SUMD_DEBUG
-        hal.console->printf(" SUMD_DECODE_STATE_GOT_CRC[2]: %x   [%x]\n\n", byte, (_crc16 & 0xff)) ;
+        hal.console->printf(" SUMD_DECODE_STATE_GOT_CRC[2]: %x   [%x]\n\n", byte, (crc16 & 0xff)) ;
 #endif
 
         log_data(AP_RCProtocol::SUMD, timestamp_us, _rxpacket.sumd_data, _rxlen);
 
-        if (_crc16 == (uint16_t)(_rxpacket.crc16_high << 8) + byte) {
+        if (crc16 == (uint16_t)(_rxpacket.crc16_high << 8) + byte) {
 #ifdef SUMD_DEBUG
             hal.console->printf(" CRC - OK \n") ;
             hal.console->printf(" Got valid SUMD Packet\n") ;
@@ -190,13 +189,14 @@ void AP_RCProtocol_SUMD::_process_byte(uint32_t timestamp_us, uint8_t byte)
             add_input(_rxpacket.length, values, (_rxpacket.status == SUMD_ID_FAILSAFE));
 #ifdef SUMD_DEBUG
         } else {
-            hal.console->printf(" CRC - fail 0x%X 0x%X\n", _crc16, (uint16_t)(_rxpacket.crc16_high << 8) + byte);
+            hal.console->printf(" CRC - fail 0x%X 0x%X\n", crc16, (uint16_t)(_rxpacket.crc16_high << 8) + byte);
 #endif
         }
 
         _decode_state = SUMD_DECODE_STATE_UNSYNCED;
         break;
     }
+    }
 }
 
 void AP_RCProtocol_SUMD::process_byte(uint8_t byte, uint32_t baudrate)
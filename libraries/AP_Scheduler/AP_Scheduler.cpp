@@ -33,6 +33,7 @@
 #include <AP_InternalError/AP_InternalError.h>
 #include <AP_Common/ExpandingString.h>
 #include <AP_HAL/SIMState.h>
+#include <AP_HAL/utility/ThreadTrace.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
 
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
@@ -70,7 +71,7 @@ const AP_Param::GroupInfo AP_Scheduler::var_info[] = {
     // @Param: OPTIONS
     // @DisplayName: Scheduling options
     // @Description: This controls optional aspects of the scheduler.
-    // @Bitmask: 0:Enable per-task perf info
+    // @Bitmask: 0:Enable per-task perf info, 1:Enable fast loop latency tracing
     // @User: Advanced
     AP_GROUPINFO("OPTIONS",  2, AP_Scheduler, _options, 0),
 
@@ -265,8 +266,14 @@ void AP_Scheduler::run(uint32_t time_available)
         hal.util->persistent_data.scheduler_task = i;
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
         fill_nanf_stack();
+#endif
+#if AP_HAL_THREAD_TRACE_ENABLED
+        const uint64_t trace_start_us = ThreadTrace::begin();
 #endif
         task.function();
+#if AP_HAL_THREAD_TRACE_ENABLED
+        ThreadTrace::end(ThreadTrace::Kind::TASK, trace_start_us, 0, task.name);
+#endif
         hal.util->persistent_data.scheduler_task = -1;
 
         // record the tick counter when we ran. This drives
@@ -355,6 +362,10 @@ void AP_Scheduler::loop()
 
     _loop_sample_time_us = AP_HAL::micros64();
     const uint32_t sample_time_us = uint32_t(_loop_sample_time_us);
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    loop_trace.set_enabled(loop_trace_requested || (_options & uint8_t(Options::LOOP_TRACE)));
+    loop_trace.loop_start(_loop_sample_time_us, get_loop_period_us());
+#endif
     
     if (_loop_timer_start_us == 0) {
         _loop_timer_start_us = sample_time_us;
@@ -397,6 +408,10 @@ void AP_Scheduler::loop()
     // run the tasks
     run(time_available);
 
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    loop_trace.loop_end();
+#endif
+
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
     // move result of AP_HAL::micros() forward:
     hal.scheduler->delay_microseconds(1);
@@ -546,6 +561,17 @@ void AP_Scheduler::task_info(ExpandingString &str)
     }
 }
 
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+// display recent fast loop latencies for @SYS/loop_trace.json
+void AP_Scheduler::loop_trace_info(ExpandingString &str)
+{
+    // ask the main loop to trace from now on without touching
+    // SCHED_OPTIONS, the first read will have no loops
+    loop_trace_requested = true;
+    loop_trace.trace_json(str);
+}
+#endif
+
 namespace AP {
 
 AP_Scheduler &scheduler()
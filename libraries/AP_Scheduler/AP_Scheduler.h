@@ -29,6 +29,7 @@
 #include <AP_HAL/Util.h>
 #include <AP_Math/AP_Math.h>
 #include "PerfInfo.h"       // loop perf monitoring
+#include "LoopTrace.h"      // fast loop latency tracing
 
 #if AP_SCHEDULER_EXTENDED_TASKINFO_ENABLED
 #define AP_SCHEDULER_NAME_INITIALIZER(_clazz,_name) .name = #_clazz "::" #_name,
@@ -93,7 +94,8 @@ public:
     };
 
     enum class Options : uint8_t {
-        RECORD_TASK_INFO = 1 << 0
+        RECORD_TASK_INFO = 1 << 0,
+        LOOP_TRACE = 1 << 1,
     };
 
     enum FastTaskPriorities {
@@ -190,12 +192,27 @@ public:
 
     void task_info(ExpandingString &str);
 
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    // fast loop latency trace for @SYS/loop_trace.json
+    void loop_trace_info(ExpandingString &str);
+#endif
+
     static const struct AP_Param::GroupInfo var_info[];
 
     // loop performance monitoring:
     AP::PerfInfo perf_info;
 
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    // fast loop latency tracing
+    AP::LoopTrace loop_trace;
+#endif
+
 private:
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    // set once @SYS/loop_trace.json has been read
+    volatile bool loop_trace_requested;
+#endif
+
     // used to enable scheduler debugging
     AP_Int8 _debug;
 
@@ -9,3 +9,12 @@
 #ifndef AP_SCHEDULER_EXTENDED_TASKINFO_ENABLED
 #define AP_SCHEDULER_EXTENDED_TASKINFO_ENABLED 1
 #endif
+
+#ifndef AP_SCHEDULER_LOOP_TRACE_ENABLED
+#define AP_SCHEDULER_LOOP_TRACE_ENABLED (AP_SCHEDULER_ENABLED && HAL_PROGRAM_SIZE_LIMIT_KB > 1024)
+#endif
+
+// keep recent loops for @SYS/loop_trace.json on boards with memory to spare
+#ifndef AP_SCHEDULER_LOOP_TRACE_DUMP_ENABLED
+#define AP_SCHEDULER_LOOP_TRACE_DUMP_ENABLED (AP_SCHEDULER_LOOP_TRACE_ENABLED && (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX))
+#endif
@@ -0,0 +1,208 @@
+#include "LoopTrace.h"
+
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Logger/AP_Logger.h>
+
+extern const AP_HAL::HAL& hal;
+
+void AP::LoopTrace::set_enabled(bool _enabled)
+{
+    if (_enabled && !enabled) {
+        // don't log anything gathered before tracing was last stopped
+        reset();
+        last_log_us = 0;
+    }
+    enabled = _enabled;
+}
+
+void AP::LoopTrace::reset()
+{
+    memset(histogram, 0, sizeof(histogram));
+    memset(sum_us, 0, sizeof(sum_us));
+    memset(max_us, 0, sizeof(max_us));
+}
+
+void AP::LoopTrace::loop_start(uint64_t sample_time_us, uint32_t loop_period_us)
+{
+    if (!enabled) {
+        in_loop = false;
+        return;
+    }
+
+    // aim for 32 buckets per loop period
+    const uint16_t width = constrain_uint32(loop_period_us / 32, 1, 1000);
+    if (width != bucket_us) {
+        // loop rate has changed, start again
+        bucket_us = width;
+        reset();
+    }
+    if (last_log_us == 0) {
+        last_log_us = sample_time_us;
+    }
+
+    sample_us = sample_time_us;
+    for (uint8_t i = 0; i < num_points; i++) {
+        offset_us[i] = not_reached;
+    }
+    in_loop = true;
+}
+
+void AP::LoopTrace::_mark(Point point)
+{
+    const uint8_t i = uint8_t(point);
+    if (!in_loop || i >= num_points || offset_us[i] != not_reached) {
+        return;
+    }
+    // points reached from other threads (e.g. a separate rate
+    // thread) aren't timed from the main loop's sample
+    if (!hal.scheduler->in_main_thread()) {
+        return;
+    }
+    offset_us[i] = MIN(AP_HAL::micros64() - sample_us, uint64_t(not_reached - 1));
+}
+
+void AP::LoopTrace::loop_end()
+{
+    if (!in_loop) {
+        return;
+    }
+    in_loop = false;
+
+    for (uint8_t i = 0; i < num_points; i++) {
+        const uint16_t t = offset_us[i];
+        if (t == not_reached) {
+            continue;
+        }
+        uint16_t &count = histogram[i][MIN(t / bucket_us, num_buckets - 1)];
+        if (count < UINT16_MAX) {
+            count++;
+        }
+        sum_us[i] += t;
+        max_us[i] = MAX(max_us[i], t);
+    }
+
+#if AP_SCHEDULER_LOOP_TRACE_DUMP_ENABLED
+    LoopRecord &r = recent[recent_next];
+    r.sample_us = sample_us;
+    memcpy(r.offset_us, offset_us, sizeof(r.offset_us));
+    recent_next = (recent_next + 1) % num_recent;
+#endif
+
+    if (sample_us - last_log_us >= 1000000U) {
+        last_log_us = sample_us;
+        update_logging();
+    }
+}
+
+// return the latency below which pct percent of samples fall, to the
+// resolution of the histogram
+uint16_t AP::LoopTrace::percentile(uint8_t point, uint8_t pct) const
+{
+    uint32_t total = 0;
+    for (uint8_t b = 0; b < num_buckets; b++) {
+        total += histogram[point][b];
+    }
+    const uint32_t target = (total * pct + 99) / 100;
+    uint32_t sum = 0;
+    for (uint8_t b = 0; b < num_buckets - 1; b++) {
+        sum += histogram[point][b];
+        if (sum >= target) {
+            return MIN((b + 1) * bucket_us, max_us[point]);
+        }
+    }
+    return max_us[point];
+}
+
+const char *AP::LoopTrace::point_name(uint8_t point)
+{
+    static const char *names[] {
+        "ins_update",
+        "ahrs_update",
+        "rate_control",
+        "mixer",
+        "rcout_push",
+    };
+    static_assert(ARRAY_SIZE(names) == num_points, "names must match points");
+    return point < num_points ? names[point] : "unknown";
+}
+
+void AP::LoopTrace::update_logging()
+{
+#if HAL_LOGGING_ENABLED
+    const uint64_t now_us = AP_HAL::micros64();
+    for (uint8_t i = 0; i < num_points; i++) {
+        uint32_t count = 0;
+        for (uint8_t b = 0; b < num_buckets; b++) {
+            count += histogram[i][b];
+        }
+        if (count == 0) {
+            continue;
+        }
+// @LoggerMessage: LATN
+// @Description: Fast loop latency from the IMU sample to points on the rate control path
+// @Field: TimeUS: Time since system startup
+// @Field: Pt: trace point: 0=INS update, 1=AHRS update, 2=rate controller, 3=mixer, 4=output push
+// @Field: N: number of loops that reached the point
+// @Field: Avg: average latency
+// @Field: P50: median latency
+// @Field: P99: 99th percentile latency
+// @Field: Max: maximum latency
+        AP::logger().WriteStreaming(
+            "LATN", "TimeUS,Pt,N,Avg,P50,P99,Max", "s#-ssss", "F--FFFF", "QBHHHHH",
+            now_us,
+            i,
+            uint16_t(MIN(count, uint32_t(UINT16_MAX))),
+            uint16_t(sum_us[i] / count),
+            percentile(i, 50),
+            percentile(i, 99),
+            max_us[i]);
+    }
+#endif
+
+    reset();
+}
+
+// recent loops in Chrome trace event format for @SYS/loop_trace.json
+// each point is a slice starting at the IMU sample, so the slices of
+// one loop nest with the longest latency outermost
+void AP::LoopTrace::trace_json(ExpandingString &str) const
+{
+    str.printf("{\"traceEvents\":[\n");
+    str.printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main loop\"}}");
+#if AP_SCHEDULER_LOOP_TRACE_DUMP_ENABLED
+    const uint8_t start = recent_next;
+    for (uint8_t n = 0; n < num_recent; n++) {
+        const LoopRecord &r = recent[(start + n) % num_recent];
+        if (r.sample_us == 0) {
+            continue;
+        }
+        // emit the points longest first
+        bool done[num_points] {};
+        for (uint8_t k = 0; k < num_points; k++) {
+            uint8_t longest = num_points;
+            for (uint8_t i = 0; i < num_points; i++) {
+                if (done[i] || r.offset_us[i] == not_reached) {
+                    continue;
+                }
+                if (longest == num_points || r.offset_us[i] > r.offset_us[longest]) {
+                    longest = i;
+                }
+            }
+            if (longest == num_points) {
+                break;
+            }
+            done[longest] = true;
+            str.printf(",\n{\"name\":\"%s\",\"cat\":\"latency\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%u,\"pid\":1,\"tid\":1}",
+                       point_name(longest),
+                       (unsigned long long)r.sample_us,
+                       unsigned(r.offset_us[longest]));
+        }
+    }
+#endif
+    str.printf("\n],\"displayTimeUnit\":\"ms\"}\n");
+}
+
+#endif  // AP_SCHEDULER_LOOP_TRACE_ENABLED
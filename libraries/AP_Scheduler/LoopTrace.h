@@ -0,0 +1,101 @@
+#pragma once
+
+#include "AP_Scheduler_config.h"
+
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+
+#include <stdint.h>
+#include <AP_Common/AP_Common.h>
+#include <AP_Common/ExpandingString.h>
+
+namespace AP {
+
+/*
+  fast loop latency tracing
+
+  Records the time from the main loop's IMU sample (wait_for_sample()
+  returning) to each point along the rate control path, once per
+  loop. Points are marked by the libraries along that path and only
+  count when marked from the main thread. Latencies are collected
+  into per-point histograms which are logged at 1Hz, and on SITL and
+  Linux the most recent loops can be read from @SYS/loop_trace.json in
+  Chrome trace format for viewing in Perfetto.
+ */
+class LoopTrace {
+public:
+    LoopTrace() {}
+
+    /* Do not allow copies */
+    CLASS_NO_COPY(LoopTrace);
+
+    enum class Point : uint8_t {
+        INS_UPDATE,     // filtered IMU data published by AP_InertialSensor::update()
+        AHRS_UPDATE,    // AHRS and EKF updated
+        RATE_CONTROL,   // rate controller outputs set
+        MIXER,          // motor outputs mixed
+        RCOUT_PUSH,     // outputs pushed to the hardware
+        NUM_POINTS
+    };
+
+    // mark a point in the current loop, the first mark in each loop counts
+    void mark(Point point) {
+        if (enabled) {
+            _mark(point);
+        }
+    }
+
+    // only called from the main thread, between loops
+    void set_enabled(bool _enabled);
+    bool is_enabled() const { return enabled; }
+
+    // called by the scheduler around each loop, loop_end() also logs
+    // the histograms once a second
+    void loop_start(uint64_t sample_time_us, uint32_t loop_period_us);
+    void loop_end();
+
+    // recent loops in Chrome trace event format
+    void trace_json(ExpandingString &str) const;
+
+private:
+    static constexpr uint8_t num_points = uint8_t(Point::NUM_POINTS);
+    static constexpr uint8_t num_buckets = 48;
+    static constexpr uint16_t not_reached = UINT16_MAX;
+
+    void _mark(Point point);
+    void reset();
+    // log histogram summaries and start new histograms
+    void update_logging();
+    uint16_t percentile(uint8_t point, uint8_t pct) const;
+    static const char *point_name(uint8_t point);
+
+    bool enabled;
+
+    // current loop, only written by the main thread
+    uint64_t sample_us;
+    uint16_t offset_us[num_points];
+    bool in_loop;
+    uint64_t last_log_us;
+
+    // histograms since the last update_logging(), bucket width is a
+    // fraction of the loop period and the last bucket catches anything
+    // beyond 1.5 loop periods
+    uint16_t bucket_us = 25;
+    uint16_t histogram[num_points][num_buckets];
+    uint32_t sum_us[num_points];
+    uint16_t max_us[num_points];
+
+#if AP_SCHEDULER_LOOP_TRACE_DUMP_ENABLED
+    // recent loops, written by the main thread and read without a
+    // lock, so a dump can include one partly updated loop
+    static constexpr uint8_t num_recent = 128;
+    struct LoopRecord {
+        uint64_t sample_us;
+        uint16_t offset_us[num_points];
+    } recent[num_recent];
+    uint8_t recent_next;
+#endif
+};
+
+};
+
+#endif  // AP_SCHEDULER_LOOP_TRACE_ENABLED
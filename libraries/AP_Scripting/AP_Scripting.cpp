@@ -98,6 +98,7 @@ const AP_Param::GroupInfo AP_Scripting::var_info[] = {
     // @Bitmask: 4: Disable pre-arm check
     // @Bitmask: 5: Save CRC of current scripts to loaded and running checksum parameters enabling pre-arm
     // @Bitmask: 6: Disable heap expansion on allocation failure
+    // @Bitmask: 7: Disable the compiled script cache
     // @User: Advanced
     AP_GROUPINFO("DEBUG_OPTS", 4, AP_Scripting, _debug_options, 0),
 
@@ -165,6 +166,25 @@ const AP_Param::GroupInfo AP_Scripting::var_info[] = {
     // @User: Advanced
     AP_GROUPINFO("THD_PRIORITY", 14, AP_Scripting, _thd_priority, uint8_t(ThreadPriority::NORMAL)),
 
+#if AP_SCRIPTING_PROFILER_ENABLED
+    // @Param: PROFILE
+    // @DisplayName: Scripting profiler sample period
+    // @Description: Enables the script profiler, sampling the running script every this many VM instructions. Results are in @SYS/lua_profile.txt, and folded call stacks are written to profile.folded in the scripts directory. Takes effect when scripts are restarted. Profiling adds overhead to every script, so leave this at 0 in normal use.
+    // @Range: 0 10000
+    // @User: Advanced
+    AP_GROUPINFO("PROFILE", 19, AP_Scripting, _profile_period, 0),
+#endif
+
+#if AP_SCRIPTING_MAX_VMS > 1
+    // @Param: VMS
+    // @DisplayName: Scripting VMs
+    // @Description: Number of Lua VMs scripts are split across, each with its own heap of SCR_HEAP_SIZE and its own thread at SCR_THD_PRIORITY. The first VM runs the scripts in the scripts directory and ROMFS. Scripts in the vm1 subdirectory of the scripts directory run in the second VM, those in vm2 in the third and so on, so a slow script can't delay scripts in another VM and VMs can run on different CPU cores. Scripts in the subdirectory of a VM that isn't enabled run in the first VM. Each VM uses its own memory, so only increase this on boards with plenty to spare.
+    // @Range: 1 4
+    // @RebootRequired: True
+    // @User: Advanced
+    AP_GROUPINFO("VMS", 20, AP_Scripting, _num_vms, 1),
+#endif
+
 #if AP_SCRIPTING_SERIALDEVICE_ENABLED
     // @Param: SDEV_EN
     // @DisplayName: Scripting serial device enable
@@ -254,6 +274,19 @@ void AP_Scripting::init(void) {
         }
     }
 
+#if AP_SCRIPTING_MAX_VMS > 1
+    // the additional VMs wait for the main thread to start them
+    const uint8_t num_vms = constrain_int16(_num_vms, 1, AP_SCRIPTING_MAX_VMS);
+    for (uint8_t i=1; i<num_vms; i++) {
+        if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&AP_Scripting::vm_thread, void),
+                                          "Scripting VM", SCRIPTING_STACK_SIZE, priority, 0)) {
+            GCS_SEND_TEXT(MAV_SEVERITY_ERROR, "Scripting: VM %u failed to start", unsigned(i));
+            break;
+        }
+        _num_vms_running++;
+    }
+#endif
+
     if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&AP_Scripting::thread, void),
                                       "Scripting", SCRIPTING_STACK_SIZE, priority, 0)) {
         GCS_SEND_TEXT(MAV_SEVERITY_ERROR, "Scripting: %s", "failed to start");
@@ -310,7 +343,7 @@ void AP_Scripting::thread(void) {
         _restart = false;
         _init_failed = false;
 
-        lua_scripts *lua = NEW_NOTHROW lua_scripts(_script_vm_exec_count, _script_heap_size, _debug_options);
+        lua_scripts *lua = NEW_NOTHROW lua_scripts(_script_vm_exec_count, _script_heap_size, _debug_options, 0);
         if (lua == nullptr || !lua->heap_allocated()) {
             GCS_SEND_TEXT(MAV_SEVERITY_CRITICAL, "Scripting: %s", "Unable to allocate memory");
             _init_failed = true;
@@ -323,6 +356,13 @@ void AP_Scripting::thread(void) {
 #if AP_ARMING_ENABLED && AP_ARMING_AUX_AUTH_ENABLED
             // Clear any dangling pre-arms from previous script loads
             AP_Arming::get_singleton()->reset_all_aux_auths();
+#endif
+#if AP_SCRIPTING_MAX_VMS > 1
+            {
+                // start the other VMs
+                WITH_SEMAPHORE(_vm_sem);
+                _vm_generation++;
+            }
 #endif
             // run won't return while scripting is still active
             lua->run();
@@ -333,6 +373,16 @@ void AP_Scripting::thread(void) {
         delete lua;
         lua = nullptr;
 
+#if AP_SCRIPTING_MAX_VMS > 1
+        // if only VM 0 has failed the other VMs carry on until
+        // scripting is stopped
+        while (should_run() && vms_active()) {
+            hal.scheduler->delay(100);
+        }
+        // the other VMs may be using the devices freed below
+        stop_vms();
+#endif
+
         // clear allocated i2c devices
         for (uint8_t i=0; i<SCRIPTING_MAX_NUM_I2C_DEVICE; i++) {
             delete _i2c_dev[i];
@@ -400,6 +450,68 @@ void AP_Scripting::thread(void) {
 }
 #pragma GCC pop_options
 
+#if AP_SCRIPTING_MAX_VMS > 1
+void AP_Scripting::vm_thread(void)
+{
+    uint8_t vm;
+    {
+        WITH_SEMAPHORE(_vm_sem);
+        vm = ++_vm_threads_started;
+    }
+
+    uint32_t last_generation = 0;
+    while (true) {
+        bool start = false;
+        {
+            // count ourselves in while holding the semaphore, so
+            // stop_vms() can't miss a VM which is about to start
+            WITH_SEMAPHORE(_vm_sem);
+            if (_vm_generation != last_generation && should_run()) {
+                last_generation = _vm_generation;
+                _vms_active++;
+                start = true;
+            }
+        }
+        if (!start) {
+            hal.scheduler->delay(100);
+            continue;
+        }
+
+        lua_scripts *lua = NEW_NOTHROW lua_scripts(_script_vm_exec_count, _script_heap_size, _debug_options, vm);
+        if (lua == nullptr || !lua->heap_allocated()) {
+            GCS_SEND_TEXT(MAV_SEVERITY_CRITICAL, "Scripting: VM %u unable to allocate memory", unsigned(vm));
+        } else {
+            // returns when the main thread stops scripting
+            lua->run();
+        }
+        delete lua;
+
+        WITH_SEMAPHORE(_vm_sem);
+        _vms_active--;
+    }
+}
+
+bool AP_Scripting::vms_active(void)
+{
+    WITH_SEMAPHORE(_vm_sem);
+    return _vms_active > 0;
+}
+
+void AP_Scripting::stop_vms(void)
+{
+    _stop = true;
+    while (true) {
+        {
+            WITH_SEMAPHORE(_vm_sem);
+            if (_vms_active == 0) {
+                return;
+            }
+        }
+        hal.scheduler->delay(10);
+    }
+}
+#endif  // AP_SCRIPTING_MAX_VMS > 1
+
 void AP_Scripting::handle_mission_command(const AP_Mission::Mission_Command& cmd_in)
 {
 #if AP_MISSION_ENABLED
@@ -430,6 +542,13 @@ void AP_Scripting::handle_mission_command(const AP_Mission::Mission_Command& cmd
 #endif
 }
 
+#if AP_SCRIPTING_PROFILER_ENABLED
+void AP_Scripting::profile_info(ExpandingString &str)
+{
+    lua_scripts::profile_info(str);
+}
+#endif
+
 bool AP_Scripting::arming_checks(size_t buflen, char *buffer) const
 {
     if (!enabled() || option_is_set(DebugOption::DISABLE_PRE_ARM)) {
@@ -485,20 +604,21 @@ void AP_Scripting::restart_all()
 
 #if HAL_GCS_ENABLED
 void AP_Scripting::handle_message(const mavlink_message_t &msg, const mavlink_channel_t chan) {
-    if (mavlink_data.rx_buffer == nullptr) {
-        return;
-    }
-
     struct mavlink_msg data {msg, chan, AP_HAL::millis()};
 
-    WITH_SEMAPHORE(mavlink_data.sem);
-    for (uint16_t i = 0; i < mavlink_data.accept_msg_ids_size; i++) {
-        if (mavlink_data.accept_msg_ids[i] == UINT32_MAX) {
-            return;
+    for (auto &vm_data : mavlink_data) {
+        WITH_SEMAPHORE(vm_data.sem);
+        if (vm_data.rx_buffer == nullptr) {
+            continue;
         }
-        if (mavlink_data.accept_msg_ids[i] == msg.msgid) {
-            mavlink_data.rx_buffer->push(data);
-            return;
+        for (uint16_t i = 0; i < vm_data.accept_msg_ids_size; i++) {
+            if (vm_data.accept_msg_ids[i] == UINT32_MAX) {
+                break;
+            }
+            if (vm_data.accept_msg_ids[i] == msg.msgid) {
+                vm_data.rx_buffer->push(data);
+                break;
+            }
         }
     }
 }
@@ -45,6 +45,8 @@ class SocketAPM;
 #include "AP_Scripting_SerialDevice.h"
 #endif
 
+class ExpandingString;
+
 class AP_Scripting
 {
 public:
@@ -94,6 +96,17 @@ public:
     };
     uint16_t get_disabled_dir() { return uint16_t(_dir_disable.get());}
 
+#if AP_SCRIPTING_MAX_VMS > 1
+    uint8_t get_num_vms() const { return _num_vms_running; }
+#endif
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+    int16_t get_profile_period() const { return _profile_period.get(); }
+
+    // profiler summary for @SYS/lua_profile.txt
+    void profile_info(ExpandingString &str);
+#endif
+
     // the number of and storage for i2c devices
     uint8_t num_i2c_devices;
     AP_HAL::I2CDevice *_i2c_dev[SCRIPTING_MAX_NUM_I2C_DEVICE];
@@ -120,8 +133,10 @@ public:
     // PWMSource storage
     uint8_t num_pwm_source;
     AP_HAL::PWMSource *_pwm_source[SCRIPTING_MAX_NUM_PWM_SOURCE];
-    int get_current_env_ref() { return current_env_ref; }
-    void set_current_env_ref(int ref) { current_env_ref = ref; }
+
+    // protects the device and socket storage above, and the mission
+    // item buffer, which scripts in any VM may use
+    HAL_Semaphore resource_sem;
 
 #if AP_NETWORKING_ENABLED
     // SocketAPM storage
@@ -134,12 +149,13 @@ public:
         uint32_t timestamp_ms;
     };
 
+    // each VM has its own receive queue and message registrations
     struct mavlink {
         ObjectBuffer<struct mavlink_msg> *rx_buffer;
         uint32_t *accept_msg_ids;
         uint16_t accept_msg_ids_size;
         HAL_Semaphore sem;
-    } mavlink_data;
+    } mavlink_data[AP_SCRIPTING_MAX_VMS];
 
     struct command_block_list {
         uint16_t id;
@@ -160,12 +176,22 @@ public:
         DISABLE_PRE_ARM = 1U << 4,
         SAVE_CHECKSUM = 1U << 5,
         DISABLE_HEAP_EXPANSION = 1U << 6,
+        DISABLE_BYTECODE_CACHE = 1U << 7,
     };
 
 private:
 
     void thread(void); // main script execution thread
 
+#if AP_SCRIPTING_MAX_VMS > 1
+    // runs the scripts of one of the additional VMs
+    void vm_thread(void);
+    // true if any of the additional VMs is running scripts
+    bool vms_active(void);
+    // stop the additional VMs and wait for them to finish
+    void stop_vms(void);
+#endif
+
     // Check if DEBUG_OPTS bit has been set to save current checksum values to params
     void save_checksum();
 
@@ -192,6 +218,12 @@ private:
     AP_Int16 _dir_disable;
     AP_Int32 _required_loaded_checksum;
     AP_Int32 _required_running_checksum;
+#if AP_SCRIPTING_PROFILER_ENABLED
+    AP_Int16 _profile_period;
+#endif
+#if AP_SCRIPTING_MAX_VMS > 1
+    AP_Int8 _num_vms;
+#endif
 
     AP_Enum<ThreadPriority> _thd_priority;
 
@@ -208,8 +240,18 @@ private:
     bool _restart; // true if scripts should be restarted
     bool _stop; // true if scripts should be stopped
 
+#if AP_SCRIPTING_MAX_VMS > 1
+    // number of VMs with threads, fixed at boot
+    uint8_t _num_vms_running = 1;
+    // the additional VMs start a new run each time the generation
+    // changes, and count themselves in and out of vms_active
+    HAL_Semaphore _vm_sem;
+    uint8_t _vm_threads_started;
+    uint32_t _vm_generation;
+    uint8_t _vms_active;
+#endif
+
     static AP_Scripting *_singleton;
-    int current_env_ref;
 };
 
 namespace AP {
@@ -18,3 +18,29 @@
 #ifndef AP_SCRIPTING_SERIALDEVICE_ENABLED
 #define AP_SCRIPTING_SERIALDEVICE_ENABLED AP_SERIALMANAGER_REGISTER_ENABLED && (HAL_PROGRAM_SIZE_LIMIT_KB>1024)
 #endif
+
+// keep compiled scripts on the filesystem so they don't need parsing
+// on every boot
+#ifndef AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+#define AP_SCRIPTING_BYTECODE_CACHE_ENABLED AP_SCRIPTING_ENABLED
+#endif
+
+// sampling profiler for scripts, enabled at runtime with SCR_PROFILE
+#ifndef AP_SCRIPTING_PROFILER_ENABLED
+#define AP_SCRIPTING_PROFILER_ENABLED AP_SCRIPTING_ENABLED
+#endif
+
+// recycle the small blocks behind vectors, locations and the like
+#ifndef AP_SCRIPTING_BLOCK_POOL_ENABLED
+#define AP_SCRIPTING_BLOCK_POOL_ENABLED AP_SCRIPTING_ENABLED
+#endif
+
+// number of Lua VMs scripts can be split across, each with its own
+// heap and thread, see SCR_VMS
+#ifndef AP_SCRIPTING_MAX_VMS
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX || CONFIG_HAL_BOARD == HAL_BOARD_SITL
+#define AP_SCRIPTING_MAX_VMS 4
+#else
+#define AP_SCRIPTING_MAX_VMS 1
+#endif
+#endif
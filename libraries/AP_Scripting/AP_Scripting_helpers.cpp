@@ -305,6 +305,7 @@ DroneCAN_Handle::Subscriber::Subscriber(DroneCAN_Handle &_handle, CanardTransfer
     handle = &_handle;
     trans_type = _transfer_type;
     link();
+    _handle.dc->get_canard_iface().subscriptions_changed();
 }
 
 DroneCAN_Handle::Subscriber::~Subscriber(void)
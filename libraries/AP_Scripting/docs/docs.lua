@@ -833,6 +833,26 @@ local Vector2f_ud = {}
 ---@return Vector2f_ud
 function Vector2f() end
 
+-- Set this Vector2f to the value of another, without creating a new userdata object
+---@param value Vector2f_ud
+---@return Vector2f_ud -- this Vector2f
+function Vector2f_ud:set(value) end
+
+-- Add another Vector2f to this one in place
+---@param value Vector2f_ud
+---@return Vector2f_ud -- this Vector2f
+function Vector2f_ud:add(value) end
+
+-- Subtract another Vector2f from this one in place
+---@param value Vector2f_ud
+---@return Vector2f_ud -- this Vector2f
+function Vector2f_ud:sub(value) end
+
+-- Multiply this Vector2f by a scalar in place
+---@param value number
+---@return Vector2f_ud -- this Vector2f
+function Vector2f_ud:mul(value) end
+
 -- Copy this Vector2f returning a new userdata object
 ---@return Vector2f_ud -- a copy of this Vector2f
 function Vector2f_ud:copy() end
@@ -893,6 +913,26 @@ local Vector3f_ud = {}
 ---@return Vector3f_ud
 function Vector3f() end
 
+-- Set this Vector3f to the value of another, without creating a new userdata object
+---@param value Vector3f_ud
+---@return Vector3f_ud -- this Vector3f
+function Vector3f_ud:set(value) end
+
+-- Add another Vector3f to this one in place
+---@param value Vector3f_ud
+---@return Vector3f_ud -- this Vector3f
+function Vector3f_ud:add(value) end
+
+-- Subtract another Vector3f from this one in place
+---@param value Vector3f_ud
+---@return Vector3f_ud -- this Vector3f
+function Vector3f_ud:sub(value) end
+
+-- Multiply this Vector3f by a scalar in place
+---@param value number
+---@return Vector3f_ud -- this Vector3f
+function Vector3f_ud:mul(value) end
+
 -- Copy this Vector3f returning a new userdata object
 ---@return Vector3f_ud -- a copy of this Vector3f
 function Vector3f_ud:copy() end
@@ -1012,6 +1052,16 @@ function Quaternion_ud:q1(value) end
 ---@param vec Vector3f_ud
 function Quaternion_ud:earth_to_body(vec) end
 
+-- Set this quaternion to the value of another, without creating a new userdata object
+---@param value Quaternion_ud
+---@return Quaternion_ud -- this quaternion
+function Quaternion_ud:set(value) end
+
+-- Multiply this quaternion by another in place
+---@param value Quaternion_ud
+---@return Quaternion_ud -- this quaternion
+function Quaternion_ud:mul(value) end
+
 -- Returns inverse of quaternion
 ---@return Quaternion_ud
 function Quaternion_ud:inverse() end
@@ -1065,6 +1115,11 @@ local Location_ud = {}
 ---@return Location_ud
 function Location() end
 
+-- Set this location to the value of another, without creating a new userdata object
+---@param value Location_ud
+---@return Location_ud -- this location
+function Location_ud:set(value) end
+
 -- Copy this location returning a new userdata object
 ---@return Location_ud -- a copy of this location
 function Location_ud:copy() end
@@ -3921,6 +3976,11 @@ scripting = {}
 -- desc
 function scripting:restart_all() end
 
+-- Small block allocations by this script's VM that were served from the block pools and from the heap, as running totals
+---@return uint32_t_ud -- hits
+---@return uint32_t_ud -- misses
+function scripting:pool_stats() end
+
 -- desc
 ---@param directoryname string
 ---@return table|nil -- table of filenames
@@ -3937,7 +3997,7 @@ function remove(filename) end
 -- MAVLink message interface can send and receive binary messages
 mavlink = {}
 
--- Initializes scripting MAVLink bufffer, check for items in the buffer with `receive_chan`
+-- Initializes scripting MAVLink bufffer, check for items in the buffer with `receive_chan`. Each VM has its own buffer and registrations
 ---@param msg_queue_length uint32_t_ud|integer|number -- Larger que allows script to deal with bursts of incomming messages or check for received messages less often
 ---@param num_rx_msgid uint32_t_ud|integer|number -- Number of unique messages to be received, register ids with `register_rx_msgid`
 function mavlink:init(msg_queue_length, num_rx_msgid) end
@@ -33,6 +33,7 @@ char keyword_creation[]            = "creation";
 char keyword_manual_operator[]     = "manual_operator";
 char keyword_operator_getter[]     = "operator_getter";
 char keyword_field_valid_mask[]    = "valid_mask";
+char keyword_inplace[]             = "inplace";
 
 
 // attributes (should include the leading ' )
@@ -372,6 +373,16 @@ struct method {
   char *dependency;
 };
 
+// a method that applies an operator to the object itself, so scripts
+// can do math on existing objects without creating new userdata
+struct inplace_op {
+  struct inplace_op * next;
+  char *name;     // lua name of the method
+  char *symbol;   // C++ operator, = for assignment
+  struct type operand;
+  int line; // line declared on
+};
+
 enum alias_type {
   ALIAS_TYPE_NONE,
   ALIAS_TYPE_MANUAL,
@@ -428,6 +439,7 @@ struct userdata {
   char *creation; // name of a manual creation function if set, note that this will not be used internally
   int creation_args; // number of args for custom creation function
   char *operator_getter; // Custom function to get values for use in operators
+  struct inplace_op *inplace_ops;
 };
 
 static struct userdata *parsed_userdata;
@@ -994,6 +1006,63 @@ void handle_operator(struct userdata *data) {
   }
 }
 
+void handle_inplace(struct userdata *data) {
+  trace(TRACE_USERDATA, "Adding an inplace operator");
+
+  if (data->ud_type != UD_USERDATA) {
+    error(ERROR_USERDATA, "Inplace operators are only allowed on userdata objects");
+  }
+
+  char *symbol = next_token();
+  if (symbol == NULL) {
+    error(ERROR_USERDATA, "Needed a symbol for the inplace operator");
+  }
+  if (strcmp(symbol, "=") && strcmp(symbol, "+") && strcmp(symbol, "-") &&
+      strcmp(symbol, "*") && strcmp(symbol, "/")) {
+    error(ERROR_USERDATA, "Unknown inplace operation type: %s", symbol);
+  }
+
+  char *name = next_token();
+  if (name == NULL) {
+    error(ERROR_USERDATA, "Needed a name for the inplace %s operator", symbol);
+  }
+
+  struct method *method = data->methods;
+  while (method != NULL && strcmp(method->name, name)) {
+    method = method->next;
+  }
+  struct inplace_op *existing = data->inplace_ops;
+  while (existing != NULL && strcmp(existing->name, name)) {
+    existing = existing->next;
+  }
+  if (method != NULL || existing != NULL) {
+    error(ERROR_USERDATA, "Method %s already exists for %s", name, data->name);
+  }
+
+  struct inplace_op *op = allocate(sizeof(struct inplace_op));
+  string_copy(&(op->name), name);
+  string_copy(&(op->symbol), symbol);
+  op->line = state.line_num;
+
+  // the operand defaults to the same type
+  if (!parse_type(&(op->operand), TYPE_RESTRICTION_OPTIONAL | TYPE_RESTRICTION_NOT_NULLABLE, RANGE_CHECK_MANDATORY)) {
+    op->operand.type = TYPE_USERDATA;
+    op->operand.data.ud.name = data->name;
+    op->operand.data.ud.sanatized_name = data->sanatized_name;
+  }
+  if ((op->operand.type == TYPE_NONE) || (op->operand.type == TYPE_LITERAL) ||
+      (op->operand.flags & TYPE_FLAGS_REFERENCE)) {
+    error(ERROR_USERDATA, "Invalid operand for inplace operator %s on %s", name, data->name);
+  }
+
+  if (next_token() != NULL) {
+    error(ERROR_USERDATA, "Extra token on inplace operator %s", name);
+  }
+
+  op->next = data->inplace_ops;
+  data->inplace_ops = op;
+}
+
 void handle_userdata(void) {
   trace(TRACE_USERDATA, "Adding a userdata");
 
@@ -1030,6 +1099,8 @@ void handle_userdata(void) {
     handle_userdata_field(node);
   } else if (strcmp(type, keyword_operator) == 0) {
     handle_operator(node);
+  } else if (strcmp(type, keyword_inplace) == 0) {
+    handle_inplace(node);
   } else if (strcmp(type, keyword_method) == 0) {
     handle_method(node);
   } else if (strcmp(type, keyword_enum) == 0) {
@@ -2424,6 +2495,32 @@ void emit_operators(struct userdata *data) {
   end_dependency(source, data->dependency);
 }
 
+void emit_inplace_ops(struct userdata *data) {
+  trace(TRACE_USERDATA, "Emitting inplace operators for %s", data->name);
+
+  start_dependency(source, data->dependency);
+
+  struct inplace_op *op = data->inplace_ops;
+  while (op != NULL) {
+    fprintf(source, "static int %s_%s(lua_State *L) {\n", data->sanatized_name, op->name);
+    fprintf(source, "    binding_argcheck(L, 2);\n");
+    fprintf(source, "    %s * ud = check_%s(L, 1);\n", data->name, data->sanatized_name);
+    emit_checker(op->operand, 2, 0, "    ");
+    if (strcmp(op->symbol, "=") == 0) {
+      fprintf(source, "    *ud = data_2;\n");
+    } else {
+      fprintf(source, "    *ud = *ud %s data_2;\n", op->symbol);
+    }
+    // return the object itself so calls can be chained
+    fprintf(source, "    lua_settop(L, 1);\n");
+    fprintf(source, "    return 1;\n");
+    fprintf(source, "}\n\n");
+    op = op->next;
+  }
+
+  end_dependency(source, data->dependency);
+}
+
 void emit_methods(struct userdata *node) {
   while(node) {
     // methods
@@ -2437,6 +2534,9 @@ void emit_methods(struct userdata *node) {
     if (node->operations) {
       emit_operators(node);
     }
+    if (node->inplace_ops) {
+      emit_inplace_ops(node);
+    }
     node = node->next;
   }
 }
@@ -2473,6 +2573,12 @@ void emit_index(struct userdata *head) {
       field = field->next;
     }
 
+    struct inplace_op *op = node->inplace_ops;
+    while(op) {
+      fprintf(source, "    {\"%s\", %s_%s},\n", op->name, node->sanatized_name, op->name);
+      op = op->next;
+    }
+
     struct method_alias *alias = node->method_aliases;
     while(alias) {
       start_dependency(source, alias->dependency);
@@ -2991,6 +3097,16 @@ void emit_docs(struct userdata *node, int is_userdata, int emit_creation) {
       method = method->next;
     }
 
+    // inplace operators, which return the object itself
+    struct inplace_op *op = node->inplace_ops;
+    while(op) {
+      fprintf(docs, "-- desc\n");
+      emit_docs_param_type(op->operand, "---@param param1", "\n");
+      fprintf(docs, "---@return %s\n", name);
+      fprintf(docs, "function %s:%s(param1) end\n\n", name, op->name);
+      op = op->next;
+    }
+
     // aliases
     struct method_alias *alias = node->method_aliases;
     while(alias) {
@@ -772,13 +772,28 @@ static void checkmode (lua_State *L, const char *mode, const char *x) {
 }
 
 
+/*
+** ArduPilot: mode for lua_load that accepts a binary chunk even when
+** LUA_SUPPORT_LOAD_BINARY is off. It is compared by address, so an
+** equal string from a script doesn't match
+*/
+LUA_API const char *lua_binarymode (void) {
+  static const char mode[] = "b";
+  return mode;
+}
+
+
 static void f_parser (lua_State *L, void *ud) {
   LClosure *cl;
   struct SParser *p = cast(struct SParser *, ud);
   int c = zgetc(p->z);  /* read first character */
-#if LUA_SUPPORT_LOAD_BINARY
+#if LUA_SUPPORT_LOAD_BINARY || LUA_SUPPORT_LOAD_BINARY_TRUSTED
   // support loading pre-compiled luac
   if (c == LUA_SIGNATURE[0]) {
+#if !LUA_SUPPORT_LOAD_BINARY
+    if (p->mode != lua_binarymode())
+      checkmode(L, "t", "binary");
+#endif
     checkmode(L, p->mode, "binary");
     cl = luaU_undump(L, p->z, p->name);
   }
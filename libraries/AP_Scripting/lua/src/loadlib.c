@@ -622,7 +622,7 @@ static void findloader (lua_State *L, const char *name) {
 static int ll_require (lua_State *L) {
   const char *name = luaL_checkstring(L, 1);
   lua_settop(L, 1);
-  lua_rawgeti(L, LUA_REGISTRYINDEX, lua_get_current_env_ref()); /* get the environment of the current script */
+  lua_rawgeti(L, LUA_REGISTRYINDEX, lua_get_current_env_ref(L)); /* get the environment of the current script */
   lua_getfield(L, 2, LUA_LOADED_TABLE); /* get _LOADED */
   lua_getfield(L, 3, name);  /* LOADED[name] */
   if (lua_toboolean(L, -1))  /* is it there? */
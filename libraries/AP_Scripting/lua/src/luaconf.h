@@ -17,6 +17,15 @@
 #ifndef LUA_SUPPORT_LOAD_BINARY
 #define LUA_SUPPORT_LOAD_BINARY 0
 #endif
+
+/*
+  allow binary chunks loaded with the mode from lua_binarymode(),
+  which only the script bytecode cache uses. Scripts can't get that
+  pointer so load() and require() still only take source
+ */
+#ifndef LUA_SUPPORT_LOAD_BINARY_TRUSTED
+#define LUA_SUPPORT_LOAD_BINARY_TRUSTED 1
+#endif
 #include <AP_Scripting/lua_common_defs.h>
 
 /*
@@ -13,6 +13,7 @@
 #include <AP_GPS/AP_GPS.h>
 
 #include "lua_bindings.h"
+#include "lua_scripts.h"
 
 #include "lua_boxed_numerics.h"
 #include <AP_Scripting/lua_generated_bindings.h>
@@ -61,13 +62,18 @@ int lua_mavlink_init(lua_State *L) {
     // get number of msgs to accept
     const uint32_t num_msgs = get_uint32(L, 2+arg_offset, 0, 25);
 
-    struct AP_Scripting::mavlink &data = AP::scripting()->mavlink_data;
+    struct AP_Scripting::mavlink &data = AP::scripting()->mavlink_data[lua_scripts::vm_index(L)];
     bool failed = false;
     {
         WITH_SEMAPHORE(data.sem);
         if (data.rx_buffer == nullptr) {
             data.rx_buffer = NEW_NOTHROW ObjectBuffer<struct AP_Scripting::mavlink_msg>(queue_size);
         }
+        if (data.accept_msg_ids != nullptr && data.accept_msg_ids_size < num_msgs) {
+            // a restarted script wants more registrations
+            delete[] data.accept_msg_ids;
+            data.accept_msg_ids = nullptr;
+        }
         if (data.accept_msg_ids == nullptr) {
             data.accept_msg_ids = NEW_NOTHROW uint32_t[num_msgs];
         }
@@ -98,14 +104,21 @@ int lua_mavlink_receive_chan(lua_State *L) {
 
     binding_argcheck(L, arg_offset);
 
+    struct AP_Scripting::mavlink &data = AP::scripting()->mavlink_data[lua_scripts::vm_index(L)];
     struct AP_Scripting::mavlink_msg msg;
-    ObjectBuffer<struct AP_Scripting::mavlink_msg> *rx_buffer = AP::scripting()->mavlink_data.rx_buffer;
+    bool initialised;
+    bool have_msg;
+    {
+        WITH_SEMAPHORE(data.sem);
+        initialised = data.rx_buffer != nullptr;
+        have_msg = initialised && data.rx_buffer->pop(msg);
+    }
 
-    if (rx_buffer == nullptr) {
+    if (!initialised) {
         return luaL_error(L, "RX not initialized");
     }
 
-    if (rx_buffer->pop(msg)) {
+    if (have_msg) {
         lua_pushlstring(L, (char *)&msg.msg, sizeof(msg.msg));
         lua_pushinteger(L, msg.chan);
         *new_uint32_t(L) = msg.timestamp_ms;
@@ -125,33 +138,35 @@ int lua_mavlink_register_rx_msgid(lua_State *L) {
 
     const uint32_t msgid = get_uint32(L, 1+arg_offset, 0, (1 << 24) - 1);
 
-    struct AP_Scripting::mavlink &data = AP::scripting()->mavlink_data;
+    struct AP_Scripting::mavlink &data = AP::scripting()->mavlink_data[lua_scripts::vm_index(L)];
 
-    // check that we aren't currently watching this ID
-    for (uint8_t i = 0; i < data.accept_msg_ids_size; i++) {
-        if (data.accept_msg_ids[i] == msgid) {
-            lua_pushboolean(L, false);
-            return 1;
-        }
-    }
+    bool registered = false;
+    bool full = false;
+    {
+        WITH_SEMAPHORE(data.sem);
 
-    int i = 0;
-    for (i = 0; i < data.accept_msg_ids_size; i++) {
-        if (data.accept_msg_ids[i] == UINT32_MAX) {
-            break;
+        // check that we aren't currently watching this ID
+        uint16_t i;
+        for (i = 0; i < data.accept_msg_ids_size; i++) {
+            if (data.accept_msg_ids[i] == msgid) {
+                break;
+            }
+            if (data.accept_msg_ids[i] == UINT32_MAX) {
+                // registrations are filled in order, so this is the
+                // first free one
+                data.accept_msg_ids[i] = msgid;
+                registered = true;
+                break;
+            }
         }
-    }
+        full = (i >= data.accept_msg_ids_size);
+    } // release semaphore here as luaL_error will NOT do that!
 
-    if (i >= data.accept_msg_ids_size) {
+    if (full) {
         return luaL_error(L, "no registrations free");
     }
 
-    {
-        WITH_SEMAPHORE(data.sem);
-        data.accept_msg_ids[i] = msgid;
-    }
-
-    lua_pushboolean(L, true);
+    lua_pushboolean(L, registered);
     return 1;
 }
 
@@ -241,9 +256,12 @@ int lua_mission_receive(lua_State *L) {
 
     struct AP_Scripting::scripting_mission_cmd cmd;
 
-    if (!input->pop(cmd)) {
-        // no new item
-        return 0;
+    {
+        WITH_SEMAPHORE(AP::scripting()->resource_sem);
+        if (!input->pop(cmd)) {
+            // no new item
+            return 0;
+        }
     }
 
     *new_uint32_t(L) = cmd.time_ms;
@@ -596,19 +614,28 @@ int lua_get_i2c_device(lua_State *L) {
     auto *scripting = AP::scripting();
 
     static_assert(SCRIPTING_MAX_NUM_I2C_DEVICE >= 0, "There cannot be a negative number of I2C devices");
-    if (scripting->num_i2c_devices >= SCRIPTING_MAX_NUM_I2C_DEVICE) {
-        return luaL_argerror(L, 1, "no i2c devices available");
+    AP_HAL::I2CDevice *dev = nullptr;
+    const char *error = nullptr;
+    {
+        // scripts in other VMs may be claiming devices, and the error
+        // must be raised after the semaphore is released
+        WITH_SEMAPHORE(scripting->resource_sem);
+        if (scripting->num_i2c_devices >= SCRIPTING_MAX_NUM_I2C_DEVICE) {
+            error = "no i2c devices available";
+        } else {
+            dev = hal.i2c_mgr->get_device_ptr(bus, address, bus_clock, use_smbus);
+            if (dev == nullptr) {
+                error = "i2c device nullptr";
+            } else {
+                scripting->_i2c_dev[scripting->num_i2c_devices++] = dev;
+            }
+        }
     }
-
-    scripting->_i2c_dev[scripting->num_i2c_devices] = hal.i2c_mgr->get_device_ptr(bus, address, bus_clock, use_smbus);
-
-    if (scripting->_i2c_dev[scripting->num_i2c_devices] == nullptr) {
-        return luaL_argerror(L, 1, "i2c device nullptr");
+    if (error != nullptr) {
+        return luaL_argerror(L, 1, error);
     }
 
-    *new_AP_HAL__I2CDevice(L) = scripting->_i2c_dev[scripting->num_i2c_devices];
-
-    scripting->num_i2c_devices++;
+    *new_AP_HAL__I2CDevice(L) = dev;
 
     return 1;
 }
@@ -695,12 +722,15 @@ int lua_get_CAN_device(lua_State *L) {
 
     auto *scripting = AP::scripting();
 
-    if (scripting->_CAN_dev == nullptr) {
-        scripting->_CAN_dev = NEW_NOTHROW ScriptingCANSensor(AP_CAN::Protocol::Scripting);
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
         if (scripting->_CAN_dev == nullptr) {
-            return luaL_argerror(L, 1, "CAN device nullptr");
+            scripting->_CAN_dev = NEW_NOTHROW ScriptingCANSensor(AP_CAN::Protocol::Scripting);
         }
     }
+    if (scripting->_CAN_dev == nullptr) {
+        return luaL_argerror(L, 1, "CAN device nullptr");
+    }
 
     if (!scripting->_CAN_dev->initialized()) {
         // Driver not initialized, probably because there is no can driver set to scripting
@@ -725,12 +755,15 @@ int lua_get_CAN_device2(lua_State *L) {
 
     auto *scripting = AP::scripting();
 
-    if (scripting->_CAN_dev2 == nullptr) {
-        scripting->_CAN_dev2 = NEW_NOTHROW ScriptingCANSensor(AP_CAN::Protocol::Scripting2);
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
         if (scripting->_CAN_dev2 == nullptr) {
-            return luaL_argerror(L, 1, "CAN device nullptr");
+            scripting->_CAN_dev2 = NEW_NOTHROW ScriptingCANSensor(AP_CAN::Protocol::Scripting2);
         }
     }
+    if (scripting->_CAN_dev2 == nullptr) {
+        return luaL_argerror(L, 1, "CAN device nullptr");
+    }
 
     if (!scripting->_CAN_dev2->initialized()) {
         // Driver not initialized, probably because there is no can driver set to scripting 2
@@ -901,18 +934,26 @@ int lua_get_PWMSource(lua_State *L) {
     auto *scripting = AP::scripting();
 
     static_assert(SCRIPTING_MAX_NUM_PWM_SOURCE >= 0, "There cannot be a negative number of PWMSources");
-    if (scripting->num_pwm_source >= SCRIPTING_MAX_NUM_PWM_SOURCE) {
-        return luaL_argerror(L, 1, "no PWMSources available");
+    AP_HAL::PWMSource *source = nullptr;
+    const char *error = nullptr;
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
+        if (scripting->num_pwm_source >= SCRIPTING_MAX_NUM_PWM_SOURCE) {
+            error = "no PWMSources available";
+        } else {
+            source = NEW_NOTHROW AP_HAL::PWMSource;
+            if (source == nullptr) {
+                error = "PWMSources device nullptr";
+            } else {
+                scripting->_pwm_source[scripting->num_pwm_source++] = source;
+            }
+        }
     }
-
-    scripting->_pwm_source[scripting->num_pwm_source] = NEW_NOTHROW AP_HAL::PWMSource;
-    if (scripting->_pwm_source[scripting->num_pwm_source] == nullptr) {
-        return luaL_argerror(L, 1, "PWMSources device nullptr");
+    if (error != nullptr) {
+        return luaL_argerror(L, 1, error);
     }
 
-    *new_AP_HAL__PWMSource(L) = scripting->_pwm_source[scripting->num_pwm_source];
-
-    scripting->num_pwm_source++;
+    *new_AP_HAL__PWMSource(L) = source;
 
     return 1;
 }
@@ -930,14 +971,23 @@ int lua_get_SocketAPM(lua_State *L) {
     if (sock == nullptr) {
         return luaL_argerror(L, 1, "SocketAPM device nullptr");
     }
-    for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
-        if (scripting->_net_sockets[i] == nullptr) {
-            scripting->_net_sockets[i] = sock;
-            *new_SocketAPM(L) = scripting->_net_sockets[i];
-            return 1;
+    bool stored = false;
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
+        for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
+            if (scripting->_net_sockets[i] == nullptr) {
+                scripting->_net_sockets[i] = sock;
+                stored = true;
+                break;
+            }
         }
     }
+    if (stored) {
+        *new_SocketAPM(L) = sock;
+        return 1;
+    }
 
+    delete sock;
     return luaL_argerror(L, 1, "no sockets available");
 }
 
@@ -952,15 +1002,22 @@ int SocketAPM_close(lua_State *L) {
     auto *scripting = AP::scripting();
 
     // clear allocated socket
-    for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
-        if (scripting->_net_sockets[i] == ud) {
-            ud->close();
-            delete ud;
-            scripting->_net_sockets[i] = nullptr;
-            *check_SocketAPM(L, 1) = nullptr;
-            break;
+    bool found = false;
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
+        for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
+            if (scripting->_net_sockets[i] == ud) {
+                scripting->_net_sockets[i] = nullptr;
+                found = true;
+                break;
+            }
         }
     }
+    if (found) {
+        ud->close();
+        delete ud;
+        *check_SocketAPM(L, 1) = nullptr;
+    }
 
     return 0;
 }
@@ -1038,19 +1095,23 @@ int SocketAPM_accept(lua_State *L) {
     auto *scripting = AP::scripting();
 
     // find an empty slot
-    for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
-        if (scripting->_net_sockets[i] == nullptr) {
-            scripting->_net_sockets[i] = ud->accept(0);
+    SocketAPM *sock = nullptr;
+    {
+        WITH_SEMAPHORE(scripting->resource_sem);
+        for (uint8_t i=0; i<SCRIPTING_MAX_NUM_NET_SOCKET; i++) {
             if (scripting->_net_sockets[i] == nullptr) {
-                return 0;
+                sock = ud->accept(0);
+                scripting->_net_sockets[i] = sock;
+                break;
             }
-            *new_SocketAPM(L) = scripting->_net_sockets[i];
-            return 1;
         }
     }
-
-    // out of socket slots, return nil, caller can retry
-    return 0;
+    if (sock == nullptr) {
+        // nothing to accept or out of socket slots, return nil, caller can retry
+        return 0;
+    }
+    *new_SocketAPM(L) = sock;
+    return 1;
 }
 
 /*
@@ -1081,10 +1142,9 @@ int SocketAPM_string_to_ipv4_addr(lua_State *L) {
 #endif // AP_NETWORKING_ENABLED
 
 
-int lua_get_current_env_ref()
+int lua_get_current_env_ref(lua_State *L)
 {
-    auto *scripting = AP::scripting();
-    return scripting->get_current_env_ref();
+    return lua_scripts::current_env_ref(L);
 }
 
 // This is used when loading modules with require, lua must only look in enabled directory's
@@ -1290,4 +1350,19 @@ int lua_gps_inject_data(lua_State *L)
 
 #endif  // AP_GPS_ENABLED
 
+#if AP_SCRIPTING_BLOCK_POOL_ENABLED
+int lua_scripting_pool_stats(lua_State *L)
+{
+    binding_argcheck(L, 1);
+    luaL_checkudata(L, 1, "scripting");
+
+    uint32_t hits, misses;
+    lua_scripts::pool_stats(L, hits, misses);
+    *new_uint32_t(L) = hits;
+    *new_uint32_t(L) = misses;
+
+    return 2;
+}
+#endif  // AP_SCRIPTING_BLOCK_POOL_ENABLED
+
 #endif  // AP_SCRIPTING_ENABLED
@@ -0,0 +1,300 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  sampling profiler for scripts
+ */
+
+#include "lua_profiler.h"
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Common/ExpandingString.h>
+
+extern const AP_HAL::HAL& hal;
+
+// number of hot spots listed for each script
+#define PROFILER_TOP_LINES 10
+
+void lua_profiler::Totals::add(const Totals &t)
+{
+    samples += t.samples;
+    time_us += t.time_us;
+    alloc_bytes += t.alloc_bytes;
+    allocs += t.allocs;
+}
+
+void lua_profiler::reset(uint16_t period)
+{
+    WITH_SEMAPHORE(_sem);
+    _period = period;
+    _script = no_index;
+    _num_scripts = 0;
+    _num_frames = 0;
+    _num_lines = 0;
+    _num_stacks = 0;
+    _pending_alloc_bytes = 0;
+    _pending_allocs = 0;
+}
+
+void lua_profiler::begin(const char *script_name)
+{
+    WITH_SEMAPHORE(_sem);
+
+    const char *name = strrchr(script_name, '/');
+    name = (name == nullptr) ? script_name : name + 1;
+
+    _script = no_index;
+    for (uint8_t i=0; i<_num_scripts; i++) {
+        if (strncmp(_scripts[i].name, name, sizeof(_scripts[i].name)-1) == 0) {
+            _script = i;
+            break;
+        }
+    }
+    if (_script == no_index && _num_scripts < max_scripts) {
+        _script = _num_scripts++;
+        Script &s = _scripts[_script];
+        memset(&s, 0, sizeof(s));
+        strncpy_noterm(s.name, name, sizeof(s.name)-1);
+    }
+
+    _run_start_us = AP_HAL::micros();
+    _last_sample_us = _run_start_us;
+    _pending_alloc_bytes = 0;
+    _pending_allocs = 0;
+}
+
+void lua_profiler::end()
+{
+    WITH_SEMAPHORE(_sem);
+    if (_script == no_index) {
+        return;
+    }
+    const uint32_t now_us = AP_HAL::micros();
+    Script &s = _scripts[_script];
+    // whatever ran after the last sample counts for the script only
+    Totals rest = take_pending(now_us);
+    s.totals.time_us += rest.time_us;
+    s.totals.alloc_bytes += rest.alloc_bytes;
+    s.totals.allocs += rest.allocs;
+    s.runs++;
+    s.run_time_us += now_us - _run_start_us;
+    _script = no_index;
+}
+
+lua_profiler::Totals lua_profiler::take_pending(uint32_t now_us)
+{
+    Totals t {};
+    t.time_us = now_us - _last_sample_us;
+    t.alloc_bytes = _pending_alloc_bytes;
+    t.allocs = _pending_allocs;
+    _last_sample_us = now_us;
+    _pending_alloc_bytes = 0;
+    _pending_allocs = 0;
+    return t;
+}
+
+/*
+  find or add the frame for the function described by ar
+ */
+uint8_t lua_profiler::find_frame(lua_State *L, lua_Debug &ar)
+{
+    if (lua_getinfo(L, "Sn", &ar) == 0) {
+        return no_index;
+    }
+    const char *src = strrchr(ar.short_src, '/');
+    src = (src == nullptr) ? ar.short_src : src + 1;
+    const char *fname = ar.name;
+    if (fname == nullptr) {
+        fname = (strcmp(ar.what, "main") == 0) ? "main" : "?";
+    }
+
+    char name[sizeof(Frame::name)];
+    hal.util->snprintf(name, sizeof(name), "%s@%s:%d", fname, src, int(ar.linedefined));
+    const uint32_t hash = crc_crc32(0, (const uint8_t *)name, strlen(name));
+
+    for (uint8_t i=0; i<_num_frames; i++) {
+        if (_frames[i].hash == hash) {
+            return i;
+        }
+    }
+    if (_num_frames >= max_frames) {
+        return no_index;
+    }
+    Frame &f = _frames[_num_frames];
+    f.hash = hash;
+    memcpy(f.name, name, sizeof(f.name));
+    return _num_frames++;
+}
+
+uint8_t lua_profiler::find_line(uint8_t frame, uint16_t line)
+{
+    for (uint8_t i=0; i<_num_lines; i++) {
+        const Line &l = _lines[i];
+        if (l.script == _script && l.frame == frame && l.line == line) {
+            return i;
+        }
+    }
+    if (_num_lines >= max_lines) {
+        return no_index;
+    }
+    Line &l = _lines[_num_lines];
+    memset(&l, 0, sizeof(l));
+    l.script = _script;
+    l.frame = frame;
+    l.line = line;
+    return _num_lines++;
+}
+
+uint8_t lua_profiler::find_stack(const uint8_t *frames, uint8_t depth)
+{
+    const uint32_t hash = crc_crc32(_script, frames, depth);
+    for (uint8_t i=0; i<_num_stacks; i++) {
+        const Stack &s = _stacks[i];
+        if (s.hash == hash && s.script == _script && s.depth == depth &&
+            memcmp(s.frames, frames, depth) == 0) {
+            return i;
+        }
+    }
+    if (_num_stacks >= max_stacks) {
+        return no_index;
+    }
+    Stack &s = _stacks[_num_stacks];
+    s.hash = hash;
+    s.script = _script;
+    s.depth = depth;
+    memcpy(s.frames, frames, depth);
+    s.samples = 0;
+    return _num_stacks++;
+}
+
+/*
+  record the stack of the running script, innermost frame first
+ */
+void lua_profiler::sample(lua_State *L)
+{
+    WITH_SEMAPHORE(_sem);
+    if (_script == no_index) {
+        return;
+    }
+    Totals t = take_pending(AP_HAL::micros());
+    t.samples = 1;
+    Script &s = _scripts[_script];
+    s.totals.add(t);
+
+    uint8_t frames[max_depth];
+    uint8_t depth = 0;
+    int current_line = -1;
+    lua_Debug ar;
+    while (depth < max_depth && lua_getstack(L, depth, &ar)) {
+        if (depth == 0) {
+            lua_getinfo(L, "l", &ar);
+            current_line = ar.currentline;
+        }
+        const uint8_t frame = find_frame(L, ar);
+        if (frame == no_index) {
+            s.dropped++;
+            return;
+        }
+        frames[depth++] = frame;
+    }
+    if (depth == 0) {
+        return;
+    }
+
+    const uint8_t line = find_line(frames[0], current_line < 0 ? 0 : current_line);
+    if (line == no_index) {
+        s.dropped++;
+    } else {
+        _lines[line].totals.add(t);
+    }
+
+    const uint8_t stack = find_stack(frames, depth);
+    if (stack == no_index) {
+        s.dropped++;
+    } else {
+        _stacks[stack].samples++;
+    }
+}
+
+void lua_profiler::info(ExpandingString &str)
+{
+    WITH_SEMAPHORE(_sem);
+    str.printf("period=%u instructions\n", unsigned(_period));
+    for (uint8_t i=0; i<_num_scripts; i++) {
+        const Script &s = _scripts[i];
+        str.printf("%s runs=%u time=%uus instructions=%u alloc=%uB/%u dropped=%u\n",
+                   s.name,
+                   unsigned(s.runs),
+                   unsigned(s.run_time_us),
+                   unsigned(s.totals.samples * _period),
+                   unsigned(s.totals.alloc_bytes),
+                   unsigned(s.totals.allocs),
+                   unsigned(s.dropped));
+
+        // list the lines with the most samples, largest first
+        uint32_t below = UINT32_MAX;
+        uint8_t below_idx = no_index;
+        for (uint8_t n=0; n<PROFILER_TOP_LINES; n++) {
+            uint8_t best = no_index;
+            for (uint8_t j=0; j<_num_lines; j++) {
+                const Line &l = _lines[j];
+                if (l.script != i) {
+                    continue;
+                }
+                // ordered by samples, then by index to break ties
+                const uint32_t samples = l.totals.samples;
+                if (samples > below || (samples == below && j <= below_idx)) {
+                    continue;
+                }
+                if (best == no_index || samples > _lines[best].totals.samples) {
+                    best = j;
+                }
+            }
+            if (best == no_index) {
+                break;
+            }
+            const Line &l = _lines[best];
+            const float pct = s.totals.samples > 0 ? l.totals.samples * 100.0f / s.totals.samples : 0;
+            str.printf("  %5.1f%% instructions=%u time=%uus alloc=%uB/%u %s line %u\n",
+                       double(pct),
+                       unsigned(l.totals.samples * _period),
+                       unsigned(l.totals.time_us),
+                       unsigned(l.totals.alloc_bytes),
+                       unsigned(l.totals.allocs),
+                       _frames[l.frame].name,
+                       unsigned(l.line));
+            below = l.totals.samples;
+            below_idx = best;
+        }
+    }
+}
+
+void lua_profiler::folded(ExpandingString &str)
+{
+    WITH_SEMAPHORE(_sem);
+    for (uint8_t i=0; i<_num_stacks; i++) {
+        const Stack &s = _stacks[i];
+        str.printf("%s", _scripts[s.script].name);
+        // outermost frame first
+        for (int8_t d=s.depth-1; d>=0; d--) {
+            str.printf(";%s", _frames[s.frames[d]].name);
+        }
+        str.printf(" %u\n", unsigned(s.samples));
+    }
+}
+
+#endif  // AP_SCRIPTING_PROFILER_ENABLED
@@ -0,0 +1,141 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  sampling profiler for scripts
+
+  The instruction count hook fires every SCR_PROFILE VM instructions
+  and records the Lua call stack. Each sample is charged with the
+  instructions, wall time and allocations since the previous sample,
+  aggregated per script by function and line, and by call stack for
+  folded stack output
+ */
+#pragma once
+
+#include "AP_Scripting_config.h"
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+
+#include <AP_Common/AP_Common.h>
+#include <AP_HAL/Semaphores.h>
+
+#include "lua/src/lua.hpp"
+
+class ExpandingString;
+
+class lua_profiler
+{
+public:
+    lua_profiler() {}
+
+    CLASS_NO_COPY(lua_profiler);
+
+    // clear all results and set the sample period in VM instructions
+    void reset(uint16_t period);
+
+    uint16_t period() const { return _period; }
+
+    // a script is about to be resumed
+    void begin(const char *script_name);
+
+    // the script has yielded or finished
+    void end();
+
+    // called from the count hook
+    void sample(lua_State *L);
+
+    // called from the Lua allocator
+    void allocated(size_t bytes) {
+        _pending_alloc_bytes += bytes;
+        _pending_allocs++;
+    }
+
+    // per script totals and hot spots
+    void info(ExpandingString &str);
+
+    // one line per call stack, in the format of flamegraph.pl
+    void folded(ExpandingString &str);
+
+private:
+    static const uint8_t max_scripts = 16;
+    static const uint8_t max_frames = 96;
+    static const uint8_t max_lines = 128;
+    static const uint8_t max_stacks = 128;
+    static const uint8_t max_depth = 8;
+    static const uint8_t no_index = 0xFF;
+
+    struct Totals {
+        uint32_t samples;
+        uint32_t time_us;
+        uint32_t alloc_bytes;
+        uint32_t allocs;
+
+        void add(const Totals &t);
+    };
+
+    struct Script {
+        char name[24];
+        Totals totals;
+        uint32_t runs;
+        uint32_t run_time_us;
+        uint32_t dropped;
+    };
+
+    // a function, named as function@file:line_defined
+    struct Frame {
+        uint32_t hash;
+        char name[44];
+    };
+
+    // the current line of the innermost function
+    struct Line {
+        uint8_t script;
+        uint8_t frame;
+        uint16_t line;
+        Totals totals;
+    };
+
+    struct Stack {
+        uint32_t hash;
+        uint8_t script;
+        uint8_t depth;
+        uint8_t frames[max_depth];
+        uint32_t samples;
+    };
+
+    HAL_Semaphore _sem;
+
+    uint16_t _period;
+    uint8_t _script = no_index;
+    uint32_t _run_start_us;
+    uint32_t _last_sample_us;
+    uint32_t _pending_alloc_bytes;
+    uint32_t _pending_allocs;
+
+    Script _scripts[max_scripts];
+    uint8_t _num_scripts;
+    Frame _frames[max_frames];
+    uint8_t _num_frames;
+    Line _lines[max_lines];
+    uint8_t _num_lines;
+    Stack _stacks[max_stacks];
+    uint8_t _num_stacks;
+
+    uint8_t find_frame(lua_State *L, lua_Debug &ar);
+    uint8_t find_line(uint8_t frame, uint16_t line);
+    uint8_t find_stack(const uint8_t *frames, uint8_t depth);
+    Totals take_pending(uint32_t now_us);
+};
+
+#endif  // AP_SCRIPTING_PROFILER_ENABLED
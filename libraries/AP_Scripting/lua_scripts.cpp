@@ -21,6 +21,8 @@
 #include <AP_HAL/AP_HAL.h>
 #include "AP_Scripting.h"
 #include <AP_Logger/AP_Logger.h>
+#include <AP_Common/ExpandingString.h>
+#include <AP_Common/AP_FWVersion.h>
 
 #include <AP_Scripting/lua_generated_bindings.h>
 
@@ -29,8 +31,6 @@
 extern const AP_HAL::HAL& hal;
 #define ENABLE_DEBUG_MODULE 0
 
-bool lua_scripts::overtime;
-jmp_buf lua_scripts::panic_jmp;
 char *lua_scripts::error_msg_buf;
 HAL_Semaphore lua_scripts::error_msg_buf_sem;
 uint8_t lua_scripts::print_error_count;
@@ -49,8 +49,9 @@ static const char *get_error_object_message(lua_State *L) {
     return m;
 }
 
-lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, AP_Int8 &debug_options)
-    : _vm_steps(vm_steps),
+lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, AP_Int8 &debug_options, uint8_t vm)
+    : _vm(vm),
+      _vm_steps(vm_steps),
       _debug_options(debug_options)
 {
     const bool allow_heap_expansion = !option_is_set(AP_Scripting::DebugOption::DISABLE_HEAP_EXPANSION);
@@ -58,11 +59,37 @@ lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, AP
 }
 
 lua_scripts::~lua_scripts() {
+#if AP_SCRIPTING_BLOCK_POOL_ENABLED
+    pool_flush();
+#endif
     _heap.destroy();
 }
 
+lua_scripts *lua_scripts::instance(lua_State *L)
+{
+    void *ud = nullptr;
+    lua_getallocf(L, &ud);
+    return (lua_scripts *)ud;
+}
+
+int lua_scripts::current_env_ref(lua_State *L)
+{
+    return instance(L)->_current_env_ref;
+}
+
 void lua_scripts::hook(lua_State *L, lua_Debug *ar) {
-    lua_scripts::overtime = true;
+    lua_scripts *self = instance(L);
+#if AP_SCRIPTING_PROFILER_ENABLED
+    if (self->profiling() && !self->overtime) {
+        profiler->sample(L);
+        self->hook_steps_remaining -= profiler->period();
+        if (self->hook_steps_remaining > 0) {
+            return;
+        }
+    }
+#endif
+
+    self->overtime = true;
 
     // we need to aggressively bail out as we are over time
     // so we will aggressively trap errors until we clear out
@@ -87,10 +114,8 @@ void lua_scripts::set_and_print_new_error_message(MAV_SEVERITY severity, const c
 
     // reset buffer and print count
     print_error_count = 0;
-    if (error_msg_buf) {
-        _heap.deallocate(error_msg_buf);
-        error_msg_buf = nullptr;
-    }
+    delete[] error_msg_buf;
+    error_msg_buf = nullptr;
 
     // generate va_list and create a copy
     va_list arg_list, arg_list_copy;
@@ -110,8 +135,8 @@ void lua_scripts::set_and_print_new_error_message(MAV_SEVERITY severity, const c
         return;
     }
 
-    // allocate buffer on scripting heap
-    error_msg_buf = (char *)_heap.allocate(len+1);
+    // not on a scripting heap, as any VM may replace the message
+    error_msg_buf = NEW_NOTHROW char[len+1];
     if (!error_msg_buf) {
         // allocation failed
         va_end(arg_list);
@@ -132,7 +157,7 @@ void lua_scripts::set_and_print_new_error_message(MAV_SEVERITY severity, const c
 
 int lua_scripts::atpanic(lua_State *L) {
     set_and_print_new_error_message(MAV_SEVERITY_CRITICAL, "Panic: %s", get_error_object_message(L));
-    longjmp(panic_jmp, 1);
+    longjmp(instance(L)->panic_jmp, 1);
     return 0;
 }
 
@@ -166,7 +191,233 @@ void lua_scripts::update_stats(const char *name, uint32_t run_time, int total_me
 #endif // HAL_LOGGING_ENABLED
 }
 
+#if AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+
+#ifndef SCRIPTING_CACHE_DIRECTORY
+#define SCRIPTING_CACHE_DIRECTORY SCRIPTING_DIRECTORY "/.cache"
+#endif
+
+// largest compiled script we will load from the cache
+#define SCRIPTING_CACHE_MAX_CODE_SIZE (512*1024U)
+
+namespace {
+// lua_load() reader for a compiled chunk in the cache
+struct bytecode_reader {
+    int fd;
+    uint32_t remaining;
+    char buf[256];
+};
+
+const char *bytecode_read(lua_State *L, void *ud, size_t *size)
+{
+    (void)L;
+    bytecode_reader *r = (bytecode_reader *)ud;
+    const int32_t n = r->remaining == 0 ? 0 : AP::FS().read(r->fd, r->buf, MIN(r->remaining, sizeof(r->buf)));
+    if (n <= 0) {
+        *size = 0;
+        return nullptr;
+    }
+    r->remaining -= n;
+    *size = n;
+    return r->buf;
+}
+
+// lua_dump() writer, collecting the many small writes into larger ones
+struct bytecode_writer {
+    int fd;
+    bool ok;
+    uint32_t size;
+    uint32_t crc;
+    uint16_t buf_len;
+    uint8_t buf[256];
+
+    void flush() {
+        if (ok && buf_len > 0) {
+            ok = AP::FS().write(fd, buf, buf_len) == buf_len;
+        }
+        buf_len = 0;
+    }
+};
+
+int bytecode_write(lua_State *L, const void *p, size_t sz, void *ud)
+{
+    (void)L;
+    bytecode_writer *w = (bytecode_writer *)ud;
+    const uint8_t *b = (const uint8_t *)p;
+    w->crc = crc_crc32(w->crc, b, sz);
+    w->size += sz;
+    while (sz > 0) {
+        const uint16_t n = MIN(sz, sizeof(w->buf) - w->buf_len);
+        memcpy(&w->buf[w->buf_len], b, n);
+        w->buf_len += n;
+        b += n;
+        sz -= n;
+        if (w->buf_len == sizeof(w->buf)) {
+            w->flush();
+        }
+    }
+    return w->ok ? 0 : 1;
+}
+}
+
+/*
+  the cache file for a script is named after the script, with scripts
+  from ROMFS or a VM subdirectory prefixed so they can't clash with
+  those in the scripts directory
+ */
+bool lua_scripts::bytecode_cache_path(const char *filename, char *path, uint8_t path_len) const
+{
+    const char *name = strrchr(filename, '/');
+    name = (name == nullptr) ? filename : name + 1;
+    char prefix[16] {};
+    const size_t dir_len = strlen(SCRIPTING_DIRECTORY);
+    if (strncmp(filename, "@ROMFS/", 7) == 0) {
+        strncpy_noterm(prefix, "romfs_", sizeof(prefix)-1);
+    } else if (strncmp(filename, SCRIPTING_DIRECTORY "/", dir_len+1) == 0 &&
+               name > filename + dir_len + 1) {
+        // name of the subdirectory, followed by an underscore
+        const size_t len = MIN(size_t(name - (filename + dir_len + 1)), sizeof(prefix)-1);
+        memcpy(prefix, filename + dir_len + 1, len);
+        prefix[len-1] = '_';
+    }
+    const int ret = hal.util->snprintf(path, path_len, "%s/%s%sc", SCRIPTING_CACHE_DIRECTORY, prefix, name);
+    return ret > 0 && ret < path_len;
+}
+
+/*
+  the git hash and version string of the running firmware
+ */
+uint32_t lua_scripts::bytecode_build_id(void)
+{
+    const AP_FWVersion &fwver = AP::fwversion();
+    return crc_crc32(fwver.fw_hash, (const uint8_t *)fwver.fw_string, strlen(fwver.fw_string));
+}
+
+bool lua_scripts::load_bytecode(lua_State *L, const char *filename, uint32_t source_crc, uint32_t source_size)
+{
+    char path[128];
+    if (!bytecode_cache_path(filename, path, sizeof(path))) {
+        return false;
+    }
+    const int fd = AP::FS().open(path, O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+
+    bytecode_header hdr;
+    bool ok = AP::FS().read(fd, &hdr, sizeof(hdr)) == int32_t(sizeof(hdr)) &&
+        hdr.magic == bytecode_magic &&
+        hdr.build_id == bytecode_build_id() &&
+        hdr.source_crc == source_crc &&
+        hdr.source_size == source_size &&
+        hdr.code_size > 0 && hdr.code_size <= SCRIPTING_CACHE_MAX_CODE_SIZE;
+
+    bytecode_reader r;
+    r.fd = fd;
+    if (ok) {
+        // check all of the chunk before any of it reaches the undump
+        r.remaining = hdr.code_size;
+        uint32_t crc = 0;
+        size_t n;
+        for (const char *b = bytecode_read(L, &r, &n); b != nullptr; b = bytecode_read(L, &r, &n)) {
+            crc = crc_crc32(crc, (const uint8_t *)b, n);
+        }
+        ok = r.remaining == 0 && crc == hdr.code_crc &&
+            AP::FS().lseek(fd, sizeof(hdr), SEEK_SET) == int32_t(sizeof(hdr));
+    }
+
+    if (ok) {
+        r.remaining = hdr.code_size;
+        if (lua_load(L, bytecode_read, &r, filename, lua_binarymode()) != LUA_OK) {
+            // a corrupt or incompatible chunk, it will be replaced
+            lua_pop(L, 1);
+            ok = false;
+        }
+    }
+    AP::FS().close(fd);
+    return ok;
+}
+
+/*
+  write to a temporary file and rename it into place, so a partly
+  written chunk is never picked up
+ */
+void lua_scripts::save_bytecode(lua_State *L, const char *filename, uint32_t source_crc, uint32_t source_size)
+{
+    char path[128];
+    char tmp_path[132];
+    if (!bytecode_cache_path(filename, path, sizeof(path))) {
+        return;
+    }
+    hal.util->snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    // fails harmlessly if it already exists
+    AP::FS().mkdir(SCRIPTING_CACHE_DIRECTORY);
+
+    const int fd = AP::FS().open(tmp_path, O_WRONLY|O_CREAT|O_TRUNC);
+    if (fd == -1) {
+        return;
+    }
+
+    bytecode_header hdr {};
+    bytecode_writer w {};
+    bool ok = AP::FS().write(fd, &hdr, sizeof(hdr)) == int32_t(sizeof(hdr));
+    if (ok) {
+        w.fd = fd;
+        w.ok = true;
+        // keep the debug information so errors still have line numbers
+        ok = lua_dump(L, bytecode_write, &w, 0) == 0;
+        w.flush();
+        ok = ok && w.ok && w.size > 0;
+    }
+    if (ok) {
+        hdr.magic = bytecode_magic;
+        hdr.build_id = bytecode_build_id();
+        hdr.source_crc = source_crc;
+        hdr.source_size = source_size;
+        hdr.code_size = w.size;
+        hdr.code_crc = w.crc;
+        ok = AP::FS().lseek(fd, 0, SEEK_SET) == 0 &&
+            AP::FS().write(fd, &hdr, sizeof(hdr)) == int32_t(sizeof(hdr)) &&
+            AP::FS().fsync(fd) == 0;
+    }
+    AP::FS().close(fd);
+
+    if (ok) {
+        AP::FS().unlink(path);
+        ok = AP::FS().rename(tmp_path, path) == 0;
+    }
+    if (!ok) {
+        AP::FS().unlink(tmp_path);
+    }
+}
+
+#endif  // AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+
 lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename) {
+    const uint32_t loadStart = AP_HAL::micros();
+    const size_t startUsed = heap_used;
+    const size_t outerPeak = heap_peak;
+    heap_peak = heap_used;
+
+    // Get checksum of file
+    uint32_t crc = 0;
+    const bool have_crc = AP::FS().crc32(filename, crc);
+
+#if AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+    bool use_cache = false;
+    uint32_t source_size = 0;
+    if (have_crc && !option_is_set(AP_Scripting::DebugOption::DISABLE_BYTECODE_CACHE)) {
+        struct stat st;
+        if (AP::FS().stat(filename, &st) == 0) {
+            use_cache = true;
+            source_size = st.st_size;
+        }
+    }
+    if (use_cache && load_bytecode(L, filename, crc, source_size)) {
+        // loaded the compiled script, nothing to parse
+    } else
+#endif
     if (int error = luaL_loadfile(L, filename)) {
         switch (error) {
             case LUA_ERRSYNTAX:
@@ -187,9 +438,11 @@ lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename)
                 return nullptr;
         }
     }
-
-    const int loadMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
-    const uint32_t loadStart = AP_HAL::micros();
+#if AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+    else if (use_cache) {
+        save_bytecode(L, filename, crc, source_size);
+    }
+#endif
 
     script_info *new_script = (script_info *)_heap.allocate(sizeof(script_info));
     if (new_script == nullptr) {
@@ -207,16 +460,16 @@ lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename)
     const uint32_t loadEnd = AP_HAL::micros();
     const int endMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
 
-    update_stats(filename, loadEnd-loadStart, endMem, loadMem);
+    // report the time to load and the peak Lua heap used while loading
+    update_stats(filename, loadEnd-loadStart, endMem, heap_peak - startUsed);
+    heap_peak = MAX(heap_peak, outerPeak);
 
     new_script->name = filename;
     new_script->env_ref = luaL_ref(L, LUA_REGISTRYINDEX); // store reference to script's environment
     new_script->run_ref = luaL_ref(L, LUA_REGISTRYINDEX); // store reference to function to run
     new_script->next_run_ms = AP_HAL::millis64() - 1; // force the script to be stale
 
-    // Get checksum of file
-    uint32_t crc = 0;
-    if (AP::FS().crc32(filename, crc)) {
+    if (have_crc) {
         // Record crc of this script
         new_script->crc = crc;
         {
@@ -310,10 +563,47 @@ void lua_scripts::load_all_scripts_in_dir(lua_State *L, const char *dirname) {
     AP::FS().closedir(d);
 }
 
+#if AP_SCRIPTING_MAX_VMS > 1
+/*
+  scripts for VM n are in the vm<n> subdirectory of the scripts
+  directory. VM 0 also runs the scripts of any VM that isn't enabled
+  with SCR_VMS, so every script runs somewhere
+ */
+void lua_scripts::load_vm_scripts(lua_State *L)
+{
+    const uint8_t num_vms = AP_Scripting::get_singleton()->get_num_vms();
+    for (uint8_t vm=1; vm<AP_SCRIPTING_MAX_VMS; vm++) {
+        const uint8_t owner = (vm < num_vms) ? vm : 0;
+        if (owner != _vm) {
+            continue;
+        }
+        char dirname[sizeof(SCRIPTING_DIRECTORY) + 8];
+        hal.util->snprintf(dirname, sizeof(dirname), "%s/vm%u", SCRIPTING_DIRECTORY, unsigned(vm));
+        if (_vm == 0) {
+            // only expected to exist for VMs in use
+            struct stat st;
+            if (AP::FS().stat(dirname, &st) != 0) {
+                continue;
+            }
+        }
+        load_all_scripts_in_dir(L, dirname);
+    }
+}
+#endif  // AP_SCRIPTING_MAX_VMS > 1
+
 void lua_scripts::reset_loop_overtime(lua_State *L) {
     overtime = false;
     // reset the hook to clear the counter
     const int32_t vm_steps = MAX(_vm_steps, 1000);
+#if AP_SCRIPTING_PROFILER_ENABLED
+    if (profiling()) {
+        // sample every period instructions, and count down to the
+        // limit in the hook
+        hook_steps_remaining = vm_steps;
+        lua_sethook(L, hook, LUA_MASKCOUNT, profiler->period());
+        return;
+    }
+#endif
     lua_sethook(L, hook, LUA_MASKCOUNT, vm_steps);
 }
 
@@ -339,7 +629,7 @@ void lua_scripts::run_next_script(lua_State *L) {
     // pop the function to the top of the stack
     lua_rawgeti(L, LUA_REGISTRYINDEX, script->run_ref);
     // set current environment for other users
-    AP::scripting()->set_current_env_ref(script->env_ref);
+    _current_env_ref = script->env_ref;
 
     if(lua_pcall(L, 0, LUA_MULTRET, 0)) {
         if (overtime) {
@@ -464,11 +754,89 @@ void lua_scripts::reschedule_script(script_info *script) {
     previous->next = script;
 }
 
-MultiHeap lua_scripts::_heap;
+#if AP_SCRIPTING_PROFILER_ENABLED
+lua_profiler *lua_scripts::profiler;
+#endif
+
+#if AP_SCRIPTING_BLOCK_POOL_ENABLED
+void *lua_scripts::pool_change_size(void *ptr, size_t old_size, size_t new_size)
+{
+    if (new_size == 0) {
+        if (ptr != nullptr && old_size > 0 && old_size <= pool_max_size) {
+            block_pool &pool = pools[(old_size-1) / pool_granule];
+            if (pool.count < pool_max_blocks) {
+                pool_block *b = (pool_block *)ptr;
+                b->next = pool.head;
+                pool.head = b;
+                pool.count++;
+                return nullptr;
+            }
+        }
+        _heap.deallocate(ptr);
+        return nullptr;
+    }
+
+    if (ptr == nullptr && new_size <= pool_max_size) {
+        block_pool &pool = pools[(new_size-1) / pool_granule];
+        if (pool.head != nullptr) {
+            pool_block *b = pool.head;
+            pool.head = b->next;
+            pool.count--;
+            pool_hits++;
+            return b;
+        }
+        pool_misses++;
+    }
+
+    const size_t alloc_size = (new_size <= pool_max_size) ? ((new_size + pool_granule - 1) / pool_granule) * pool_granule : new_size;
+    void *ret = _heap.change_size(ptr, old_size, alloc_size);
+    if (ret == nullptr) {
+        // the pools may be holding what we need
+        pool_flush();
+        ret = _heap.change_size(ptr, old_size, alloc_size);
+    }
+    return ret;
+}
+
+void lua_scripts::pool_stats(lua_State *L, uint32_t &hits, uint32_t &misses)
+{
+    const lua_scripts *self = instance(L);
+    hits = self->pool_hits;
+    misses = self->pool_misses;
+}
+
+void lua_scripts::pool_flush(void)
+{
+    for (block_pool &pool : pools) {
+        while (pool.head != nullptr) {
+            pool_block *b = pool.head;
+            pool.head = b->next;
+            _heap.deallocate(b);
+        }
+        pool.count = 0;
+    }
+}
+#endif  // AP_SCRIPTING_BLOCK_POOL_ENABLED
 
 void *lua_scripts::alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
-    (void)ud; /* not used */
-    return _heap.change_size(ptr, osize, nsize);
+    lua_scripts *self = (lua_scripts *)ud;
+    // for a new block osize is the type of object, not a size
+    const size_t old_size = (ptr == nullptr) ? 0 : osize;
+#if AP_SCRIPTING_BLOCK_POOL_ENABLED
+    void *ret = self->pool_change_size(ptr, old_size, nsize);
+#else
+    void *ret = self->_heap.change_size(ptr, osize, nsize);
+#endif
+    if (ret != nullptr || nsize == 0) {
+        self->heap_used += nsize - old_size;
+        self->heap_peak = MAX(self->heap_peak, self->heap_used);
+#if AP_SCRIPTING_PROFILER_ENABLED
+        if (self->profiling() && nsize > old_size) {
+            profiler->allocated(nsize - old_size);
+        }
+#endif
+    }
+    return ret;
 }
 
 void lua_scripts::run(void) {
@@ -487,6 +855,9 @@ void lua_scripts::run(void) {
         if (lua_state != nullptr) {
             lua_close(lua_state); // shutdown the old state
         }
+#if AP_SCRIPTING_BLOCK_POOL_ENABLED
+        pool_flush();
+#endif
         // remove all the old scheduled scripts
         for (script_info *script = scripts; script != nullptr; script = scripts) {
             remove_script(nullptr, script);
@@ -495,7 +866,9 @@ void lua_scripts::run(void) {
         overtime = false;
     }
 
-    lua_state = lua_newstate(alloc, NULL);
+    heap_used = 0;
+    heap_peak = 0;
+    lua_state = lua_newstate(alloc, this);
     lua_State *L = lua_state;
     if (L == nullptr) {
         GCS_SEND_TEXT(MAV_SEVERITY_CRITICAL, "Lua: Couldn't allocate a lua state");
@@ -509,6 +882,18 @@ void lua_scripts::run(void) {
     lua_atpanic(L, atpanic);
     load_generated_bindings(L);
 
+#if AP_SCRIPTING_PROFILER_ENABLED
+    const int16_t profile_period = AP_Scripting::get_singleton()->get_profile_period();
+    if (_vm == 0 && profile_period > 0 && profiler == nullptr) {
+        profiler = NEW_NOTHROW lua_profiler();
+    }
+    if (_vm == 0 && profiler != nullptr) {
+        // a period of less than 100 instructions costs far more than
+        // the scripts being profiled
+        profiler->reset(profile_period > 0 ? MAX(profile_period, 100) : 0);
+    }
+#endif
+
     // set up string metatable. we set up one for all scripts that no script has
     // access to, as it's impossible to set up one per-script and we don't want
     // any script to be able to mess with it.
@@ -528,19 +913,32 @@ void lua_scripts::run(void) {
     // Skip those directores disabled with SCR_DIR_DISABLE param
     uint16_t dir_disable = AP_Scripting::get_singleton()->get_disabled_dir();
     bool loaded = false;
+    const uint32_t bootStart = AP_HAL::micros();
+    const size_t bootUsed = heap_used;
+    heap_peak = heap_used;
     if ((dir_disable & uint16_t(AP_Scripting::SCR_DIR::SCRIPTS)) == 0) {
-        load_all_scripts_in_dir(L, SCRIPTING_DIRECTORY);
+        if (_vm == 0) {
+            load_all_scripts_in_dir(L, SCRIPTING_DIRECTORY);
+        }
+#if AP_SCRIPTING_MAX_VMS > 1
+        load_vm_scripts(L);
+#endif
         loaded = true;
     }
 #ifdef HAL_HAVE_AP_ROMFS_EMBEDDED_LUA
-    if ((dir_disable & uint16_t(AP_Scripting::SCR_DIR::ROMFS)) == 0) {
+    if (_vm == 0 && (dir_disable & uint16_t(AP_Scripting::SCR_DIR::ROMFS)) == 0) {
         load_all_scripts_in_dir(L, "@ROMFS/scripts");
         loaded = true;
     }
 #endif
-    if (!loaded) {
+    if (!loaded && _vm == 0) {
         GCS_SEND_TEXT(MAV_SEVERITY_CRITICAL, "Lua: All directory's disabled see SCR_DIR_DISABLE");
     }
+    {
+        // report the total time and peak heap of the boot time load
+        const int bootMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+        update_stats("load", AP_HAL::micros() - bootStart, bootMem, heap_peak - bootUsed);
+    }
 
 #ifndef __clang_analyzer__
     succeeded_initial_load = true;
@@ -588,6 +986,11 @@ void lua_scripts::run(void) {
 
             const int startMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
             const uint32_t loadEnd = AP_HAL::micros();
+#if AP_SCRIPTING_PROFILER_ENABLED
+            if (profiling()) {
+                profiler->begin(script_name);
+            }
+#endif
 
             // NOTE!  the base pointer of our scripts linked list,
             // *and all its contents* may become invalid as part of
@@ -595,6 +998,11 @@ void lua_scripts::run(void) {
             // anything that was in *scripts after this call.
             run_next_script(L);
 
+#if AP_SCRIPTING_PROFILER_ENABLED
+            if (profiling()) {
+                profiler->end();
+            }
+#endif
             const uint32_t runEnd = AP_HAL::micros();
             const int endMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
 
@@ -626,6 +1034,10 @@ void lua_scripts::run(void) {
             set_and_print_new_error_message(MAV_SEVERITY_WARNING, "Required SCR_HEAP_SIZE over %u", unsigned(expansion_size));
         }
 
+#if AP_SCRIPTING_PROFILER_ENABLED
+        update_profiler();
+#endif
+
         // re-print the latest error message every 10 seconds 10 times
         const uint8_t error_prints = 10;
         if ((print_error_count < error_prints) && (AP_HAL::millis() - last_print_ms > 10000)) {
@@ -644,15 +1056,62 @@ void lua_scripts::run(void) {
         lua_close(lua_state); // shutdown the old state
         lua_state = nullptr;
     }
+#if AP_SCRIPTING_BLOCK_POOL_ENABLED
+    pool_flush();
+#endif
 
-    error_msg_buf_sem.take_blocking();
-    if (error_msg_buf != nullptr) {
-        _heap.deallocate(error_msg_buf);
+    if (_vm == 0) {
+        // scripting is being stopped, the semaphore covers VMs still stopping
+        error_msg_buf_sem.take_blocking();
+        delete[] error_msg_buf;
         error_msg_buf = nullptr;
+        error_msg_buf_sem.give();
     }
-    error_msg_buf_sem.give();
 }
 
+#if AP_SCRIPTING_PROFILER_ENABLED
+#ifndef SCRIPTING_PROFILE_FILE
+#define SCRIPTING_PROFILE_FILE SCRIPTING_DIRECTORY "/profile.folded"
+#endif
+
+/*
+  write the folded stacks to the filesystem every 10 seconds while
+  profiling, for use with flamegraph.pl and similar tools
+ */
+void lua_scripts::update_profiler(void)
+{
+    if (!profiling()) {
+        return;
+    }
+    const uint32_t now_ms = AP_HAL::millis();
+    if (now_ms - last_profile_dump_ms < 10000) {
+        return;
+    }
+    last_profile_dump_ms = now_ms;
+
+    ExpandingString str;
+    profiler->folded(str);
+    if (str.has_failed_allocation()) {
+        return;
+    }
+    const int fd = AP::FS().open(SCRIPTING_PROFILE_FILE, O_WRONLY|O_CREAT|O_TRUNC);
+    if (fd == -1) {
+        return;
+    }
+    AP::FS().write(fd, str.get_string(), str.get_length());
+    AP::FS().close(fd);
+}
+
+void lua_scripts::profile_info(ExpandingString &str)
+{
+    if (profiler == nullptr) {
+        str.printf("profiler disabled, see SCR_PROFILE\n");
+        return;
+    }
+    profiler->info(str);
+}
+#endif  // AP_SCRIPTING_PROFILER_ENABLED
+
 // Return the file checksums of running and loaded scripts
 uint32_t lua_scripts::get_loaded_checksum()
 {
@@ -28,13 +28,14 @@
 #include <AP_HAL/Semaphores.h>
 #include <AP_MultiHeap/AP_MultiHeap.h>
 #include "lua_common_defs.h"
+#include "lua_profiler.h"
 
 #include "lua/src/lua.hpp"
 
 class lua_scripts
 {
 public:
-    lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, AP_Int8 &debug_options);
+    lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, AP_Int8 &debug_options, uint8_t vm);
 
     ~lua_scripts();
 
@@ -46,10 +47,28 @@ public:
     // run scripts, does not return unless an error occured
     void run(void);
 
-    static bool overtime; // script exceeded it's execution slot, and we are bailing out
+    // environment of the script currently running in the VM of L
+    static int current_env_ref(lua_State *L);
+
+    // number of the VM running L
+    static uint8_t vm_index(lua_State *L) { return instance(L)->_vm; }
+
+#if AP_SCRIPTING_BLOCK_POOL_ENABLED
+    // small block allocations served from the pools and from the heap
+    static void pool_stats(lua_State *L, uint32_t &hits, uint32_t &misses);
+#endif
 
 private:
 
+    // the instance owning L, which is passed to Lua as the allocator data
+    static lua_scripts *instance(lua_State *L);
+
+    // VM number, VM 0 runs the scripts in SCRIPTING_DIRECTORY and ROMFS
+    const uint8_t _vm;
+
+    bool overtime; // script exceeded it's execution slot, and we are bailing out
+    int _current_env_ref;
+
     void create_sandbox(lua_State *L);
 
     typedef struct script_info {
@@ -63,10 +82,42 @@ private:
 
     script_info *load_script(lua_State *L, char *filename);
 
+#if AP_SCRIPTING_BYTECODE_CACHE_ENABLED
+    /*
+      compiled scripts are kept in SCRIPTING_CACHE_DIRECTORY as a
+      header followed by the output of lua_dump. The header ties the
+      chunk to the source and firmware build it was compiled from, and
+      the CRC over the chunk is checked before it is loaded as the
+      undump doesn't validate the bytecode
+     */
+    struct PACKED bytecode_header {
+        uint32_t magic;
+        uint32_t build_id;
+        uint32_t source_crc;
+        uint32_t source_size;
+        uint32_t code_size;
+        uint32_t code_crc;
+    };
+    static const uint32_t bytecode_magic = 0x4341554C;
+
+    bool bytecode_cache_path(const char *filename, char *path, uint8_t path_len) const;
+    // identifies the firmware build, so a new build never loads old bytecode
+    static uint32_t bytecode_build_id(void);
+    // push the compiled function for filename, returns false on a cache miss
+    bool load_bytecode(lua_State *L, const char *filename, uint32_t source_crc, uint32_t source_size);
+    // save the function on the top of the stack as the compiled filename
+    void save_bytecode(lua_State *L, const char *filename, uint32_t source_crc, uint32_t source_size);
+#endif
+
     void reset_loop_overtime(lua_State *L);
 
     void load_all_scripts_in_dir(lua_State *L, const char *dirname);
 
+#if AP_SCRIPTING_MAX_VMS > 1
+    // load the scripts in the VM subdirectories this VM runs
+    void load_vm_scripts(lua_State *L);
+#endif
+
     void run_next_script(lua_State *L);
 
     void remove_script(lua_State *L, script_info *script);
@@ -82,7 +133,7 @@ private:
 
     // lua panic handler, will jump back to the start of run
     static int atpanic(lua_State *L);
-    static jmp_buf panic_jmp;
+    jmp_buf panic_jmp;
 
     lua_State *lua_state;
 
@@ -95,12 +146,56 @@ private:
 
     static void *alloc(void *ud, void *ptr, size_t osize, size_t nsize);
 
-    static MultiHeap _heap;
+#if AP_SCRIPTING_BLOCK_POOL_ENABLED
+    /*
+      freelists of small blocks. Scripts doing math on vectors,
+      locations and quaternions create and collect userdata at the rate
+      they run, so freed blocks are kept for reuse rather than going
+      back through the heap. Blocks up to pool_max_size are allocated
+      rounded up to a pool_granule multiple so any block in a pool can
+      be reused for any size in that pool
+     */
+    static const uint8_t pool_granule = 8;
+    static const uint8_t pool_max_size = 64;
+    static const uint8_t pool_max_blocks = 16;
+    struct pool_block {
+        pool_block *next;
+    };
+    struct block_pool {
+        pool_block *head;
+        uint8_t count;
+    };
+    block_pool pools[pool_max_size / pool_granule];
+    uint32_t pool_hits;
+    uint32_t pool_misses;
+    void *pool_change_size(void *ptr, size_t old_size, size_t new_size);
+    // return all pooled blocks to the heap
+    void pool_flush(void);
+#endif
+
+    // bytes currently allocated by Lua and the most allocated since
+    // heap_peak was last reset
+    size_t heap_used;
+    size_t heap_peak;
+
+#if AP_SCRIPTING_PROFILER_ENABLED
+    // kept across restarts so @SYS can read it at any time. Only VM 0
+    // is profiled, as the profiler follows a single running script
+    static lua_profiler *profiler;
+    // instructions left before the script is over time, when the
+    // hook also fires for profiler samples
+    int32_t hook_steps_remaining;
+    bool profiling() const { return _vm == 0 && profiler != nullptr && profiler->period() > 0; }
+    uint32_t last_profile_dump_ms;
+    void update_profiler(void);
+#endif
+
+    MultiHeap _heap;
 
     // helper for print and log of runtime stats
     void update_stats(const char *name, uint32_t run_time, int total_mem, int run_mem);
 
-    // must be static for use in atpanic
+    // shared by all VMs
     static void print_error(MAV_SEVERITY severity);
     static char *error_msg_buf;
     static HAL_Semaphore error_msg_buf_sem;
@@ -113,7 +208,7 @@ private:
     static HAL_Semaphore crc_sem;
 
 public:
-    // must be static for use in atpanic, public to allow bindings to issue none fatal warnings
+    // static so all VMs share the last error, public to allow bindings to issue none fatal warnings
     static void set_and_print_new_error_message(MAV_SEVERITY severity, const char *fmt, ...) FMT_PRINTF(2,3);
 
     // return last error message, nullptr if none, must use semaphore as this is updated in the scripting thread
@@ -126,6 +221,11 @@ public:
     static uint32_t get_loaded_checksum();
     static uint32_t get_running_checksum();
 
+#if AP_SCRIPTING_PROFILER_ENABLED
+    // profiler results for @SYS/lua_profile.txt
+    static void profile_info(ExpandingString &str);
+#endif
+
 };
 
 #endif  // AP_SCRIPTING_ENABLED
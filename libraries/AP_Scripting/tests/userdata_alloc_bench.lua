@@ -0,0 +1,75 @@
+-- compare the garbage generated by operator and in-place userdata math
+--
+-- Operators such as a + b create a new userdata for every result,
+-- which the collector has to find and free later. The in-place
+-- methods update an existing object instead, so a script can reuse a
+-- scratch object and create nothing per iteration.
+
+---@diagnostic disable: need-check-nil
+
+local ITERATIONS = 2000
+-- each round frees fewer blocks than a pool holds, so the next round
+-- can take them all back from the pool
+local ROUND = 4
+
+local a = Vector3f()
+local b = Vector3f()
+a:x(1)
+a:y(2)
+a:z(3)
+b:x(0.5)
+b:y(-0.5)
+b:z(0.25)
+
+-- returns small block allocations per iteration, the time taken and
+-- the small block pool hits and misses. The collector runs as usual
+-- and finishes a cycle after each round, so freed blocks are reused
+local function measure(fn)
+  collectgarbage("collect")
+  local start_us = micros()
+  local start_hits, start_misses = scripting:pool_stats()
+  for _ = 1, ITERATIONS // ROUND do
+    for _ = 1, ROUND do
+      fn()
+    end
+    repeat until collectgarbage("step")
+  end
+  local hits, misses = scripting:pool_stats()
+  local elapsed_us = micros() - start_us
+  hits = (hits - start_hits):toint()
+  misses = (misses - start_misses):toint()
+  return (hits + misses) / ITERATIONS, elapsed_us, hits, misses
+end
+
+local result
+local function operators()
+  result = (a + b) * 2.0 - b
+end
+
+local scratch = Vector3f()
+local function inplace()
+  scratch:set(a):add(b):mul(2.0):sub(b)
+end
+
+local function check()
+  operators()
+  inplace()
+  assert(math.abs(result:x() - scratch:x()) < 1.0e-6, "x mismatch")
+  assert(math.abs(result:y() - scratch:y()) < 1.0e-6, "y mismatch")
+  assert(math.abs(result:z() - scratch:z()) < 1.0e-6, "z mismatch")
+end
+
+function update()
+  check()
+  local op_allocs, op_us, op_hits, op_misses = measure(operators)
+  local ip_allocs, ip_us, ip_hits, ip_misses = measure(inplace)
+  gcs:send_text(6, string.format("userdata operators: %.1f allocs/iter %uus pool %u/%u", op_allocs, op_us:toint(), op_hits, op_misses))
+  gcs:send_text(6, string.format("userdata in-place: %.1f allocs/iter %uus pool %u/%u", ip_allocs, ip_us:toint(), ip_hits, ip_misses))
+  assert(op_hits + op_misses > 0, "operators did not allocate")
+  assert(op_hits > op_misses, "freed userdata was not reused from the pool")
+  assert(ip_hits + ip_misses == 0, "in-place methods allocated")
+  gcs:send_text(6, "Userdata alloc tests passed")
+  return update, 5000
+end
+
+return update()
@@ -605,6 +605,9 @@ const AP_Scheduler::Task AP_Vehicle::scheduler_tasks[] = {
 #if HAL_GYROFFT_ENABLED
     FAST_TASK_CLASS(AP_GyroFFT,    &vehicle.gyro_fft,       sample_gyros),
 #endif
+#if AP_DDS_ENABLED && AP_DDS_EVENT_DRIVEN_ENABLED
+    FAST_TASK_CLASS(AP_Vehicle,    &vehicle,                dds_data_ready),
+#endif
 #if AP_AIRSPEED_ENABLED
     SCHED_TASK_CLASS(AP_Airspeed,  &vehicle.airspeed,       update,                   10, 100, 41),    // NOTE: the priority number here should be right before Plane's calc_airspeed_errors
 #endif
@@ -1132,6 +1135,19 @@ bool AP_Vehicle::init_dds_client()
     }
     return dds_client->start();
 }
+
+#if AP_DDS_EVENT_DRIVEN_ENABLED
+/*
+  common fast tasks run after the vehicle's, so by now the IMUs have
+  been read and the AHRS updated for this loop
+ */
+void AP_Vehicle::dds_data_ready()
+{
+    if (dds_client != nullptr) {
+        dds_client->data_ready(AP_DDS_Client::EVENT_IMU | AP_DDS_Client::EVENT_EKF);
+    }
+}
+#endif
 #endif // AP_DDS_ENABLED
 
 // Check if this mode can be entered from the GCS
@@ -522,6 +522,10 @@ protected:
     // Declare the dds client for communication with ROS2 and DDS(common for all vehicles)
     AP_DDS_Client *dds_client;
     bool init_dds_client() WARN_IF_UNUSED;
+#if AP_DDS_EVENT_DRIVEN_ENABLED
+    // tell DDS the fast loop has new IMU and AHRS data
+    void dds_data_ready();
+#endif
 #endif
 
     // Check if this mode can be entered from the GCS
@@ -13,6 +13,7 @@
 #include "GCS_MAVLink.h"
 #include <AP_Mission/AP_Mission.h>
 #include <stdint.h>
+#include <atomic>
 #include "MAVLink_routing.h"
 #include <AP_RTC/JitterCorrection.h>
 #include <AP_Common/Bitmask.h>
@@ -34,6 +35,8 @@
 
 #define GCS_DEBUG_SEND_MESSAGE_TIMINGS 0
 
+class ExpandingString;
+
 #ifndef HAL_GCS_ALLOW_PARAM_SET_DEFAULT
 #define HAL_GCS_ALLOW_PARAM_SET_DEFAULT 1
 #endif  // HAL_GCS_IGNORE_PARAM_SET_DEFAULT
@@ -214,6 +217,17 @@ public:
     // this is called when we discover we'd like to send something but can't:
     void out_of_space_to_send() { out_of_space_to_send_count++; }
 
+#if AP_MAVLINK_TX_SCHEDULER_ENABLED
+    // called with the number of bytes written to the port, including
+    // forwarded packets
+    void tx_bytes_sent(uint16_t nbytes) {
+        tx_sched.bytes_sent.fetch_add(nbytes, std::memory_order_relaxed);
+    }
+
+    // output scheduler state and per-message drop counts for this link
+    void tx_scheduler_info(ExpandingString &str) const;
+#endif
+
     void send_mission_ack(const mavlink_message_t &msg,
                           MAV_MISSION_TYPE mission_type,
                           MAV_MISSION_RESULT result) const {
@@ -484,6 +498,14 @@ public:
     virtual uint64_t capabilities() const;
     uint16_t get_stream_slowdown_ms() const { return stream_slowdown_ms; }
 
+#if AP_MAVLINK_MISSION_UPLOAD_STAGING_ENABLED
+    // true if mission uploads on this link may have several item
+    // requests outstanding at once
+    bool mission_upload_window_enabled() const {
+        return option_enabled(Option::MISSION_UPLOAD_WINDOW);
+    }
+#endif
+
     MAV_RESULT set_message_interval(uint32_t msg_id, int32_t interval_us);
 
 protected:
@@ -525,6 +547,8 @@ protected:
         // first bit is reserved for: MAVLINK2_SIGNING_DISABLED = (1U << 0),
         NO_FORWARD                = (1U << 1),  // don't forward MAVLink data to or from this device
         NOSTREAMOVERRIDE          = (1U << 2),  // ignore REQUEST_DATA_STREAM messages (eg. from GCSs)
+        TX_SCHEDULER              = (1U << 3),  // thin out stream messages when the radio reports congestion
+        MISSION_UPLOAD_WINDOW     = (1U << 4),  // request several mission items at once during uploads
     };
     bool option_enabled(Option option) const {
         return options & static_cast<uint16_t>(option);
@@ -885,6 +909,61 @@ private:
     void find_next_bucket_to_send(uint16_t now16_ms);
     void remove_message_from_bucket(int8_t bucket, ap_message id);
 
+#if AP_MAVLINK_TX_SCHEDULER_ENABLED
+    /*
+      token bucket output scheduler. Every byte written to the port
+      uses tokens, which are refilled at the estimated link
+      capacity. Stream messages are only sent if enough tokens are
+      left for their priority, so under congestion the low priority
+      streams are thinned out first and the rates degrade smoothly
+      instead of the link stalling on whichever bucket is next.
+      HIGH priority streams, HEARTBEAT, parameters, mission items and
+      pushed messages are never held back. Only used on links with the
+      TX_SCHEDULER option set
+     */
+    enum class TxPriority : uint8_t {
+        HIGH,
+        NORMAL,
+        LOW,
+    };
+    static TxPriority tx_priority(ap_message id);
+
+    struct {
+        // all bytes written to the port. Written by any thread sending
+        // on this channel
+        std::atomic<uint32_t> bytes_sent {0};
+        uint32_t window_bytes;      // bytes_sent at start of window
+        uint32_t window_start_ms;
+        uint32_t last_update_ms;
+        uint16_t window_slowdown_ms;  // stream_slowdown_ms at start of window
+        float capacity;             // estimated link capacity, bytes/s
+        float throughput;           // measured bytes/s written
+        float tokens;               // bytes we may send now
+        uint32_t accounted_bytes;   // bytes_sent already taken from tokens
+        uint32_t congested_windows;
+        uint32_t dropped_total;
+        // sent and dropped counts of the messages dropped most. A
+        // count for every message would cost too much RAM on each link
+        struct {
+            ap_message id;
+            uint16_t sent;
+            uint16_t dropped;   // zero for an unused entry
+        } msg_stats[8];
+    } tx_sched;
+
+    // refill tokens and update the capacity estimate
+    void tx_scheduler_update();
+    // count a message sent or dropped by the scheduler
+    void tx_scheduler_count_sent(ap_message id);
+    void tx_scheduler_count_dropped(ap_message id);
+    // return false if this instance of a stream message should be
+    // dropped to save bandwidth
+    bool tx_scheduler_allow(ap_message id);
+    float tx_burst_bytes() const;
+#else
+    bool tx_scheduler_allow(ap_message) { return true; }
+#endif
+
     // bitmask of IDs the code has spontaneously decided it wants to
     // send out.  Examples include HEARTBEAT (gcs_send_heartbeat)
     Bitmask<MSG_LAST> pushed_ap_message_ids;
@@ -1254,6 +1333,11 @@ public:
     void update_send();
     void update_receive();
 
+#if AP_MAVLINK_TX_SCHEDULER_ENABLED
+    // output scheduler state of all links, for @SYS/mavlink_tx.txt
+    void tx_scheduler_info(ExpandingString &str);
+#endif
+
     // minimum amount of time (in microseconds) that must remain in
     // the main scheduler loop before we are allowed to send any
     // mavlink messages.  We want to prioritise the main flight
@@ -1360,6 +1360,9 @@ bool GCS_MAVLINK::do_try_send_message(const ap_message id)
 #endif
         return false;
     }
+#if AP_MAVLINK_TX_SCHEDULER_ENABLED
+    tx_scheduler_count_sent(id);
+#endif
 #if GCS_DEBUG_SEND_MESSAGE_TIMINGS
     const uint32_t delta_us = AP_HAL::micros() - start_send_message_us;
     hal.scheduler->restore_interrupts(data);
@@ -1572,6 +1575,10 @@ void GCS_MAVLINK::update_send()
     // check for any in-progress tasks; check_tasks does its own rate-limiting
     GCS_MAVLINK_InProgress::check_tasks();
 
+#if AP_MAVLINK_TX_SCHEDULER_ENABLED
+    tx_scheduler_update();
+#endif
+
     const uint32_t start = AP_HAL::millis();
     const uint16_t start16 = start & 0xFFFF;
     while (AP_HAL::millis() - start < 5) { // spend a max of 5ms sending messages.  This should never trigger - out_of_time() should become true
@@ -1636,9 +1643,12 @@ void GCS_MAVLINK::update_send()
 
         ap_message next = next_deferred_bucket_message_to_send(start16);
         if (next != no_message_to_send) {
-            if (!do_try_send_message(next)) {
+            if (tx_scheduler_allow(next) && !do_try_send_message(next)) {
                 break;
             }
+            // a message the output scheduler drops is only counted as
+            // dropped, but it still leaves the bucket so the rest of
+            // the bucket goes out on time
             bucket_message_ids_to_send.clear(next);
             if (bucket_message_ids_to_send.count() == 0) {
                 // we sent everything in the bucket.  Reschedule it.
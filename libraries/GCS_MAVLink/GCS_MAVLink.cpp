@@ -147,6 +147,12 @@ void comm_send_buffer(mavlink_channel_t chan, const uint8_t *buf, uint8_t len)
         return;
     }
     const size_t written = mavlink_comm_port[chan]->write(buf, len);
+#if AP_MAVLINK_TX_SCHEDULER_ENABLED
+    GCS_MAVLINK *tx_link = gcs().chan(chan);
+    if (tx_link != nullptr) {
+        tx_link->tx_bytes_sent(written);
+    }
+#endif
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
     if (written < len && !mavlink_comm_port[chan]->is_write_locked()) {
         AP_HAL::panic("Short write on UART: %lu < %u", (unsigned long)written, len);
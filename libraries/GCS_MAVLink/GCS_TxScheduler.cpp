@@ -0,0 +1,279 @@
+/*
+  Congestion aware output scheduling of MAVLink stream messages
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GCS_config.h"
+
+#if AP_MAVLINK_TX_SCHEDULER_ENABLED
+
+#include "GCS.h"
+#include <AP_Common/ExpandingString.h>
+
+extern const AP_HAL::HAL& hal;
+
+// period over which throughput is measured and the capacity estimate
+// is adjusted
+#define TX_SCHED_WINDOW_MS 100
+
+// lowest capacity estimate in bytes/s. This is enough for the
+// messages we never hold back
+#define TX_SCHED_MIN_CAPACITY 300
+
+/*
+  relative importance of stream messages. Anything not listed is
+  NORMAL
+ */
+GCS_MAVLINK::TxPriority GCS_MAVLINK::tx_priority(ap_message id)
+{
+    switch (id) {
+    // what a GCS needs to fly the vehicle safely
+    case MSG_SYS_STATUS:
+    case MSG_EXTENDED_SYS_STATE:
+    case MSG_GPS_RAW:
+    case MSG_CURRENT_WAYPOINT:
+    case MSG_MISSION_ITEM_REACHED:
+    case MSG_NAV_CONTROLLER_OUTPUT:
+    case MSG_FENCE_STATUS:
+    case MSG_EKF_STATUS_REPORT:
+    case MSG_BATTERY_STATUS:
+    case MSG_HOME:
+    case MSG_ORIGIN:
+    case MSG_ADSB_VEHICLE:
+#if AP_AHRS_ENABLED
+    case MSG_ATTITUDE:
+    case MSG_LOCATION:
+    case MSG_VFR_HUD:
+#endif
+        return TxPriority::HIGH;
+
+    // high rate, bulky or diagnostic messages
+    case MSG_RAW_IMU:
+    case MSG_SCALED_IMU:
+    case MSG_SCALED_IMU2:
+    case MSG_SCALED_IMU3:
+    case MSG_SCALED_PRESSURE:
+    case MSG_SCALED_PRESSURE2:
+    case MSG_SCALED_PRESSURE3:
+    case MSG_SERVO_OUTPUT_RAW:
+    case MSG_RC_CHANNELS:
+    case MSG_RC_CHANNELS_RAW:
+    case MSG_GPS_RTK:
+    case MSG_GPS2_RTK:
+    case MSG_MEMINFO:
+    case MSG_HWSTATUS:
+    case MSG_MCU_STATUS:
+    case MSG_POWER_STATUS:
+    case MSG_SYSTEM_TIME:
+    case MSG_SIMSTATE:
+    case MSG_SIM_STATE:
+    case MSG_PID_TUNING:
+    case MSG_VIBRATION:
+    case MSG_ESC_TELEMETRY:
+    case MSG_RPM:
+    case MSG_NAMED_FLOAT:
+    case MSG_LOCAL_POSITION:
+    case MSG_POSITION_TARGET_GLOBAL_INT:
+    case MSG_POSITION_TARGET_LOCAL_NED:
+    case MSG_ATTITUDE_TARGET:
+    case MSG_AIS_VESSEL:
+#if AP_AHRS_ENABLED
+    case MSG_AHRS:
+    case MSG_AHRS2:
+    case MSG_ATTITUDE_QUATERNION:
+#endif
+#if AP_MAVLINK_MSG_HIGHRES_IMU_ENABLED
+    case MSG_HIGHRES_IMU:
+#endif
+        return TxPriority::LOW;
+
+    default:
+        return TxPriority::NORMAL;
+    }
+}
+
+// size of the token bucket; 100ms worth of link capacity
+float GCS_MAVLINK::tx_burst_bytes() const
+{
+    return MAX(tx_sched.capacity * 0.1f, float(TX_SCHED_MIN_CAPACITY));
+}
+
+/*
+  called at the start of each update_send(). Takes the bytes written
+  since the last call (including forwarded packets) out of the bucket,
+  refills it at the estimated capacity and, once per window, adjusts
+  the capacity estimate: if the radio asked us to slow down through
+  RADIO_STATUS then the link carried less than we offered and we back
+  off towards the measured throughput. Otherwise we probe back up
+  towards the nominal rate of the port.
+
+  A full port buffer is not taken as congestion. It happens whenever
+  a link is busy, and backing off on it would steadily take capacity
+  away from a link which is simply in use
+ */
+void GCS_MAVLINK::tx_scheduler_update()
+{
+    const uint32_t now_ms = AP_HAL::millis();
+    const float nominal = MAX(float(_port->bw_in_bytes_per_second()), float(TX_SCHED_MIN_CAPACITY));
+    const uint32_t bytes_sent = tx_sched.bytes_sent.load(std::memory_order_relaxed);
+
+    if (tx_sched.last_update_ms == 0) {
+        tx_sched.capacity = nominal;
+        tx_sched.tokens = tx_burst_bytes();
+        tx_sched.accounted_bytes = bytes_sent;
+        tx_sched.last_update_ms = now_ms;
+        tx_sched.window_start_ms = now_ms;
+        tx_sched.window_bytes = bytes_sent;
+        tx_sched.window_slowdown_ms = stream_slowdown_ms;
+        return;
+    }
+
+    const float burst = tx_burst_bytes();
+    tx_sched.tokens -= bytes_sent - tx_sched.accounted_bytes;
+    tx_sched.accounted_bytes = bytes_sent;
+    tx_sched.tokens += tx_sched.capacity * (now_ms - tx_sched.last_update_ms) * 0.001f;
+    tx_sched.tokens = constrain_float(tx_sched.tokens, -burst, burst);
+    tx_sched.last_update_ms = now_ms;
+
+    const uint32_t window_ms = now_ms - tx_sched.window_start_ms;
+    if (window_ms < TX_SCHED_WINDOW_MS) {
+        return;
+    }
+    const float window_rate = (bytes_sent - tx_sched.window_bytes) * 1000.0f / window_ms;
+    tx_sched.throughput = 0.8f * tx_sched.throughput + 0.2f * window_rate;
+
+    const bool congested = stream_slowdown_ms > tx_sched.window_slowdown_ms;
+    if (congested) {
+        tx_sched.capacity = MAX(MIN(tx_sched.capacity, window_rate) * 0.9f, float(TX_SCHED_MIN_CAPACITY));
+        tx_sched.congested_windows++;
+    } else {
+        tx_sched.capacity = MIN(tx_sched.capacity + nominal * 0.05f, nominal);
+    }
+
+    tx_sched.window_start_ms = now_ms;
+    tx_sched.window_bytes = bytes_sent;
+    tx_sched.window_slowdown_ms = stream_slowdown_ms;
+}
+
+/*
+  decide whether the next stream message from the current bucket
+  should be sent. Lower priority messages need more tokens left in the
+  bucket, so as the link fills up they are dropped first, and each is
+  dropped in proportion to how short of tokens we are. HIGH priority
+  messages are never dropped; they still use tokens, so they hold the
+  other streams back instead
+ */
+bool GCS_MAVLINK::tx_scheduler_allow(ap_message id)
+{
+    if (!option_enabled(Option::TX_SCHEDULER)) {
+        return true;
+    }
+
+    float threshold;
+    switch (tx_priority(id)) {
+    case TxPriority::HIGH:
+    default:
+        return true;
+    case TxPriority::NORMAL:
+        threshold = 0.25f;
+        break;
+    case TxPriority::LOW:
+        threshold = 0.5f;
+        break;
+    }
+
+    // anything written since the last update comes off straight away
+    const uint32_t unaccounted = tx_sched.bytes_sent.load(std::memory_order_relaxed) - tx_sched.accounted_bytes;
+    const float tokens = tx_sched.tokens - unaccounted;
+    if (tokens >= threshold * tx_burst_bytes()) {
+        return true;
+    }
+
+    tx_scheduler_count_dropped(id);
+    tx_sched.dropped_total++;
+    return false;
+}
+
+void GCS_MAVLINK::tx_scheduler_count_sent(ap_message id)
+{
+    for (auto &m : tx_sched.msg_stats) {
+        if (m.dropped != 0 && m.id == id) {
+            if (m.sent < UINT16_MAX) {
+                m.sent++;
+            }
+            return;
+        }
+    }
+}
+
+/*
+  count a dropped message, replacing the least dropped message in the
+  table if this one isn't in it yet
+ */
+void GCS_MAVLINK::tx_scheduler_count_dropped(ap_message id)
+{
+    auto *slot = &tx_sched.msg_stats[0];
+    for (auto &m : tx_sched.msg_stats) {
+        if (m.dropped != 0 && m.id == id) {
+            slot = &m;
+            break;
+        }
+        if (m.dropped < slot->dropped) {
+            slot = &m;
+        }
+    }
+    if (slot->dropped == 0 || slot->id != id) {
+        slot->id = id;
+        slot->sent = 0;
+        slot->dropped = 0;
+    }
+    if (slot->dropped < UINT16_MAX) {
+        slot->dropped++;
+    }
+}
+
+void GCS_MAVLINK::tx_scheduler_info(ExpandingString &str) const
+{
+    str.printf("chan %u%s capacity=%u throughput=%u tokens=%d congested=%u dropped=%u\n",
+               unsigned(chan - MAVLINK_COMM_0),
+               option_enabled(Option::TX_SCHEDULER) ? "" : " (disabled)",
+               unsigned(tx_sched.capacity),
+               unsigned(tx_sched.throughput),
+               int(tx_sched.tokens),
+               unsigned(tx_sched.congested_windows),
+               unsigned(tx_sched.dropped_total));
+    for (const auto &m : tx_sched.msg_stats) {
+        if (m.dropped == 0) {
+            continue;
+        }
+        str.printf("  msg %u prio %u sent=%u dropped=%u\n",
+                   unsigned(m.id),
+                   unsigned(tx_priority(m.id)),
+                   unsigned(m.sent),
+                   unsigned(m.dropped));
+    }
+}
+
+void GCS::tx_scheduler_info(ExpandingString &str)
+{
+    for (uint8_t i=0; i<num_gcs(); i++) {
+        const GCS_MAVLINK *link = chan(i);
+        if (link != nullptr) {
+            link->tx_scheduler_info(str);
+        }
+    }
+}
+
+#endif  // AP_MAVLINK_TX_SCHEDULER_ENABLED
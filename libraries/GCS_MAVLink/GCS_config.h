@@ -78,6 +78,19 @@
 #define AP_MAVLINK_MSG_SERIAL_CONTROL_ENABLED HAL_GCS_ENABLED
 #endif
 
+// budget the bytes sent on each link and thin out low priority
+// stream messages when the link is congested
+#ifndef AP_MAVLINK_TX_SCHEDULER_ENABLED
+#define AP_MAVLINK_TX_SCHEDULER_ENABLED (HAL_GCS_ENABLED && HAL_PROGRAM_SIZE_LIMIT_KB > 1024)
+#endif
+
+// stage mission uploads in RAM and replace the mission in one go
+// once every item has been received, optionally with several item
+// requests outstanding at once
+#ifndef AP_MAVLINK_MISSION_UPLOAD_STAGING_ENABLED
+#define AP_MAVLINK_MISSION_UPLOAD_STAGING_ENABLED (HAL_GCS_ENABLED && AP_MISSION_ENABLED && HAL_PROGRAM_SIZE_LIMIT_KB > 1024)
+#endif
+
 #ifndef AP_MAVLINK_MSG_UAVIONIX_ADSB_OUT_STATUS_ENABLED
 #define AP_MAVLINK_MSG_UAVIONIX_ADSB_OUT_STATUS_ENABLED HAL_ADSB_ENABLED
 #endif
@@ -22,6 +22,15 @@ void MissionItemProtocol::init_send_requests(GCS_MAVLINK &_link,
 
     link = &_link;
 
+    request_window = 1;
+#if AP_MAVLINK_MISSION_UPLOAD_STAGING_ENABLED
+    if (items_staged() && link->mission_upload_window_enabled()) {
+        request_window = upload_window;
+    }
+#endif
+    request_next = _request_first;
+    window_received = 0;
+
     timelast_request_ms = AP_HAL::millis();
     link->send_message(next_item_ap_message_id());
 
@@ -269,7 +278,18 @@ void MissionItemProtocol::handle_mission_item(const mavlink_message_t &msg, cons
     }
 
     // check if this is the requested waypoint
-    if (cmd.seq != request_i) {
+    if (request_window > 1) {
+        const uint16_t ofs = cmd.seq - request_i;
+        if (cmd.seq < request_i ||
+            (ofs < request_window && (window_received & (1UL<<ofs)))) {
+            // a duplicate, probably answering a request we repeated
+            return;
+        }
+        if (ofs >= request_window || cmd.seq > request_last) {
+            send_mission_ack(msg, MAV_MISSION_INVALID_SEQUENCE);
+            return;
+        }
+    } else if (cmd.seq != request_i) {
         send_mission_ack(msg, MAV_MISSION_INVALID_SEQUENCE);
         return;
     }
@@ -286,7 +306,10 @@ void MissionItemProtocol::handle_mission_item(const mavlink_message_t &msg, cons
     const uint16_t _item_count = item_count();
 
     MAV_MISSION_RESULT result;
-    if (cmd.seq < _item_count) {
+    if (items_staged()) {
+        // stored when the transfer is complete
+        result = stage_item(cmd);
+    } else if (cmd.seq < _item_count) {
         // command index is within the existing list, replace the command
         result = replace_item(cmd);
     } else if (cmd.seq == _item_count) {
@@ -306,7 +329,15 @@ void MissionItemProtocol::handle_mission_item(const mavlink_message_t &msg, cons
 
     // update waypoint receiving state machine
     timelast_receive_ms = AP_HAL::millis();
-    request_i++;
+    if (request_window > 1) {
+        window_received |= 1UL << (cmd.seq - request_i);
+        while (window_received & 1U) {
+            window_received >>= 1;
+            request_i++;
+        }
+    } else {
+        request_i++;
+    }
 
     if (request_i > request_last) {
         transfer_is_complete(*link, msg);
@@ -366,6 +397,30 @@ void MissionItemProtocol::queued_request_send()
         INTERNAL_ERROR(AP_InternalError::error_t::gcs_bad_missionprotocol_link);
         return;
     }
+    if (request_window > 1) {
+        // keep up to request_window requests outstanding.  If we run
+        // out of space the rest go out as more items arrive
+        if (request_next < request_i) {
+            request_next = request_i;
+        }
+        const uint32_t window_end = MIN(uint32_t(request_i) + request_window, uint32_t(request_last) + 1U);
+        while (request_next < window_end) {
+            if (window_received & (1UL << (request_next - request_i))) {
+                request_next++;
+                continue;
+            }
+            CHECK_PAYLOAD_SIZE2_VOID(link->get_chan(), MISSION_REQUEST);
+            mavlink_msg_mission_request_send(
+                link->get_chan(),
+                dest_sysid,
+                dest_compid,
+                request_next,
+                mission_type());
+            request_next++;
+            timelast_request_ms = AP_HAL::millis();
+        }
+        return;
+    }
     CHECK_PAYLOAD_SIZE2_VOID(link->get_chan(), MISSION_REQUEST);
     mavlink_msg_mission_request_send(
         link->get_chan(),
@@ -407,6 +462,8 @@ void MissionItemProtocol::update()
     const uint32_t wp_recv_timeout_ms = 1000U + link->get_stream_slowdown_ms();
     if (tnow - timelast_request_ms > wp_recv_timeout_ms) {
         timelast_request_ms = tnow;
+        // ask again for anything in the window we haven't got
+        request_next = request_i;
         link->send_message(next_item_ap_message_id());
     }
 }
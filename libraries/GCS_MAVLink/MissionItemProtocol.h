@@ -21,6 +21,11 @@
 // Starting of uploads (for the same protocol) is also blocked -
 // essentially the GCS uploading a set of items (e.g. a mission) has a
 // mutex over the mission.
+//
+// Backends which stage items and only store them once the transfer
+// is complete can accept items in any order.  On links with the
+// MISSION_UPLOAD_WINDOW option those uploads keep several requests
+// outstanding at once rather than waiting a round trip per item.
 class MissionItemProtocol
 {
 public:
@@ -77,6 +82,14 @@ protected:
 
     uint16_t        request_last; // last request index
 
+    // backends which can take items in any order during an upload
+    // return true here, and are given them through stage_item()
+    // rather than replace_item() and append_item()
+    virtual bool items_staged() const { return false; }
+    virtual MAV_MISSION_RESULT stage_item(const mavlink_mission_item_int_t &mission_item_int) WARN_IF_UNUSED {
+        return MAV_MISSION_UNSUPPORTED;
+    }
+
 private:
 
     // returns true if we are either not receiving, or we successfully
@@ -87,6 +100,14 @@ private:
 
     uint16_t        request_i; // request index
 
+    // number of requests we may have outstanding.  Items from
+    // request_i onwards which have arrived are recorded in
+    // window_received, bit 0 being request_i
+    static const uint8_t upload_window = 16;
+    uint8_t         request_window = 1;
+    uint16_t        request_next;   // next index to request when windowed
+    uint32_t        window_received;
+
     // waypoints
     uint8_t         dest_sysid;  // where to send requests
     uint8_t         dest_compid; // "
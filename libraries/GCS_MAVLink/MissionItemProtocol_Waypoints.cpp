@@ -28,21 +28,35 @@
 
 #include "GCS.h"
 
-MAV_MISSION_RESULT MissionItemProtocol_Waypoints::append_item(const mavlink_mission_item_int_t &mission_item_int)
-{
-    // sanity check for DO_JUMP command
-    AP_Mission::Mission_Command cmd {};
+extern const AP_HAL::HAL& hal;
 
+MAV_MISSION_RESULT MissionItemProtocol_Waypoints::convert_item(const mavlink_mission_item_int_t &mission_item_int, AP_Mission::Mission_Command &cmd) const
+{
     const MAV_MISSION_RESULT res = AP_Mission::mavlink_int_to_mission_cmd(mission_item_int, cmd);
     if (res != MAV_MISSION_ACCEPTED) {
         return res;
     }
 
+    // sanity check for DO_JUMP command
     if (cmd.id == MAV_CMD_DO_JUMP) {
-        if ((cmd.content.jump.target >= item_count() && cmd.content.jump.target > request_last) || cmd.content.jump.target == 0) {
+        // a staged upload replaces the whole mission, so only its own
+        // items can be targets
+        const uint16_t count = items_staged() ? 0 : item_count();
+        if ((cmd.content.jump.target >= count && cmd.content.jump.target > request_last) || cmd.content.jump.target == 0) {
             return MAV_MISSION_ERROR;
         }
     }
+    return MAV_MISSION_ACCEPTED;
+}
+
+MAV_MISSION_RESULT MissionItemProtocol_Waypoints::append_item(const mavlink_mission_item_int_t &mission_item_int)
+{
+    AP_Mission::Mission_Command cmd {};
+
+    const MAV_MISSION_RESULT res = convert_item(mission_item_int, cmd);
+    if (res != MAV_MISSION_ACCEPTED) {
+        return res;
+    }
 
     if (!mission.add_cmd(cmd)) {
         return MAV_MISSION_ERROR;
@@ -57,6 +71,12 @@ bool MissionItemProtocol_Waypoints::clear_all_items()
 
 MAV_MISSION_RESULT MissionItemProtocol_Waypoints::complete(const GCS_MAVLINK &_link)
 {
+#if AP_MAVLINK_MISSION_UPLOAD_STAGING_ENABLED
+    if (staged_records != nullptr &&
+        !mission.replace_all_cmds(staged_records, staged_count)) {
+        return MAV_MISSION_ERROR;
+    }
+#endif
     _link.send_text(MAV_SEVERITY_INFO, "Flight plan received");
 #if HAL_LOGGING_ENABLED
     AP::logger().Write_EntireMission();
@@ -103,17 +123,11 @@ MAV_MISSION_RESULT MissionItemProtocol_Waypoints::replace_item(const mavlink_mis
 {
     AP_Mission::Mission_Command cmd {};
 
-    const MAV_MISSION_RESULT res = AP_Mission::mavlink_int_to_mission_cmd(mission_item_int, cmd);
+    const MAV_MISSION_RESULT res = convert_item(mission_item_int, cmd);
     if (res != MAV_MISSION_ACCEPTED) {
         return res;
     }
 
-    // sanity check for DO_JUMP command
-    if (cmd.id == MAV_CMD_DO_JUMP) {
-        if ((cmd.content.jump.target >= item_count() && cmd.content.jump.target > request_last) || cmd.content.jump.target == 0) {
-            return MAV_MISSION_ERROR;
-        }
-    }
     if (!mission.replace_cmd(cmd.index, cmd)) {
         return MAV_MISSION_ERROR;
     }
@@ -127,8 +141,54 @@ void MissionItemProtocol_Waypoints::timeout()
 
 void MissionItemProtocol_Waypoints::truncate(const mavlink_mission_count_t &packet)
 {
+#if AP_MAVLINK_MISSION_UPLOAD_STAGING_ENABLED
+    if (staged_records != nullptr) {
+        // the current mission stays as it is until the new one is complete
+        return;
+    }
+#endif
     // new mission arriving, truncate mission to be the same length
     mission.truncate(packet.count);
 }
 
+#if AP_MAVLINK_MISSION_UPLOAD_STAGING_ENABLED
+MAV_MISSION_RESULT MissionItemProtocol_Waypoints::allocate_receive_resources(const uint16_t count)
+{
+    if (count == 0) {
+        return MAV_MISSION_ACCEPTED;
+    }
+    // if there isn't the memory to stage the upload then items are
+    // stored as they arrive. Leave plenty for everything else
+    const uint32_t size = uint32_t(count) * AP_MISSION_EEPROM_COMMAND_SIZE;
+    if (size > hal.util->available_memory() / 2) {
+        return MAV_MISSION_ACCEPTED;
+    }
+    staged_records = NEW_NOTHROW uint8_t[size];
+    staged_count = (staged_records != nullptr) ? count : 0;
+    return MAV_MISSION_ACCEPTED;
+}
+
+void MissionItemProtocol_Waypoints::free_upload_resources()
+{
+    delete[] staged_records;
+    staged_records = nullptr;
+    staged_count = 0;
+}
+
+MAV_MISSION_RESULT MissionItemProtocol_Waypoints::stage_item(const mavlink_mission_item_int_t &mission_item_int)
+{
+    AP_Mission::Mission_Command cmd {};
+
+    const MAV_MISSION_RESULT res = convert_item(mission_item_int, cmd);
+    if (res != MAV_MISSION_ACCEPTED) {
+        return res;
+    }
+    if (mission_item_int.seq >= staged_count) {
+        return MAV_MISSION_ERROR;
+    }
+    AP_Mission::cmd_to_record(cmd, &staged_records[uint32_t(mission_item_int.seq) * AP_MISSION_EEPROM_COMMAND_SIZE]);
+    return MAV_MISSION_ACCEPTED;
+}
+#endif  // AP_MAVLINK_MISSION_UPLOAD_STAGING_ENABLED
+
 #endif  // HAL_GCS_ENABLED && AP_MISSION_ENABLED
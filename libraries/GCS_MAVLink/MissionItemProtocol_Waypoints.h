@@ -38,9 +38,28 @@ protected:
         return MSG_NEXT_MISSION_REQUEST_WAYPOINTS;
     }
 
+#if AP_MAVLINK_MISSION_UPLOAD_STAGING_ENABLED
+    // a whole mission upload is staged in RAM and only replaces the
+    // stored mission once every item has arrived
+    bool items_staged() const override { return staged_records != nullptr; }
+    MAV_MISSION_RESULT stage_item(const mavlink_mission_item_int_t &) override WARN_IF_UNUSED;
+#endif
+
 private:
     AP_Mission &mission;
 
+    // convert an item and sanity check it against the mission being uploaded
+    MAV_MISSION_RESULT convert_item(const mavlink_mission_item_int_t &mission_item_int, AP_Mission::Mission_Command &cmd) const WARN_IF_UNUSED;
+
+#if AP_MAVLINK_MISSION_UPLOAD_STAGING_ENABLED
+    // storage records for the mission being uploaded
+    uint8_t *staged_records = nullptr;
+    uint16_t staged_count;
+
+    MAV_MISSION_RESULT allocate_receive_resources(const uint16_t count) override WARN_IF_UNUSED;
+    void free_upload_resources() override;
+#endif
+
     // append_item() is called by the base class to add the supplied
     // item to the end of the list of stored items.
     MAV_MISSION_RESULT append_item(const mavlink_mission_item_int_t &) override WARN_IF_UNUSED;
@@ -80,6 +80,8 @@ JSON::JSON(const char *frame_str) :
             }
         }
     }
+
+    build_key_index();
 }
 
 /*
@@ -98,6 +100,19 @@ void JSON::set_interface_ports(const char* address, const int port_in, const int
     printf("JSON control interface set to %s:%u\n", target_ip, control_port);
 }
 
+/*
+    fill in the common fields of a servo packet
+*/
+template <typename T>
+static void fill_servo_packet(T &pkt, uint16_t frame_rate, uint32_t frame_count, const struct sitl_input &input)
+{
+    pkt.frame_rate = frame_rate;
+    pkt.frame_count = frame_count;
+    for (uint8_t i=0; i<ARRAY_SIZE(pkt.pwm); i++) {
+        pkt.pwm[i] = input.servos[i];
+    }
+}
+
 /*
     Decode and send servos
 */
@@ -106,23 +121,31 @@ void JSON::output_servos(const struct sitl_input &input)
     size_t pkt_size = 0;
     ssize_t send_ret = -1;
     if (SRV_Channels::have_32_channels()) {
-      servo_packet_32 pkt;
-      pkt.frame_rate = rate_hz;
-      pkt.frame_count = frame_counter;
-      for (uint8_t i=0; i<32; i++) {
-          pkt.pwm[i] = input.servos[i];
+      if (binary_frames) {
+          servo_packet_32_caps pkt;
+          fill_servo_packet(pkt, rate_hz, frame_counter, input);
+          pkt.capabilities = CAP_BINARY_SENSORS;
+          pkt_size = sizeof(pkt);
+          send_ret = sock.sendto(&pkt, pkt_size, target_ip, control_port);
+      } else {
+          servo_packet_32 pkt;
+          fill_servo_packet(pkt, rate_hz, frame_counter, input);
+          pkt_size = sizeof(pkt);
+          send_ret = sock.sendto(&pkt, pkt_size, target_ip, control_port);
       }
-      pkt_size = sizeof(pkt);
-      send_ret = sock.sendto(&pkt, pkt_size, target_ip, control_port);
     } else {
-      servo_packet_16 pkt;
-      pkt.frame_rate = rate_hz;
-      pkt.frame_count = frame_counter;
-      for (uint8_t i=0; i<16; i++) {
-          pkt.pwm[i] = input.servos[i];
+      if (binary_frames) {
+          servo_packet_16_caps pkt;
+          fill_servo_packet(pkt, rate_hz, frame_counter, input);
+          pkt.capabilities = CAP_BINARY_SENSORS;
+          pkt_size = sizeof(pkt);
+          send_ret = sock.sendto(&pkt, pkt_size, target_ip, control_port);
+      } else {
+          servo_packet_16 pkt;
+          fill_servo_packet(pkt, rate_hz, frame_counter, input);
+          pkt_size = sizeof(pkt);
+          send_ret = sock.sendto(&pkt, pkt_size, target_ip, control_port);
       }
-      pkt_size = sizeof(pkt);
-      send_ret = sock.sendto(&pkt, pkt_size, target_ip, control_port);
     }
 
     if ((size_t)send_ret != pkt_size) {
@@ -136,100 +159,288 @@ void JSON::output_servos(const struct sitl_input &input)
 }
 
 
+/*
+    FNV-1a hash of section/key
+*/
+uint32_t JSON::key_hash(const char *section, uint8_t section_len, const char *key, uint8_t key_len)
+{
+    uint32_t h = 2166136261U;
+    for (uint8_t i=0; i<section_len; i++) {
+        h = (h ^ uint8_t(section[i])) * 16777619U;
+    }
+    h = (h ^ uint8_t('/')) * 16777619U;
+    for (uint8_t i=0; i<key_len; i++) {
+        h = (h ^ uint8_t(key[i])) * 16777619U;
+    }
+    return h;
+}
+
+/*
+    build the index used to look up keys while parsing
+*/
+void JSON::build_key_index(void)
+{
+    memset(key_index, -1, sizeof(key_index));
+    for (uint8_t i=0; i<ARRAY_SIZE(keytable); i++) {
+        const struct keytable &key = keytable[i];
+        const uint32_t h = key_hash(key.section, strlen(key.section), key.key, strlen(key.key));
+        keytable_hash[i] = h;
+        uint8_t slot = h % key_index_size;
+        while (key_index[slot] != -1) {
+            slot = (slot + 1) % key_index_size;
+        }
+        key_index[slot] = i;
+    }
+}
+
+/*
+    return the keytable index for a section and key, or -1
+*/
+int8_t JSON::find_key(const char *section, uint8_t section_len, const char *key, uint8_t key_len) const
+{
+    const uint32_t h = key_hash(section, section_len, key, key_len);
+    for (uint8_t n=0, slot=h % key_index_size; n<key_index_size; n++, slot=(slot + 1) % key_index_size) {
+        const int8_t i = key_index[slot];
+        if (i == -1) {
+            return -1;
+        }
+        const struct keytable &k = keytable[i];
+        if (keytable_hash[i] == h &&
+            strlen(k.section) == section_len && strncmp(k.section, section, section_len) == 0 &&
+            strlen(k.key) == key_len && strncmp(k.key, key, key_len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static const char *skip_space(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r') {
+        p++;
+    }
+    return p;
+}
+
+/*
+    parse a [a, b, ...] array of n numbers, returning a pointer after
+    the closing bracket or nullptr on error
+*/
+static const char *parse_array(const char *p, double *v, uint8_t n)
+{
+    if (*p != '[') {
+        return nullptr;
+    }
+    p++;
+    for (uint8_t i=0; i<n; i++) {
+        char *end;
+        v[i] = strtod(p, &end);
+        if (end == p) {
+            return nullptr;
+        }
+        p = skip_space(end);
+        if (i < n-1) {
+            if (*p != ',') {
+                return nullptr;
+            }
+            p++;
+        }
+    }
+    if (*p != ']') {
+        return nullptr;
+    }
+    return p+1;
+}
+
 /*
     very simple JSON parser for sensor data
     called with pointer to one row of sensor data, nul terminated
 
+    The text is scanned once. Each key is looked up in the keytable
+    by the hash of its section and name, and the value parsed in
+    place. Values of keys we don't know contain no quotes or braces
+    we care about, so they are skipped by the scan.
+
     This parser does not do any syntax checking, and is not at all
     general purpose
 */
 uint32_t JSON::parse_sensors(const char *json)
 {
     uint32_t received_bitmask = 0;
+    const char *section = "";
+    uint8_t section_len = 0;
+    uint8_t depth = 0;
 
     //printf("%s\n", json);
-    for (uint16_t i=0; i<ARRAY_SIZE(keytable); i++) {
-        struct keytable &key = keytable[i];
-
-        /* look for section header */
-        const char *p = strstr(json, key.section);
-        if (!p) {
-            // we don't have this sensor
-            if (key.required) {
-                printf("Failed to find %s\n", key.section);
-                return 0;
+    const char *p = json;
+    while (*p) {
+        if (*p == '{') {
+            depth++;
+            p++;
+            continue;
+        }
+        if (*p == '}') {
+            if (depth > 0) {
+                depth--;
+            }
+            if (depth <= 1) {
+                // left a section
+                section_len = 0;
             }
+            p++;
+            continue;
+        }
+        if (*p != '"') {
+            p++;
+            continue;
+        }
+
+        // a string, which is a key if followed by a colon
+        const char *name = p+1;
+        const char *name_end = strchr(name, '"');
+        if (name_end == nullptr) {
+            break;
+        }
+        p = skip_space(name_end+1);
+        if (*p != ':') {
             continue;
         }
-        p += strlen(key.section)+1;
-
-        // find key inside section
-        p = strstr(p, key.key);
-        if (!p) {
-            if (key.required) {
-                printf("Failed to find key %s/%s\n", key.section, key.key);
-                return 0;
+        p = skip_space(p+1);
+        const uint8_t name_len = MIN(name_end - name, 255);
+        if (*p == '{') {
+            // start of a section
+            if (depth == 1) {
+                section = name;
+                section_len = name_len;
             }
             continue;
         }
 
-        // record the keys that are found
-        received_bitmask |= 1U << i;
+        const int8_t i = find_key(section, section_len, name, name_len);
+        if (i < 0) {
+            continue;
+        }
+        struct keytable &key = keytable[i];
 
-        p += strlen(key.key)+2;
+        double v[4];
+        const char *end = p;
         switch (key.type) {
             case DATA_UINT64:
-                *((uint64_t *)key.ptr) = strtoull(p, nullptr, 10);
-                //printf("%s/%s = %lu\n", key.section, key.key, *((uint64_t *)key.ptr));
+                *((uint64_t *)key.ptr) = strtoull(p, (char **)&end, 10);
                 break;
 
             case DATA_FLOAT:
-                *((float *)key.ptr) = atof(p);
-                //printf("%s/%s = %f\n", key.section, key.key, *((float *)key.ptr));
+                *((float *)key.ptr) = strtod(p, (char **)&end);
                 break;
 
             case DATA_DOUBLE:
-                *((double *)key.ptr) = atof(p);
-                //printf("%s/%s = %f\n", key.section, key.key, *((double *)key.ptr));
+                *((double *)key.ptr) = strtod(p, (char **)&end);
                 break;
 
             case DATA_VECTOR3F: {
-                Vector3f *v = (Vector3f *)key.ptr;
-                if (sscanf(p, "[%f, %f, %f]", &v->x, &v->y, &v->z) != 3) {
+                end = parse_array(p, v, 3);
+                if (end == nullptr) {
                     printf("Failed to parse Vector3f for %s/%s\n", key.section, key.key);
                     return received_bitmask;
                 }
-                //printf("%s/%s = %f, %f, %f\n", key.section, key.key, v->x, v->y, v->z);
+                *((Vector3f *)key.ptr) = Vector3f(v[0], v[1], v[2]);
                 break;
             }
 
             case DATA_VECTOR3D: {
-                Vector3d *v = (Vector3d *)key.ptr;
-                if (sscanf(p, "[%lf, %lf, %lf]", &v->x, &v->y, &v->z) != 3) {
+                end = parse_array(p, v, 3);
+                if (end == nullptr) {
                     printf("Failed to parse Vector3f for %s/%s\n", key.section, key.key);
                     return received_bitmask;
                 }
-                //printf("%s/%s = %f, %f, %f\n", key.section, key.key, v->x, v->y, v->z);
+                *((Vector3d *)key.ptr) = Vector3d(v[0], v[1], v[2]);
                 break;
             }
 
             case QUATERNION: {
-                Quaternion *v = static_cast<Quaternion*>(key.ptr);
-                if (sscanf(p, "[%f, %f, %f, %f]", &(v->q1), &(v->q2), &(v->q3), &(v->q4)) != 4) {
+                end = parse_array(p, v, 4);
+                if (end == nullptr) {
                     printf("Failed to parse Vector4f for %s/%s\n", key.section, key.key);
                     return received_bitmask;
                 }
+                Quaternion *q = static_cast<Quaternion*>(key.ptr);
+                q->q1 = v[0];
+                q->q2 = v[1];
+                q->q3 = v[2];
+                q->q4 = v[3];
                 break;
             }
 
             case BOOLEAN:
-                *((bool *)key.ptr) = strtoull(p, nullptr, 10) != 0;
-                //printf("%s/%s = %i\n", key.section, key.key, *((unit8_t *)key.ptr));
+                if (strncmp(p, "true", 4) == 0) {
+                    *((bool *)key.ptr) = true;
+                    end = p + 4;
+                } else if (strncmp(p, "false", 5) == 0) {
+                    *((bool *)key.ptr) = false;
+                    end = p + 5;
+                } else {
+                    *((bool *)key.ptr) = strtoull(p, (char **)&end, 10) != 0;
+                }
                 break;
+        }
+
+        // record the keys that are found
+        received_bitmask |= 1U << i;
+        p = end;
+    }
+
+    if (!check_required(received_bitmask)) {
+        return 0;
+    }
+    return received_bitmask;
+}
 
+/*
+    true if all the required keys were received
+*/
+bool JSON::check_required(uint32_t received_bitmask) const
+{
+    for (uint8_t i=0; i<ARRAY_SIZE(keytable); i++) {
+        const struct keytable &key = keytable[i];
+        if (key.required && (received_bitmask & (1U << i)) == 0) {
+            printf("Failed to find key %s/%s\n", key.section, key.key);
+            return false;
         }
     }
+    return true;
+}
 
+/*
+    unpack a binary sensor frame
+*/
+uint32_t JSON::parse_binary(const sensor_packet_binary &pkt)
+{
+    if (pkt.version != binary_version) {
+        printf("Unsupported binary sensor frame version %u\n", unsigned(pkt.version));
+        return 0;
+    }
+    // binary_frames is only meaningful in JSON text
+    const uint32_t received_bitmask = pkt.present & ((1U << ARRAY_SIZE(keytable)) - 1) & ~BINARY_FRAMES;
+    if (!check_required(received_bitmask)) {
+        return 0;
+    }
+    state.timestamp_s = pkt.timestamp;
+    state.imu.gyro = Vector3f(pkt.gyro[0], pkt.gyro[1], pkt.gyro[2]);
+    state.imu.accel_body = Vector3f(pkt.accel_body[0], pkt.accel_body[1], pkt.accel_body[2]);
+    state.position = Vector3d(pkt.position[0], pkt.position[1], pkt.position[2]);
+    state.attitude = Vector3f(pkt.attitude[0], pkt.attitude[1], pkt.attitude[2]);
+    state.quaternion.q1 = pkt.quaternion[0];
+    state.quaternion.q2 = pkt.quaternion[1];
+    state.quaternion.q3 = pkt.quaternion[2];
+    state.quaternion.q4 = pkt.quaternion[3];
+    state.velocity = Vector3f(pkt.velocity[0], pkt.velocity[1], pkt.velocity[2]);
+    for (uint8_t i=0; i<ARRAY_SIZE(state.rng); i++) {
+        state.rng[i] = pkt.rng[i];
+    }
+    state.wind_vane_apparent.direction = pkt.windvane_direction;
+    state.wind_vane_apparent.speed = pkt.windvane_speed;
+    state.airspeed = pkt.airspeed;
+    state.no_time_sync = pkt.no_time_sync != 0;
     return received_bitmask;
 }
 
@@ -254,23 +465,46 @@ void JSON::recv_fdm(const struct sitl_input &input)
         }
     }
 
-    // convert '\n' into nul
-    while (uint8_t *p = (uint8_t *)memchr(&sensor_buffer[sensor_buffer_len], '\n', ret)) {
-        *p = 0;
-    }
-    sensor_buffer_len += ret;
+    uint32_t received_bitmask;
+    const uint8_t *p2 = nullptr;
+    sensor_packet_binary pkt;
+    if (sensor_buffer_len == 0 && size_t(ret) == sizeof(pkt) &&
+        UINT16_VALUE(sensor_buffer[1], sensor_buffer[0]) == binary_magic) {
+        // a whole binary frame, there is no text to keep
+        if (!binary_frames) {
+            // the backend must ask first, so it knows we understand
+            // the frame before relying on it
+            if (!binary_rejected) {
+                printf("Ignoring binary sensor frames, send binary_frames in a JSON frame first\n");
+                binary_rejected = true;
+            }
+            return;
+        }
+        memcpy(&pkt, sensor_buffer, sizeof(pkt));
+        received_bitmask = parse_binary(pkt);
+    } else {
+        // convert '\n' into nul
+        while (uint8_t *p = (uint8_t *)memchr(&sensor_buffer[sensor_buffer_len], '\n', ret)) {
+            *p = 0;
+        }
+        sensor_buffer_len += ret;
 
-    const uint8_t *p2 = (const uint8_t *)memrchr(sensor_buffer, 0, sensor_buffer_len);
-    if (p2 == nullptr || p2 == sensor_buffer) {
-        return;
-    }
+        p2 = (const uint8_t *)memrchr(sensor_buffer, 0, sensor_buffer_len);
+        if (p2 == nullptr || p2 == sensor_buffer) {
+            return;
+        }
 
-    const uint8_t *p1 = (const uint8_t *)memrchr(sensor_buffer, 0, p2 - sensor_buffer);
-    if (p1 == nullptr) {
-        return;
-    }
+        const uint8_t *p1 = (const uint8_t *)memrchr(sensor_buffer, 0, p2 - sensor_buffer);
+        if (p1 == nullptr) {
+            return;
+        }
 
-    const uint32_t received_bitmask = parse_sensors((const char *)(p1+1));
+        received_bitmask = parse_sensors((const char *)(p1+1));
+        if (received_bitmask != 0 && (received_bitmask & BINARY_FRAMES) == 0) {
+            // a restarted backend may not know about binary frames
+            binary_frames = false;
+        }
+    }
     if (received_bitmask == 0) {
         // did not receive one of the mandatory fields
         printf("Did not contain all mandatory fields\n");
@@ -301,8 +535,10 @@ void JSON::recv_fdm(const struct sitl_input &input)
     }
     last_received_bitmask = received_bitmask;
 
-    memmove(sensor_buffer, p2, sensor_buffer_len - (p2 - sensor_buffer));
-    sensor_buffer_len = sensor_buffer_len - (p2 - sensor_buffer);
+    if (p2 != nullptr) {
+        memmove(sensor_buffer, p2, sensor_buffer_len - (p2 - sensor_buffer));
+        sensor_buffer_len = sensor_buffer_len - (p2 - sensor_buffer);
+    }
 
     accel_body = state.imu.accel_body;
     gyro = state.imu.gyro;
@@ -54,6 +54,32 @@ private:
         uint16_t pwm[32];
     };
 
+    /*
+      servo packets with a capability word, only sent to a backend
+      which has asked for them by sending binary_frames in a JSON
+      frame, so older backends never see them
+     */
+    struct PACKED servo_packet_16_caps {
+        uint16_t magic = 18459; // constant magic value
+        uint16_t frame_rate;
+        uint32_t frame_count;
+        uint16_t pwm[16];
+        uint32_t capabilities;
+    };
+
+    struct PACKED servo_packet_32_caps {
+        uint16_t magic = 29570; // constant magic value
+        uint16_t frame_rate;
+        uint32_t frame_count;
+        uint16_t pwm[32];
+        uint32_t capabilities;
+    };
+
+    enum ServoCapability {
+        // binary sensor frames are accepted
+        CAP_BINARY_SENSORS = 1U << 0,
+    };
+
     // default connection_info_.ip_address
     const char *target_ip = "127.0.0.1";
 
@@ -65,10 +91,49 @@ private:
     uint32_t frame_counter;
     double last_timestamp_s;
 
+    // set when the backend asks for binary sensor frames
+    bool binary_frames;
+    bool binary_rejected;
+
+    /*
+      compact binary alternative to the JSON sensor frame. A physics
+      backend may send these instead of JSON text once it has seen
+      CAP_BINARY_SENSORS in a servo packet, each datagram is
+      recognised by its magic value. present is a bitmask of DataKey
+      values giving the fields that are valid
+     */
+    struct PACKED sensor_packet_binary {
+        uint16_t magic;         // 0x4A42 "JB"
+        uint16_t version;       // 1
+        uint32_t present;
+        double timestamp;
+        float gyro[3];
+        float accel_body[3];
+        double position[3];
+        float attitude[3];
+        float quaternion[4];
+        float velocity[3];
+        float rng[6];
+        float windvane_direction;
+        float windvane_speed;
+        float airspeed;
+        uint8_t no_time_sync;
+    };
+    static_assert(sizeof(sensor_packet_binary) == 141, "binary sensor frame size");
+    static const uint16_t binary_magic = 0x4A42;
+    static const uint16_t binary_version = 1;
+
     void output_servos(const struct sitl_input &input);
     void recv_fdm(const struct sitl_input &input);
 
     uint32_t parse_sensors(const char *json);
+    uint32_t parse_binary(const sensor_packet_binary &pkt);
+    bool check_required(uint32_t received_bitmask) const;
+
+    // hash of a section and key name, as used by the key index
+    static uint32_t key_hash(const char *section, uint8_t section_len, const char *key, uint8_t key_len);
+    int8_t find_key(const char *section, uint8_t section_len, const char *key, uint8_t key_len) const;
+    void build_key_index(void);
 
     // buffer for parsing pose data in JSON format
     uint8_t sensor_buffer[65000];
@@ -110,7 +175,7 @@ private:
         void *ptr;
         enum data_type type;
         bool required;
-    } keytable[17] = {
+    } keytable[18] = {
         { "", "timestamp", &state.timestamp_s, DATA_DOUBLE, true },
         { "imu", "gyro",    &state.imu.gyro, DATA_VECTOR3F, true },
         { "imu", "accel_body", &state.imu.accel_body, DATA_VECTOR3F, true },
@@ -128,6 +193,7 @@ private:
         {"windvane","speed", &state.wind_vane_apparent.speed, DATA_FLOAT, false},
         {"", "airspeed", &state.airspeed, DATA_FLOAT, false},
         {"", "no_time_sync", &state.no_time_sync, BOOLEAN, false},
+        {"", "binary_frames", &binary_frames, BOOLEAN, false},
     };
 
     // Enum coresponding to the ordering of keys in the keytable.
@@ -149,8 +215,14 @@ private:
         WIND_SPD    = 1U << 14,
         AIRSPEED    = 1U << 15,
         TIME_SYNC   = 1U << 16,
+        BINARY_FRAMES = 1U << 17,
     };
     uint32_t last_received_bitmask;
+
+    // open addressed index from key hash to keytable entry, -1 if empty
+    static const uint8_t key_index_size = 64;
+    int8_t key_index[key_index_size];
+    uint32_t keytable_hash[ARRAY_SIZE(keytable)];
 };
 
 }
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+
+# flake8: noqa
+
+'''
+ minimal JSON physics backend for measuring the lockstep frame rate
+ a vehicle sits still on the ground and every servo packet is answered
+ at once, so the frame rate is limited by SITL and the sensor format
+
+ ./benchmark.py            JSON text sensor frames
+ ./benchmark.py --binary   binary sensor frames, once SITL has
+                           advertised support in its servo packets
+'''
+
+import json
+import socket
+import struct
+import time
+
+from argparse import ArgumentParser
+parser = ArgumentParser(description='JSON SITL frame rate benchmark')
+parser.add_argument("--binary", action='store_true', help="send binary sensor frames")
+parser.add_argument("--port", default=9002, type=int, help="port to listen for servo packets on")
+parser.add_argument("--rngs", default=6, type=int, help="number of rangefinders to send, to make the frames larger")
+parser.add_argument("--period", default=5.0, type=float, help="seconds between reports")
+args = parser.parse_args()
+
+SERVO_FORMATS = {
+    18458: 'HHI16H',
+    29569: 'HHI32H',
+}
+# servo packets with a capability word, sent once we ask for binary frames
+SERVO_CAPS_FORMATS = {
+    18459: '<HHI16HI',
+    29570: '<HHI32HI',
+}
+CAP_BINARY_SENSORS = 1 << 0
+
+BINARY_MAGIC = 0x4A42
+BINARY_VERSION = 1
+BINARY_FORMAT = '<HHId3f3f3d3f4f3f6f3fB'
+
+# present bits, in keytable order
+TIMESTAMP = 1 << 0
+GYRO = 1 << 1
+ACCEL_BODY = 1 << 2
+POSITION = 1 << 3
+QUAT_ATT = 1 << 5
+VELOCITY = 1 << 6
+RNG_1 = 1 << 7
+
+sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+sock.bind(('', args.port))
+
+def sensor_frame(timestamp, binary):
+    gyro = [0.0, 0.0, 0.0]
+    accel = [0.0, 0.0, -9.80665]
+    position = [0.0, 0.0, 0.0]
+    quaternion = [1.0, 0.0, 0.0, 0.0]
+    velocity = [0.0, 0.0, 0.0]
+    rng = [1.5] * args.rngs + [0.0] * (6 - args.rngs)
+
+    if binary:
+        present = TIMESTAMP | GYRO | ACCEL_BODY | POSITION | QUAT_ATT | VELOCITY
+        for i in range(args.rngs):
+            present |= RNG_1 << i
+        return struct.pack(BINARY_FORMAT, BINARY_MAGIC, BINARY_VERSION, present,
+                           timestamp, *gyro, *accel, *position, 0, 0, 0,
+                           *quaternion, *velocity, *rng, 0, 0, 0, 0)
+
+    frame = {
+        "timestamp": timestamp,
+        "imu": {
+            "gyro": gyro,
+            "accel_body": accel,
+        },
+        "position": position,
+        "quaternion": quaternion,
+        "velocity": velocity,
+    }
+    if args.binary:
+        # ask SITL to advertise binary frame support
+        frame["binary_frames"] = True
+    for i in range(args.rngs):
+        frame["rng_%u" % (i+1)] = rng[i]
+    return bytes("\n" + json.dumps(frame, separators=(',', ':')) + "\n", "ascii")
+
+print("Waiting for SITL on port %u, sending %s sensor frames" % (args.port, "binary" if args.binary else "JSON"))
+
+phys_time = 0.0
+last_frame_count = None
+frames = 0
+report_start = None
+frame_bytes = 0
+while True:
+    data, address = sock.recvfrom(100)
+    magic = struct.unpack('H', data[:2])[0]
+    fmt = SERVO_FORMATS.get(magic, SERVO_CAPS_FORMATS.get(magic))
+    if fmt is None or len(data) != struct.calcsize(fmt):
+        continue
+    decoded = struct.unpack(fmt, data)
+    # only send binary once this SITL has said it accepts it
+    binary = magic in SERVO_CAPS_FORMATS and (decoded[-1] & CAP_BINARY_SENSORS) != 0
+    frame_rate_hz = decoded[1]
+    frame_count = decoded[2]
+
+    if last_frame_count is not None and frame_count < last_frame_count:
+        print("SITL reset")
+        phys_time = 0.0
+    last_frame_count = frame_count
+
+    phys_time += 1.0 / frame_rate_hz
+    pkt = sensor_frame(phys_time, binary)
+    sock.sendto(pkt, address)
+    frame_bytes = len(pkt)
+
+    now = time.time()
+    if report_start is None:
+        report_start = now
+    frames += 1
+    if now - report_start >= args.period:
+        rate = frames / (now - report_start)
+        print("%.0f frames/s, %.2f x realtime at %uHz, %u byte frames" %
+              (rate, rate / frame_rate_hz, frame_rate_hz, frame_bytes))
+        frames = 0
+        report_start = now
@@ -487,6 +487,10 @@ void SRV_Channels::push()
 {
     hal.rcout->push();
 
+#if AP_SCHEDULER_LOOP_TRACE_ENABLED
+    AP::scheduler().loop_trace.mark(AP::LoopTrace::Point::RCOUT_PUSH);
+#endif
+
 #if AP_VOLZ_ENABLED
     // give volz library a chance to update
     volz.update();
@@ -337,6 +337,20 @@ bool StorageAccess::copy_area(const StorageAccess &source) const
     return true;
 }
 
+/*
+  the microSD file is flushed in 1k blocks in block order, so only the
+  HAL storage can keep write order
+ */
+bool StorageAccess::keeps_write_order(void) const
+{
+#if AP_SDCARD_STORAGE_ENABLED
+    if (file != nullptr) {
+        return false;
+    }
+#endif
+    return hal.storage->keeps_write_order();
+}
+
 #if AP_SDCARD_STORAGE_ENABLED
 /*
   attach a file to a storage region
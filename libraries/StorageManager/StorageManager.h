@@ -116,6 +116,10 @@ public:
     // copy from one storage area to another
     bool copy_area(const StorageAccess &source) const;
 
+    // true if writes to this area are persisted in the order they
+    // were made
+    bool keeps_write_order(void) const;
+
     // attach a storage file from microSD
     bool attach_file(const char *fname, uint16_t size_kbyte);
 